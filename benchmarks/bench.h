@@ -0,0 +1,129 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/*
+ * Shared definitions of the benchmark harness. The RRG and relay loops live in separate
+ * translation units because their public headers cannot be included together.
+ */
+
+#include <stdint.h>
+
+#include "emu_slave.h"
+#include "mb_arena.h"
+#include "mb_platform.h"
+#include "mb_stats.h"
+
+/**
+ * @def BENCH_INTERLOCK_MAX_TRIPS
+ * @brief Most faults raised per baud rate by the interlock loop (each takes a few sampling periods).
+ */
+#define BENCH_INTERLOCK_MAX_TRIPS 50
+
+/**
+ * @def BENCH_INTERLOCK_PERIOD_US
+ * @brief Sampling period of the acquisition watched by the interlock loop.
+ */
+#define BENCH_INTERLOCK_PERIOD_US 10000
+
+/**
+ * @def BENCH_INTERLOCK_FAULT_PERIOD_US
+ * @brief Sampling period of that acquisition while a fault is present.
+ */
+#define BENCH_INTERLOCK_FAULT_PERIOD_US 1000
+
+/**
+ * @struct BENCH_Options
+ * @brief Parameters shared by all benchmark loops.
+ */
+typedef struct
+{
+    int iterations;     ///< Calls made per operation and baud rate.
+    int timeout;        ///< Response timeout passed to `RRG_Init()` / `RELAY_Init()` (in milliseconds).
+    int rrg_slave_id;   ///< Address of the emulated regulator.
+    int relay_slave_id; ///< Address of the emulated relay.
+    MB_Arena *arena;    ///< Storage of the devices (`NULL`: the heap).
+} BENCH_Options;
+
+/**
+ * @struct BENCH_Result
+ * @brief Measurements of one operation at one baud rate.
+ */
+typedef struct
+{
+    const char *name;            ///< Name of the measured API call.
+    uint64_t ops;                ///< Calls made.
+    uint64_t errors;             ///< Calls that returned an error.
+    int64_t elapsed_ns;          ///< Wall time of the whole loop.
+    uint64_t allocations;        ///< Heap allocations made by the process during the loop.
+    MB_LatencyHistogram latency; ///< Duration of every call as seen by the caller.
+} BENCH_Result;
+
+/// @brief Accounts for one call that started at `start_ns`.
+static inline void _benchRecord(BENCH_Result *result, int64_t start_ns, int failed)
+{
+    _mbRecordLatency(&result->latency, _mbMonotonicNs() - start_ns);
+    ++result->ops;
+    if (failed)
+        ++result->errors;
+}
+
+/**
+ * @brief Returns the number of heap allocations the process made so far.
+ *
+ * Counted only with glibc, whose allocator the harness wraps; always 0 elsewhere.
+ */
+uint64_t BENCH_AllocationCount(void);
+
+/**
+ * @brief Runs the `RRG_SetFlow()` and `RRG_GetFlow()` loops.
+ *
+ * @param options Benchmark parameters.
+ * @param port Serial port of the emulated slaves.
+ * @param baudrate Baud rate of the line.
+ * @param results Array of two results (set, get) to fill.
+ * @return 0 on success, -1 if the regulator could not be opened.
+ */
+int BENCH_RunRrg(const BENCH_Options *options, const char *port, int baudrate, BENCH_Result *results);
+
+/**
+ * @brief Runs the `RELAY_TurnOn()` / `RELAY_TurnOff()` loop.
+ *
+ * @param options Benchmark parameters.
+ * @param port Serial port of the emulated slaves.
+ * @param baudrate Baud rate of the line.
+ * @param results Array of two results (on, off) to fill.
+ * @return 0 on success, -1 if the relay could not be opened.
+ */
+int BENCH_RunRelay(const BENCH_Options *options, const char *port, int baudrate, BENCH_Result *results);
+
+/**
+ * @brief Runs the interlock loop: raises a regulator fault on the emulator and times the relay shutoff.
+ *
+ * The fault is raised at varying phases of the sampling period. The first result is the time
+ * from raising it to the relay write reaching the emulator; the second is the latency the
+ * interlock itself recorded (from the read that saw the fault to the return of the action).
+ *
+ * @param options Benchmark parameters.
+ * @param slave Emulator serving the regulator and the relay.
+ * @param baudrate Baud rate of the line.
+ * @param results Array of two results (end to end, interlock) to fill.
+ * @return 0 on success, -1 if the devices could not be opened or the acquisition started.
+ */
+int BENCH_RunInterlock(const BENCH_Options *options, EMU_Slave *slave, int baudrate, BENCH_Result *results);
+
+/**
+ * @brief Opens the relay for the interlock loop.
+ * @return The relay handle, or `NULL` if it could not be opened.
+ */
+void *BENCH_OpenRelay(const BENCH_Options *options, const char *port, int baudrate);
+
+/// @brief Turns the relay of `BENCH_OpenRelay()` on. Returns 0 on success.
+int BENCH_RelayOn(void *relay);
+
+/// @brief Turns the relay of `BENCH_OpenRelay()` off (the interlock action). Returns 0 on success.
+int BENCH_RelayOff(void *relay);
+
+/// @brief Closes and frees the relay of `BENCH_OpenRelay()`.
+void BENCH_CloseRelay(void *relay);
+
+#endif // !BENCH_H
@@ -0,0 +1,39 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bench.h"
+
+/*
+ * Counts the heap allocations of the whole process by wrapping the allocator of glibc, which
+ * keeps its own entry points exported. Elsewhere nothing is counted and the count stays 0.
+ */
+
+static uint64_t g_allocations = 0;
+
+uint64_t BENCH_AllocationCount(void) { return __atomic_load_n(&g_allocations, __ATOMIC_RELAXED); }
+
+#ifdef __GLIBC__
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *block, size_t size);
+
+void *malloc(size_t size)
+{
+    __atomic_fetch_add(&g_allocations, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    __atomic_fetch_add(&g_allocations, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *block, size_t size)
+{
+    __atomic_fetch_add(&g_allocations, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(block, size);
+}
+
+#endif // __GLIBC__
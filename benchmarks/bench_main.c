@@ -0,0 +1,209 @@
+#define _DEFAULT_SOURCE
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "emu_slave.h"
+
+#define BENCH_MAX_BAUDRATES 16
+#define BENCH_DEFAULT_BAUDRATES "9600,19200,38400,57600,115200"
+#define BENCH_DEFAULT_ITERATIONS 200
+#define BENCH_DEFAULT_TIMEOUT_MS 100
+#define BENCH_DEFAULT_DELAY_US 500
+#define BENCH_DEFAULT_RRG_SLAVE_ID 1
+#define BENCH_DEFAULT_RELAY_SLAVE_ID 6
+#define BENCH_OPERATIONS 6
+#define BENCH_ARENA_SIZE (1 << 20)
+
+static volatile sig_atomic_t g_stop = 0;
+
+// Storage of the devices with `-a`, handed out again at every baud rate.
+static unsigned char g_arena_storage[BENCH_ARENA_SIZE];
+
+/**
+ * @brief Signal handler for `Ctrl+C` (SIGINT) in serve mode.
+ * @param sig Signal number.
+ */
+static void handle_sigint(int sig)
+{
+    (void)sig;
+    g_stop = 1;
+}
+
+static void print_usage(const char *program)
+{
+    printf("Usage: %s [options]\n"
+           "  -b RATES    Comma-separated baud rates (default " BENCH_DEFAULT_BAUDRATES ").\n"
+           "  -n COUNT    Calls per operation and baud rate (default %d).\n"
+           "  -d US       Slave processing delay in microseconds (default %d).\n"
+           "  -t MS       Response timeout in milliseconds (default %d).\n"
+           "  -D RATE     Probability of an unanswered request (0-1).\n"
+           "  -C RATE     Probability of a response with a bad CRC (0-1).\n"
+           "  -E RATE     Probability of an exception response (0-1).\n"
+           "  -x          Reject \"Write Multiple Registers\" (exercises the single-write fallback).\n"
+           "  -a          Open the devices on a static arena and fail if a loop allocates.\n"
+           "  -s          Only serve the emulated slaves at the first baud rate until Ctrl+C.\n",
+           program, BENCH_DEFAULT_ITERATIONS, BENCH_DEFAULT_DELAY_US, BENCH_DEFAULT_TIMEOUT_MS);
+}
+
+/**
+ * @brief Parses a comma-separated list of baud rates.
+ * @return The number of rates, or -1 on a malformed list.
+ */
+static int parse_baudrates(const char *list, int *baudrates)
+{
+    int count = 0;
+    const char *cursor = list;
+    while (*cursor)
+    {
+        char *end;
+        long value = strtol(cursor, &end, 10);
+        if (end == cursor || value <= 0 || count == BENCH_MAX_BAUDRATES || (*end && *end != ','))
+            return -1;
+        baudrates[count++] = (int)value;
+        cursor = *end ? end + 1 : end;
+    }
+    return count > 0 ? count : -1;
+}
+
+static void print_result(int baudrate, const BENCH_Result *result)
+{
+    double ops_per_s = result->elapsed_ns > 0 ? (double)result->ops * 1e9 / (double)result->elapsed_ns : 0.0;
+    double mean_us = result->ops ? (double)result->latency.total_us / (double)result->ops : 0.0;
+    printf("%8d  %-14s %8llu %9.1f %9.1f %8llu %8llu %8llu %8llu %7llu %7llu\n", baudrate, result->name,
+           (unsigned long long)result->ops, ops_per_s, mean_us,
+           (unsigned long long)MB_LatencyPercentileUs(&result->latency, 0.50),
+           (unsigned long long)MB_LatencyPercentileUs(&result->latency, 0.90),
+           (unsigned long long)MB_LatencyPercentileUs(&result->latency, 0.99),
+           (unsigned long long)MB_LatencyPercentileUs(&result->latency, 1.0), (unsigned long long)result->errors,
+           (unsigned long long)result->allocations);
+}
+
+int main(int argc, char **argv)
+{
+    // 1. Parse the command line.
+    int baudrates[BENCH_MAX_BAUDRATES];
+    int baudrate_count = parse_baudrates(BENCH_DEFAULT_BAUDRATES, baudrates);
+    BENCH_Options options = {BENCH_DEFAULT_ITERATIONS, BENCH_DEFAULT_TIMEOUT_MS, BENCH_DEFAULT_RRG_SLAVE_ID,
+                             BENCH_DEFAULT_RELAY_SLAVE_ID, NULL};
+    MB_Arena arena;
+    EMU_SlaveConfig emu_config;
+    memset(&emu_config, 0, sizeof(emu_config));
+    emu_config.response_delay_us = BENCH_DEFAULT_DELAY_US;
+    emu_config.rrg_slave_id = options.rrg_slave_id;
+    emu_config.relay_slave_id = options.relay_slave_id;
+    int serve = 0, opt;
+
+    while ((opt = getopt(argc, argv, "b:n:d:t:D:C:E:xash")) != -1)
+    {
+        switch (opt)
+        {
+        case 'b':
+            baudrate_count = parse_baudrates(optarg, baudrates);
+            break;
+        case 'n':
+            options.iterations = atoi(optarg);
+            break;
+        case 'd':
+            emu_config.response_delay_us = atoi(optarg);
+            break;
+        case 't':
+            options.timeout = atoi(optarg);
+            break;
+        case 'D':
+            emu_config.drop_rate = atof(optarg);
+            break;
+        case 'C':
+            emu_config.crc_error_rate = atof(optarg);
+            break;
+        case 'E':
+            emu_config.exception_rate = atof(optarg);
+            break;
+        case 'x':
+            emu_config.reject_write_multiple = 1;
+            break;
+        case 'a':
+            options.arena = &arena;
+            break;
+        case 's':
+            serve = 1;
+            break;
+        default:
+            print_usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (baudrate_count < 0 || options.iterations <= 0 || options.timeout <= 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // 2. In serve mode just expose the emulated slaves (e.g., to the Python UI).
+    if (serve)
+    {
+        EMU_Slave *slave;
+        emu_config.baudrate = baudrates[0];
+        if (EMU_SlaveOpen(&emu_config, &slave) != 0)
+        {
+            perror("EMU_SlaveOpen");
+            return 1;
+        }
+        signal(SIGINT, handle_sigint);
+        printf("Serving RRG (ID %d) and relay (ID %d) at %d baud on %s. Press Ctrl+C to stop.\n",
+               emu_config.rrg_slave_id, emu_config.relay_slave_id, baudrates[0], EMU_SlaveGetPort(slave));
+        fflush(stdout);
+        while (!g_stop)
+            pause();
+        EMU_SlaveClose(slave);
+        return 0;
+    }
+
+    // 3. Run every loop at every baud rate, each against a fresh emulator.
+    printf("%d calls per operation, slave delay %d us, timeout %d ms\n\n", options.iterations,
+           emu_config.response_delay_us, options.timeout);
+    printf("%8s  %-14s %8s %9s %9s %8s %8s %8s %8s %7s %7s\n", "baud", "operation", "ops", "ops/s", "mean_us",
+           "p50_us", "p90_us", "p99_us", "max_us", "errors", "allocs");
+    int status = 0;
+    for (int i = 0; i < baudrate_count; ++i)
+    {
+        EMU_Slave *slave;
+        emu_config.baudrate = baudrates[i];
+        if (EMU_SlaveOpen(&emu_config, &slave) != 0)
+        {
+            perror("EMU_SlaveOpen");
+            return 1;
+        }
+
+        // Every device of the previous baud rate is closed: the arena can start over.
+        if (options.arena)
+            MB_ArenaInit(options.arena, g_arena_storage, sizeof(g_arena_storage));
+        BENCH_Result results[BENCH_OPERATIONS];
+        memset(results, 0, sizeof(results));
+        int rrg_status = BENCH_RunRrg(&options, EMU_SlaveGetPort(slave), baudrates[i], &results[0]);
+        int relay_status = BENCH_RunRelay(&options, EMU_SlaveGetPort(slave), baudrates[i], &results[2]);
+        int interlock_status = BENCH_RunInterlock(&options, slave, baudrates[i], &results[4]);
+        for (int op = 0; op < BENCH_OPERATIONS; ++op)
+            if (results[op].ops)
+            {
+                print_result(baudrates[i], &results[op]);
+                if (options.arena && results[op].allocations)
+                    status = 1;
+            }
+        if (rrg_status != 0 || relay_status != 0 || interlock_status != 0)
+            status = 1;
+
+        EMU_SlaveCounters counters;
+        EMU_SlaveGetCounters(slave, &counters);
+        if (counters.dropped || counters.crc_errors || counters.exceptions || counters.bad_frames)
+            printf("%8s  injected: %llu dropped, %llu bad CRC, %llu exceptions; %llu malformed requests\n", "",
+                   (unsigned long long)counters.dropped, (unsigned long long)counters.crc_errors,
+                   (unsigned long long)counters.exceptions, (unsigned long long)counters.bad_frames);
+        EMU_SlaveClose(slave);
+    }
+    return status;
+}
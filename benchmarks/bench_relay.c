@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "relay.h"
+
+int BENCH_RunRelay(const BENCH_Options *options, const char *port, int baudrate, BENCH_Result *results)
+{
+    // 1. Open the relay on the emulated line.
+    Relay_Config config;
+    memset(&config, 0, sizeof(config));
+    config.port = (char *)port;
+    config.baudrate = baudrate;
+    config.slave_id = options->relay_slave_id;
+    config.timeout = options->timeout;
+    config.arena = options->arena;
+
+    Relay_Handle handle;
+    if (RELAY_Init(&config, &handle) != RELAY_OK)
+    {
+        fprintf(stderr, "RELAY_Init failed: %s\n", RELAY_GetLastError());
+        return -1;
+    }
+
+    // 2. Toggle the relay, so every call changes its state.
+    results[0].name = "RELAY_TurnOn";
+    results[1].name = "RELAY_TurnOff";
+    int64_t start_ns = _mbMonotonicNs();
+    for (int i = 0; i < options->iterations; ++i)
+    {
+        uint64_t allocations = BENCH_AllocationCount();
+        int64_t call_ns = _mbMonotonicNs();
+        int result = RELAY_TurnOn(&handle);
+        _benchRecord(&results[0], call_ns, result != RELAY_OK);
+        results[0].allocations += BENCH_AllocationCount() - allocations;
+
+        allocations = BENCH_AllocationCount();
+        call_ns = _mbMonotonicNs();
+        result = RELAY_TurnOff(&handle);
+        _benchRecord(&results[1], call_ns, result != RELAY_OK);
+        results[1].allocations += BENCH_AllocationCount() - allocations;
+    }
+
+    // The loop interleaves both calls: split its wall time in proportion to their latencies.
+    int64_t elapsed_ns = _mbMonotonicNs() - start_ns;
+    uint64_t total_us = results[0].latency.total_us + results[1].latency.total_us;
+    results[0].elapsed_ns = total_us ? (int64_t)((double)elapsed_ns * results[0].latency.total_us / total_us) : 0;
+    results[1].elapsed_ns = elapsed_ns - results[0].elapsed_ns;
+
+    RELAY_Close(&handle);
+    return 0;
+}
+
+void *BENCH_OpenRelay(const BENCH_Options *options, const char *port, int baudrate)
+{
+    Relay_Config config;
+    memset(&config, 0, sizeof(config));
+    config.port = (char *)port;
+    config.baudrate = baudrate;
+    config.slave_id = options->relay_slave_id;
+    config.timeout = options->timeout;
+    config.arena = options->arena;
+
+    Relay_Handle *handle = malloc(sizeof(Relay_Handle));
+    if (handle && RELAY_Init(&config, handle) != RELAY_OK)
+    {
+        fprintf(stderr, "RELAY_Init failed: %s\n", RELAY_GetLastError());
+        free(handle);
+        handle = NULL;
+    }
+    return handle;
+}
+
+int BENCH_RelayOn(void *relay) { return RELAY_TurnOn(relay); }
+
+int BENCH_RelayOff(void *relay) { return RELAY_TurnOff(relay); }
+
+void BENCH_CloseRelay(void *relay)
+{
+    RELAY_Close(relay);
+    free(relay);
+}
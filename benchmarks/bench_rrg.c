@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "rrg.h"
+
+#define BENCH_WAIT_TIMEOUT_NS 1000000000LL
+#define BENCH_WAIT_POLL_NS 100000LL
+
+/// @brief Returns non-zero once the interlock of `handle` is re-armed.
+static int _interlockArmed(RRG_Handle *handle)
+{
+    RRG_InterlockStatus status;
+    return RRG_GetInterlockStatus(handle, &status) == RRG_OK && !status.faulted && !status.failed_reads;
+}
+
+int BENCH_RunRrg(const BENCH_Options *options, const char *port, int baudrate, BENCH_Result *results)
+{
+    // 1. Open the regulator on the emulated line.
+    RRG_Config config;
+    memset(&config, 0, sizeof(config));
+    config.port = (char *)port;
+    config.baudrate = baudrate;
+    config.slave_id = options->rrg_slave_id;
+    config.timeout = options->timeout;
+    config.arena = options->arena;
+
+    RRG_Handle handle;
+    if (RRG_Init(&config, &handle) != RRG_OK)
+    {
+        fprintf(stderr, "RRG_Init failed: %s\n", RRG_GetLastError());
+        return -1;
+    }
+
+    // 2. Write a different setpoint every time, so no layer can skip the write.
+    results[0].name = "RRG_SetFlow";
+    uint64_t allocations = BENCH_AllocationCount();
+    int64_t start_ns = _mbMonotonicNs();
+    for (int i = 0; i < options->iterations; ++i)
+    {
+        int64_t call_ns = _mbMonotonicNs();
+        int result = RRG_SetFlow(&handle, (float)(i % 100) + 0.5f);
+        _benchRecord(&results[0], call_ns, result != RRG_OK);
+    }
+    results[0].elapsed_ns = _mbMonotonicNs() - start_ns;
+    results[0].allocations = BENCH_AllocationCount() - allocations;
+
+    // 3. Read the measured flow back.
+    results[1].name = "RRG_GetFlow";
+    allocations = BENCH_AllocationCount();
+    start_ns = _mbMonotonicNs();
+    for (int i = 0; i < options->iterations; ++i)
+    {
+        float flow;
+        int64_t call_ns = _mbMonotonicNs();
+        int result = RRG_GetFlow(&handle, &flow);
+        _benchRecord(&results[1], call_ns, result != RRG_OK);
+    }
+    results[1].elapsed_ns = _mbMonotonicNs() - start_ns;
+    results[1].allocations = BENCH_AllocationCount() - allocations;
+
+    RRG_Close(&handle);
+    return 0;
+}
+
+int BENCH_RunInterlock(const BENCH_Options *options, EMU_Slave *slave, int baudrate, BENCH_Result *results)
+{
+    // 1. Open both devices; a mass flow overrange of the regulator turns the relay off.
+    RRG_Config config;
+    memset(&config, 0, sizeof(config));
+    config.port = (char *)EMU_SlaveGetPort(slave);
+    config.baudrate = baudrate;
+    config.slave_id = options->rrg_slave_id;
+    config.timeout = options->timeout;
+    config.arena = options->arena;
+
+    RRG_Handle handle;
+    if (RRG_Init(&config, &handle) != RRG_OK)
+    {
+        fprintf(stderr, "RRG_Init failed: %s\n", RRG_GetLastError());
+        return -1;
+    }
+    void *relay = BENCH_OpenRelay(options, config.port, baudrate);
+    RRG_Interlock interlock = {RRG_STATUS_MASS_FLOW_OVERRANGE, 0, BENCH_INTERLOCK_FAULT_PERIOD_US, BENCH_RelayOff,
+                               relay};
+    if (!relay || RRG_SetInterlock(&handle, &interlock) != RRG_OK ||
+        RRG_StartAcquisition(&handle, BENCH_INTERLOCK_PERIOD_US) != RRG_OK)
+    {
+        fprintf(stderr, "Interlock setup failed: %s\n", RRG_GetLastErrorEx(&handle));
+        if (relay)
+            BENCH_CloseRelay(relay);
+        RRG_Close(&handle);
+        return -1;
+    }
+
+    // 2. Raise the fault at a different phase of the sampling period each time, once the
+    // previous one cleared, and wait for the relay write to reach the emulator. The
+    // allocations counted meanwhile include those of the acquisition thread.
+    results[0].name = "fault_to_off";
+    uint64_t allocations = BENCH_AllocationCount();
+    int trips = options->iterations < BENCH_INTERLOCK_MAX_TRIPS ? options->iterations : BENCH_INTERLOCK_MAX_TRIPS;
+    int64_t start_ns = _mbMonotonicNs();
+    for (int i = 0; i < trips; ++i)
+    {
+        BENCH_RelayOn(relay);
+        EMU_SlaveSetRrgStatus(slave, 0);
+        int64_t now = _mbMonotonicNs(), timeout = now + BENCH_WAIT_TIMEOUT_NS;
+        while (!_interlockArmed(&handle) && now < timeout)
+        {
+            _mbSleepUntilNs(now + BENCH_WAIT_POLL_NS);
+            now = _mbMonotonicNs();
+        }
+        _mbSleepUntilNs(now + (int64_t)(i * 7919 % BENCH_INTERLOCK_PERIOD_US) * 1000);
+
+        int64_t fault_ns = _mbMonotonicNs(), off_ns;
+        EMU_SlaveSetRrgStatus(slave, RRG_STATUS_MASS_FLOW_OVERRANGE);
+        now = fault_ns;
+        while ((off_ns = EMU_SlaveGetRelayOffTime(slave)) <= fault_ns && now < fault_ns + BENCH_WAIT_TIMEOUT_NS)
+        {
+            _mbSleepUntilNs(now + BENCH_WAIT_POLL_NS);
+            now = _mbMonotonicNs();
+        }
+        int failed = off_ns <= fault_ns;
+        _mbRecordLatency(&results[0].latency, failed ? now - fault_ns : off_ns - fault_ns);
+        ++results[0].ops;
+        if (failed)
+            ++results[0].errors;
+    }
+    results[0].elapsed_ns = _mbMonotonicNs() - start_ns;
+    results[0].allocations = BENCH_AllocationCount() - allocations;
+    EMU_SlaveSetRrgStatus(slave, 0);
+
+    // 3. The share of the library, as recorded by the interlock.
+    RRG_StopAcquisition(&handle);
+    RRG_InterlockStatus status;
+    RRG_GetInterlockStatus(&handle, &status);
+    results[1].name = "RRG_Interlock";
+    results[1].ops = status.trips;
+    results[1].errors = status.action_status != 0;
+    results[1].elapsed_ns = results[0].elapsed_ns;
+    results[1].latency = status.latency;
+
+    BENCH_CloseRelay(relay);
+    RRG_Close(&handle);
+    return 0;
+}
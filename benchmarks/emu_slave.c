@@ -0,0 +1,422 @@
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 700
+
+#include "emu_slave.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "mb_platform.h"
+
+#define EMU_REGISTER_SPACE 4096 ///< Register addresses emulated per device (0-4095).
+#define EMU_FRAME_MAX 256       ///< Largest RTU frame (MODBUS application data unit).
+#define EMU_POLL_MS 50          ///< Idle time after which a partial frame is discarded.
+#define EMU_BITS_PER_CHAR 10    ///< Start bit, 8 data bits and one stop bit (8N1).
+#define EMU_DEFAULT_SEED 0x2545F491u
+
+#define EMU_FC_READ_HOLDING 0x03
+#define EMU_FC_READ_INPUT 0x04
+#define EMU_FC_WRITE_SINGLE 0x06
+#define EMU_FC_WRITE_MULTIPLE 0x10
+
+#define EMU_EX_ILLEGAL_FUNCTION 0x01
+#define EMU_EX_ILLEGAL_ADDRESS 0x02
+#define EMU_EX_ILLEGAL_VALUE 0x03
+#define EMU_EX_DEVICE_FAILURE 0x04
+
+/* Register maps from the device datasheets. */
+#define EMU_RRG_SETPOINT 2053
+#define EMU_RRG_GAS 2100
+#define EMU_RRG_STATUS 2101
+#define EMU_RRG_FLOW 2103
+#define EMU_RELAY_STATE 512
+
+typedef struct
+{
+    int first; ///< First implemented register.
+    int count; ///< Number of consecutive implemented registers.
+} EMU_RegisterRange;
+
+static const EMU_RegisterRange rrg_ranges[] = {{EMU_RRG_SETPOINT, 2}, {EMU_RRG_GAS, EMU_RRG_FLOW + 2 - EMU_RRG_GAS}};
+static const EMU_RegisterRange relay_ranges[] = {{EMU_RELAY_STATE, 1}};
+
+typedef struct
+{
+    int slave_id;                        ///< Address of the device on the line.
+    const EMU_RegisterRange *ranges;     ///< Implemented registers.
+    int range_count;                     ///< Number of entries in `ranges`.
+    uint16_t regs[EMU_REGISTER_SPACE];   ///< Register contents.
+} EMU_Device;
+
+struct EMU_Slave
+{
+    EMU_SlaveConfig config;     ///< Copy of the configuration passed to `EMU_SlaveOpen()`.
+    char port[64];              ///< Path of the pty side opened by the master.
+    int master_fd;              ///< Controlling side of the pty, read and written by the emulator.
+    int hold_fd;                ///< Pty side kept open so the line never hangs up between masters.
+    int stop;                   ///< Set to stop the serving thread (accessed atomically).
+    int64_t char_ns;            ///< Wire time of one character at the configured baud rate.
+    uint32_t rng;               ///< State of the error injection generator.
+    MB_Thread thread;           ///< Serving thread.
+    EMU_Device rrg;             ///< Emulated gas flow regulator.
+    EMU_Device relay;           ///< Emulated relay.
+    int rrg_status;             ///< Status register of the regulator, set by `EMU_SlaveSetRrgStatus()` (atomic).
+    int64_t relay_off_ns;       ///< Time the relay was last turned off, 0 if never (accessed atomically).
+    EMU_SlaveCounters counters; ///< Counters updated by the serving thread (accessed atomically).
+};
+
+/// @brief MODBUS CRC-16 (polynomial 0xA001, initial value 0xFFFF).
+static inline uint16_t _crc16(const uint8_t *data, size_t length)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; ++i)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit)
+            crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0xA001) : (uint16_t)(crc >> 1);
+    }
+    return crc;
+}
+
+/// @brief Returns a uniformly distributed number in [0, 1) (xorshift32).
+static inline double _random(EMU_Slave *slave)
+{
+    slave->rng ^= slave->rng << 13;
+    slave->rng ^= slave->rng >> 17;
+    slave->rng ^= slave->rng << 5;
+    return (double)(slave->rng >> 8) / 16777216.0;
+}
+
+/// @brief Draws whether an error with the given probability is injected.
+static inline int _inject(EMU_Slave *slave, double rate) { return rate > 0.0 && _random(slave) < rate; }
+
+/// @brief Returns the length of the request starting at `frame`, 0 if more bytes are needed to
+/// tell, or -1 for an unsupported function code.
+static inline int _requestLength(const uint8_t *frame, size_t length)
+{
+    if (length < 2)
+        return 0;
+    switch (frame[1])
+    {
+    case EMU_FC_READ_HOLDING:
+    case EMU_FC_READ_INPUT:
+    case EMU_FC_WRITE_SINGLE:
+        return 8; // Address, function, register, count or value, CRC.
+    case EMU_FC_WRITE_MULTIPLE:
+        return length < 7 ? 0 : 9 + frame[6]; // Header, byte count, data, CRC.
+    default:
+        return -1;
+    }
+}
+
+/// @brief Returns non-zero if `[address, address + count)` lies within one implemented range.
+static inline int _isImplemented(const EMU_Device *device, int address, int count)
+{
+    for (int i = 0; i < device->range_count; ++i)
+    {
+        const EMU_RegisterRange *range = &device->ranges[i];
+        if (address >= range->first && address + count <= range->first + range->count)
+            return 1;
+    }
+    return 0;
+}
+
+/// @brief Applies a write to a device; the regulator's measured flow follows its setpoint at once.
+static inline void _writeRegisters(EMU_Slave *slave, EMU_Device *device, int address, const uint8_t *data, int count)
+{
+    for (int i = 0; i < count; ++i)
+        device->regs[address + i] = (uint16_t)((data[2 * i] << 8) | data[2 * i + 1]);
+    if (device == &slave->rrg)
+    {
+        device->regs[EMU_RRG_FLOW] = device->regs[EMU_RRG_SETPOINT];
+        device->regs[EMU_RRG_FLOW + 1] = device->regs[EMU_RRG_SETPOINT + 1];
+    }
+    else if (address == EMU_RELAY_STATE && !device->regs[EMU_RELAY_STATE])
+        _mbAtomicStoreReleaseI64(&slave->relay_off_ns, _mbMonotonicNs());
+}
+
+/// @brief Builds an exception response into `response` and returns its length without CRC.
+static inline int _exception(EMU_Slave *slave, const uint8_t *request, uint8_t code, uint8_t *response)
+{
+    _mbAtomicIncU64(&slave->counters.exceptions);
+    response[0] = request[0];
+    response[1] = (uint8_t)(request[1] | 0x80);
+    response[2] = code;
+    return 3;
+}
+
+/// @brief Executes one request and builds its response.
+/// @return The length of the response including its CRC, or 0 if the request is not answered.
+static int _process(EMU_Slave *slave, const uint8_t *request, int length, uint8_t *response)
+{
+    // 1. Select the addressed devices (address 0 is a broadcast write to all of them).
+    int slave_id = request[0];
+    EMU_Device *devices[2];
+    int device_count = 0;
+    if (slave_id == 0 || slave_id == slave->rrg.slave_id)
+        devices[device_count++] = &slave->rrg;
+    if (slave_id == 0 || slave_id == slave->relay.slave_id)
+        devices[device_count++] = &slave->relay;
+    if (device_count == 0)
+        return 0; // Another slave on the line: stay silent.
+    _mbAtomicIncU64(&slave->counters.requests);
+
+    // 2. Inject errors.
+    if (_inject(slave, slave->config.drop_rate))
+    {
+        _mbAtomicIncU64(&slave->counters.dropped);
+        return 0;
+    }
+
+    // 3. Execute the request.
+    int function = request[1];
+    int address = (request[2] << 8) | request[3];
+    int count = (request[4] << 8) | request[5];
+    int response_length;
+    if (slave_id != 0 && _inject(slave, slave->config.exception_rate))
+        response_length = _exception(slave, request, EMU_EX_DEVICE_FAILURE, response);
+    else if (function == EMU_FC_READ_HOLDING || function == EMU_FC_READ_INPUT)
+    {
+        if (slave_id == 0)
+            return 0; // Reads cannot be broadcast.
+        if (count < 1 || count > 125)
+            response_length = _exception(slave, request, EMU_EX_ILLEGAL_VALUE, response);
+        else if (!_isImplemented(devices[0], address, count))
+            response_length = _exception(slave, request, EMU_EX_ILLEGAL_ADDRESS, response);
+        else
+        {
+            slave->rrg.regs[EMU_RRG_STATUS] = (uint16_t)_mbAtomicLoadInt(&slave->rrg_status);
+            memcpy(response, request, 2);
+            response[2] = (uint8_t)(2 * count);
+            for (int i = 0; i < count; ++i)
+            {
+                response[3 + 2 * i] = (uint8_t)(devices[0]->regs[address + i] >> 8);
+                response[4 + 2 * i] = (uint8_t)(devices[0]->regs[address + i] & 0xFF);
+            }
+            response_length = 3 + 2 * count;
+        }
+    }
+    else if (function == EMU_FC_WRITE_MULTIPLE && slave->config.reject_write_multiple)
+        response_length = _exception(slave, request, EMU_EX_ILLEGAL_FUNCTION, response);
+    else
+    {
+        // Single writes carry the value in place of the count.
+        const uint8_t *data = function == EMU_FC_WRITE_SINGLE ? &request[4] : &request[7];
+        int written = function == EMU_FC_WRITE_SINGLE ? 1 : count;
+        if (function == EMU_FC_WRITE_MULTIPLE && (count < 1 || count > 123 || request[6] != 2 * count ||
+                                                 length != 9 + 2 * count))
+            response_length = _exception(slave, request, EMU_EX_ILLEGAL_VALUE, response);
+        else
+        {
+            int applied = 0;
+            for (int i = 0; i < device_count; ++i)
+                if (_isImplemented(devices[i], address, written))
+                {
+                    _writeRegisters(slave, devices[i], address, data, written);
+                    applied = 1;
+                }
+            if (slave_id == 0)
+                return 0; // Broadcasts are never answered.
+            if (!applied)
+                response_length = _exception(slave, request, EMU_EX_ILLEGAL_ADDRESS, response);
+            else
+            {
+                memcpy(response, request, 6); // Both write functions echo address and value/count.
+                response_length = 6;
+            }
+        }
+    }
+    if (slave_id == 0)
+        return 0;
+
+    // 4. Append the CRC, corrupting it if requested.
+    uint16_t crc = _crc16(response, (size_t)response_length);
+    response[response_length++] = (uint8_t)(crc & 0xFF);
+    response[response_length++] = (uint8_t)(crc >> 8);
+    if (_inject(slave, slave->config.crc_error_rate))
+    {
+        response[response_length - 1] ^= 0x01;
+        _mbAtomicIncU64(&slave->counters.crc_errors);
+    }
+    return response_length;
+}
+
+/// @brief Writes a whole buffer to the pty.
+static inline void _writeAll(int fd, const uint8_t *data, int length)
+{
+    while (length > 0)
+    {
+        ssize_t written = write(fd, data, (size_t)length);
+        if (written < 0)
+        {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            return;
+        }
+        data += written;
+        length -= (int)written;
+    }
+}
+
+/// @brief Serving thread: reassembles requests, answers them after the simulated line time.
+MB_THREAD_ROUTINE(_serve, arg)
+{
+    EMU_Slave *slave = (EMU_Slave *)arg;
+    uint8_t rx[EMU_FRAME_MAX], response[EMU_FRAME_MAX];
+    size_t rx_length = 0;
+
+    while (!_mbAtomicLoadInt(&slave->stop))
+    {
+        // 1. Wait for bytes; a partial frame followed by silence is discarded (RTU framing).
+        struct pollfd pfd = {slave->master_fd, POLLIN, 0};
+        int ready = poll(&pfd, 1, EMU_POLL_MS);
+        if (ready <= 0 || !(pfd.revents & POLLIN))
+        {
+            if (ready == 0 && rx_length > 0)
+            {
+                _mbAtomicIncU64(&slave->counters.bad_frames);
+                rx_length = 0;
+            }
+            continue;
+        }
+        ssize_t received = read(slave->master_fd, rx + rx_length, sizeof(rx) - rx_length);
+        if (received <= 0)
+            continue;
+        int64_t received_ns = _mbMonotonicNs();
+        rx_length += (size_t)received;
+
+        // 2. Answer every complete request in the buffer.
+        while (rx_length > 0)
+        {
+            int length = _requestLength(rx, rx_length);
+            if (length < 0 || length > EMU_FRAME_MAX)
+            {
+                _mbAtomicIncU64(&slave->counters.bad_frames);
+                rx_length = 0;
+                break;
+            }
+            if (length == 0 || rx_length < (size_t)length)
+                break;
+
+            uint16_t crc = _crc16(rx, (size_t)length - 2);
+            if (rx[length - 2] != (crc & 0xFF) || rx[length - 1] != (crc >> 8))
+            {
+                _mbAtomicIncU64(&slave->counters.bad_frames);
+                rx_length = 0;
+                break;
+            }
+
+            int response_length = _process(slave, rx, length, response);
+            if (response_length > 0)
+            {
+                // The request took its wire time plus the 3.5 character silence to arrive, the
+                // response takes its own wire time to leave.
+                int64_t line_ns = (int64_t)(2 * length + 7) * slave->char_ns / 2 +
+                                  (int64_t)response_length * slave->char_ns;
+                _mbSleepUntilNs(received_ns + line_ns + (int64_t)slave->config.response_delay_us * 1000);
+                _writeAll(slave->master_fd, response, response_length);
+                _mbAtomicIncU64(&slave->counters.responses);
+            }
+            memmove(rx, rx + length, rx_length - (size_t)length);
+            rx_length -= (size_t)length;
+        }
+    }
+    MB_THREAD_RETURN;
+}
+
+int EMU_SlaveOpen(const EMU_SlaveConfig *config, EMU_Slave **slave)
+{
+    // 1. Validate input parameters.
+    if (!config || !slave || config->baudrate <= 0 || config->response_delay_us < 0 || config->drop_rate < 0.0 ||
+        config->drop_rate > 1.0 || config->crc_error_rate < 0.0 || config->crc_error_rate > 1.0 ||
+        config->exception_rate < 0.0 || config->exception_rate > 1.0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    EMU_Slave *emu = calloc(1, sizeof(EMU_Slave));
+    if (!emu)
+        return -1;
+    emu->config = *config;
+    emu->char_ns = (int64_t)EMU_BITS_PER_CHAR * 1000000000LL / config->baudrate;
+    emu->rng = config->seed ? config->seed : EMU_DEFAULT_SEED;
+    emu->rrg = (EMU_Device){config->rrg_slave_id, rrg_ranges, (int)(sizeof(rrg_ranges) / sizeof(rrg_ranges[0])), {0}};
+    emu->relay =
+        (EMU_Device){config->relay_slave_id, relay_ranges, (int)(sizeof(relay_ranges) / sizeof(relay_ranges[0])), {0}};
+    emu->hold_fd = -1;
+
+    // 2. Create the pty pair.
+    const char *name;
+    emu->master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (emu->master_fd < 0 || grantpt(emu->master_fd) != 0 || unlockpt(emu->master_fd) != 0 ||
+        !(name = ptsname(emu->master_fd)) || strlen(name) >= sizeof(emu->port))
+        goto fail;
+    strcpy(emu->port, name);
+
+    // 3. Keep the other side open in raw mode, so nothing is echoed and reads never see a hangup.
+    struct termios tio;
+    emu->hold_fd = open(emu->port, O_RDWR | O_NOCTTY);
+    if (emu->hold_fd < 0 || tcgetattr(emu->hold_fd, &tio) != 0)
+        goto fail;
+    cfmakeraw(&tio);
+    if (tcsetattr(emu->hold_fd, TCSANOW, &tio) != 0)
+        goto fail;
+
+    // 4. Start serving.
+    if (_mbThreadCreate(&emu->thread, _serve, emu) != 0)
+        goto fail;
+    *slave = emu;
+    return 0;
+
+fail:;
+    int saved_errno = errno;
+    if (emu->hold_fd >= 0)
+        close(emu->hold_fd);
+    if (emu->master_fd >= 0)
+        close(emu->master_fd);
+    free(emu);
+    errno = saved_errno;
+    return -1;
+}
+
+const char *EMU_SlaveGetPort(const EMU_Slave *slave) { return slave ? slave->port : NULL; }
+
+void EMU_SlaveGetCounters(const EMU_Slave *slave, EMU_SlaveCounters *counters)
+{
+    if (!slave || !counters)
+        return;
+    counters->requests = _mbAtomicLoadU64(&slave->counters.requests);
+    counters->responses = _mbAtomicLoadU64(&slave->counters.responses);
+    counters->dropped = _mbAtomicLoadU64(&slave->counters.dropped);
+    counters->crc_errors = _mbAtomicLoadU64(&slave->counters.crc_errors);
+    counters->exceptions = _mbAtomicLoadU64(&slave->counters.exceptions);
+    counters->bad_frames = _mbAtomicLoadU64(&slave->counters.bad_frames);
+}
+
+void EMU_SlaveSetRrgStatus(EMU_Slave *slave, int status)
+{
+    if (slave)
+        _mbAtomicStoreInt(&slave->rrg_status, status);
+}
+
+int64_t EMU_SlaveGetRelayOffTime(const EMU_Slave *slave)
+{
+    return slave ? _mbAtomicLoadAcquireI64(&slave->relay_off_ns) : 0;
+}
+
+void EMU_SlaveClose(EMU_Slave *slave)
+{
+    if (!slave)
+        return;
+    _mbAtomicStoreInt(&slave->stop, 1);
+    _mbThreadJoin(slave->thread);
+    close(slave->hold_fd);
+    close(slave->master_fd);
+    free(slave);
+}
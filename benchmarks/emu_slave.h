@@ -0,0 +1,82 @@
+#ifndef EMU_SLAVE_H
+#define EMU_SLAVE_H
+
+/*
+ * Emulated MODBUS-RTU slaves (a gas flow regulator and a relay) served on a pseudo-terminal.
+ * The device libraries open the pty like a real serial port, so the whole stack (libmodbus
+ * framing, CRC, timeouts, the bus layer) runs without hardware. POSIX only.
+ */
+
+#include <stdint.h>
+
+/**
+ * @struct EMU_SlaveConfig
+ * @brief Behaviour of the emulated line and devices.
+ */
+typedef struct
+{
+    int baudrate;              ///< Simulated line speed; every frame is delayed by its wire time at this rate.
+    int response_delay_us;     ///< Processing time of the slave between the end of a request and its response.
+    int rrg_slave_id;          ///< Address of the emulated regulator (registers 2053-2054 and 2100-2104).
+    int relay_slave_id;        ///< Address of the emulated relay (register 512).
+    double drop_rate;          ///< Probability that a request is not answered at all (the master times out).
+    double crc_error_rate;     ///< Probability that a response is sent with a corrupted CRC.
+    double exception_rate;     ///< Probability that a request is answered with a "slave device failure" exception.
+    int reject_write_multiple; ///< Non-zero to answer function 0x10 with "illegal function" (single-write fallback).
+    uint32_t seed;             ///< Seed of the error injection generator (0 picks a fixed default).
+} EMU_SlaveConfig;
+
+/**
+ * @struct EMU_SlaveCounters
+ * @brief What the emulated slaves saw and did since they were opened.
+ */
+typedef struct
+{
+    uint64_t requests;   ///< Well-formed requests addressed to an emulated device.
+    uint64_t responses;  ///< Responses sent, including corrupted and exception responses.
+    uint64_t dropped;    ///< Requests deliberately left unanswered.
+    uint64_t crc_errors; ///< Responses sent with a corrupted CRC.
+    uint64_t exceptions; ///< Exception responses (injected or caused by an invalid request).
+    uint64_t bad_frames; ///< Frames discarded because of an unknown function code or a wrong CRC.
+} EMU_SlaveCounters;
+
+/**
+ * @brief Emulated slaves bound to one pseudo-terminal, served by a background thread.
+ */
+typedef struct EMU_Slave EMU_Slave;
+
+/**
+ * @brief Creates a pseudo-terminal pair and starts serving the emulated devices on it.
+ *
+ * @param config Behaviour of the line and the devices.
+ * @param slave Pointer that receives the emulator on success.
+ * @return 0 on success, -1 on failure (`errno` tells why).
+ */
+int EMU_SlaveOpen(const EMU_SlaveConfig *config, EMU_Slave **slave);
+
+/**
+ * @brief Returns the device path of the pty side to pass as `port` to `RRG_Init()` / `RELAY_Init()`.
+ */
+const char *EMU_SlaveGetPort(const EMU_Slave *slave);
+
+/**
+ * @brief Copies the counters of the emulator; safe while it is serving requests.
+ */
+void EMU_SlaveGetCounters(const EMU_Slave *slave, EMU_SlaveCounters *counters);
+
+/**
+ * @brief Sets the status register of the emulated regulator (2101), e.g., to raise a fault.
+ */
+void EMU_SlaveSetRrgStatus(EMU_Slave *slave, int status);
+
+/**
+ * @brief Returns the monotonic time the emulated relay was last turned off (0 if never).
+ */
+int64_t EMU_SlaveGetRelayOffTime(const EMU_Slave *slave);
+
+/**
+ * @brief Stops the serving thread, closes the pseudo-terminal and frees the emulator.
+ */
+void EMU_SlaveClose(EMU_Slave *slave);
+
+#endif // !EMU_SLAVE_H
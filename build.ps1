@@ -6,6 +6,8 @@ $LIBRRG_PATH = "build\c_api\src\rrg\librrg.dll"
 $LIBRRG_RESOURCES_PATH = "ui\resources\librrg.dll"
 $LIBRELAY_PATH = "build\c_api\src\relay\librelay.dll"
 $LIBRELAY_RESOURCES_PATH = "ui\resources\librelay.dll"
+$LIBMB_PATH = "build\c_api\src\mb\libmb.dll"
+$LIBMB_RESOURCES_PATH = "ui\resources\libmb.dll"
 
 $RRG_LIVE_TEST_PATH = "build\c_api\rrg_live_test.exe"
 $RELAY_LIVE_TEST_PATH = "build\c_api\relay_live_test.exe"
@@ -46,6 +48,9 @@ Copy-Item -Path $LIBRRG_PATH -Destination ".\librrg.dll" -Force
 Copy-Item -Path $LIBRELAY_PATH -Destination $LIBRELAY_RESOURCES_PATH -Force
 Copy-Item -Path $LIBRELAY_PATH -Destination ".\librelay.dll" -Force
 
+Copy-Item -Path $LIBMB_PATH -Destination $LIBMB_RESOURCES_PATH -Force
+Copy-Item -Path $LIBMB_PATH -Destination ".\libmb.dll" -Force
+
 # Copy executable tests
 Write-Host "Copying test executables..."
 Copy-Item -Path $RRG_LIVE_TEST_PATH -Destination ".\rrg_live_test.exe" -Force
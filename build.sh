@@ -4,6 +4,8 @@ LIBRRG_PATH="build/c_api/src/rrg/librrg.so"
 LIBRRG_RESOURCES_PATH="ui/resources/librrg.so"
 LIBRELAY_PATH="build/c_api/src/relay/librelay.so"
 LIBRELAY_RESOURCES_PATH="ui/resources/librelay.so"
+LIBMB_PATH="build/c_api/src/mb/libmb.so"
+LIBMB_RESOURCES_PATH="ui/resources/libmb.so"
 
 RRG_LIVE_TEST_PATH="build/c_api/rrg_live_test"
 RELAY_LIVE_TEST_PATH="build/c_api/relay_live_test"
@@ -20,6 +22,9 @@ cp -v $LIBRRG_PATH ./librrg.so
 cp -v $LIBRELAY_PATH $LIBRELAY_RESOURCES_PATH
 cp -v $LIBRELAY_PATH ./librelay.so
 
+cp -v $LIBMB_PATH $LIBMB_RESOURCES_PATH
+cp -v $LIBMB_PATH ./libmb.so
+
 cp -v $RRG_LIVE_TEST_PATH ./rrg_live_test
 
 rm -rf build/
@@ -0,0 +1,27 @@
+#ifndef MB_ALLOC_H
+#define MB_ALLOC_H
+
+/*
+ * Internal allocation helpers of the device libraries: objects come from the caller's arena
+ * when there is one, from the heap otherwise. It is not part of the public API and must not
+ * be included from public headers.
+ */
+
+#include <stdlib.h>
+
+#include "mb_arena.h"
+
+/// @brief Allocates a zeroed block from `arena`, or from the heap if `arena` is `NULL`.
+static inline void *_mbAlloc(MB_Arena *arena, size_t size)
+{
+    return arena ? MB_ArenaAlloc(arena, size) : calloc(1, size);
+}
+
+/// @brief Releases a block of `_mbAlloc()`; arena blocks are only reclaimed with the whole arena.
+static inline void _mbFree(MB_Arena *arena, void *block)
+{
+    if (!arena)
+        free(block);
+}
+
+#endif // !MB_ALLOC_H
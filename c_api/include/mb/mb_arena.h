@@ -0,0 +1,72 @@
+#ifndef MB_ARENA_H
+#define MB_ARENA_H
+
+#include <stddef.h>
+
+#include "mb_errors.h"
+#include "mb_preprocessor_macros.h"
+
+/**
+ * @def MB_ARENA_ALIGNMENT
+ * @brief Alignment of every block of an arena: a cache line, so that state written by
+ *        different threads (e.g., the two ends of a ring) never shares one.
+ */
+#define MB_ARENA_ALIGNMENT 64
+
+MB_BEGIN_DECLS
+
+/**
+ * @struct MB_Arena
+ * @brief Caller-provided storage that the buses and device handles take their state from
+ *        instead of the heap.
+ *
+ * Pass an arena to `MB_BusConfig::arena` (or `RRG_Config::arena`, `Relay_Config::arena`) to
+ * reserve everything a device needs while it is opened: the bus with its request queues,
+ * the frame buffers of the fast transport, and the sample rings of the acquisition. Past
+ * the init, the request paths and the acquisition loop then never allocate, so memory can
+ * be locked with `mlockall()` and latency stays bounded. A binary log (`mb_log.h`) recorded
+ * by the acquisition is the exception: its segments are files opened and preallocated on
+ * the acquisition thread as the log rotates.
+ *
+ * Blocks are never given back one by one: the storage is reused as a whole (with
+ * `MB_ArenaInit()` again) once every object built from it is closed. A bus built in an arena
+ * is closed with its last device, whatever `MB_BusSetPoolLinger()` says, so closing the
+ * devices is enough. Size the arena with `MB_ArenaUsed()` after opening the devices once.
+ */
+typedef struct
+{
+    unsigned char *base; ///< First block, aligned to `MB_ARENA_ALIGNMENT`.
+    size_t size;         ///< Usable bytes from `base`.
+    size_t used;         ///< Bytes handed out so far.
+} MB_Arena;
+
+/**
+ * @brief Prepares an arena over `storage` (e.g., a static array) and zeroes it.
+ *
+ * Zeroing touches every page up front, so a locked arena never faults afterwards.
+ *
+ * @param arena Arena to initialize.
+ * @param storage Memory the arena hands out; it must outlive every object built from it.
+ * @param size Size of `storage` in bytes.
+ * @return `MB_OK` on success, otherwise `ERROR_MB_INVALID_PARAMETER`.
+ */
+MB_API int MB_ArenaInit(MB_Arena *MB_RESTRICT arena, void *MB_RESTRICT storage, size_t size);
+
+/**
+ * @brief Takes a zeroed block of `size` bytes from the arena.
+ *
+ * Safe to call from several threads (e.g., devices opened in parallel).
+ *
+ * @return The block, aligned to `MB_ARENA_ALIGNMENT`, or `NULL` (`ERROR_MB_OUT_OF_MEMORY`)
+ *         if the arena is too small.
+ */
+MB_API void *MB_ArenaAlloc(MB_Arena *arena, size_t size);
+
+/**
+ * @brief Returns the number of bytes handed out so far, padding included.
+ */
+MB_API size_t MB_ArenaUsed(const MB_Arena *arena);
+
+MB_END_DECLS
+
+#endif // !MB_ARENA_H
@@ -0,0 +1,694 @@
+#ifndef MB_BUS_H
+#define MB_BUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mb_arena.h"
+#include "mb_errors.h"
+#include "mb_preprocessor_macros.h"
+
+/**
+ * @def MB_MAX_SLAVE_ID
+ * @brief Highest slave address allowed on a MODBUS-RTU line.
+ */
+#define MB_MAX_SLAVE_ID 247
+
+/**
+ * @def MB_TRANSPORT_RTU
+ * @brief `MB_BusConfig::transport`: MODBUS-RTU on a local serial port.
+ */
+#define MB_TRANSPORT_RTU 0
+
+/**
+ * @def MB_TRANSPORT_TCP
+ * @brief `MB_BusConfig::transport`: MODBUS TCP to a gateway, which addresses the slaves behind it by unit ID.
+ */
+#define MB_TRANSPORT_TCP 1
+
+/**
+ * @def MB_TRANSPORT_RTU_OVER_TCP
+ * @brief `MB_BusConfig::transport`: raw RTU frames through a TCP connection to a serial device server.
+ */
+#define MB_TRANSPORT_RTU_OVER_TCP 2
+
+/**
+ * @def MB_TRANSPORT_SIM
+ * @brief `MB_BusConfig::transport`: the simulated line (see `mb_sim.h`) registered under the port name.
+ */
+#define MB_TRANSPORT_SIM 3
+
+/**
+ * @def MB_TCP_DEFAULT_SERVICE
+ * @brief TCP port of a gateway whose endpoint names none (the MODBUS TCP port).
+ */
+#define MB_TCP_DEFAULT_SERVICE "502"
+
+/**
+ * @def MB_ENDPOINT_HOST_MAX
+ * @brief Size of the buffer holding the host part of a gateway endpoint, terminating NUL included.
+ */
+#define MB_ENDPOINT_HOST_MAX 256
+
+/**
+ * @def MB_BUS_QUEUE_CAPACITY
+ * @brief Maximum number of asynchronous requests of one priority class pending on one bus.
+ */
+#define MB_BUS_QUEUE_CAPACITY 64
+
+/**
+ * @def MB_BUS_REQUEST_PAYLOAD_SIZE
+ * @brief Maximum size of the payload copied into the queue with each asynchronous request (in bytes).
+ */
+#define MB_BUS_REQUEST_PAYLOAD_SIZE 64
+
+/**
+ * @def MB_DEFAULT_BYTE_TIMEOUT_US
+ * @brief Inter-character timeout libmodbus uses by default, kept for slaves without adaptive timeouts.
+ */
+#define MB_DEFAULT_BYTE_TIMEOUT_US 500000
+
+/**
+ * @def MB_MAX_TIMEOUT_MS
+ * @brief Largest configurable response timeout (in milliseconds), so that it fits in microseconds.
+ */
+#define MB_MAX_TIMEOUT_MS 2000000
+
+/**
+ * @def MB_ADAPTIVE_TIMEOUT_MIN_US
+ * @brief Lower bound of an adaptive response timeout (in microseconds).
+ */
+#define MB_ADAPTIVE_TIMEOUT_MIN_US 3000
+
+/**
+ * @def MB_ADAPTIVE_TIMEOUT_MAX_US
+ * @brief Upper bound of an adaptive response timeout (in microseconds).
+ */
+#define MB_ADAPTIVE_TIMEOUT_MAX_US 2000000
+
+/**
+ * @def MB_ADAPTIVE_TIMEOUT_MARGIN_US
+ * @brief Fixed margin added on top of the estimated tail latency (in microseconds).
+ */
+#define MB_ADAPTIVE_TIMEOUT_MARGIN_US 1000
+
+/**
+ * @def MB_ADAPTIVE_TIMEOUT_WARMUP
+ * @brief Number of round trips measured before the estimate replaces the configured timeout.
+ */
+#define MB_ADAPTIVE_TIMEOUT_WARMUP 8
+
+/**
+ * @def MB_BROADCAST_MAX_REGISTERS
+ * @brief Largest number of registers one broadcast write may carry.
+ */
+#define MB_BROADCAST_MAX_REGISTERS 16
+
+/**
+ * @def MB_BROADCAST_TURNAROUND_US
+ * @brief Time left to the slaves to apply a broadcast before the next request (in microseconds).
+ *
+ * Slaves do not answer a broadcast, so the line must stay quiet until the slowest one has
+ * processed it. The MODBUS specification suggests 100-200 ms for arbitrary devices; a
+ * register write on the regulators and relays of this library completes well within this.
+ */
+#define MB_BROADCAST_TURNAROUND_US 5000
+
+/**
+ * @def MB_RECONNECT_MIN_BACKOFF_MS
+ * @brief Delay before the second attempt to reopen a lost port; it doubles after every failure.
+ */
+#define MB_RECONNECT_MIN_BACKOFF_MS 10
+
+/**
+ * @def MB_RECONNECT_MAX_BACKOFF_MS
+ * @brief Longest delay between two attempts to reopen a lost port.
+ */
+#define MB_RECONNECT_MAX_BACKOFF_MS 2000
+
+/**
+ * @def MB_TRANSACTION_OK
+ * @brief Transaction outcome: every request was answered (its duration is a latency sample).
+ */
+#define MB_TRANSACTION_OK 0
+
+/**
+ * @def MB_TRANSACTION_TIMEOUT
+ * @brief Transaction outcome: the slave did not answer in time.
+ */
+#define MB_TRANSACTION_TIMEOUT 1
+
+/**
+ * @def MB_TRANSACTION_FAILED
+ * @brief Transaction outcome: any other failure (exception response, CRC error, ...).
+ */
+#define MB_TRANSACTION_FAILED 2
+
+/**
+ * @def MB_TRANSACTION_SKIPPED
+ * @brief Transaction outcome: nothing was sent (e.g., a write suppressed by a device write cache).
+ */
+#define MB_TRANSACTION_SKIPPED 3
+
+/**
+ * @def MB_TRANSACTION_LINK_LOST
+ * @brief Transaction outcome: the port itself failed (e.g., a USB adapter was unplugged).
+ *
+ * The bus is marked down and reopened in the background; transactions fail fast with
+ * `ERROR_MB_LINK_DOWN` until it is back.
+ */
+#define MB_TRANSACTION_LINK_LOST 4
+
+/**
+ * @def MB_PRIORITY_SAFETY
+ * @brief Priority class of safety writes (e.g., a relay shutoff), served before anything else.
+ */
+#define MB_PRIORITY_SAFETY 0
+
+/**
+ * @def MB_PRIORITY_SETPOINT
+ * @brief Priority class of setpoint and configuration writes.
+ */
+#define MB_PRIORITY_SETPOINT 1
+
+/**
+ * @def MB_PRIORITY_TELEMETRY
+ * @brief Priority class of background reads (flow, acquisition, pollers), served last.
+ */
+#define MB_PRIORITY_TELEMETRY 2
+
+/**
+ * @def MB_PRIORITY_COUNT
+ * @brief Number of priority classes.
+ */
+#define MB_PRIORITY_COUNT 3
+
+/**
+ * @def MB_LATENCY_SUB_BUCKET_BITS
+ * @brief Histogram buckets per power of two, as a power of two (8 buckets: relative precision 1/8).
+ */
+#define MB_LATENCY_SUB_BUCKET_BITS 3
+
+/**
+ * @def MB_LATENCY_SUB_BUCKETS
+ * @brief Histogram buckets per power of two above `MB_LATENCY_LINEAR_US`.
+ */
+#define MB_LATENCY_SUB_BUCKETS (1 << MB_LATENCY_SUB_BUCKET_BITS)
+
+/**
+ * @def MB_LATENCY_LINEAR_US
+ * @brief Latencies below this value (in microseconds) get one histogram bucket per microsecond.
+ */
+#define MB_LATENCY_LINEAR_US (2 * MB_LATENCY_SUB_BUCKETS)
+
+/**
+ * @def MB_LATENCY_MAX_LOG2_US
+ * @brief Latencies of `2^MB_LATENCY_MAX_LOG2_US` microseconds (about 4.2 s) and above share the last bucket.
+ */
+#define MB_LATENCY_MAX_LOG2_US 22
+
+/**
+ * @def MB_LATENCY_BUCKETS
+ * @brief Number of buckets of an `MB_LatencyHistogram`.
+ */
+#define MB_LATENCY_BUCKETS \
+    (MB_LATENCY_LINEAR_US + (MB_LATENCY_MAX_LOG2_US - MB_LATENCY_SUB_BUCKET_BITS - 1) * MB_LATENCY_SUB_BUCKETS)
+
+/**
+ * @def MB_RTU_READ_REQUEST_SIZE
+ * @brief Size of a "Read Holding Registers" (0x03) request frame in bytes (address, function, start, count, CRC).
+ */
+#define MB_RTU_READ_REQUEST_SIZE 8
+
+/**
+ * @def MB_RTU_READ_RESPONSE_SIZE
+ * @brief Size of the response frame to a read of `count` registers in bytes.
+ */
+#define MB_RTU_READ_RESPONSE_SIZE(count) (5 + 2 * (count))
+
+/**
+ * @def MB_RTU_WRITE_SINGLE_SIZE
+ * @brief Size of a "Write Single Register" (0x06) request frame, and of its echo response, in bytes.
+ */
+#define MB_RTU_WRITE_SINGLE_SIZE 8
+
+/**
+ * @def MB_RTU_WRITE_MULTIPLE_REQUEST_SIZE
+ * @brief Size of a "Write Multiple Registers" (0x10) request frame carrying `count` registers in bytes.
+ */
+#define MB_RTU_WRITE_MULTIPLE_REQUEST_SIZE(count) (9 + 2 * (count))
+
+/**
+ * @def MB_RTU_WRITE_MULTIPLE_RESPONSE_SIZE
+ * @brief Size of the response frame to a "Write Multiple Registers" request in bytes.
+ */
+#define MB_RTU_WRITE_MULTIPLE_RESPONSE_SIZE 8
+
+MB_BEGIN_DECLS
+
+/**
+ * @struct MB_BusConfig
+ * @brief Line parameters of one physical MODBUS bus (one port, many slaves).
+ *
+ * With the TCP transports `port` names the gateway as "host:port" ("[address]:port" for an
+ * IPv6 address); the TCP port defaults to `MB_TCP_DEFAULT_SERVICE`. The serial settings then
+ * describe the line behind the gateway, and only time broadcasts.
+ */
+typedef struct
+{
+    char *port;      ///< Serial port (e.g., "/dev/ttyUSB0" on Linux or "COM3" on Windows), gateway endpoint or
+                     ///< name of a simulated line.
+    int baudrate;    ///< Baud rate for serial communication (e.g., 9600, 19200, 38400).
+    char parity;     ///< Parity: 'N', 'E' or 'O'.
+    int data_bits;   ///< Number of data bits (usually 8).
+    int stop_bits;   ///< Number of stop bits (usually 1).
+    int timeout;     ///< Default response timeout for every slave on the bus (in milliseconds).
+    int transport;   ///< One of `MB_TRANSPORT_*` (0 is `MB_TRANSPORT_RTU`).
+    MB_Arena *arena; ///< Storage of a new bus and its queues (`NULL`: the heap); its threads then start at once.
+} MB_BusConfig;
+
+/**
+ * @struct MB_TrafficCounters
+ * @brief Request counters of one device handle.
+ *
+ * Every field is updated with relaxed atomic increments, so reading it from another
+ * thread is safe but different fields may be a few requests apart.
+ */
+typedef struct
+{
+    uint64_t transactions;   ///< Transactions made on the line (several requests may make up one).
+    uint64_t failures;       ///< Transactions that failed, whatever the reason.
+    uint64_t timeouts;       ///< Requests the slave did not answer in time.
+    uint64_t crc_errors;     ///< Responses rejected because of a bad CRC.
+    uint64_t exceptions;     ///< MODBUS exception responses.
+    uint64_t retries;        ///< Requests sent again in another form (e.g., a setpoint write fallback).
+    uint64_t skipped_writes; ///< Writes suppressed by the write cache of the handle.
+    uint64_t bytes_sent;     ///< RTU request bytes put on the line.
+    uint64_t bytes_received; ///< RTU response bytes of the successful requests.
+} MB_TrafficCounters;
+
+/**
+ * @struct MB_LatencyHistogram
+ * @brief HDR-style log-linear histogram of the duration of one operation.
+ *
+ * Bucket `i` counts the transactions that took from `MB_LatencyBucketLowerUs(i)` up to
+ * `MB_LatencyBucketLowerUs(i + 1)` microseconds: one microsecond wide below
+ * `MB_LATENCY_LINEAR_US`, then `MB_LATENCY_SUB_BUCKETS` buckets per power of two.
+ */
+typedef struct
+{
+    uint64_t count;                       ///< Recorded transactions.
+    uint64_t total_us;                    ///< Sum of their durations (for the mean).
+    uint64_t buckets[MB_LATENCY_BUCKETS]; ///< Transactions per duration bucket.
+} MB_LatencyHistogram;
+
+/**
+ * @struct MB_Bus
+ * @brief Opaque object owning the libmodbus context of one serial port.
+ *
+ * Device handles (`RRG_Handle`, `Relay_Handle`) attach to a bus by slave ID and share
+ * its context. Every request made through a handle is wrapped into a bus transaction,
+ * which serializes access to the line and selects the right slave.
+ */
+typedef struct MB_Bus MB_Bus;
+
+/**
+ * @brief Asynchronous request executed by the I/O worker of a bus.
+ *
+ * The job runs on the worker thread and wraps its own libmodbus calls into a bus transaction,
+ * exactly like a synchronous call would. A request whose deadline passed while it was queued
+ * is still handed to its job, with `status` set to `ERROR_MB_DEADLINE_EXPIRED`: the job must
+ * not touch the line then, only report the outcome.
+ *
+ * @param payload Copy of the payload passed to `MB_BusSubmit()`, valid until the job returns.
+ * @param request_id ID returned by `MB_BusSubmit()` for this request.
+ * @param status `MB_OK`, or `ERROR_MB_DEADLINE_EXPIRED` if the request must be dropped.
+ */
+typedef void (*MB_BusJob)(void *payload, uint64_t request_id, int status);
+
+/**
+ * @struct MB_BusListener
+ * @brief Callback a device handle registers to restore its state once a lost port is reopened.
+ *
+ * The structure is owned by the caller (typically embedded in the device handle) and must
+ * stay valid until `MB_BusRemoveListener()` returns.
+ */
+typedef struct MB_BusListener
+{
+    void (*on_reconnect)(void *user_data); ///< Called on the reconnect thread, outside any transaction.
+    void *user_data;                       ///< Passed to `on_reconnect`.
+    struct MB_BusListener *next;           ///< Next listener of the bus (managed by the bus).
+} MB_BusListener;
+
+/**
+ * @brief Opens the bus for the given serial port or gateway, or returns the one that is already open.
+ *
+ * Buses are kept in a process-wide registry keyed by port name, so opening the same port
+ * twice (from the same or from different device libraries) yields the same object with
+ * its reference count incremented. The serial settings and the transport must match the open bus,
+ * and a bus built in an arena is only shared by configurations passing that same arena (a bus
+ * on the heap is shared with any of them).
+ *
+ * Every bus has its own line lock and I/O worker, so buses behind different gateways (or
+ * different ports of one gateway) run their transactions in parallel.
+ *
+ * @param config Pointer to an `MB_BusConfig` structure with the line parameters.
+ * @param bus Pointer that receives the bus object on success.
+ * @return `MB_OK` on success, otherwise an error code (`ERROR_MB_CONFIG_MISMATCH` if the port
+ *         is already open with different settings or from another arena).
+ */
+MB_API int MB_BusOpen(const MB_BusConfig *MB_RESTRICT config, MB_Bus **MB_RESTRICT bus);
+
+/**
+ * @brief Keeps released buses open for a while, so reopening the same port is instant.
+ *
+ * When the last reference to a bus goes away, the port normally closes at once. With a
+ * linger time, the bus stays in the registry with its context, timings and link state, and
+ * an `MB_BusOpen()` of the same port with the same settings within the delay gets it back
+ * without reopening the serial device. Idle buses that expire are closed by the next
+ * `MB_BusOpen()` or `MB_BusClose()`, or by `MB_BusFlushPool()`. A bus built in an arena
+ * (`MB_BusConfig::arena`) never lingers.
+ *
+ * @param linger_ms Time an unused bus stays open, in milliseconds (0, the default, closes it at once).
+ */
+MB_API void MB_BusSetPoolLinger(int linger_ms);
+
+/**
+ * @brief Closes every idle bus kept open by the pool linger, whatever its age.
+ */
+MB_API void MB_BusFlushPool(void);
+
+/**
+ * @brief Takes an additional reference to an open bus.
+ *
+ * Device libraries call this when a handle attaches to the bus, so the port stays open
+ * until the last user releases it with `MB_BusClose()`.
+ *
+ * @param bus Pointer to an open bus.
+ */
+MB_API void MB_BusRetain(MB_Bus *bus);
+
+/**
+ * @brief Releases one reference to the bus; the port is closed when the last reference goes away.
+ *
+ * @param bus Pointer to an open bus.
+ */
+MB_API void MB_BusClose(MB_Bus *bus);
+
+/**
+ * @brief Registers a callback run every time the bus reopens its port after losing it.
+ *
+ * Listeners run one after another on the reconnect thread of the bus, once the line is
+ * usable again; they may start transactions (e.g., to write back a setpoint).
+ *
+ * @param bus Pointer to an open bus.
+ * @param listener Listener to add; it must not be registered already.
+ * @return `MB_OK` on success, otherwise `ERROR_MB_INVALID_PARAMETER`.
+ */
+MB_API int MB_BusAddListener(MB_Bus *MB_RESTRICT bus, MB_BusListener *MB_RESTRICT listener);
+
+/**
+ * @brief Unregisters a listener; once this returns, its callback is not running and will not run again.
+ *
+ * @note Must not be called from a listener callback.
+ *
+ * @param bus Pointer to an open bus.
+ * @param listener Listener registered with `MB_BusAddListener()` (ignored if it is not).
+ */
+MB_API void MB_BusRemoveListener(MB_Bus *MB_RESTRICT bus, MB_BusListener *MB_RESTRICT listener);
+
+/**
+ * @brief Tells whether the port of the bus is usable (not being reopened after a failure).
+ *
+ * @param bus Pointer to an open bus.
+ * @return Non-zero if the link is up, 0 if it is down or `bus` is `NULL`.
+ */
+MB_API int MB_BusIsLinkUp(MB_Bus *bus);
+
+/**
+ * @brief Returns the number of times the bus reopened its port after losing it.
+ *
+ * @param bus Pointer to an open bus.
+ * @return The reconnect count, or 0 if `bus` is `NULL`.
+ */
+MB_API uint64_t MB_BusGetReconnectCount(MB_Bus *bus);
+
+/**
+ * @brief Returns the libmodbus context (`modbus_t *`) owned by the bus.
+ *
+ * @param bus Pointer to an open bus.
+ * @return The context, or `NULL` if `bus` is `NULL` or uses `MB_TRANSPORT_RTU_OVER_TCP` or
+ *         `MB_TRANSPORT_SIM` (libmodbus has no such backend: the bus frames its requests itself).
+ */
+MB_API void *MB_BusGetContext(MB_Bus *bus) MB_PURE;
+
+/**
+ * @brief Sets the response timeout used for requests addressed to one slave.
+ *
+ * @param bus Pointer to an open bus.
+ * @param slave_id Slave address (0-247).
+ * @param timeout Response timeout in milliseconds.
+ * @return `MB_OK` on success, otherwise `ERROR_MB_INVALID_PARAMETER`.
+ */
+MB_API int MB_BusSetSlaveTimeout(MB_Bus *bus, int slave_id, int timeout);
+
+/**
+ * @brief Enables or disables adaptive response timeouts for one slave.
+ *
+ * In adaptive mode the bus measures the round trip of every successful transaction with
+ * the slave and keeps an exponentially weighted moving average of it together with its
+ * mean deviation (as TCP does for retransmission timers). Once `MB_ADAPTIVE_TIMEOUT_WARMUP`
+ * round trips are known, the response and byte timeouts become `mean + 4 * deviation +
+ * MB_ADAPTIVE_TIMEOUT_MARGIN_US`, an estimate of the p99 latency bounded by
+ * `MB_ADAPTIVE_TIMEOUT_MIN_US` and `MB_ADAPTIVE_TIMEOUT_MAX_US`. Until then the timeout set
+ * with `MB_BusSetSlaveTimeout()` is used.
+ *
+ * The first timeout after a successful response doubles the timeout once, so a slave that
+ * slowed down gets a chance to be measured again; further consecutive timeouts keep it, so
+ * polling a dead slave stays cheap.
+ *
+ * @param bus Pointer to an open bus.
+ * @param slave_id Slave address (0-247).
+ * @param enabled Non-zero to enable adaptive timeouts (the estimate restarts from scratch).
+ * @return `MB_OK` on success, otherwise `ERROR_MB_INVALID_PARAMETER`.
+ */
+MB_API int MB_BusSetAdaptiveTimeout(MB_Bus *bus, int slave_id, int enabled);
+
+/**
+ * @brief Returns the response timeout currently applied to one slave.
+ *
+ * @param bus Pointer to an open bus.
+ * @param slave_id Slave address (0-247).
+ * @return The timeout in microseconds, or `MB_ERR` on invalid parameters.
+ */
+MB_API int MB_BusGetSlaveTimeoutUs(MB_Bus *bus, int slave_id);
+
+/**
+ * @brief Checks that a slave is alive with one register read bounded by a short timeout.
+ *
+ * A dead or unplugged slave then costs `timeout_ms` instead of the full response timeout of
+ * the slave, which matters when many devices are opened at start-up. Any answer counts,
+ * an exception response included. The timeout of the slave is left as it was.
+ *
+ * @param bus Pointer to an open bus.
+ * @param slave_id Slave address (0-247).
+ * @param addr Holding register read by the probe.
+ * @param timeout_ms Longest wait for the answer (in milliseconds, positive).
+ * @return `MB_OK` if the slave answered, otherwise `MB_ERR` (`ERROR_MB_NO_RESPONSE` if it
+ *         did not, `errno` tells why).
+ */
+MB_API int MB_BusProbe(MB_Bus *bus, int slave_id, int addr, int timeout_ms);
+
+/**
+ * @brief Starts a bus transaction: locks the line and selects the slave.
+ *
+ * Must be paired with `MB_BusEndTransaction()`. All libmodbus calls made between the two
+ * are guaranteed not to interleave with requests of other handles on the same bus.
+ *
+ * Threads waiting for the line are served by priority class: when the line is released it
+ * goes to a waiter of the most urgent class, so a safety write waits for at most the one
+ * transaction in progress, however many threads keep polling the bus.
+ *
+ * @param bus Pointer to an open bus.
+ * @param slave_id Slave address the following requests are sent to.
+ * @param priority One of the `MB_PRIORITY_*` classes.
+ * @param deadline_ns Monotonic time (`CLOCK_MONOTONIC`, in nanoseconds) after which the
+ *                    transaction is pointless, or 0 for none. If the line is only obtained
+ *                    later, it is released at once and `ERROR_MB_DEADLINE_EXPIRED` is reported.
+ * A bus whose port was lost fails at once with `ERROR_MB_LINK_DOWN` instead of letting
+ * every caller wait for its own timeout, until the reconnect thread has reopened the port.
+ *
+ * @return A non-`NULL` token on success: the libmodbus context (`modbus_t *`) of RTU and TCP
+ *         buses, the bus itself with `MB_TRANSPORT_RTU_OVER_TCP` and `MB_TRANSPORT_SIM`. Requests are made with
+ *         `MB_BusReadRegisters()` and the like, which work with every transport. `NULL` on
+ *         failure (the bus is left unlocked in that case).
+ */
+MB_API void *MB_BusBeginTransaction(MB_Bus *bus, int slave_id, int priority, int64_t deadline_ns) MB_HOT;
+
+/**
+ * @brief Ends a bus transaction started with `MB_BusBeginTransaction()` and unlocks the line.
+ *
+ * The outcome feeds the adaptive timeout of the slave. A transaction made of several
+ * requests yields one sample covering all of them, which errs on the side of a longer timeout.
+ * `MB_TRANSACTION_LINK_LOST` marks the link down and wakes the reconnect thread of the bus.
+ *
+ * @param bus Pointer to the bus the transaction was started on.
+ * @param outcome One of the `MB_TRANSACTION_*` outcomes.
+ * @return The duration of the transaction in nanoseconds (0 if `bus` is `NULL`).
+ */
+MB_API int64_t MB_BusEndTransaction(MB_Bus *bus, int outcome) MB_HOT;
+
+/**
+ * @brief Moves an open transaction on to another slave without releasing the line.
+ *
+ * The part addressed to the current slave ends as with `MB_BusEndTransaction()` (its outcome
+ * feeds the adaptive timeout of that slave) and `slave_id` is selected with its timeouts. A
+ * group of requests to several slaves then goes out back to back: no other thread takes the
+ * line in between and no handover to a waiting thread delays the next request.
+ *
+ * @param bus Pointer to the bus the transaction was started on.
+ * @param slave_id Slave address the following requests are sent to.
+ * @param outcome One of the `MB_TRANSACTION_*` outcomes of the part that ends.
+ * @param elapsed_ns Receives the duration of the part that ended in nanoseconds, even if
+ *                   `slave_id` cannot be selected.
+ * @return `MB_OK` on success, otherwise `MB_ERR` (`ERROR_MB_LINK_DOWN` without selecting
+ *         `slave_id` if `outcome` is `MB_TRANSACTION_LINK_LOST`). The line stays locked either
+ *         way: the transaction must still be ended with `MB_BusEndTransaction()`.
+ */
+MB_API int MB_BusSwitchSlave(MB_Bus *MB_RESTRICT bus, int slave_id, int outcome,
+                             int64_t *MB_RESTRICT elapsed_ns) MB_HOT;
+
+/**
+ * @brief Reads `count` holding registers (0x03) of the slave of the open transaction.
+ *
+ * The request goes through libmodbus, or is framed by the bus itself on an RTU-over-TCP bus.
+ * Like libmodbus, failures are reported through `errno` only (`ETIMEDOUT`, `EMBBADCRC`, ...).
+ *
+ * @return The number of registers read, or `MB_ERR` on failure.
+ */
+MB_API int MB_BusReadRegisters(MB_Bus *MB_RESTRICT bus, int addr, int count, uint16_t *MB_RESTRICT dest) MB_HOT;
+
+/**
+ * @brief Reads `count` input registers (0x04) of the slave of the open transaction, see `MB_BusReadRegisters()`.
+ * @return The number of registers read, or `MB_ERR` on failure.
+ */
+MB_API int MB_BusReadInputRegisters(MB_Bus *MB_RESTRICT bus, int addr, int count, uint16_t *MB_RESTRICT dest);
+
+/**
+ * @brief Writes one register ("Write Single Register", 0x06) of the slave of the open
+ * transaction, see `MB_BusReadRegisters()`.
+ * @return 1 on success, or `MB_ERR` on failure.
+ */
+MB_API int MB_BusWriteRegister(MB_Bus *bus, int addr, uint16_t value) MB_HOT;
+
+/**
+ * @brief Writes `count` registers ("Write Multiple Registers", 0x10) of the slave of the open
+ * transaction, see `MB_BusReadRegisters()`. An RTU-over-TCP bus carries at most
+ * `MB_BROADCAST_MAX_REGISTERS` per request.
+ * @return The number of registers written, or `MB_ERR` on failure.
+ */
+MB_API int MB_BusWriteRegisters(MB_Bus *MB_RESTRICT bus, int addr, int count, const uint16_t *MB_RESTRICT regs) MB_HOT;
+
+/**
+ * @brief Writes registers of every slave on the line at once with a broadcast request (slave 0).
+ *
+ * Must be called within a transaction. One register is sent with "Write Single Register"
+ * (0x06), more with "Write Multiple Registers" (0x10). Slaves never answer a broadcast, so
+ * nothing confirms that they applied it: the call returns once the frame is on the line and
+ * `MB_BROADCAST_TURNAROUND_US` have passed. Every slave receives it, whatever its type, so
+ * it only suits lines whose slaves all share the register map.
+ *
+ * @param bus Pointer to the bus the transaction was started on.
+ * @param addr First register.
+ * @param count Number of registers (1 to `MB_BROADCAST_MAX_REGISTERS`).
+ * @param regs Register values.
+ * @return `MB_OK` on success, otherwise `MB_ERR` (`ERROR_MB_FAILED_BROADCAST` if the frame
+ *         could not be sent).
+ */
+MB_API int MB_BusBroadcastRegisters(MB_Bus *MB_RESTRICT bus, int addr, int count, const uint16_t *MB_RESTRICT regs);
+
+/**
+ * @brief Queues an asynchronous request to the I/O worker of the bus.
+ *
+ * The worker thread is started on the first submission and executes the requests of all
+ * handles attached to the bus one by one: the most urgent priority class first, in
+ * submission order within a class. Every class has its own `MB_BUS_QUEUE_CAPACITY` slots,
+ * so a flood of telemetry reads never keeps a safety write out of the queue. The payload
+ * is copied into the queue, so no memory is allocated per request.
+ *
+ * @param bus Pointer to an open bus.
+ * @param job Function executed on the worker thread.
+ * @param payload Arguments of the job, copied into the queue (may be `NULL` if `size` is 0).
+ * @param size Payload size, at most `MB_BUS_REQUEST_PAYLOAD_SIZE` bytes.
+ * @param priority One of the `MB_PRIORITY_*` classes.
+ * @param deadline_ns Monotonic time after which the request is dropped instead of sent
+ *                    (its job then gets `ERROR_MB_DEADLINE_EXPIRED`), or 0 for none.
+ * @param request_id Optional pointer that receives the ID of the request (IDs start at 1 and
+ *                   grow monotonically per bus).
+ * @return `MB_OK` on success, `ERROR_MB_QUEUE_FULL` if `MB_BUS_QUEUE_CAPACITY` requests of
+ *         the class are already pending, otherwise an error code.
+ */
+MB_API int MB_BusSubmit(MB_Bus *MB_RESTRICT bus, MB_BusJob job, const void *MB_RESTRICT payload, size_t size,
+                        int priority, int64_t deadline_ns, uint64_t *MB_RESTRICT request_id);
+
+/**
+ * @brief Blocks until the request with the given ID and every request submitted before it have completed.
+ *
+ * A more urgent request submitted later may complete first; it is not waited for.
+ *
+ * @note Must not be called from a job or a completion callback running on the worker thread.
+ *
+ * @param bus Pointer to an open bus.
+ * @param request_id ID returned by `MB_BusSubmit()`.
+ * @return `MB_OK` on success, otherwise `ERROR_MB_INVALID_PARAMETER`.
+ */
+MB_API int MB_BusWait(MB_Bus *bus, uint64_t request_id);
+
+/**
+ * @brief Blocks until every request submitted to the bus so far has completed.
+ *
+ * @note Must not be called from a job or a completion callback running on the worker thread.
+ *
+ * @param bus Pointer to an open bus.
+ * @return `MB_OK` on success, otherwise `ERROR_MB_INVALID_PARAMETER`.
+ */
+MB_API int MB_BusFlush(MB_Bus *bus);
+
+/**
+ * @brief Returns the lower bound of a latency histogram bucket.
+ *
+ * @param bucket Bucket index, from 0 to `MB_LATENCY_BUCKETS` (the latter gives the upper
+ *               bound of the last bucket).
+ * @return The bound in microseconds, or 0 for an invalid index.
+ */
+MB_API uint64_t MB_LatencyBucketLowerUs(int bucket) MB_CONST;
+
+/**
+ * @brief Estimates a percentile of the durations recorded in a histogram.
+ *
+ * @param histogram Histogram to read (e.g., one entry of `RRG_Stats.latency`).
+ * @param quantile Quantile between 0 and 1 (0.99 for the p99).
+ * @return The upper bound of the bucket holding the quantile in microseconds, or 0 if the
+ *         histogram is empty.
+ */
+MB_API uint64_t MB_LatencyPercentileUs(const MB_LatencyHistogram *histogram, double quantile);
+
+/**
+ * @brief Retrieves the description of the last error encountered in the bus API.
+ *
+ * @return A constant character string containing the error message.
+ */
+MB_API const char *MB_GetLastError() MB_PURE;
+
+/**
+ * @brief Retrieves the code of the last error encountered in the bus API (`ERROR_MB_*`).
+ *
+ * Device libraries use it to translate bus failures into their own error codes.
+ *
+ * @return The last error code, `MB_OK` if the last call succeeded.
+ */
+MB_API int MB_GetLastErrorCode() MB_PURE;
+
+MB_END_DECLS
+
+#endif // !MB_BUS_H
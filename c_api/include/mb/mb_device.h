@@ -0,0 +1,116 @@
+#ifndef MB_DEVICE_H
+#define MB_DEVICE_H
+
+#include <stdint.h>
+
+#include "mb_bus.h"
+
+/**
+ * @def MB_REGISTER_READ
+ * @brief `MB_RegisterDesc::flags`: the register can be read (function code 0x03).
+ */
+#define MB_REGISTER_READ 0x01
+
+/**
+ * @def MB_REGISTER_WRITE
+ * @brief `MB_RegisterDesc::flags`: the register can be written (function codes 0x06/0x10).
+ */
+#define MB_REGISTER_WRITE 0x02
+
+/**
+ * @def MB_REGISTER_SIGNED
+ * @brief `MB_RegisterDesc::flags`: the raw value is a two's complement integer.
+ */
+#define MB_REGISTER_SIGNED 0x04
+
+/**
+ * @def MB_REGISTER_RW
+ * @brief `MB_RegisterDesc::flags`: the register can be read and written.
+ */
+#define MB_REGISTER_RW (MB_REGISTER_READ | MB_REGISTER_WRITE)
+
+/**
+ * @def MB_REGISTER_MAX_WIDTH
+ * @brief Widest value a register descriptor may describe (in 16-bit registers).
+ */
+#define MB_REGISTER_MAX_WIDTH 2
+
+/**
+ * @def MB_MAX_READ_REGISTERS
+ * @brief Largest register count of one "Read Holding Registers" request allowed by MODBUS.
+ */
+#define MB_MAX_READ_REGISTERS 125
+
+MB_BEGIN_DECLS
+
+/**
+ * @struct MB_RegisterDesc
+ * @brief Entry of the register map of a device type: where a value lives and how it is encoded.
+ *
+ * Drivers describe their device with a `static const` array of descriptors sorted by
+ * address. The shared helpers encode, decode and plan reads from it, so a new device type
+ * only provides its table to get batched reads, the write cache and the statistics.
+ */
+typedef struct
+{
+    uint16_t address; ///< First register.
+    uint8_t width;    ///< Number of 16-bit registers (1, or 2 for a 32-bit value stored high word first).
+    uint8_t flags;    ///< `MB_REGISTER_*` access and encoding flags.
+    int32_t scale;    ///< Raw counts per engineering unit (e.g., 1000 for a value with three decimals).
+} MB_RegisterDesc;
+
+/**
+ * @struct MB_ReadSpan
+ * @brief One read request of a plan: `count` registers starting at `address`.
+ */
+typedef struct
+{
+    uint16_t address; ///< First register of the request.
+    uint16_t count;   ///< Number of registers of the request.
+} MB_ReadSpan;
+
+/**
+ * @struct MB_ShadowRegister
+ * @brief Last value of a register (or register pair) confirmed by a device, for its write cache.
+ */
+typedef struct
+{
+    int valid;                            ///< Non-zero when `regs` holds a confirmed value (accessed atomically).
+    uint16_t regs[MB_REGISTER_MAX_WIDTH]; ///< Register contents; only `regs[0]` is used for single registers.
+    int64_t t_ns;                         ///< Monotonic time the value was last written to or read from the device.
+} MB_ShadowRegister;
+
+/**
+ * @struct MB_DeviceConfig
+ * @brief Serial line settings and slave parameters used to open the bus of a device.
+ */
+typedef struct
+{
+    MB_BusConfig bus;     ///< Serial settings of the port.
+    int slave_id;         ///< Slave address of the device (0-247).
+    int adaptive_timeout; ///< Non-zero to adapt the timeout of the slave (see `MB_BusSetAdaptiveTimeout()`).
+    int probe_address;    ///< Holding register read by the liveness probe.
+    int probe_timeout;    ///< Timeout of the liveness probe (in milliseconds; 0: the device is not probed).
+} MB_DeviceConfig;
+
+/**
+ * @brief Opens (or shares) the bus of a device and configures the response timeout of its slave.
+ *
+ * This is the common part of the `*_Init()` functions of the device drivers: if another
+ * handle already uses the port, its bus is reused. The timeout (`bus.timeout`) applies to
+ * this slave only, so other slaves on the bus keep theirs; in adaptive mode it is only the
+ * starting point until the latency of the slave is measured.
+ *
+ * With a probe timeout the slave must then answer one read of `probe_address` within it
+ * (see `MB_BusProbe()`), so an absent device fails fast instead of on its first request.
+ *
+ * @param config Settings of the device.
+ * @param bus Pointer that receives a new reference to the bus on success (release it with `MB_BusClose()`).
+ * @return `MB_OK` on success, otherwise an error code (`ERROR_MB_FAILED_SET_TIMEOUT` if the
+ *         timeout of the slave could not be set, `ERROR_MB_NO_RESPONSE` if it missed the probe).
+ */
+MB_API int MB_DeviceOpen(const MB_DeviceConfig *MB_RESTRICT config, MB_Bus **MB_RESTRICT bus);
+
+MB_END_DECLS
+
+#endif // !MB_DEVICE_H
@@ -0,0 +1,270 @@
+#ifndef MB_DEVICE_IO_H
+#define MB_DEVICE_IO_H
+
+/*
+ * Internal helpers shared by the device drivers: register codecs and read planning over the
+ * `MB_RegisterDesc` tables, requests counted in the handle's statistics, transaction
+ * bookkeeping and the write cache. Each helper returns a plain success flag, so every driver
+ * keeps its own error codes. It is not part of the public API and must not be included from
+ * public headers.
+ */
+
+#include "mb_device.h"
+#include "mb_rtu.h"
+#include "mb_stats.h"
+
+/**
+ * @def MB_PLAN_MAX_SPANS
+ * @brief Largest number of requests a read plan may hold.
+ */
+#define MB_PLAN_MAX_SPANS 8
+
+/**
+ * @def MB_PLAN_MAX_REGISTERS
+ * @brief Largest number of registers all the requests of a read plan may cover.
+ */
+#define MB_PLAN_MAX_REGISTERS 64
+
+/**
+ * @struct MB_ReadPlan
+ * @brief Requests reading a set of table entries, with the registers between merged entries.
+ */
+typedef struct
+{
+    MB_ReadSpan spans[MB_PLAN_MAX_SPANS]; ///< Requests in address order.
+    int span_count;                       ///< Number of requests.
+    int register_count;                   ///< Registers read by all the requests.
+} MB_ReadPlan;
+
+/// @brief Decodes the raw value of a register entry (high word first), without scaling.
+static inline int64_t _mbRegisterRaw(const MB_RegisterDesc *desc, const uint16_t *regs)
+{
+    if (desc->width == 1)
+        return desc->flags & MB_REGISTER_SIGNED ? (int64_t)(int16_t)regs[0] : (int64_t)regs[0];
+    uint32_t raw = ((uint32_t)regs[0] << 16) | regs[1];
+    return desc->flags & MB_REGISTER_SIGNED ? (int64_t)(int32_t)raw : (int64_t)raw;
+}
+
+/// @brief Decodes a register entry into engineering units.
+static inline double _mbRegisterDecode(const MB_RegisterDesc *desc, const uint16_t *regs)
+{
+    // The reciprocal gives the same floats as a division for every 32-bit raw value of the decimal
+    // scales of the tables (1 to 1000), at the cost of a multiplication.
+    return (double)_mbRegisterRaw(desc, regs) * (1.0 / desc->scale);
+}
+
+/**
+ * @brief Decodes `count` values of a register entry stored back to back (e.g., raw samples) into
+ *        engineering units, exactly like `_mbRegisterDecode()` does one by one.
+ *
+ * The encoding is resolved once, outside the loops, so each of them is branch-free and the
+ * compiler vectorizes the word merge, the sign extension and the scaling.
+ */
+static inline void _mbRegisterDecodeMany(const MB_RegisterDesc *desc, const uint16_t *MB_RESTRICT regs, size_t count,
+                                         float *MB_RESTRICT values)
+{
+    const double unit = 1.0 / desc->scale;
+    const int is_signed = desc->flags & MB_REGISTER_SIGNED;
+    if (desc->width == 1 && is_signed)
+        for (size_t i = 0; i < count; ++i)
+            values[i] = (float)((double)(int16_t)regs[i] * unit);
+    else if (desc->width == 1)
+        for (size_t i = 0; i < count; ++i)
+            values[i] = (float)((double)regs[i] * unit);
+    else if (is_signed)
+        for (size_t i = 0; i < count; ++i)
+            values[i] = (float)((double)(int32_t)(((uint32_t)regs[2 * i] << 16) | regs[2 * i + 1]) * unit);
+    else
+        for (size_t i = 0; i < count; ++i)
+            values[i] = (float)((double)(((uint32_t)regs[2 * i] << 16) | regs[2 * i + 1]) * unit);
+}
+
+/// @brief Encodes a value in engineering units into the registers of an entry, rounded to the nearest
+/// raw count and saturated to the range of the entry (NaN encodes as 0).
+static inline void _mbRegisterEncode(const MB_RegisterDesc *desc, float value, uint16_t *regs)
+{
+    // 1. Scale in double: a float product loses the last counts of large values.
+    double scaled = (double)value * desc->scale;
+    if (scaled != scaled)
+        scaled = 0.0;
+
+    // 2. Saturate instead of wrapping around, then round half away from zero.
+    const int bits = desc->width == 1 ? 16 : 32;
+    const int is_signed = desc->flags & MB_REGISTER_SIGNED;
+    const double max = (double)((1LL << (is_signed ? bits - 1 : bits)) - 1);
+    const double min = is_signed ? -max - 1.0 : 0.0;
+    if (scaled < min)
+        scaled = min;
+    else if (scaled > max)
+        scaled = max;
+    int64_t raw = (int64_t)(scaled < 0.0 ? scaled - 0.5 : scaled + 0.5);
+
+    // 3. Store the two's complement, high word first.
+    if (desc->width == 1)
+        regs[0] = (uint16_t)raw;
+    else
+    {
+        regs[0] = (uint16_t)((uint32_t)raw >> 16);
+        regs[1] = (uint16_t)raw;
+    }
+}
+
+/**
+ * @brief Plans the fewest read requests covering the entries of `table` selected by `fields`.
+ *
+ * `table` must be sorted by address and `fields` is a bit mask of its indexes. Entries closer
+ * than `max_gap` unused registers share one request, as long as it stays within
+ * `MB_MAX_READ_REGISTERS`: a few extra registers on the line cost far less than another
+ * request and its round trip. Only gaps the device answers may be merged, so drivers pick
+ * `max_gap` from their register map. With a `static const` table and constant arguments the
+ * compiler folds the whole plan.
+ *
+ * @return 0 on success, -1 if the plan exceeds `MB_PLAN_MAX_SPANS` or `MB_PLAN_MAX_REGISTERS`.
+ */
+static inline int _mbPlanReads(const MB_RegisterDesc *table, int table_size, uint32_t fields, int max_gap,
+                               MB_ReadPlan *plan)
+{
+    plan->span_count = 0;
+    plan->register_count = 0;
+    MB_ReadSpan *span = NULL;
+    for (int i = 0; i < table_size; ++i)
+    {
+        const MB_RegisterDesc *desc = &table[i];
+        if (!(fields & (1u << i)) || !(desc->flags & MB_REGISTER_READ))
+            continue;
+        int end = desc->address + desc->width;
+        if (span && desc->address <= span->address + span->count + max_gap &&
+            end - span->address <= MB_MAX_READ_REGISTERS)
+        {
+            int grown = end - span->address;
+            if (grown > span->count)
+            {
+                plan->register_count += grown - span->count;
+                span->count = (uint16_t)grown;
+            }
+            continue;
+        }
+        if (plan->span_count == MB_PLAN_MAX_SPANS)
+            return -1;
+        span = &plan->spans[plan->span_count++];
+        span->address = desc->address;
+        span->count = desc->width;
+        plan->register_count += desc->width;
+    }
+    return plan->register_count <= MB_PLAN_MAX_REGISTERS ? 0 : -1;
+}
+
+/// @brief Returns where the registers of `desc` are in the data read by `plan` (spans stored back to back).
+static inline const uint16_t *_mbPlanLocate(const MB_ReadPlan *plan, const uint16_t *data, const MB_RegisterDesc *desc)
+{
+    for (int i = 0; i < plan->span_count; ++i)
+    {
+        const MB_ReadSpan *span = &plan->spans[i];
+        if (desc->address >= span->address && desc->address + desc->width <= span->address + span->count)
+            return data + (desc->address - span->address);
+        data += span->count;
+    }
+    return NULL;
+}
+
+/// @brief Classifies a finished transaction for the adaptive timeout of the bus (reads `errno`).
+static inline int _mbTransactionOutcome(int succeeded)
+{
+    if (succeeded)
+        return MB_TRANSACTION_OK;
+    if (errno == ETIMEDOUT)
+        return MB_TRANSACTION_TIMEOUT;
+    return _mbIsLinkError(errno) ? MB_TRANSACTION_LINK_LOST : MB_TRANSACTION_FAILED;
+}
+
+/// @brief Reads `count` holding registers within an open transaction. Returns non-zero on success.
+static inline int _mbReadRegisters(MB_Bus *bus, MB_TrafficCounters *traffic, int addr, int count, uint16_t *dest)
+{
+    int read = MB_BusReadRegisters(bus, addr, count, dest) != MB_ERR;
+    _mbCountRequest(traffic, MB_RTU_READ_REQUEST_SIZE, MB_RTU_READ_RESPONSE_SIZE(count), read, errno);
+    return read;
+}
+
+/// @brief Reads every span of a plan within an open transaction, back to back into `data`.
+/// Returns non-zero on success.
+static inline int _mbReadPlan(MB_Bus *bus, MB_TrafficCounters *traffic, const MB_ReadPlan *plan, uint16_t *data)
+{
+    for (int i = 0; i < plan->span_count; ++i)
+    {
+        if (!_mbReadRegisters(bus, traffic, plan->spans[i].address, plan->spans[i].count, data))
+            return 0;
+        data += plan->spans[i].count;
+    }
+    return 1;
+}
+
+/// @brief Writes one register ("Write Single Register") within an open transaction. Returns non-zero on success.
+static inline int _mbWriteRegister(MB_Bus *bus, MB_TrafficCounters *traffic, int addr, uint16_t value)
+{
+    int written = MB_BusWriteRegister(bus, addr, value) != MB_ERR;
+    _mbCountRequest(traffic, MB_RTU_WRITE_SINGLE_SIZE, MB_RTU_WRITE_SINGLE_SIZE, written, errno);
+    return written;
+}
+
+/// @brief Writes `count` registers in one "Write Multiple Registers" request. Returns non-zero on success.
+static inline int _mbWriteRegisters(MB_Bus *bus, MB_TrafficCounters *traffic, int addr, int count,
+                                    const uint16_t *regs)
+{
+    int written = MB_BusWriteRegisters(bus, addr, count, regs) != MB_ERR;
+    _mbCountRequest(traffic, MB_RTU_WRITE_MULTIPLE_REQUEST_SIZE(count), MB_RTU_WRITE_MULTIPLE_RESPONSE_SIZE, written,
+                    errno);
+    return written;
+}
+
+/// @brief Runs a prepared request of the fast RTU transport within an open transaction, counted
+/// like the libmodbus requests above. Returns non-zero on success.
+static inline int _mbRtuRequest(MB_Bus *bus, MB_TrafficCounters *traffic, MB_RtuFrame *frame, const uint16_t *payload,
+                                uint16_t *dest)
+{
+    int done = MB_BusRtuExecute(bus, frame, payload, dest) != MB_ERR;
+    _mbCountRequest(traffic, frame->request_size, frame->response_size, done, errno);
+    return done;
+}
+
+/// @brief Ends a transaction made on the line and counts it, with its duration, in the handle's statistics.
+static inline void _mbFinishTransaction(MB_Bus *bus, MB_TrafficCounters *traffic, MB_LatencyHistogram *latency,
+                                        int succeeded)
+{
+    int64_t elapsed_ns = MB_BusEndTransaction(bus, _mbTransactionOutcome(succeeded));
+    _mbCountTransaction(traffic, succeeded);
+    _mbRecordLatency(latency, elapsed_ns);
+}
+
+/// @brief Ends a transaction in which the write cache made every request unnecessary.
+static inline void _mbSkipTransaction(MB_Bus *bus, MB_TrafficCounters *traffic)
+{
+    MB_BusEndTransaction(bus, MB_TRANSACTION_SKIPPED);
+    _mbAtomicIncU64(&traffic->skipped_writes);
+}
+
+/// @brief Forgets a shadow register: the next write reaches the device.
+static inline void _mbShadowInvalidate(MB_ShadowRegister *shadow) { _mbAtomicStoreInt(&shadow->valid, 0); }
+
+/// @brief Returns non-zero if the device is known to hold `regs` already and the value is younger
+/// than `refresh_ns` (0: any age), so writing them can be skipped.
+static inline int _mbShadowMatches(const MB_ShadowRegister *shadow, int64_t refresh_ns, const uint16_t *regs,
+                                   int count)
+{
+    if (!_mbAtomicLoadInt(&shadow->valid))
+        return 0;
+    for (int i = 0; i < count; ++i)
+        if (shadow->regs[i] != regs[i])
+            return 0;
+    return !refresh_ns || _mbMonotonicNs() - shadow->t_ns < refresh_ns;
+}
+
+/// @brief Stores a value confirmed by the device (written or read back) in a shadow register.
+static inline void _mbShadowUpdate(MB_ShadowRegister *shadow, const uint16_t *regs, int count)
+{
+    shadow->regs[0] = regs[0];
+    shadow->regs[1] = count > 1 ? regs[1] : 0;
+    shadow->t_ns = _mbMonotonicNs();
+    _mbAtomicStoreInt(&shadow->valid, 1);
+}
+
+#endif // !MB_DEVICE_IO_H
@@ -0,0 +1,169 @@
+#ifndef MB_ERRORS_H
+#define MB_ERRORS_H
+
+#include "mb_preprocessor_macros.h"
+
+/**
+ * @def MODBUS_ERR
+ * @brief General error code for libmodbus failures.
+ */
+#define MODBUS_ERR -1
+
+/**
+ * @brief Last error code of the calling thread.
+ *
+ * The variable is thread-local, so threads driving different devices never see each other's errors.
+ */
+extern MB_THREAD_LOCAL int MB_GlobalError;
+
+/**
+ * @def MB_OK
+ * @brief No error occurred.
+ */
+#define MB_OK 0
+
+/**
+ * @def MB_ERR
+ * @brief General error. Base to compose other error types.
+ */
+#define MB_ERR -1
+
+/**
+ * @def ERROR_MB_FAILED_CONNECT
+ * @brief Connection to the serial port failed.
+ */
+#define ERROR_MB_FAILED_CONNECT -9001
+
+/**
+ * @def ERROR_MB_FAILED_CREATE_CONTEXT
+ * @brief Failed to create a MODBUS-RTU context.
+ */
+#define ERROR_MB_FAILED_CREATE_CONTEXT -9002
+
+/**
+ * @def ERROR_MB_FAILED_SET_SLAVE
+ * @brief Failed to select the MODBUS slave ID for a transaction.
+ */
+#define ERROR_MB_FAILED_SET_SLAVE -9003
+
+/**
+ * @def ERROR_MB_FAILED_SET_TIMEOUT
+ * @brief Failed to set MODBUS response timeout.
+ */
+#define ERROR_MB_FAILED_SET_TIMEOUT -9004
+
+/**
+ * @def ERROR_MB_INVALID_PARAMETER
+ * @brief An invalid parameter was passed to the function.
+ */
+#define ERROR_MB_INVALID_PARAMETER -9005
+
+/**
+ * @def ERROR_MB_CONFIG_MISMATCH
+ * @brief The port is already open with different serial settings, or its bus was built in another arena.
+ */
+#define ERROR_MB_CONFIG_MISMATCH -9006
+
+/**
+ * @def ERROR_MB_OUT_OF_MEMORY
+ * @brief Failed to allocate memory for the bus object.
+ */
+#define ERROR_MB_OUT_OF_MEMORY -9007
+
+/**
+ * @def ERROR_MB_QUEUE_FULL
+ * @brief The request queue of the bus is full.
+ */
+#define ERROR_MB_QUEUE_FULL -9008
+
+/**
+ * @def ERROR_MB_FAILED_START_WORKER
+ * @brief Failed to start the I/O worker thread of the bus.
+ */
+#define ERROR_MB_FAILED_START_WORKER -9009
+
+/**
+ * @def ERROR_MB_FAILED_READ
+ * @brief A register read of a polling job failed (the sample carries the libmodbus errno).
+ */
+#define ERROR_MB_FAILED_READ -9010
+
+/**
+ * @def ERROR_MB_POLLER_RUNNING
+ * @brief The operation is not allowed while the poller is running.
+ */
+#define ERROR_MB_POLLER_RUNNING -9011
+
+/**
+ * @def ERROR_MB_POLLER_FULL
+ * @brief The poller already holds `MB_POLLER_MAX_JOBS` jobs or serves `MB_POLLER_MAX_BUSES` buses.
+ */
+#define ERROR_MB_POLLER_FULL -9012
+
+/**
+ * @def ERROR_MB_FAILED_START_POLLER
+ * @brief Failed to allocate the sample rings or to start the I/O threads of the poller.
+ */
+#define ERROR_MB_FAILED_START_POLLER -9013
+
+/**
+ * @def ERROR_MB_FAILED_SET_AFFINITY
+ * @brief Failed to pin an I/O thread of the poller to the requested CPU core.
+ */
+#define ERROR_MB_FAILED_SET_AFFINITY -9014
+
+/**
+ * @def ERROR_MB_DEADLINE_EXPIRED
+ * @brief The deadline of a transaction or request passed before it could be sent, so it was dropped.
+ */
+#define ERROR_MB_DEADLINE_EXPIRED -9015
+
+/**
+ * @def ERROR_MB_FAILED_OPEN_LOG
+ * @brief Failed to create or preallocate a segment file of a binary log.
+ */
+#define ERROR_MB_FAILED_OPEN_LOG -9016
+
+/**
+ * @def ERROR_MB_FAILED_WRITE_LOG
+ * @brief Failed to write records to the current segment of a binary log.
+ */
+#define ERROR_MB_FAILED_WRITE_LOG -9017
+
+/**
+ * @def ERROR_MB_FAILED_BROADCAST
+ * @brief Failed to send a broadcast request on the line.
+ */
+#define ERROR_MB_FAILED_BROADCAST -9018
+
+/**
+ * @def ERROR_MB_LINK_DOWN
+ * @brief The port of the bus was lost and is being reopened in the background.
+ */
+#define ERROR_MB_LINK_DOWN -9019
+
+/**
+ * @def ERROR_MB_NOT_SUPPORTED
+ * @brief The port cannot be driven by the fast RTU transport (e.g., on Windows).
+ */
+#define ERROR_MB_NOT_SUPPORTED -9020
+
+/**
+ * @def ERROR_MB_NO_RESPONSE
+ * @brief The slave did not answer the liveness probe (see `MB_BusProbe()`).
+ */
+#define ERROR_MB_NO_RESPONSE -9021
+
+/**
+ * @def ERROR_MB_FAILED_READ_LOG
+ * @brief Failed to read the segment files of a binary log, or they hold no record of the stream.
+ */
+#define ERROR_MB_FAILED_READ_LOG -9022
+
+/// @brief Resets the thread-local 'MB_GlobalError' to the status OK.
+static inline void _resetBusGlobalError() { MB_GlobalError = MB_OK; }
+
+/// @brief Sets the thread-local 'MB_GlobalError' to the specified error status.
+static inline void _setBusGlobalError(int error_code) { MB_GlobalError = error_code; }
+
+#endif // !MB_ERRORS_H
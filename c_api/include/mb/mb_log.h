@@ -0,0 +1,162 @@
+#ifndef MB_LOG_H
+#define MB_LOG_H
+
+#include <stdint.h>
+
+#include "mb_errors.h"
+#include "mb_preprocessor_macros.h"
+
+/**
+ * @def MB_LOG_MAX_REGISTERS
+ * @brief Largest register set stored in one log record.
+ */
+#define MB_LOG_MAX_REGISTERS 4
+
+/**
+ * @def MB_LOG_DEFAULT_SEGMENT_RECORDS
+ * @brief Records per segment when `MB_LogConfig::segment_records` is 0 (24 MiB files).
+ */
+#define MB_LOG_DEFAULT_SEGMENT_RECORDS (1 << 20)
+
+/**
+ * @def MB_LOG_MAGIC
+ * @brief First 8 bytes of every segment file (including the terminating NUL).
+ */
+#define MB_LOG_MAGIC "MBFLOG1"
+
+/**
+ * @def MB_LOG_VERSION
+ * @brief Version of the segment layout, bumped on any incompatible change.
+ */
+#define MB_LOG_VERSION 1
+
+/**
+ * @def MB_LOG_MAX_PATH
+ * @brief Longest segment path (directory, prefix and suffix) the log can build.
+ */
+#define MB_LOG_MAX_PATH 512
+
+MB_BEGIN_DECLS
+
+/**
+ * @struct MB_LogRecord
+ * @brief One fixed-size (24-byte) record of a binary log, stored as is in the segment files.
+ */
+typedef struct
+{
+    int64_t t_ns;                              ///< Monotonic clock timestamp taken right before the request.
+    int32_t status;                            ///< `MB_OK`/`RRG_OK`, or the error code of the failed read.
+    uint8_t channel;                           ///< Stream the record belongs to (e.g., the index of the regulator).
+    uint8_t slave_id;                          ///< Slave address the registers were read from.
+    uint8_t register_count;                    ///< Number of valid registers (0 to `MB_LOG_MAX_REGISTERS`).
+    uint8_t reserved;                          ///< Always 0.
+    uint16_t registers[MB_LOG_MAX_REGISTERS];  ///< Raw registers read (the first `register_count` are valid).
+} MB_LogRecord;
+
+/**
+ * @struct MB_LogSegmentHeader
+ * @brief 64-byte header at the start of every segment file, followed by `capacity` records.
+ *
+ * Files are written in the byte order of the host (little-endian on every supported target).
+ * A reader maps the file and uses the first `count` records; the rest of the file is
+ * preallocated space. `count` is rewritten after each batch, so a segment being written is
+ * readable at any time.
+ */
+typedef struct
+{
+    char magic[8];          ///< `MB_LOG_MAGIC`.
+    uint32_t version;       ///< `MB_LOG_VERSION`.
+    uint32_t record_size;   ///< `sizeof(MB_LogRecord)`.
+    uint64_t capacity;      ///< Number of records the file has room for.
+    uint64_t count;         ///< Number of records written so far.
+    uint64_t sequence;      ///< Number of the segment, also part of its file name.
+    int64_t mono_origin_ns; ///< Monotonic clock when the segment was created...
+    int64_t wall_origin_ns; ///< ...and wall-clock time (ns since the Unix epoch) at the same moment.
+    uint8_t reserved[8];    ///< Always 0.
+} MB_LogSegmentHeader;
+
+/**
+ * @struct MB_LogConfig
+ * @brief Location and rotation policy of a binary log.
+ */
+typedef struct
+{
+    const char *directory; ///< Existing directory the segments are written to.
+    const char *prefix;    ///< File name prefix: segments are named `<prefix>-<sequence:06>.mblog`.
+    int segment_records;   ///< Records per segment (0 for `MB_LOG_DEFAULT_SEGMENT_RECORDS`).
+    int max_segments;      ///< Oldest segments beyond this number are deleted (0: keep all).
+} MB_LogConfig;
+
+/**
+ * @brief Opaque writer of a segment-rotated binary log.
+ *
+ * Records are appended in batches to preallocated segment files, so the steady state costs
+ * one buffered write per batch and neither text formatting nor file growth. When a segment
+ * is full the next one is created; numbering continues after the segments already in the
+ * directory, so a restarted application never overwrites an earlier run.
+ */
+typedef struct MB_Log MB_Log;
+
+/**
+ * @brief Opens a log and creates its first segment.
+ *
+ * @param config Location and rotation policy (the strings are copied).
+ * @param log Pointer that receives the log on success.
+ * @return `MB_OK` on success, `ERROR_MB_INVALID_PARAMETER`, `ERROR_MB_OUT_OF_MEMORY` or
+ *         `ERROR_MB_FAILED_OPEN_LOG` otherwise.
+ */
+MB_API int MB_LogOpen(const MB_LogConfig *MB_RESTRICT config, MB_Log **MB_RESTRICT log);
+
+/**
+ * @brief Appends records to the log and updates the record count of the segment header.
+ *
+ * Thread-safe: several acquisition threads may share one log. A batch that does not fit in
+ * the current segment continues in the next one. Records become visible to readers (and
+ * survive a crash of the process) when the call returns.
+ *
+ * A batch that fills the current segment opens and preallocates the next file in the calling
+ * thread, which allocates the stream and blocks on the disk.
+ *
+ * @param log Pointer to a log.
+ * @param records Records to append.
+ * @param count Number of records.
+ * @return `MB_OK` on success, otherwise an error code (`ERROR_MB_FAILED_WRITE_LOG`).
+ */
+MB_API int MB_LogAppend(MB_Log *MB_RESTRICT log, const MB_LogRecord *MB_RESTRICT records, int count);
+
+/**
+ * @brief Returns the total number of records appended since the log was opened.
+ *
+ * @param log Pointer to a log.
+ */
+MB_API uint64_t MB_LogGetRecordCount(MB_Log *log);
+
+/**
+ * @brief Reads the records of one channel from every segment of a log, oldest segment first.
+ *
+ * Only the directory and the prefix of `config` are used. Segments being written are read up
+ * to their current record count, and files that are no valid segment are skipped. Call it with
+ * `records` set to `NULL` to count the records, then again with room for them.
+ *
+ * @param config Directory and prefix of the log.
+ * @param channel Channel of the records to read, or -1 for all of them.
+ * @param records Receives the first `capacity` records (may be `NULL` if `capacity` is 0).
+ * @param capacity Room of `records`.
+ * @param count Receives the number of records of the channel in the log (possibly more than `capacity`).
+ * @return `MB_OK` on success, `ERROR_MB_INVALID_PARAMETER` or `ERROR_MB_FAILED_READ_LOG` otherwise.
+ */
+MB_API int MB_LogRead(const MB_LogConfig *MB_RESTRICT config, int channel, MB_LogRecord *MB_RESTRICT records,
+                      size_t capacity, size_t *MB_RESTRICT count);
+
+/**
+ * @brief Closes the current segment and frees the log.
+ *
+ * The unused preallocated tail of the last segment is kept; readers rely on `count` only.
+ *
+ * @param log Pointer to a log (may be `NULL`).
+ */
+MB_API void MB_LogClose(MB_Log *log);
+
+MB_END_DECLS
+
+#endif // !MB_LOG_H
@@ -0,0 +1,257 @@
+#ifndef MB_PLATFORM_H
+#define MB_PLATFORM_H
+
+/*
+ * Internal portability layer used by the device libraries (locks, condition variables, threads,
+ * clocks, atomics).
+ * It is not part of the public API and must not be included from public headers.
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+
+typedef SRWLOCK MB_Mutex;
+#define MB_MUTEX_INITIALIZER SRWLOCK_INIT
+
+static inline void _mbMutexInit(MB_Mutex *mutex) { InitializeSRWLock(mutex); }
+static inline void _mbMutexDestroy(MB_Mutex *mutex) { (void)mutex; }
+static inline void _mbMutexLock(MB_Mutex *mutex) { AcquireSRWLockExclusive(mutex); }
+static inline void _mbMutexUnlock(MB_Mutex *mutex) { ReleaseSRWLockExclusive(mutex); }
+
+typedef CONDITION_VARIABLE MB_Cond;
+#define MB_COND_INITIALIZER CONDITION_VARIABLE_INIT
+
+static inline void _mbCondInit(MB_Cond *cond) { InitializeConditionVariable(cond); }
+static inline void _mbCondDestroy(MB_Cond *cond) { (void)cond; }
+static inline void _mbCondWait(MB_Cond *cond, MB_Mutex *mutex) { SleepConditionVariableSRW(cond, mutex, INFINITE, 0); }
+static inline void _mbCondBroadcast(MB_Cond *cond) { WakeAllConditionVariable(cond); }
+
+typedef HANDLE MB_Thread;
+typedef DWORD(WINAPI *MB_ThreadRoutine)(void *arg);
+#define MB_THREAD_ROUTINE(name, arg) static DWORD WINAPI name(void *arg)
+#define MB_THREAD_RETURN return 0
+
+/// @brief Starts a thread running `routine(arg)`. Returns 0 on success.
+static inline int _mbThreadCreate(MB_Thread *thread, MB_ThreadRoutine routine, void *arg)
+{
+    *thread = CreateThread(NULL, 0, routine, arg, 0, NULL);
+    return *thread ? 0 : -1;
+}
+
+/// @brief Waits for the thread to finish and releases it.
+static inline void _mbThreadJoin(MB_Thread thread)
+{
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+/// @brief Returns a monotonic timestamp in nanoseconds.
+static inline int64_t _mbMonotonicNs()
+{
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (int64_t)((counter.QuadPart / frequency.QuadPart) * 1000000000LL +
+                     (counter.QuadPart % frequency.QuadPart) * 1000000000LL / frequency.QuadPart);
+}
+
+/// @brief Returns the wall-clock time in nanoseconds since the Unix epoch.
+static inline int64_t _mbRealtimeNs()
+{
+    FILETIME time; // 100 ns intervals since 1601-01-01.
+    GetSystemTimePreciseAsFileTime(&time);
+    uint64_t intervals = ((uint64_t)time.dwHighDateTime << 32) | time.dwLowDateTime;
+    return (int64_t)(intervals - 116444736000000000ULL) * 100;
+}
+
+/// @brief Sleeps until the monotonic clock reaches `deadline_ns` (millisecond granularity).
+static inline void _mbSleepUntilNs(int64_t deadline_ns)
+{
+    int64_t remaining_ns = deadline_ns - _mbMonotonicNs();
+    if (remaining_ns > 0)
+        Sleep((DWORD)((remaining_ns + 999999) / 1000000));
+}
+
+/// @brief Waits on `cond` until signalled or until the monotonic clock reaches `deadline_ns`.
+static inline void _mbCondWaitUntilNs(MB_Cond *cond, MB_Mutex *mutex, int64_t deadline_ns)
+{
+    int64_t remaining_ns = deadline_ns - _mbMonotonicNs();
+    SleepConditionVariableSRW(cond, mutex, remaining_ns > 0 ? (DWORD)((remaining_ns + 999999) / 1000000) : 0, 0);
+}
+
+/* x86/x64 loads and stores of aligned words are atomic; the compiler barrier orders them. */
+static inline size_t _mbAtomicLoadAcquire(const size_t *ptr)
+{
+    size_t value = *(const volatile size_t *)ptr;
+    _ReadWriteBarrier();
+    return value;
+}
+
+static inline void _mbAtomicStoreRelease(size_t *ptr, size_t value)
+{
+    _ReadWriteBarrier();
+    *(volatile size_t *)ptr = value;
+}
+
+static inline int _mbAtomicLoadInt(const int *ptr) { return *(const volatile int *)ptr; }
+static inline void _mbAtomicStoreInt(int *ptr, int value) { InterlockedExchange((volatile LONG *)ptr, value); }
+static inline void _mbAtomicIncU64(uint64_t *ptr) { InterlockedIncrement64((volatile LONG64 *)ptr); }
+static inline void _mbAtomicAddU64(uint64_t *ptr, uint64_t value) { InterlockedExchangeAdd64((volatile LONG64 *)ptr, (LONG64)value); }
+static inline uint64_t _mbAtomicLoadU64(const uint64_t *ptr) { return *(const volatile uint64_t *)ptr; }
+static inline void _mbAtomicStoreU64(uint64_t *ptr, uint64_t value) { InterlockedExchange64((volatile LONG64 *)ptr, (LONG64)value); }
+
+static inline int64_t _mbAtomicLoadAcquireI64(const int64_t *ptr)
+{
+    int64_t value = *(const volatile int64_t *)ptr;
+    _ReadWriteBarrier();
+    return value;
+}
+
+static inline void _mbAtomicStoreReleaseI64(int64_t *ptr, int64_t value)
+{
+    _ReadWriteBarrier();
+    *(volatile int64_t *)ptr = value;
+}
+
+/// @brief Restricts a thread to one CPU core. Returns 0 on success.
+static inline int _mbThreadSetAffinity(MB_Thread thread, int cpu)
+{
+    if (cpu < 0 || cpu >= (int)(sizeof(DWORD_PTR) * 8))
+        return -1;
+    return SetThreadAffinityMask(thread, (DWORD_PTR)1 << cpu) ? 0 : -1;
+}
+
+/// @brief Returns the index of the highest set bit of a non-zero value.
+static inline int _mbLog2U64(uint64_t value)
+{
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return (int)index;
+}
+#else
+#include <pthread.h>
+#include <time.h>
+
+typedef pthread_mutex_t MB_Mutex;
+#define MB_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+
+static inline void _mbMutexInit(MB_Mutex *mutex) { pthread_mutex_init(mutex, NULL); }
+static inline void _mbMutexDestroy(MB_Mutex *mutex) { pthread_mutex_destroy(mutex); }
+static inline void _mbMutexLock(MB_Mutex *mutex) { pthread_mutex_lock(mutex); }
+static inline void _mbMutexUnlock(MB_Mutex *mutex) { pthread_mutex_unlock(mutex); }
+
+typedef pthread_cond_t MB_Cond;
+#define MB_COND_INITIALIZER PTHREAD_COND_INITIALIZER ///< Static condition variable, for untimed waits only.
+
+/// @brief Initializes a condition variable whose timed waits follow the monotonic clock.
+static inline void _mbCondInit(MB_Cond *cond)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+static inline void _mbCondDestroy(MB_Cond *cond) { pthread_cond_destroy(cond); }
+static inline void _mbCondWait(MB_Cond *cond, MB_Mutex *mutex) { pthread_cond_wait(cond, mutex); }
+static inline void _mbCondBroadcast(MB_Cond *cond) { pthread_cond_broadcast(cond); }
+
+typedef pthread_t MB_Thread;
+typedef void *(*MB_ThreadRoutine)(void *arg);
+#define MB_THREAD_ROUTINE(name, arg) static void *name(void *arg)
+#define MB_THREAD_RETURN return NULL
+
+/// @brief Starts a thread running `routine(arg)`. Returns 0 on success.
+static inline int _mbThreadCreate(MB_Thread *thread, MB_ThreadRoutine routine, void *arg)
+{
+    return pthread_create(thread, NULL, routine, arg);
+}
+
+/// @brief Waits for the thread to finish and releases it.
+static inline void _mbThreadJoin(MB_Thread thread) { pthread_join(thread, NULL); }
+
+/// @brief Returns a monotonic timestamp in nanoseconds.
+static inline int64_t _mbMonotonicNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/// @brief Returns the wall-clock time in nanoseconds since the Unix epoch.
+static inline int64_t _mbRealtimeNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/// @brief Sleeps until the monotonic clock reaches `deadline_ns` (absolute deadline, no drift).
+static inline void _mbSleepUntilNs(int64_t deadline_ns)
+{
+    struct timespec ts = {(time_t)(deadline_ns / 1000000000LL), (long)(deadline_ns % 1000000000LL)};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ; // Interrupted by a signal: sleep again until the same absolute deadline.
+}
+
+/// @brief Waits on `cond` until signalled or until the monotonic clock reaches `deadline_ns`.
+static inline void _mbCondWaitUntilNs(MB_Cond *cond, MB_Mutex *mutex, int64_t deadline_ns)
+{
+    struct timespec ts = {(time_t)(deadline_ns / 1000000000LL), (long)(deadline_ns % 1000000000LL)};
+    pthread_cond_timedwait(cond, mutex, &ts);
+}
+
+static inline size_t _mbAtomicLoadAcquire(const size_t *ptr) { return __atomic_load_n(ptr, __ATOMIC_ACQUIRE); }
+static inline void _mbAtomicStoreRelease(size_t *ptr, size_t value) { __atomic_store_n(ptr, value, __ATOMIC_RELEASE); }
+static inline int _mbAtomicLoadInt(const int *ptr) { return __atomic_load_n(ptr, __ATOMIC_ACQUIRE); }
+static inline void _mbAtomicStoreInt(int *ptr, int value) { __atomic_store_n(ptr, value, __ATOMIC_RELEASE); }
+static inline void _mbAtomicIncU64(uint64_t *ptr) { __atomic_fetch_add(ptr, 1, __ATOMIC_RELAXED); }
+static inline void _mbAtomicAddU64(uint64_t *ptr, uint64_t value) { __atomic_fetch_add(ptr, value, __ATOMIC_RELAXED); }
+static inline uint64_t _mbAtomicLoadU64(const uint64_t *ptr) { return __atomic_load_n(ptr, __ATOMIC_RELAXED); }
+static inline void _mbAtomicStoreU64(uint64_t *ptr, uint64_t value) { __atomic_store_n(ptr, value, __ATOMIC_RELAXED); }
+static inline int64_t _mbAtomicLoadAcquireI64(const int64_t *ptr) { return __atomic_load_n(ptr, __ATOMIC_ACQUIRE); }
+static inline void _mbAtomicStoreReleaseI64(int64_t *ptr, int64_t value) { __atomic_store_n(ptr, value, __ATOMIC_RELEASE); }
+
+#if defined(__linux__) && defined(_GNU_SOURCE)
+/// @brief Restricts a thread to one CPU core. Returns 0 on success.
+static inline int _mbThreadSetAffinity(MB_Thread thread, int cpu)
+{
+    cpu_set_t set;
+    if (cpu < 0 || cpu >= CPU_SETSIZE)
+        return -1;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(thread, sizeof(set), &set) == 0 ? 0 : -1;
+}
+#else
+/// @brief Thread affinity is unavailable here (on Linux the translation unit must define `_GNU_SOURCE`).
+static inline int _mbThreadSetAffinity(MB_Thread thread, int cpu)
+{
+    (void)thread;
+    (void)cpu;
+    return -1;
+}
+#endif
+
+/// @brief Returns the index of the highest set bit of a non-zero value.
+static inline int _mbLog2U64(uint64_t value) { return 63 - __builtin_clzll(value); }
+#endif
+
+/// @brief Returns non-zero if a libmodbus `errno` means the port itself failed (e.g., an unplugged
+/// USB adapter or a gateway that dropped the connection), as opposed to a slave that did not
+/// answer or answered badly.
+static inline int _mbIsLinkError(int modbus_errno)
+{
+    return modbus_errno == EIO || modbus_errno == ENXIO || modbus_errno == ENODEV || modbus_errno == EBADF ||
+           modbus_errno == EPIPE || modbus_errno == ECONNRESET || modbus_errno == ECONNABORTED ||
+           modbus_errno == ENOTCONN;
+}
+
+#endif // !MB_PLATFORM_H
@@ -0,0 +1,168 @@
+#ifndef MB_POLLER_H
+#define MB_POLLER_H
+
+#include <stdint.h>
+
+#include "mb_bus.h"
+
+/**
+ * @def MB_POLL_MAX_REGISTERS
+ * @brief Largest register set one polling job may read.
+ */
+#define MB_POLL_MAX_REGISTERS 16
+
+/**
+ * @def MB_POLLER_MAX_JOBS
+ * @brief Maximum number of jobs of one poller.
+ */
+#define MB_POLLER_MAX_JOBS 64
+
+/**
+ * @def MB_POLLER_MAX_BUSES
+ * @brief Maximum number of buses (I/O threads) of one poller.
+ */
+#define MB_POLLER_MAX_BUSES 16
+
+/**
+ * @def MB_POLLER_DEFAULT_CAPACITY
+ * @brief Samples buffered per bus when `MB_PollerCreate()` is given a capacity of 0.
+ */
+#define MB_POLLER_DEFAULT_CAPACITY 8192
+
+/**
+ * @def MB_POLLER_STOP_POLL_US
+ * @brief Longest time an idle I/O thread sleeps before checking for `MB_PollerStop()` (in microseconds).
+ */
+#define MB_POLLER_STOP_POLL_US 10000
+
+MB_BEGIN_DECLS
+
+/**
+ * @struct MB_PollJob
+ * @brief Register set read periodically from one slave.
+ */
+typedef struct
+{
+    MB_Bus *bus;         ///< Bus of the slave (e.g., the `bus` of an `RRG_Handle`).
+    int slave_id;        ///< Slave address (1-247).
+    int first_register;  ///< Address of the first register to read.
+    int register_count;  ///< Number of registers to read (1 to `MB_POLL_MAX_REGISTERS`).
+    int input_registers; ///< Non-zero to read input registers (0x04) instead of holding registers (0x03).
+    int period_us;       ///< Polling period in microseconds.
+} MB_PollJob;
+
+/**
+ * @struct MB_PollSample
+ * @brief Timestamped result of one read of a polling job.
+ */
+typedef struct
+{
+    int64_t t_ns;                              ///< Monotonic clock timestamp taken right before the request.
+    int32_t job_id;                            ///< ID returned by `MB_PollerAddJob()`.
+    int32_t status;                            ///< `MB_OK`, `ERROR_MB_FAILED_READ`, or the bus error (e.g., a missed deadline).
+    int32_t modbus_errno;                      ///< libmodbus errno of a failed read (0 otherwise).
+    uint16_t registers[MB_POLL_MAX_REGISTERS]; ///< Registers read (the first `register_count` are valid).
+} MB_PollSample;
+
+/**
+ * @brief Opaque scheduler polling register sets on several buses in parallel.
+ *
+ * Every bus gets its own I/O thread, so adapters on different serial ports are polled
+ * concurrently and the aggregate sample rate grows with their number. On each bus the jobs
+ * run one at a time, earliest deadline first, inside regular bus transactions, so they
+ * interleave safely with the device handles attached to the same bus.
+ */
+typedef struct MB_Poller MB_Poller;
+
+/**
+ * @brief Creates an empty poller.
+ *
+ * @param capacity Samples buffered per bus until they are drained (0 for `MB_POLLER_DEFAULT_CAPACITY`);
+ *                 rounded up to a power of two.
+ * @param poller Pointer that receives the poller on success.
+ * @return `MB_OK` on success, otherwise an error code.
+ */
+MB_API int MB_PollerCreate(int capacity, MB_Poller **MB_RESTRICT poller);
+
+/**
+ * @brief Adds a job to a stopped poller.
+ *
+ * The poller keeps a reference to the bus of the job until `MB_PollerDestroy()`, so the
+ * port stays open even if the device handles on it are closed.
+ *
+ * @param poller Pointer to a poller.
+ * @param job Job to add (copied).
+ * @param job_id Optional pointer that receives the ID of the job (IDs start at 0), reported in its samples.
+ * @return `MB_OK` on success, `ERROR_MB_POLLER_RUNNING`, `ERROR_MB_POLLER_FULL` or
+ *         `ERROR_MB_INVALID_PARAMETER` otherwise.
+ */
+MB_API int MB_PollerAddJob(MB_Poller *MB_RESTRICT poller, const MB_PollJob *MB_RESTRICT job,
+                           int *MB_RESTRICT job_id);
+
+/**
+ * @brief Pins the I/O thread of one bus to a CPU core (applied by `MB_PollerStart()`).
+ *
+ * @param poller Pointer to a stopped poller.
+ * @param bus Bus of at least one job of the poller.
+ * @param cpu Core index, or -1 to let the scheduler place the thread.
+ * @return `MB_OK` on success, otherwise an error code.
+ */
+MB_API int MB_PollerSetCpu(MB_Poller *MB_RESTRICT poller, MB_Bus *MB_RESTRICT bus, int cpu);
+
+/**
+ * @brief Starts one I/O thread per bus. Samples left from a previous run are discarded.
+ *
+ * Each job is first read right away, then every `period_us` on absolute deadlines. After
+ * an overrun (a read, or the other jobs of the bus, took longer than the period) the schedule
+ * of the job restarts from now instead of firing a burst of catch-up reads.
+ *
+ * @param poller Pointer to a poller with at least one job.
+ * @return `MB_OK` on success, otherwise an error code (`ERROR_MB_FAILED_SET_AFFINITY` if a
+ *         requested core could not be used; no thread is left running then).
+ */
+MB_API int MB_PollerStart(MB_Poller *poller);
+
+/**
+ * @brief Stops the I/O threads and waits for them to exit.
+ *
+ * Samples already taken stay available to `MB_PollerDrain()` until the next start.
+ *
+ * @param poller Pointer to a poller.
+ */
+MB_API void MB_PollerStop(MB_Poller *poller);
+
+/**
+ * @brief Moves up to `max` samples of all buses into `samples`, merged in timestamp order.
+ *
+ * Every bus buffers its samples in its own lock-free single-producer/single-consumer ring.
+ * A sample is only handed out once no I/O thread can still produce an older one, so
+ * successive drains form one stream ordered by `t_ns`. A read in progress holds the stream
+ * back by at most its duration (bounded by the response timeout).
+ *
+ * Only one thread may drain a poller at a time.
+ *
+ * @param poller Pointer to a poller.
+ * @param samples Caller-provided array of at least `max` samples.
+ * @param max Capacity of `samples`.
+ * @return The number of samples copied (0 if none are pending), or `MB_ERR` on invalid parameters.
+ */
+MB_API int MB_PollerDrain(MB_Poller *MB_RESTRICT poller, MB_PollSample *MB_RESTRICT samples, int max) MB_HOT;
+
+/**
+ * @brief Returns how many samples were dropped because the ring of their bus was full.
+ *
+ * @param poller Pointer to a poller.
+ * @return The number of dropped samples since the poller was last started.
+ */
+MB_API uint64_t MB_PollerGetDroppedSamples(MB_Poller *poller);
+
+/**
+ * @brief Stops the poller, releases its buses and frees it.
+ *
+ * @param poller Pointer to a poller (may be `NULL`).
+ */
+MB_API void MB_PollerDestroy(MB_Poller *poller);
+
+MB_END_DECLS
+
+#endif // !MB_POLLER_H
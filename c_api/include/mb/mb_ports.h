@@ -0,0 +1,58 @@
+#ifndef MB_PORTS_H
+#define MB_PORTS_H
+
+#include "mb_errors.h"
+#include "mb_preprocessor_macros.h"
+
+/**
+ * @def MB_PORT_NAME_MAX
+ * @brief Size of the buffer holding one port name, terminating NUL included.
+ */
+#define MB_PORT_NAME_MAX 64
+
+/**
+ * @def MB_MAX_PORTS
+ * @brief Largest number of serial ports kept by the port scan.
+ */
+#define MB_MAX_PORTS 64
+
+/**
+ * @def MB_PORT_SCAN_CACHE_MS
+ * @brief Age after which the port list is scanned again where the OS offers no cheap change
+ *        detection (Windows).
+ */
+#define MB_PORT_SCAN_CACHE_MS 1000
+
+MB_BEGIN_DECLS
+
+/**
+ * @struct MB_PortName
+ * @brief Name of a serial port, as passed to `MB_BusConfig::port` (e.g., "/dev/ttyUSB0" or "COM3").
+ */
+typedef struct
+{
+    char name[MB_PORT_NAME_MAX]; ///< NUL-terminated port name.
+} MB_PortName;
+
+/**
+ * @brief Lists the serial ports a bus can be opened on, in natural order ("ttyUSB2" before "ttyUSB10").
+ *
+ * The list is scanned once and cached. On POSIX systems it is scanned again only when the
+ * modification time of `/dev` changes, which happens whenever an adapter is plugged in or
+ * removed, so polling this function (e.g., from a UI timer) costs a single `stat()`. On
+ * Windows the serial devices known to the object manager are listed and the result expires
+ * after `MB_PORT_SCAN_CACHE_MS`. No process is spawned. Thread-safe.
+ *
+ * On POSIX systems USB and on-board UARTs are listed (`ttyUSB*`, `ttyACM*`, `ttyAMA*`,
+ * `ttyXRUSB*`, `rfcomm*`, and `cu.usbserial*`/`cu.usbmodem*` on macOS); the legacy `ttyS*`
+ * nodes are skipped, as most of them exist whether or not hardware is behind them.
+ *
+ * @param ports Array that receives the port names (may be `NULL` if `max` is 0).
+ * @param max Capacity of `ports`.
+ * @return The number of ports stored (at most `max`), or `MB_ERR` on invalid parameters.
+ */
+MB_API int MB_EnumeratePorts(MB_PortName *ports, int max);
+
+MB_END_DECLS
+
+#endif // !MB_PORTS_H
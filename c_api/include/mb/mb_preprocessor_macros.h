@@ -0,0 +1,87 @@
+#ifndef MB_PREPROCESSOR_MACROS_H
+#define MB_PREPROCESSOR_MACROS_H
+
+/* Cross-platform definition of the `restrict` keyword for compiler optimization. */
+#if defined(_MSC_VER)
+#define MB_RESTRICT __restrict
+#elif defined(__GNUC__) || defined(__clang__)
+#define MB_RESTRICT __restrict__
+#else
+#define MB_RESTRICT
+#endif
+
+/* Cross-platform thread-local storage class for per-thread error state. */
+#if defined(_MSC_VER)
+#define MB_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__) || defined(__clang__)
+#define MB_THREAD_LOCAL __thread
+#else
+#define MB_THREAD_LOCAL _Thread_local
+#endif
+
+/* Cross-platform shared library export macros */
+#if defined(_MSC_VER) // Windows (Microsoft Visual Studio)
+#if defined(MB_DLL_EXPORTS)
+#define MB_API __declspec(dllexport)
+#else
+#define MB_API __declspec(dllimport)
+#endif
+#else // Linux/macOS
+#define MB_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+#define MB_BEGIN_DECLS \
+    extern "C"          \
+    {
+#define MB_END_DECLS }
+#else
+#define MB_BEGIN_DECLS
+#define MB_END_DECLS
+#endif
+
+/* Likely/Unlikely branch prediction hints */
+#if defined(__GNUC__) || defined(__clang__)
+#define likely(x) __builtin_expect(!!(x), 1)
+#define unlikely(x) __builtin_expect(!!(x), 0)
+#else
+#define likely(x) (x)
+#define unlikely(x) (x)
+#endif
+
+/* Function attributes for optimization */
+#if defined(__GNUC__) || defined(__clang__)
+#define MB_HOT __attribute__((hot))
+#define MB_PURE __attribute__((pure))
+#define MB_CONST __attribute__((const))
+#else
+#define MB_HOT
+#define MB_PURE
+#define MB_CONST
+#endif
+
+#ifdef __linux__
+#define MB_COMMON_PRETTY_FUNC __PRETTY_FUNCTION__
+#elif defined(_WIN32)
+#define MB_COMMON_PRETTY_FUNC __FUNCSIG__
+#else
+#define MB_COMMON_PRETTY_FUNC __func__
+#endif
+
+#define MB_STRINGIFY(x) MB_STRINGIFY_IMPL(x)
+#define MB_STRINGIFY_IMPL(x) #x
+
+#define MB_DEBUG_FMT "MB DEBUG: [File: %s, Line: %d, Function: %s]"
+#define MB_DEBUG_ARGS __FILE__, __LINE__, MB_COMMON_PRETTY_FUNC
+
+#ifdef MB_DEBUG
+#define MB_MODBUS_DEBUG_MSG fprintf(stderr, MB_DEBUG_FMT ": %s\n", MB_DEBUG_ARGS, modbus_strerror(errno));
+#define MB_DEBUG_MSG(msg) fprintf(stderr, MB_DEBUG_FMT ": %s\n", MB_DEBUG_ARGS, msg);
+#define MB_DEBUG_GET_LAST_ERR fprintf(stderr, MB_DEBUG_FMT ": %s\n", MB_DEBUG_ARGS, MB_GetLastError());
+#else
+#define MB_MODBUS_DEBUG_MSG
+#define MB_DEBUG_MSG(msg)
+#define MB_DEBUG_GET_LAST_ERR
+#endif
+
+#endif // !MB_PREPROCESSOR_MACROS_H
@@ -0,0 +1,110 @@
+#ifndef MB_RING_H
+#define MB_RING_H
+
+/*
+ * Internal single-producer/single-consumer lock-free ring buffer of fixed-size records.
+ * One thread may push while another one pops, without any lock. It is not part of the
+ * public API and must not be included from public headers.
+ */
+
+#include <string.h>
+
+#include "mb_alloc.h"
+#include "mb_platform.h"
+
+/**
+ * @struct MB_Ring
+ * @brief Ring of `capacity` records of `record_size` bytes; `capacity` is a power of two.
+ */
+typedef struct
+{
+    unsigned char *records; ///< Storage for `capacity` records.
+    size_t record_size;     ///< Size of one record in bytes.
+    size_t mask;            ///< `capacity - 1`, used to wrap indexes.
+    size_t head;            ///< Total number of records pushed (written by the producer only).
+    size_t tail;            ///< Total number of records popped (written by the consumer only).
+    uint64_t dropped;       ///< Records rejected because the ring was full.
+    MB_Arena *arena;        ///< Arena `records` comes from (`NULL`: the heap).
+} MB_Ring;
+
+/// @brief Allocates the ring from `arena` (the heap if `NULL`); `capacity` is rounded up to a power
+/// of two. Returns 0 on success.
+static inline int _mbRingInit(MB_Ring *ring, size_t record_size, size_t capacity, MB_Arena *arena)
+{
+    size_t rounded = 1;
+    while (rounded < capacity)
+        rounded <<= 1;
+
+    memset(ring, 0, sizeof(*ring));
+    ring->records = _mbAlloc(arena, rounded * record_size);
+    if (!ring->records)
+        return -1;
+    ring->record_size = record_size;
+    ring->mask = rounded - 1;
+    ring->arena = arena;
+    return 0;
+}
+
+/// @brief Empties the ring and clears its drop counter, keeping the storage. Neither side may use the ring meanwhile.
+static inline void _mbRingReset(MB_Ring *ring)
+{
+    ring->head = 0;
+    ring->tail = 0;
+    ring->dropped = 0;
+}
+
+/// @brief Releases the ring storage. Neither side may use the ring afterwards.
+static inline void _mbRingDestroy(MB_Ring *ring)
+{
+    _mbFree(ring->arena, ring->records);
+    ring->records = NULL;
+}
+
+/// @brief Producer side: copies one record into the ring. Returns 0, or -1 if the ring is full.
+static inline int _mbRingPush(MB_Ring *ring, const void *record)
+{
+    size_t head = ring->head, tail = _mbAtomicLoadAcquire(&ring->tail);
+    if (head - tail > ring->mask)
+    {
+        _mbAtomicIncU64(&ring->dropped);
+        return -1;
+    }
+
+    memcpy(ring->records + (head & ring->mask) * ring->record_size, record, ring->record_size);
+    _mbAtomicStoreRelease(&ring->head, head + 1);
+    return 0;
+}
+
+/// @brief Consumer side: moves up to `max` records into `out`. Returns the number of records copied.
+static inline size_t _mbRingPop(MB_Ring *ring, void *out, size_t max)
+{
+    size_t tail = ring->tail, head = _mbAtomicLoadAcquire(&ring->head);
+    size_t count = head - tail < max ? head - tail : max;
+    if (!count)
+        return 0;
+
+    // Copy in at most two contiguous chunks: up to the end of the storage, then from its start.
+    size_t first = (tail & ring->mask), chunk = ring->mask + 1 - first;
+    if (chunk > count)
+        chunk = count;
+    memcpy(out, ring->records + first * ring->record_size, chunk * ring->record_size);
+    if (count > chunk)
+        memcpy((unsigned char *)out + chunk * ring->record_size, ring->records, (count - chunk) * ring->record_size);
+
+    _mbAtomicStoreRelease(&ring->tail, tail + count);
+    return count;
+}
+
+/// @brief Consumer side: returns the oldest record without removing it, or `NULL` if the ring is empty.
+static inline const void *_mbRingPeek(MB_Ring *ring)
+{
+    size_t tail = ring->tail;
+    if (_mbAtomicLoadAcquire(&ring->head) == tail)
+        return NULL;
+    return ring->records + (tail & ring->mask) * ring->record_size;
+}
+
+/// @brief Consumer side: removes the record returned by `_mbRingPeek()`.
+static inline void _mbRingSkip(MB_Ring *ring) { _mbAtomicStoreRelease(&ring->tail, ring->tail + 1); }
+
+#endif // !MB_RING_H
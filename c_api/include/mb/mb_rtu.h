@@ -0,0 +1,173 @@
+#ifndef MB_RTU_H
+#define MB_RTU_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mb_bus.h"
+
+/**
+ * @def MB_RTU_FRAME_MAX_REGISTERS
+ * @brief Largest number of registers a prepared write request may carry (a broadcast included).
+ */
+#define MB_RTU_FRAME_MAX_REGISTERS MB_BROADCAST_MAX_REGISTERS
+
+/**
+ * @def MB_RTU_FRAME_SIZE
+ * @brief Size of the request buffer of a prepared frame (the largest write, CRC included).
+ */
+#define MB_RTU_FRAME_SIZE MB_RTU_WRITE_MULTIPLE_REQUEST_SIZE(MB_RTU_FRAME_MAX_REGISTERS)
+
+/**
+ * @def MB_RTU_MAX_ADU_SIZE
+ * @brief Largest MODBUS-RTU frame (slave address, PDU and CRC) in bytes.
+ */
+#define MB_RTU_MAX_ADU_SIZE 256
+
+MB_BEGIN_DECLS
+
+/**
+ * @struct MB_RtuFrame
+ * @brief Request template of the fast RTU transport, prepared once per device operation.
+ *
+ * The slave address, function code, register address and count are encoded when the frame
+ * is prepared, together with the CRC of these header bytes. Sending it then only patches the
+ * register values (for writes) and finishes the CRC over them; a read request is sent as is.
+ * A write prepared for slave 0 is a broadcast: it is sent without waiting for a response.
+ */
+typedef struct
+{
+    uint8_t request[MB_RTU_FRAME_SIZE]; ///< Request frame; the header is filled in by `MB_RtuPrepare*()`.
+    uint8_t request_size;               ///< Length of the request, CRC included.
+    uint8_t payload_offset;             ///< Offset of the first register value in `request` (writes).
+    uint8_t register_count;             ///< Registers read or written.
+    uint8_t function;                   ///< MODBUS function code (0x03, 0x04, 0x06 or 0x10).
+    uint16_t header_crc;                ///< CRC of the bytes before the payload, the seed of the CRC of each request.
+    uint16_t response_size;             ///< Length of a normal response, CRC included.
+} MB_RtuFrame;
+
+/**
+ * @struct MB_RtuPort
+ * @brief Serial port (or RTU-over-TCP connection) driven by the fast RTU transport, with its
+ * preallocated response buffer.
+ */
+typedef struct
+{
+    int fd;                                ///< File descriptor of the port (-1 if none).
+    int dirty;                             ///< Non-zero when unread bytes of a failed exchange may be pending.
+    int stream;                            ///< Non-zero if `fd` is a socket rather than a serial port.
+    uint8_t response[MB_RTU_MAX_ADU_SIZE]; ///< Receives the responses.
+} MB_RtuPort;
+
+/**
+ * @brief Computes the MODBUS CRC-16 of `length` bytes, table-driven.
+ * @param crc Starting value: `0xFFFF` for a new frame, or the CRC of the preceding bytes.
+ * @return The CRC, to be sent low byte first.
+ */
+MB_API uint16_t MB_RtuCrc16(uint16_t crc, const uint8_t *MB_RESTRICT data, size_t length);
+
+/**
+ * @brief Prepares a "Read Holding Registers" (0x03) request; the whole frame is constant.
+ * @param count Number of registers (1 to `MODBUS_MAX_READ_REGISTERS`, i.e. 125).
+ * @return `MB_OK` on success, or `MB_ERR` with `ERROR_MB_INVALID_PARAMETER`.
+ */
+MB_API int MB_RtuPrepareRead(MB_RtuFrame *MB_RESTRICT frame, int slave_id, int addr, int count);
+
+/**
+ * @brief Prepares a "Read Input Registers" (0x04) request, see `MB_RtuPrepareRead()`.
+ * @return `MB_OK` on success, or `MB_ERR` with `ERROR_MB_INVALID_PARAMETER`.
+ */
+MB_API int MB_RtuPrepareReadInput(MB_RtuFrame *MB_RESTRICT frame, int slave_id, int addr, int count);
+
+/**
+ * @brief Prepares a write request: "Write Single Register" (0x06) if `multiple` is 0 (then
+ * `count` must be 1), "Write Multiple Registers" (0x10) otherwise.
+ * @param count Number of registers (1 to `MB_RTU_FRAME_MAX_REGISTERS`).
+ * @return `MB_OK` on success, or `MB_ERR` with `ERROR_MB_INVALID_PARAMETER`.
+ */
+MB_API int MB_RtuPrepareWrite(MB_RtuFrame *MB_RESTRICT frame, int slave_id, int addr, int count, int multiple);
+
+/**
+ * @brief Binds a port to the fast transport and tunes it for latency.
+ *
+ * Reads return as soon as a byte arrives (`VMIN` = `VTIME` = 0) and, where the driver supports
+ * it (Linux `ASYNC_LOW_LATENCY`), the UART hands received bytes over immediately instead of
+ * batching them for up to a tick. The tuning is best effort: ports that refuse it (e.g.,
+ * pseudo-terminals) are used as they are. A descriptor that is no terminal is taken for a
+ * connected stream socket (see `MB_RtuOpenTcp()`).
+ *
+ * @param fd File descriptor of the open serial port (e.g., `modbus_get_socket()` of an RTU context).
+ * @return `MB_OK` on success, or `MB_ERR` with `ERROR_MB_NOT_SUPPORTED` if the platform has no
+ *         descriptor based serial I/O (Windows).
+ */
+MB_API int MB_RtuOpenPort(MB_RtuPort *MB_RESTRICT port, int fd);
+
+/**
+ * @brief Connects to a serial device server that forwards raw RTU frames over TCP ("RTU over
+ * TCP") and binds the connection to the fast transport.
+ *
+ * Every address `host` resolves to is tried in turn, each within `timeout_us`. The socket is
+ * non-blocking and sends without delay (`TCP_NODELAY`), as every request is one small frame
+ * that waits for its response.
+ *
+ * @param host Host name or address of the gateway.
+ * @param service TCP port of the gateway (e.g., "502" or "4001").
+ * @param timeout_us Time allowed to establish one connection (in microseconds).
+ * @return `MB_OK` on success, otherwise `MB_ERR` (`ERROR_MB_FAILED_CONNECT` with `errno` set,
+ *         or `ERROR_MB_NOT_SUPPORTED` on Windows).
+ */
+MB_API int MB_RtuOpenTcp(MB_RtuPort *MB_RESTRICT port, const char *MB_RESTRICT host, const char *MB_RESTRICT service,
+                         int timeout_us);
+
+/**
+ * @brief Closes the connection opened by `MB_RtuOpenTcp()` (serial ports belong to their
+ * libmodbus context and are only unbound).
+ */
+MB_API void MB_RtuClosePort(MB_RtuPort *port);
+
+/**
+ * @brief Sends a prepared request and reads its response straight into the buffer of the port.
+ *
+ * The response is checked (slave, function, CRC, echoed address and count) and exception
+ * responses are reported, with `errno` set to the values libmodbus uses (`ETIMEDOUT`,
+ * `EMBBADCRC`, `EMBXILFUN`, ...), so callers classify failures the same way on both transports.
+ * The first byte must arrive within `timeout_us`, each following one within `byte_timeout_us`.
+ *
+ * A broadcast (slave 0) returns as soon as the frame is sent.
+ *
+ * @param payload Register values of a write request (`frame->register_count` of them), else ignored.
+ * @param dest Receives the registers of a read request (may be `NULL` for writes).
+ * @return The number of registers read or written, or `MB_ERR` on failure.
+ */
+MB_API int MB_RtuExecute(MB_RtuPort *MB_RESTRICT port, MB_RtuFrame *MB_RESTRICT frame,
+                         const uint16_t *MB_RESTRICT payload, uint16_t *MB_RESTRICT dest, int timeout_us,
+                         int byte_timeout_us);
+
+/**
+ * @brief Enables the fast RTU transport on a bus.
+ *
+ * Afterwards `MB_BusRtuExecute()` may be used within transactions next to the libmodbus
+ * calls, which keep working on the same port. The port stays tuned across reconnects.
+ * Enabling it again is a no-op, and so is enabling it on an RTU-over-TCP bus, which always
+ * uses this transport. Safe to call while other threads use the bus.
+ *
+ * @return `MB_OK` on success, or `MB_ERR` with `ERROR_MB_NOT_SUPPORTED` if the port cannot be
+ *         driven directly (the caller keeps using libmodbus), e.g., on a MODBUS TCP bus.
+ */
+MB_API int MB_BusEnableFastRtu(MB_Bus *bus);
+
+/**
+ * @brief Runs a prepared request within a transaction (see `MB_BusBeginTransaction()`),
+ * with the response and byte timeouts of the slave.
+ *
+ * The frame must address the slave of the transaction. See `MB_RtuExecute()` for the
+ * arguments and the error reporting.
+ *
+ * @return The number of registers read or written, or `MB_ERR` on failure.
+ */
+MB_API int MB_BusRtuExecute(MB_Bus *MB_RESTRICT bus, MB_RtuFrame *MB_RESTRICT frame,
+                            const uint16_t *MB_RESTRICT payload, uint16_t *MB_RESTRICT dest);
+
+MB_END_DECLS
+
+#endif // !MB_RTU_H
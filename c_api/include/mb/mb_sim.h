@@ -0,0 +1,200 @@
+#ifndef MB_SIM_H
+#define MB_SIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mb_log.h"
+#include "mb_rtu.h"
+
+/**
+ * @def MB_SIM_NAME_MAX
+ * @brief Longest name of a simulated line, terminating NUL included.
+ */
+#define MB_SIM_NAME_MAX 64
+
+/**
+ * @def MB_SIM_MAX_SLAVES
+ * @brief Maximum number of slaves on one simulated line.
+ */
+#define MB_SIM_MAX_SLAVES 16
+
+/**
+ * @def MB_SIM_DEFAULT_STEP_US
+ * @brief Simulated time a read of the value advances at speed 0 when `MB_SimConfig::step_us` is 0.
+ */
+#define MB_SIM_DEFAULT_STEP_US 10000
+
+MB_BEGIN_DECLS
+
+/**
+ * @struct MB_SimConfig
+ * @brief Name and clock of a simulated line.
+ *
+ * The simulated clock starts at 0 when the line is opened. At a positive `speed` it runs
+ * that many times faster than the monotonic clock (100 replays a recording at 100x). At
+ * speed 0 every slave has its own clock, advanced by each read of its value: a recording
+ * then moves one record per read and is replayed as fast as the devices are polled.
+ */
+typedef struct
+{
+    const char *name; ///< Name the line is opened by: the `port` of an `MB_TRANSPORT_SIM` bus (copied).
+    double speed;     ///< Simulated seconds per real second (1: real time), or 0 to advance per read.
+    int step_us;      ///< Simulated time a read advances at speed 0 without a recording (0: the default).
+    int loop;         ///< Non-zero to restart the recordings at their end; otherwise their last record holds.
+    int latency_us;   ///< Time every request takes, as the line would (0: answered at once).
+} MB_SimConfig;
+
+/**
+ * @struct MB_SimSlave
+ * @brief Simulated slave: a register image with one value that follows a setpoint.
+ *
+ * Every register reads as written (0 until then), through functions 0x03 and 0x04 alike.
+ * The value is either replayed from a recording (see `MB_SimLoadRecording()`) or, once a
+ * setpoint is written (in one request, or one register at a time with function 0x06 once
+ * every word was), follows it as a first-order lag: it covers 63% of a step within
+ * `time_constant_ms` of simulated time. A replay thus runs until the first setpoint write,
+ * and the response starts from the replayed value. With a `width` of 0 the slave is a plain
+ * register image (e.g., a relay).
+ */
+typedef struct
+{
+    int slave_id;              ///< Address of the slave (1 to `MB_MAX_SLAVE_ID`).
+    uint16_t value_address;    ///< First register of the simulated value (e.g., the measured flow).
+    uint16_t setpoint_address; ///< First register of the setpoint the value follows.
+    uint8_t width;             ///< Registers of the value and of the setpoint (0, 1, or 2 high word first).
+    uint8_t flags;             ///< `MB_REGISTER_SIGNED` if both hold two's complement integers.
+    int time_constant_ms;      ///< Time constant of the lag in simulated time (0: the setpoint is reached at once).
+} MB_SimSlave;
+
+/**
+ * @brief Opaque simulated line, shared by the buses that open it by name.
+ *
+ * A bus opened with `MB_TRANSPORT_SIM` hands its requests to the line registered under its
+ * `port` instead of a serial port, so every device library, the acquisition and the poller
+ * run unchanged against it: no hardware is needed to test a control change or to load the
+ * application at many times the real data rate. Requests are framed exactly as on the fast
+ * RTU transport, and answered with the `errno` values of a real slave.
+ */
+typedef struct MB_Sim MB_Sim;
+
+/**
+ * @brief Creates a simulated line and registers it under its name.
+ *
+ * @param config Name and clock of the line.
+ * @param sim Pointer that receives the line on success.
+ * @return `MB_OK` on success, `ERROR_MB_INVALID_PARAMETER`, `ERROR_MB_CONFIG_MISMATCH` (the name
+ *         is taken) or `ERROR_MB_OUT_OF_MEMORY` otherwise.
+ */
+MB_API int MB_SimOpen(const MB_SimConfig *MB_RESTRICT config, MB_Sim **MB_RESTRICT sim);
+
+/**
+ * @brief Adds a slave to the line; safe while buses use it.
+ *
+ * @param sim Pointer to a simulated line.
+ * @param slave Description of the slave.
+ * @return `MB_OK` on success, `ERROR_MB_INVALID_PARAMETER` (bad description, address taken or
+ *         `MB_SIM_MAX_SLAVES` reached) or `ERROR_MB_OUT_OF_MEMORY`.
+ */
+MB_API int MB_SimAddSlave(MB_Sim *MB_RESTRICT sim, const MB_SimSlave *MB_RESTRICT slave);
+
+/**
+ * @brief Writes registers of a slave directly, as its firmware would (e.g., a status word).
+ *
+ * A write to the setpoint does not start the lag, unlike one made through a bus.
+ *
+ * @return `MB_OK` on success, otherwise `ERROR_MB_INVALID_PARAMETER`.
+ */
+MB_API int MB_SimSetRegisters(MB_Sim *MB_RESTRICT sim, int slave_id, int addr, int count,
+                              const uint16_t *MB_RESTRICT regs);
+
+/**
+ * @brief Reads registers of a slave directly, without advancing its clock (e.g., to check the
+ * setpoint a test wrote).
+ *
+ * @return `MB_OK` on success, otherwise `ERROR_MB_INVALID_PARAMETER`.
+ */
+MB_API int MB_SimGetRegisters(MB_Sim *MB_RESTRICT sim, int slave_id, int addr, int count, uint16_t *MB_RESTRICT dest);
+
+/**
+ * @brief Makes the value of a slave replay recorded reads, from the start of the simulated clock.
+ *
+ * The records are copied; their timestamps set the pace (only their differences matter).
+ * Each holds the registers of the value as read (`register_count` at least `width`); a
+ * record of a failed read makes the reads at its time fail with `ETIMEDOUT`, as the recorded
+ * one did. Loading a recording again restarts the replay of the slave and ends its lag.
+ *
+ * @param records Records of one stream in time order (e.g., one channel of a flow log).
+ * @param count Number of records (at least 1).
+ * @return `MB_OK` on success, `ERROR_MB_INVALID_PARAMETER` or `ERROR_MB_OUT_OF_MEMORY` otherwise.
+ */
+MB_API int MB_SimLoadRecording(MB_Sim *MB_RESTRICT sim, int slave_id, const MB_LogRecord *MB_RESTRICT records,
+                               size_t count);
+
+/**
+ * @brief Loads one channel of a binary log (see `MB_LogRead()`) as the recording of a slave.
+ *
+ * @param config Directory and prefix of the log.
+ * @param channel Channel of the records to replay.
+ * @return `MB_OK` on success, `ERROR_MB_FAILED_READ_LOG` if the log has no record of the
+ *         channel or cannot be read, `ERROR_MB_INVALID_PARAMETER` or `ERROR_MB_OUT_OF_MEMORY`.
+ */
+MB_API int MB_SimLoadLog(MB_Sim *MB_RESTRICT sim, int slave_id, const MB_LogConfig *MB_RESTRICT config, int channel);
+
+/**
+ * @brief Changes the speed of the simulated clock; the simulated time goes on from where it is.
+ *
+ * @param speed Simulated seconds per real second, or 0 to advance per read (see `MB_SimConfig`).
+ * @return `MB_OK` on success, otherwise `ERROR_MB_INVALID_PARAMETER`.
+ */
+MB_API int MB_SimSetSpeed(MB_Sim *sim, double speed);
+
+/**
+ * @brief Returns the number of requests the line answered or failed so far.
+ */
+MB_API uint64_t MB_SimGetRequestCount(MB_Sim *sim);
+
+/**
+ * @brief Unregisters the line and drops the reference of its owner.
+ *
+ * The buses still using it fail their requests from then on as if the port was unplugged
+ * (`ENOTCONN`), and reattach by name in the background: a line opened again under the same
+ * name takes over, as a replugged adapter would.
+ *
+ * @param sim Pointer to a simulated line (may be `NULL`).
+ */
+MB_API void MB_SimClose(MB_Sim *sim);
+
+/**
+ * @brief Takes a reference to the open line registered under `name` (used by the buses).
+ *
+ * @param name Name of the line.
+ * @param sim Pointer that receives the line on success.
+ * @return `MB_OK` on success, otherwise `ERROR_MB_FAILED_CONNECT` (no such line).
+ */
+MB_API int MB_SimAttach(const char *MB_RESTRICT name, MB_Sim **MB_RESTRICT sim);
+
+/**
+ * @brief Drops a reference taken with `MB_SimAttach()`; the last one frees the line.
+ *
+ * @param sim Pointer to a simulated line (may be `NULL`).
+ */
+MB_API void MB_SimRelease(MB_Sim *sim);
+
+/**
+ * @brief Answers a prepared request (see `MB_RtuExecute()`, whose result and `errno` values it
+ * reproduces).
+ *
+ * An unknown slave does not answer (`ETIMEDOUT`), registers past the end of the address space
+ * are an exception (`EMBXILADD`), and a broadcast (slave 0) writes every slave.
+ *
+ * @param payload Register values of a write request (`frame->register_count` of them), else ignored.
+ * @param dest Receives the registers of a read request (may be `NULL` for writes).
+ * @return The number of registers read or written, or `MB_ERR` on failure.
+ */
+MB_API int MB_SimExecute(MB_Sim *MB_RESTRICT sim, const MB_RtuFrame *MB_RESTRICT frame,
+                         const uint16_t *MB_RESTRICT payload, uint16_t *MB_RESTRICT dest) MB_HOT;
+
+MB_END_DECLS
+
+#endif // !MB_SIM_H
@@ -0,0 +1,87 @@
+#ifndef MB_STATS_H
+#define MB_STATS_H
+
+/*
+ * Internal helpers that update the `MB_TrafficCounters` and `MB_LatencyHistogram` of a
+ * device handle. Every update is a relaxed atomic increment, so handles polled from
+ * several threads (caller, I/O worker, acquisition) can share their counters. It is not
+ * part of the public API and must not be included from public headers.
+ */
+
+#ifdef _WIN32
+#include "modbus.h"
+#else
+#include <modbus/modbus.h>
+#endif
+
+#include <errno.h>
+#include <string.h>
+
+#include "mb_bus.h"
+#include "mb_platform.h"
+
+/// @brief Returns the histogram bucket of a duration given in microseconds.
+static inline int _mbLatencyBucket(uint64_t us)
+{
+    if (us < MB_LATENCY_LINEAR_US)
+        return (int)us;
+    int log2 = _mbLog2U64(us);
+    if (log2 >= MB_LATENCY_MAX_LOG2_US)
+        return MB_LATENCY_BUCKETS - 1;
+
+    // The top `MB_LATENCY_SUB_BUCKET_BITS` bits below the leading one select the sub-bucket.
+    int sub = (int)(us >> (log2 - MB_LATENCY_SUB_BUCKET_BITS)) - MB_LATENCY_SUB_BUCKETS;
+    return MB_LATENCY_LINEAR_US + (log2 - MB_LATENCY_SUB_BUCKET_BITS - 1) * MB_LATENCY_SUB_BUCKETS + sub;
+}
+
+/// @brief Records the duration of one transaction in a histogram.
+static inline void _mbRecordLatency(MB_LatencyHistogram *histogram, int64_t elapsed_ns)
+{
+    uint64_t us = elapsed_ns > 0 ? (uint64_t)(elapsed_ns / 1000) : 0;
+    _mbAtomicIncU64(&histogram->count);
+    _mbAtomicAddU64(&histogram->total_us, us);
+    _mbAtomicIncU64(&histogram->buckets[_mbLatencyBucket(us)]);
+}
+
+/// @brief Counts one request sent on the line and, if it succeeded, its response.
+/// On failure `modbus_errno` tells a timeout, a CRC error and an exception response apart.
+static inline void _mbCountRequest(MB_TrafficCounters *counters, int sent, int received, int succeeded,
+                                   int modbus_errno)
+{
+    _mbAtomicAddU64(&counters->bytes_sent, (uint64_t)sent);
+    if (succeeded)
+    {
+        _mbAtomicAddU64(&counters->bytes_received, (uint64_t)received);
+        return;
+    }
+    if (modbus_errno == ETIMEDOUT)
+        _mbAtomicIncU64(&counters->timeouts);
+    else if (modbus_errno == EMBBADCRC)
+        _mbAtomicIncU64(&counters->crc_errors);
+    else if (modbus_errno >= EMBXILFUN && modbus_errno <= EMBXGTAR)
+        _mbAtomicIncU64(&counters->exceptions);
+}
+
+/// @brief Counts one transaction and its outcome.
+static inline void _mbCountTransaction(MB_TrafficCounters *counters, int succeeded)
+{
+    _mbAtomicIncU64(&counters->transactions);
+    if (!succeeded)
+        _mbAtomicIncU64(&counters->failures);
+}
+
+/// @brief Copies `count` counters with atomic loads, so concurrent updates are never torn.
+static inline void _mbLoadCounters(uint64_t *dst, const uint64_t *src, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        dst[i] = _mbAtomicLoadU64(&src[i]);
+}
+
+/// @brief Zeroes `count` counters with atomic stores, so threads updating them meanwhile never race the reset.
+static inline void _mbResetCounters(uint64_t *counters, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        _mbAtomicStoreU64(&counters[i], 0);
+}
+
+#endif // !MB_STATS_H
@@ -1,9 +1,13 @@
 #ifndef RELAY_H
 #define RELAY_H
 
+#include <stdint.h>
+
 #include "relay_constants.h"
 #include "relay_errors.h"
 #include "relay_preprocessor_macros.h"
+#include "mb_bus.h"
+#include "mb_device.h"
 
 #define RELAY_CHECK_PTR(ptr, checking_result)           \
     if (!ptr)                                           \
@@ -29,32 +33,93 @@ RELAY_BEGIN_DECLS
 /**
  * @struct Relay_Config
  * @brief Structure containing essential parameters for establishing a
- * connection with the relay via MODBUS-RTU.
+ * connection with the relay via MODBUS, on a serial port or through a TCP gateway.
  */
 typedef struct
 {
-    char *port;   ///< Serial port (e.g., "/dev/ttyUSB0" on Linux or "COM3" on Windows).
-    int baudrate; ///< Baud rate for serial communication (e.g., 9600, 19200, 38400).
-    int slave_id; ///< MODBUS device ID of the relay (default is often 1).
-    int timeout;  ///< Timeout for response (in milliseconds).
+    char *port;                 ///< Serial port (e.g., "/dev/ttyUSB0" or "COM3"), or "host:port" of a gateway.
+    int baudrate;               ///< Baud rate for serial communication (e.g., 9600, 19200, 38400).
+    int slave_id;               ///< MODBUS device ID of the relay (default is often 1).
+    int timeout;                ///< Timeout for response (in milliseconds).
+    int adaptive_timeout;       ///< Non-zero to adapt the timeout to the measured latency (see `MB_BusSetAdaptiveTimeout()`).
+    int write_cache;            ///< Non-zero to skip writes of the state the relay already holds (see `RELAY_SetWriteCache()`).
+    int write_cache_refresh_ms; ///< Age after which the cached state is written again anyway (0: never).
+    int fast_transport;         ///< Non-zero to bypass libmodbus where possible (see `RELAY_SetFastTransport()`).
+    int transport;              ///< One of `MB_TRANSPORT_*` (0 is `MB_TRANSPORT_RTU`, a local serial port).
+    int probe_timeout;          ///< Timeout of the liveness probe of `RELAY_Init()` (in milliseconds; 0: no probe).
+    MB_Arena *arena;            ///< Storage of the bus and template of the handle (`NULL`: the heap), see `MB_Arena`.
 } Relay_Config;
 
+/**
+ * @typedef Relay_ShadowRegister
+ * @brief Last value of a register confirmed by the relay (only `regs[0]` is used).
+ */
+typedef MB_ShadowRegister Relay_ShadowRegister;
+
+/**
+ * @struct Relay_Stats
+ * @brief Performance counters of one handle, filled by `RELAY_GetStats()`.
+ */
+typedef struct
+{
+    MB_TrafficCounters traffic;                        ///< Requests, errors and bytes of the handle.
+    MB_LatencyHistogram latency[RELAY_STATS_OP_COUNT]; ///< Transaction durations per operation (`RELAY_STATS_OP_*`).
+} Relay_Stats;
+
 /**
  * @struct Relay_Handle
  * @brief Internal handle that stores the communication context.
+ *
+ * Several handles (relay and RRG) may be attached to the same `MB_Bus`; they then
+ * share one libmodbus context and the bus serializes their requests.
+ *
+ * Each handle keeps the outcome of its own last operation (see `RELAY_GetLastErrorEx()`).
  */
 typedef struct
 {
-    void *modbus_ctx; ///< Pointer to the libmodbus context used for communication.
+    void *modbus_ctx;                  ///< Pointer to the libmodbus context of the bus (shared, owned by the bus).
+    MB_Bus *bus;                       ///< Bus the handle is attached to.
+    void *rtu_frame;                   ///< Request template of the fast RTU transport (`NULL` until enabled).
+    MB_Arena *arena;                   ///< Arena the template of the handle comes from (`NULL`: the heap).
+    int slave_id;                      ///< MODBUS device ID of the relay on the bus.
+    int last_error;                    ///< Error code of the last operation made through the handle (accessed atomically).
+    int last_modbus_errno;             ///< libmodbus `errno` of the last failed request (0 if none, accessed atomically).
+    int write_cache;                   ///< Non-zero when writes matching the shadow register are skipped.
+    int fast_transport;                ///< Non-zero when state writes bypass libmodbus (accessed atomically).
+    int64_t cache_refresh_ns;          ///< Age after which the cached state is written again anyway (0: never).
+    Relay_ShadowRegister shadow_state; ///< On/off register 512.
+    Relay_Stats stats;                 ///< Performance counters (read them with `RELAY_GetStats()`).
 } Relay_Handle;
 
+/**
+ * @brief Completion callback of an asynchronous request (`RELAY_*Async()`).
+ *
+ * Runs on the I/O worker thread of the bus once the request is done. It should return
+ * quickly; it may submit new requests but must not call `RELAY_Wait()` or `RELAY_Close()`.
+ *
+ * @param handle Handle the request was submitted through.
+ * @param request_id ID returned when the request was submitted.
+ * @param error_code RELAY_OK on success, otherwise the error code of the request.
+ * @param user_data Pointer passed at submission.
+ */
+typedef void (*Relay_Callback)(Relay_Handle *handle, uint64_t request_id, int error_code, void *user_data);
+
 /**
  * @brief Initializes and establishes a connection to the relay.
  *
  * This function sets up a MODBUS-RTU connection over the specified serial port,
  * configures the communication settings (baud rate, slave ID, and timeout), and attempts
  * to connect to the device. On success, the provided handle is populated with the
- * communication context.
+ * communication context. If the port is already open by another handle, its bus is
+ * reused instead of reopening the serial device.
+ *
+ * With a probe timeout, the relay must also answer one read of its state register within
+ * it, so an absent device is reported after `probe_timeout` (see `MB_BusProbe()`).
+ *
+ * With an arena, the bus (unless another handle opened it) and the fast transport template
+ * are taken from it, and the threads of the bus start right away: `RELAY_TurnOn()`,
+ * `RELAY_TurnOff()` and the other request paths then never allocate. A port whose bus was
+ * built in another arena is refused (`ERROR_RELAY_PORT_CONFIG_MISMATCH`).
  *
  * @param config Pointer to a Relay_Config structure containing connection parameters.
  * @param handle Pointer to a Relay_Handle structure that will be populated upon success.
@@ -64,6 +129,19 @@ typedef struct
  */
 RELAY_API int RELAY_Init(const Relay_Config *RELAY_RESTRICT config, Relay_Handle *RELAY_RESTRICT handle);
 
+/**
+ * @brief Attaches a handle to an already open bus by slave ID.
+ *
+ * The handle takes its own reference to the bus, so the caller may release its
+ * reference with `MB_BusClose()` at any time.
+ *
+ * @param bus Bus opened with `MB_BusOpen()`.
+ * @param slave_id MODBUS device ID of the relay (0-247).
+ * @param handle Pointer to a Relay_Handle structure that will be populated upon success.
+ * @return RELAY_OK on success, otherwise an error code.
+ */
+RELAY_API int RELAY_Attach(MB_Bus *RELAY_RESTRICT bus, int slave_id, Relay_Handle *RELAY_RESTRICT handle);
+
 /**
  * @brief Turns on the relay.
  *
@@ -72,7 +150,7 @@ RELAY_API int RELAY_Init(const Relay_Config *RELAY_RESTRICT config, Relay_Handle
  * @param handle Pointer to an initialized Relay_Handle structure.
  * @return RELAY_OK if the command is successfully executed, otherwise an error code.
  *
- * @note The function validates that the handle and the underlying MODBUS context are not NULL.
+ * @note The function validates that the handle and the bus it is attached to are not NULL.
  */
 RELAY_API int RELAY_TurnOn(Relay_Handle *RELAY_RESTRICT handle);
 
@@ -80,34 +158,155 @@ RELAY_API int RELAY_TurnOn(Relay_Handle *RELAY_RESTRICT handle);
  * @brief Turns off the relay.
  *
  * This function writes a value of 0 to the MODBUS register designated for turning the relay off.
+ * It is a safety action (`MB_PRIORITY_SAFETY`): it takes the line before any setpoint write or
+ * telemetry read waiting on the same bus, so it waits for at most one transaction in progress.
  *
  * @param handle Pointer to an initialized Relay_Handle structure.
  * @return RELAY_OK if the command is successfully executed, otherwise an error code.
  *
- * @note The function validates that the handle and the underlying MODBUS context are not NULL.
+ * @note The function validates that the handle and the bus it is attached to are not NULL.
  */
 RELAY_API int RELAY_TurnOff(Relay_Handle *RELAY_RESTRICT handle);
 
+/**
+ * @brief Enables or disables the write cache of the handle.
+ *
+ * With the cache enabled, the handle remembers the state last written to the relay, and
+ * `RELAY_TurnOn()`, `RELAY_TurnOff()` and their asynchronous variants succeed without touching
+ * the line when the relay is already in the requested state, unless the state was confirmed
+ * more than `refresh_ms` milliseconds ago. Any failed operation on the handle invalidates the cache.
+ *
+ * @param handle Pointer to an initialized Relay_Handle structure.
+ * @param enabled Non-zero to enable the cache (it starts empty).
+ * @param refresh_ms Age after which the cached state is written again anyway (0: never).
+ * @return RELAY_OK on success, otherwise an error code.
+ */
+RELAY_API int RELAY_SetWriteCache(Relay_Handle *RELAY_RESTRICT handle, int enabled, int refresh_ms);
+
+/**
+ * @brief Forgets the cached state, so the next write reaches the relay.
+ *
+ * May be called from any thread, for instance after the relay was power cycled.
+ *
+ * @param handle Pointer to an initialized Relay_Handle structure.
+ */
+RELAY_API void RELAY_InvalidateWriteCache(Relay_Handle *RELAY_RESTRICT handle);
+
+/**
+ * @brief Switches the state writes of the handle to the fast RTU transport, or back to libmodbus.
+ *
+ * `RELAY_TurnOn()`, `RELAY_TurnOff()` and their asynchronous variants then send a request
+ * prepared once for the slave (only the value and the CRC change) and read the echo straight
+ * from the port, tuned for low latency. Errors are reported exactly the same way.
+ *
+ * @param handle Pointer to an initialized Relay_Handle structure.
+ * @param enabled Non-zero to use the fast transport, 0 for libmodbus.
+ * @return RELAY_OK on success, or ERROR_RELAY_NOT_SUPPORTED if the port cannot be driven
+ *         directly (e.g., on Windows or a MODBUS TCP bus); the handle then keeps using libmodbus.
+ */
+RELAY_API int RELAY_SetFastTransport(Relay_Handle *RELAY_RESTRICT handle, int enabled);
+
+/**
+ * @brief Queues a "turn on" command to the I/O worker of the bus and returns immediately.
+ *
+ * Requests of all handles attached to a bus (relay and RRG) are executed one by one, the
+ * most urgent class first (`MB_PRIORITY_*`: "turn off" before "turn on" and RRG writes,
+ * telemetry last) and in submission order within a class. The outcome is reported to
+ * `callback` only; it does not change the handle's last error.
+ *
+ * @param handle Pointer to an initialized Relay_Handle structure. It must stay valid until
+ *               the request completes (`RELAY_Close()` waits for pending requests).
+ * @param callback Optional completion callback (may be `NULL`).
+ * @param user_data Pointer passed to `callback`.
+ * @param request_id Optional pointer that receives the ID of the request.
+ * @return RELAY_OK if the request was queued, otherwise an error code
+ *         (`ERROR_RELAY_QUEUE_FULL` if `MB_BUS_QUEUE_CAPACITY` requests of its class are pending).
+ */
+RELAY_API int RELAY_TurnOnAsync(Relay_Handle *RELAY_RESTRICT handle, Relay_Callback callback, void *user_data,
+                                uint64_t *RELAY_RESTRICT request_id);
+
+/**
+ * @brief Queues a "turn off" command to the I/O worker of the bus and returns immediately.
+ *
+ * @see RELAY_TurnOnAsync()
+ */
+RELAY_API int RELAY_TurnOffAsync(Relay_Handle *RELAY_RESTRICT handle, Relay_Callback callback, void *user_data,
+                                 uint64_t *RELAY_RESTRICT request_id);
+
+/**
+ * @brief Blocks until the asynchronous request with the given ID (and every request submitted
+ * on the same bus before it) has completed.
+ *
+ * @param handle Pointer to an initialized Relay_Handle structure.
+ * @param request_id ID returned by one of the `RELAY_*Async()` functions.
+ * @return RELAY_OK on success, otherwise an error code.
+ */
+RELAY_API int RELAY_Wait(Relay_Handle *RELAY_RESTRICT handle, uint64_t request_id);
+
 /**
  * @brief Closes the connection to the relay and frees resources.
  *
- * This function terminates the MODBUS-RTU communication session and releases any allocated memory
- * or handles associated with the connection.
+ * This function waits for the asynchronous requests pending on the bus and detaches the
+ * handle from it. The MODBUS-RTU communication session is terminated once no other handle
+ * uses the bus.
  *
  * @param handle Pointer to an initialized Relay_Handle structure.
  */
 RELAY_API void RELAY_Close(Relay_Handle *RELAY_RESTRICT handle);
 
+/**
+ * @brief Copies the performance counters of the handle.
+ *
+ * Every transaction made through the handle, synchronous or asynchronous, is counted with
+ * its duration at the cost of a few relaxed atomic increments. Writes skipped by the write
+ * cache are counted in `traffic.skipped_writes` only.
+ *
+ * @param handle Pointer to an initialized Relay_Handle structure.
+ * @param stats Pointer to a Relay_Stats structure that receives the counters.
+ * @return RELAY_OK on success, otherwise an error code.
+ */
+RELAY_API int RELAY_GetStats(const Relay_Handle *RELAY_RESTRICT handle, Relay_Stats *RELAY_RESTRICT stats);
+
+/**
+ * @brief Resets the performance counters of the handle to zero.
+ *
+ * Transactions completing while the counters are reset may be partially counted.
+ *
+ * @param handle Pointer to an initialized Relay_Handle structure.
+ */
+RELAY_API void RELAY_ResetStats(Relay_Handle *RELAY_RESTRICT handle);
+
 /**
  * @brief Retrieves the description of the last error encountered in the RELAY API.
  *
- * This function returns a human-readable string describing the last error that occurred,
- * which can be useful for debugging and logging purposes.
+ * This function returns a human-readable string describing the last error that occurred
+ * in the calling thread, which can be useful for debugging and logging purposes.
  *
  * @return A constant character string containing the error message.
  */
 RELAY_API const char *RELAY_GetLastError() RELAY_PURE;
 
+/**
+ * @brief Retrieves the description of the last error encountered by the given handle.
+ *
+ * Unlike `RELAY_GetLastError()`, which reports the last call made by the calling thread,
+ * this function reports the last operation made through `handle`, whichever thread made it.
+ *
+ * @param handle Pointer to an initialized Relay_Handle structure.
+ * @return A constant character string containing the error message.
+ */
+RELAY_API const char *RELAY_GetLastErrorEx(const Relay_Handle *RELAY_RESTRICT handle);
+
+/**
+ * @brief Retrieves the code of the last error encountered by the given handle.
+ *
+ * @param handle Pointer to an initialized Relay_Handle structure.
+ * @param modbus_errno Optional pointer that receives the libmodbus `errno` of the failed
+ *                     request (pass it to `modbus_strerror()`), 0 if there was none.
+ * @return The last error code of the handle, `RELAY_OK` if its last operation succeeded.
+ */
+RELAY_API int RELAY_GetLastErrorCodeEx(const Relay_Handle *RELAY_RESTRICT handle, int *RELAY_RESTRICT modbus_errno);
+
 RELAY_END_DECLS
 
 #endif // !RELAY_H
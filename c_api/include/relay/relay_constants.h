@@ -43,4 +43,22 @@
  */
 #define MODBUS_REGISTER_TURN_ON_OFF 512
 
+/**
+ * @def RELAY_STATS_OP_TURN_ON
+ * @brief Index of the writes of 1 (`RELAY_TurnOn()`, `RELAY_TurnOnAsync()`) in `Relay_Stats.latency`.
+ */
+#define RELAY_STATS_OP_TURN_ON 0
+
+/**
+ * @def RELAY_STATS_OP_TURN_OFF
+ * @brief Index of the writes of 0 (`RELAY_TurnOff()`, `RELAY_TurnOffAsync()`) in `Relay_Stats.latency`.
+ */
+#define RELAY_STATS_OP_TURN_OFF 1
+
+/**
+ * @def RELAY_STATS_OP_COUNT
+ * @brief Number of operations with their own latency histogram.
+ */
+#define RELAY_STATS_OP_COUNT 2
+
 #endif // !RELAY_CONSTANTS_H
@@ -1,6 +1,8 @@
 #ifndef RELAY_ERRORS_H
 #define RELAY_ERRORS_H
 
+#include "relay_preprocessor_macros.h"
+
 /**
  * @def MODBUS_ERR
  * @brief General error code for libmodbus failures.
@@ -8,9 +10,11 @@
 #define MODBUS_ERR -1
 
 /**
- * @brief Global variable to store the last occurred error code.
+ * @brief Last error code of the calling thread.
+ *
+ * The variable is thread-local, so threads driving different devices never see each other's errors.
  */
-extern int RELAY_GlobalError;
+extern RELAY_THREAD_LOCAL int RELAY_GlobalError;
 
 /**
  * @def RELAY_OK
@@ -60,10 +64,47 @@ extern int RELAY_GlobalError;
  */
 #define ERROR_RELAY_INVALID_PARAMETER -6006
 
-/// @brief Resets the global 'RELAY_GlobalError' to the status OK.
+/**
+ * @def ERROR_RELAY_PORT_CONFIG_MISMATCH
+ * @brief The serial port is already open by another handle with different serial settings, or
+ *        its bus was built in another arena.
+ */
+#define ERROR_RELAY_PORT_CONFIG_MISMATCH -6007
+
+/**
+ * @def ERROR_RELAY_QUEUE_FULL
+ * @brief The asynchronous request queue of the bus is full.
+ */
+#define ERROR_RELAY_QUEUE_FULL -6008
+
+/**
+ * @def ERROR_RELAY_FAILED_START_WORKER
+ * @brief Failed to start the I/O worker thread of the bus.
+ */
+#define ERROR_RELAY_FAILED_START_WORKER -6009
+
+/**
+ * @def ERROR_RELAY_LINK_DOWN
+ * @brief The serial port was lost and the bus is reopening it in the background.
+ */
+#define ERROR_RELAY_LINK_DOWN -6010
+
+/**
+ * @def ERROR_RELAY_NOT_SUPPORTED
+ * @brief The port cannot be driven by the fast RTU transport; libmodbus stays in use.
+ */
+#define ERROR_RELAY_NOT_SUPPORTED -6011
+
+/**
+ * @def ERROR_RELAY_NO_RESPONSE
+ * @brief The relay did not answer the liveness probe of `RELAY_Init()`.
+ */
+#define ERROR_RELAY_NO_RESPONSE -6012
+
+/// @brief Resets the thread-local 'RELAY_GlobalError' to the status OK.
 static inline void _resetGlobalError() { RELAY_GlobalError = RELAY_OK; }
 
-/// @brief Sets the global 'RELAY_GlobalError' to the specified error status.
+/// @brief Sets the thread-local 'RELAY_GlobalError' to the specified error status.
 static inline void _setGlobalError(int error_code) { RELAY_GlobalError = error_code; }
 
 #endif // !RELAY_ERRORS_H
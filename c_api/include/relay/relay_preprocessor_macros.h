@@ -11,6 +11,15 @@
 #define RELAY_RESTRICT
 #endif
 
+/* Cross-platform thread-local storage class for per-thread error state. */
+#if defined(_MSC_VER)
+#define RELAY_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__) || defined(__clang__)
+#define RELAY_THREAD_LOCAL __thread
+#else
+#define RELAY_THREAD_LOCAL _Thread_local
+#endif
+
 /* Cross-platform shared library export macros */
 #if defined(_MSC_VER) // Windows (Microsoft Visual Studio)
 #if defined(RELAY_DLL_EXPORTS)
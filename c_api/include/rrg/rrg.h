@@ -1,9 +1,16 @@
 #ifndef RRG_H
 #define RRG_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include "rrg_constants.h"
 #include "rrg_errors.h"
 #include "rrg_preprocessor_macros.h"
+#include "mb_bus.h"
+#include "mb_device.h"
+#include "mb_log.h"
+#include "mb_sim.h"
 
 /**
  * @def RRG_CHECK_PTR(ptr, checking_result)
@@ -67,31 +74,292 @@ RRG_BEGIN_DECLS
 /**
  * @struct RRG_Config
  * @brief Structure containing essential parameters for establishing a
- * connection with the gas flow regulator via MODBUS-RTU.
+ * connection with the gas flow regulator via MODBUS, on a serial port or through a TCP gateway.
  */
 typedef struct
 {
-    char *port;   ///< Serial port (e.g., "/dev/ttyUSB0" on Linux or "COM3" on Windows).
-    int baudrate; ///< Baud rate for serial communication (e.g., 9600, 19200, 38400).
-    int slave_id; ///< MODBUS device ID of the gas regulator (default is often 1).
-    int timeout;  ///< Timeout for response (in milliseconds).
+    char *port;                 ///< Serial port (e.g., "/dev/ttyUSB0" or "COM3"), or "host:port" of a gateway.
+    int baudrate;               ///< Baud rate for serial communication (e.g., 9600, 19200, 38400).
+    int slave_id;               ///< MODBUS device ID of the gas regulator (default is often 1).
+    int timeout;                ///< Timeout for response (in milliseconds).
+    int setpoint_write_mode;    ///< One of `RRG_SETPOINT_WRITE_MODE_*` (0 is `RRG_SETPOINT_WRITE_MODE_AUTO`).
+    int adaptive_timeout;       ///< Non-zero to adapt the timeout to the measured latency (see `MB_BusSetAdaptiveTimeout()`).
+    int write_cache;            ///< Non-zero to skip writes of values the device already holds (see `RRG_SetWriteCache()`).
+    int write_cache_refresh_ms; ///< Age after which a cached value is written again anyway (0: never).
+    int fast_transport;         ///< Non-zero to bypass libmodbus where possible (see `RRG_SetFastTransport()`).
+    int transport;              ///< One of `MB_TRANSPORT_*` (0 is `MB_TRANSPORT_RTU`, a local serial port).
+    int probe_timeout;          ///< Timeout of the liveness probe of `RRG_Init()` (in milliseconds; 0: no probe).
+    MB_Arena *arena;            ///< Storage of the bus and engines of the handle (`NULL`: the heap), see `MB_Arena`.
 } RRG_Config;
 
+/**
+ * @typedef RRG_ShadowRegister
+ * @brief Last value of a register (or register pair) confirmed by the regulator.
+ */
+typedef MB_ShadowRegister RRG_ShadowRegister;
+
+/**
+ * @struct RRG_Stats
+ * @brief Performance counters of one handle, filled by `RRG_GetStats()`.
+ */
+typedef struct
+{
+    MB_TrafficCounters traffic;                      ///< Requests, errors and bytes of the handle.
+    MB_LatencyHistogram latency[RRG_STATS_OP_COUNT]; ///< Transaction durations per operation (`RRG_STATS_OP_*`).
+} RRG_Stats;
+
+/**
+ * @struct RRG_FlowChange
+ * @brief Acquired sample that passed the change filter of the handle (see `RRG_SetChangeFilter()`).
+ */
+typedef struct
+{
+    int64_t t_ns;    ///< Monotonic clock timestamp of the sample (in nanoseconds).
+    float flow;      ///< Measured flow in SCCM (0 if the read failed).
+    int32_t status;  ///< `RRG_OK`, or the error code of the failed (or dropped) read.
+    float rate;      ///< Flow change since the previous successful sample, in SCCM per second (0 if none).
+    int32_t reasons; ///< `RRG_CHANGE_*` flags telling why the sample was reported.
+} RRG_FlowChange;
+
+/**
+ * @brief Change callback of the acquisition thread, called with every sample passing the filter.
+ *
+ * Runs on the acquisition thread right after the sample is published, so it delays the next
+ * read while it runs and should return quickly. It must not stop the acquisition or close
+ * the handle.
+ *
+ * @param change Sample that passed the filter (valid during the call only).
+ * @param user_data Pointer given in `RRG_ChangeFilter::user_data`.
+ */
+typedef void (*RRG_ChangeCallback)(const RRG_FlowChange *change, void *user_data);
+
+/**
+ * @struct RRG_ChangeFilter
+ * @brief Conditions under which an acquired sample is reported as a change.
+ *
+ * A sample is reported when any condition holds; a condition set to 0 is disabled, except
+ * that a deadband of 0 still reports every sample whose flow differs from the last one
+ * reported. The first sample and every change of status are always reported.
+ */
+typedef struct
+{
+    float deadband;              ///< Smallest flow change from the last reported sample that is reported, in SCCM.
+    float rate_threshold;        ///< Flow slope above which a sample is reported, in SCCM per second (0: off).
+    int heartbeat_us;            ///< Longest time without a report; the next sample is then reported (0: off).
+    RRG_ChangeCallback callback; ///< Called for each reported sample (may be `NULL`: drain them instead).
+    void *user_data;             ///< Pointer passed to `callback`.
+} RRG_ChangeFilter;
+
+/**
+ * @brief Interlock action of the acquisition thread, called when the interlock of the handle trips.
+ *
+ * Runs on the acquisition thread right after the read that detected the fault, before the
+ * sample is published, so nothing but the action itself stands between the detection and
+ * the shutoff. It may make bus requests (e.g., `RELAY_TurnOff()`, whose writes have the
+ * safety priority) but must not stop the acquisition or close the handle.
+ *
+ * @param target Pointer given in `RRG_Interlock::target` (e.g., a `Relay_Handle`).
+ * @return 0 on success, otherwise an error code (kept in `RRG_InterlockStatus::action_status`).
+ */
+typedef int (*RRG_InterlockAction)(void *target);
+
+/**
+ * @struct RRG_Interlock
+ * @brief Faults the acquisition thread watches for, and what it does when one occurs.
+ *
+ * The interlock trips once per fault: when a status bit of `fault_mask` is set, or when
+ * `max_failed_reads` reads failed in a row. It is re-armed by the first successful read
+ * without any of these bits.
+ */
+typedef struct
+{
+    int fault_mask;             ///< `RRG_STATUS_*` bits of register 2101 that trip the interlock (0: none).
+    int max_failed_reads;       ///< Consecutive failed reads that trip the interlock (0: failed reads never do).
+    int fault_period_us;        ///< Sampling period from a suspected fault until it clears (0: the normal period).
+    RRG_InterlockAction action; ///< Called when the interlock trips (may be `NULL`: only record the trip).
+    void *target;               ///< Pointer passed to `action`.
+} RRG_Interlock;
+
+/**
+ * @struct RRG_InterlockStatus
+ * @brief State of the interlock and fault-to-shutoff latency, filled by `RRG_GetInterlockStatus()`.
+ *
+ * The latency of a trip runs from the start of the read that detected the fault to the
+ * return of the action: it is the part of the reaction time spent in this library.
+ */
+typedef struct
+{
+    int faulted;                 ///< Non-zero from a trip until the interlock is re-armed.
+    int instrument_status;       ///< Status bits of the last successful read (register 2101).
+    int failed_reads;            ///< Reads failed in a row so far.
+    int reasons;                 ///< `RRG_INTERLOCK_*` flags of the last trip.
+    int action_status;           ///< Value returned by the action of the last trip (0 without an action).
+    uint64_t trips;              ///< Times the interlock tripped.
+    int64_t last_trip_ns;        ///< Start of the read that detected the last fault (monotonic clock).
+    int64_t last_latency_ns;     ///< Latency of the last trip.
+    int64_t max_latency_ns;      ///< Worst latency of all trips.
+    MB_LatencyHistogram latency; ///< Latencies of all trips.
+} RRG_InterlockStatus;
+
 /**
  * @struct RRG_Handle
  * @brief Internal handle that stores the communication context with the gas
  * regulator.
+ *
+ * Several handles (RRG and relay) may be attached to the same `MB_Bus`; they then
+ * share one libmodbus context and the bus serializes their requests.
+ *
+ * Each handle keeps the outcome of its own last operation, so devices polled from
+ * different threads report their errors independently (see `RRG_GetLastErrorEx()`).
  */
 typedef struct
 {
-    void *modbus_ctx; ///< Pointer to the libmodbus context used for communication.
+    void *modbus_ctx;                   ///< Pointer to the libmodbus context of the bus (shared, owned by the bus).
+    MB_Bus *bus;                        ///< Bus the handle is attached to.
+    int slave_id;                       ///< MODBUS device ID of the gas regulator on the bus.
+    int setpoint_write_mode;            ///< Setpoint write mode currently in use (`RRG_SETPOINT_WRITE_MODE_*`).
+    void *acquisition;                  ///< Background acquisition engine (`NULL` until `RRG_StartAcquisition()`).
+    void *ramp;                         ///< Setpoint ramp engine (`NULL` until `RRG_StartRamp()`).
+    void *rtu_frames;                   ///< Request templates of the fast RTU transport (`NULL` until enabled).
+    MB_Arena *arena;                    ///< Arena the engines and templates of the handle come from (`NULL`: the heap).
+    int last_error;                     ///< Error code of the last operation made through the handle (accessed atomically).
+    int last_modbus_errno;              ///< libmodbus `errno` of the last failed request (0 if none, accessed atomically).
+    int write_cache;                    ///< Non-zero when writes matching the shadow registers are skipped.
+    int fast_transport;                 ///< Non-zero when the hot operations bypass libmodbus (accessed atomically).
+    int64_t cache_refresh_ns;           ///< Age after which a cached value is written again anyway (0: never).
+    int64_t telemetry_deadline_ns;      ///< Time after which a queued flow read is dropped (0: never).
+    MB_Log *flow_log;                   ///< Binary log the acquisition thread records to (`NULL`: none).
+    int flow_log_channel;               ///< Channel of the records of the handle in `flow_log`.
+    int change_filter_enabled;          ///< Non-zero when the acquisition thread reports changes (`change_filter`).
+    RRG_ChangeFilter change_filter;     ///< Change filter the next acquisition thread applies.
+    int interlock_enabled;              ///< Non-zero when the acquisition thread watches for faults (`interlock`).
+    RRG_Interlock interlock;            ///< Interlock the next acquisition thread arms.
+    RRG_ShadowRegister shadow_setpoint; ///< Setpoint registers 2053-2054.
+    RRG_ShadowRegister shadow_gas;      ///< Gas type register 2100.
+    int64_t command_setpoint;           ///< Last commanded setpoint registers, `(1 << 32) | regs` (0: none), atomic.
+    int64_t command_gas;                ///< Last commanded gas register, `(1 << 32) | reg` (0: none), atomic.
+    MB_BusListener reconnect_listener;  ///< Writes the commanded values back after the bus reopens a lost port.
+    RRG_Stats stats;                    ///< Performance counters (read them with `RRG_GetStats()`).
 } RRG_Handle;
 
+/**
+ * @struct RRG_Snapshot
+ * @brief Telemetry picture of the regulator collected by `RRG_ReadSnapshot()`.
+ */
+typedef struct
+{
+    int gas_id;            ///< Active gas type (register 2100).
+    float flow;            ///< Measured flow in SCCM (registers 2103-2104).
+    float setpoint;        ///< Current setpoint in SCCM (registers 2053-2054), only with `RRG_SNAPSHOT_WITH_SETPOINT`.
+    int instrument_status; ///< Status bits `RRG_STATUS_*` (register 2101).
+    int flags;             ///< `RRG_SNAPSHOT_*` flags describing which optional fields were read.
+} RRG_Snapshot;
+
+/**
+ * @struct RRG_Sample
+ * @brief Timestamped flow measurement produced by the acquisition thread.
+ */
+typedef struct
+{
+    int64_t t_ns;   ///< Monotonic clock timestamp taken right before the request (in nanoseconds).
+    float flow;     ///< Measured flow in SCCM (0 if the read failed).
+    int32_t status; ///< `RRG_OK`, or the error code of the failed (or dropped) read.
+} RRG_Sample;
+
+/**
+ * @struct RRG_RampPoint
+ * @brief Point of a ramp profile: the setpoint to reach `t_us` after the start of the ramp.
+ */
+typedef struct
+{
+    int64_t t_us;   ///< Time from the start of the ramp in microseconds (strictly increasing).
+    float setpoint; ///< Setpoint in SCCM.
+} RRG_RampPoint;
+
+/**
+ * @struct RRG_RampProfile
+ * @brief Setpoint trajectory streamed by `RRG_StartRamp()`.
+ */
+typedef struct
+{
+    const RRG_RampPoint *points; ///< Points of the profile (copied when the ramp starts).
+    int point_count;             ///< Number of points (1 to `RRG_RAMP_MAX_POINTS`).
+    int interpolation;           ///< `RRG_RAMP_LINEAR` or `RRG_RAMP_STEP`.
+    int read_every;              ///< Read the flow back every `read_every` ticks (0: never).
+} RRG_RampProfile;
+
+/**
+ * @struct RRG_RampTick
+ * @brief Outcome of one control tick of a ramp.
+ */
+typedef struct
+{
+    int64_t t_ns;     ///< Scheduled time of the tick (monotonic clock, in nanoseconds).
+    int64_t late_ns;  ///< How late the ramp thread woke up for the tick.
+    float setpoint;   ///< Setpoint of the profile at the tick, in SCCM.
+    float flow;       ///< Flow read back in the tick (0 unless `RRG_RAMP_TICK_READ`).
+    float error;      ///< Tracking error `flow - setpoint` (0 unless `RRG_RAMP_TICK_READ`).
+    int32_t status;   ///< `RRG_OK`, or the error code of the tick (`ERROR_RRG_DEADLINE_EXPIRED` if missed).
+    int32_t flags;    ///< `RRG_RAMP_TICK_*` flags.
+    int32_t reserved; ///< Padding, always 0.
+} RRG_RampTick;
+
+/**
+ * @struct RRG_RampStatus
+ * @brief Progress and timing of the ramp of a handle, filled by `RRG_GetRampStatus()`.
+ */
+typedef struct
+{
+    int running;           ///< Non-zero until the profile is complete or the ramp is stopped.
+    int last_status;       ///< Status of the last tick.
+    uint64_t ticks;        ///< Ticks executed.
+    uint64_t missed_ticks; ///< Ticks skipped or dropped because the line or the thread was late.
+    uint64_t writes;       ///< Setpoints written.
+    uint64_t reads;        ///< Flow reads made.
+    int64_t max_late_ns;   ///< Worst wake-up lateness of the ramp thread.
+    double mean_late_ns;   ///< Average wake-up lateness of the ramp thread.
+    float max_abs_error;   ///< Largest absolute tracking error, in SCCM.
+    float mean_abs_error;  ///< Average absolute tracking error, in SCCM.
+} RRG_RampStatus;
+
+/**
+ * @brief Completion callback of an asynchronous request (`RRG_*Async()`).
+ *
+ * Runs on the I/O worker thread of the bus once the request is done. It delays the
+ * following requests on the bus while it runs, so it should return quickly; it may
+ * submit new requests but must not call `RRG_Wait()` or `RRG_Close()`.
+ *
+ * @param handle Handle the request was submitted through.
+ * @param request_id ID returned when the request was submitted.
+ * @param error_code `RRG_OK` on success, otherwise the error code of the request.
+ * @param value Measured flow for `RRG_GetFlowAsync()`, requested setpoint for
+ *              `RRG_SetFlowAsync()`, gas ID for `RRG_SetGasAsync()`.
+ * @param user_data Pointer passed at submission.
+ */
+typedef void (*RRG_Callback)(RRG_Handle *handle, uint64_t request_id, int error_code, float value, void *user_data);
+
 /**
  * @brief Initializes and establishes a connection to the gas flow regulator.
  *
  * This function sets up a MODBUS-RTU connection over the specified serial port,
  * configures the communication settings, and attempts to connect to the device.
+ * If the port is already open by another handle, its bus is reused instead of
+ * reopening the serial device.
+ *
+ * With a probe timeout, the regulator must also answer one read of its status register
+ * within it: an absent device is reported after `probe_timeout` rather than the full
+ * response timeout (see `MB_BusProbe()`).
+ *
+ * With an arena, the bus (unless another handle opened it), the acquisition engine with
+ * its rings and the fast transport templates are all taken from it, and the threads of the
+ * bus start right away: nothing is allocated afterwards by `RRG_SetFlow()`, `RRG_GetFlow()`,
+ * the other request paths or the acquisition loop, and restarting the acquisition reuses
+ * the engine. Only `RRG_StartRamp()` still allocates its profile copy. A port whose bus was
+ * built in another arena is refused (`ERROR_RRG_PORT_CONFIG_MISMATCH`).
+ *
+ * A flow log (`RRG_SetFlowLog()`) is outside this guarantee: the acquisition thread appends
+ * its batches itself, and each time a segment fills up it opens and preallocates the next
+ * file, which takes heap memory for the stream and blocks on the disk.
  *
  * @param config Pointer to an `RRG_Config` structure containing connection
  * parameters.
@@ -102,6 +370,24 @@ typedef struct
  */
 RRG_API int RRG_Init(const RRG_Config *RRG_RESTRICT config, RRG_Handle *RRG_RESTRICT handle);
 
+/**
+ * @brief Attaches a handle to an already open bus by slave ID.
+ *
+ * The handle takes its own reference to the bus, so the caller may release its
+ * reference with `MB_BusClose()` at any time. The setpoint write mode starts as
+ * `RRG_SETPOINT_WRITE_MODE_AUTO` and can be changed in the handle afterwards.
+ *
+ * If the bus loses its port, requests fail with `ERROR_RRG_LINK_DOWN` while it is reopened
+ * in the background; once it is back, the handle writes the last gas and setpoint it was
+ * commanded to the regulator again, before the application's next request.
+ *
+ * @param bus Bus opened with `MB_BusOpen()`.
+ * @param slave_id MODBUS device ID of the gas regulator (0-247).
+ * @param handle Pointer to an `RRG_Handle` structure that will be populated upon success.
+ * @return Returns `RRG_OK` on success, otherwise an error code.
+ */
+RRG_API int RRG_Attach(MB_Bus *RRG_RESTRICT bus, int slave_id, RRG_Handle *RRG_RESTRICT handle);
+
 /**
  * @brief Sends a new flow rate setpoint to the gas regulator.
  *
@@ -109,12 +395,65 @@ RRG_API int RRG_Init(const RRG_Config *RRG_RESTRICT config, RRG_Handle *RRG_REST
  * will attempt to maintain. The value is provided in SCCM (Standard Cubic
  * Centimeters per Minute).
  *
+ * Both setpoint registers (2053-2054) are written in one "Write Multiple Registers"
+ * transaction, so the device never holds a half-updated 32-bit value. If the
+ * handle was configured with `RRG_SETPOINT_WRITE_MODE_AUTO` and the firmware
+ * rejects function code 0x10, the handle switches to `RRG_SETPOINT_WRITE_MODE_SINGLE`
+ * and the value is written as two separate registers from then on.
+ *
  * @param handle Pointer to an initialized `RRG_Handle` structure.
  * @param setpoint Desired gas flow rate in SCCM.
  * @return Returns `RRG_OK` on success, or an error code if the command fails.
  */
 RRG_API int RRG_SetFlow(RRG_Handle *RRG_RESTRICT handle, float setpoint) RRG_HOT;
 
+/**
+ * @brief Sets the flow setpoints of a group of regulators sharing one bus, in one bus transaction.
+ *
+ * The line is taken once for the whole group, so the writes to the successive slaves go out
+ * back to back and no other request of the bus comes in between. Writes of values a
+ * regulator already holds are skipped, as with `RRG_SetFlow()`.
+ *
+ * With `RRG_GROUP_BROADCAST` and the same setpoint for every regulator, one broadcast frame
+ * replaces the per-slave writes. Broadcasts are not acknowledged, so their values are not
+ * stored in the write caches unless `RRG_GROUP_VERIFY` confirms them: it reads every
+ * setpoint back after the writes and writes it again, addressed to the regulator, where it
+ * differs (e.g., a regulator that missed the broadcast or only accepts single writes).
+ *
+ * @param handles Handles of the group, all attached to the same bus.
+ * @param setpoints Desired flow of every regulator of the group in SCCM.
+ * @param count Number of regulators of the group.
+ * @param flags Bitwise OR of `RRG_GROUP_*` flags.
+ * @param statuses Optional array that receives the outcome (`RRG_OK` or an error code) of
+ *                 every regulator, which is also stored in its handle.
+ * @return `RRG_OK` if every regulator was set, otherwise `RRG_ERR` (the thread's error is
+ *         the first failure of the group; `ERROR_RRG_INVALID_PARAMETER` if the handles do
+ *         not share one bus).
+ */
+RRG_API int RRG_SetFlowGroup(RRG_Handle *const *RRG_RESTRICT handles, const float *RRG_RESTRICT setpoints,
+                             int count, int flags, int *RRG_RESTRICT statuses);
+
+/**
+ * @brief Reads the measured flow of many regulators, over any number of buses, in one call.
+ *
+ * The regulators are grouped by bus. The line of every bus is taken once and its slaves are
+ * read back to back; the buses themselves work at the same time: every bus but the one of
+ * `handles[0]` is handed to its I/O worker while the calling thread reads its own, so the
+ * call lasts about as long as the slowest bus instead of the sum of all of them.
+ *
+ * @param handles Handles of the regulators, attached to any buses.
+ * @param count Number of regulators.
+ * @param flows Array of `count` floats that receives the flow of every regulator in SCCM
+ *              (0 for a regulator that could not be read).
+ * @param statuses Array of `count` ints that receives the outcome (`RRG_OK` or an error code)
+ *                 of every regulator, which is also stored in its handle.
+ * @param flags Bitwise OR of `RRG_MANY_*` flags (0 to overlap the buses).
+ * @return `RRG_OK` if every regulator was read, otherwise `RRG_ERR` (the thread's error is
+ *         the first failure in `statuses`).
+ */
+RRG_API int RRG_GetFlowMany(RRG_Handle *const *RRG_RESTRICT handles, int count, float *RRG_RESTRICT flows,
+                            int *RRG_RESTRICT statuses, int flags);
+
 /**
  * @brief Retrieves the current measured gas flow rate.
  *
@@ -128,6 +467,53 @@ RRG_API int RRG_SetFlow(RRG_Handle *RRG_RESTRICT handle, float setpoint) RRG_HOT
  */
 RRG_API int RRG_GetFlow(RRG_Handle *RRG_RESTRICT handle, float *RRG_RESTRICT flow) RRG_HOT;
 
+/**
+ * @brief Converts raw flow register pairs (2103-2104, e.g., from the records of a flow log)
+ *        into SCCM, in bulk.
+ *
+ * Every pair is a signed 32-bit count of thousandths of SCCM, high word first. The result
+ * is the one `RRG_GetFlow()` returns for the same registers; the loop is branch-free, so
+ * the compiler vectorizes it, which makes converting once at the consumer cheap.
+ *
+ * @param regs `2 * count` registers: the pairs back to back.
+ * @param count Number of pairs.
+ * @param flows Array of `count` floats that receives the flows in SCCM.
+ * @return Returns `RRG_OK` on success, or an error code if a pointer is `NULL`.
+ */
+RRG_API int RRG_ConvertRaw(const uint16_t *RRG_RESTRICT regs, size_t count, float *RRG_RESTRICT flows) RRG_HOT;
+
+/**
+ * @brief Adds a simulated regulator to a simulated line (see `mb_sim.h`).
+ *
+ * Its flow (2103-2104) replays the recording loaded with `MB_SimLoadRecording()` or
+ * `MB_SimLoadLog()` (e.g., a flow log of a real regulator) and, once a setpoint is written to
+ * 2053-2054, approaches it as a first-order lag. The other registers read as written, so a
+ * handle opened on the line with `RRG_Init()` works as with the hardware.
+ *
+ * @param sim Pointer to a simulated line.
+ * @param slave_id Address of the regulator on the line.
+ * @param time_constant_ms Time constant of the flow response (in milliseconds of simulated time).
+ * @return Returns `RRG_OK` on success, or an error code (`ERROR_RRG_INVALID_PARAMETER`,
+ *         `ERROR_RRG_FAILED_CREATE_CONTEXT` when out of memory).
+ */
+RRG_API int RRG_SimAddRegulator(MB_Sim *RRG_RESTRICT sim, int slave_id, int time_constant_ms);
+
+/**
+ * @brief Reads gas type, instrument status, measured flow and, optionally, the setpoint in as few
+ * transactions as possible.
+ *
+ * The contiguous register window 2100-2104 (gas type, status and flow) is fetched with a
+ * single "Read Holding Registers" request. The setpoint lives in a separate block
+ * (2053-2054) and is only read, as a second request, when `RRG_SNAPSHOT_WITH_SETPOINT`
+ * is passed in `flags`.
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure.
+ * @param snapshot Pointer to an `RRG_Snapshot` structure that will be filled on success.
+ * @param flags Bitwise OR of `RRG_SNAPSHOT_*` flags (0 for gas, status and flow only).
+ * @return Returns `RRG_OK` on success, or an error code if any of the requests fails.
+ */
+RRG_API int RRG_ReadSnapshot(RRG_Handle *RRG_RESTRICT handle, RRG_Snapshot *RRG_RESTRICT snapshot, int flags) RRG_HOT;
+
 /**
  * @brief Selects the gas type for the regulator.
  *
@@ -141,26 +527,397 @@ RRG_API int RRG_GetFlow(RRG_Handle *RRG_RESTRICT handle, float *RRG_RESTRICT flo
  */
 RRG_API int RRG_SetGas(RRG_Handle *RRG_RESTRICT handle, int gas_id);
 
+/**
+ * @brief Enables or disables the write cache of the handle.
+ *
+ * With the cache enabled, the handle remembers the setpoint and gas type last written to
+ * (or read back from) the regulator. `RRG_SetFlow()`, `RRG_SetGas()` and their asynchronous
+ * variants then succeed without touching the line when the value is already in the device,
+ * unless it was confirmed more than `refresh_ms` milliseconds ago. Any failed operation on
+ * the handle invalidates the cache, as the state of the device is unknown after it.
+ *
+ * @note The cache assumes the handle is the only writer of these registers: set a refresh
+ *       interval if the values may also be changed from the front panel or another master.
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure.
+ * @param enabled Non-zero to enable the cache (it starts empty).
+ * @param refresh_ms Age after which a cached value is written again anyway (0: never).
+ * @return Returns `RRG_OK` on success, otherwise an error code.
+ */
+RRG_API int RRG_SetWriteCache(RRG_Handle *RRG_RESTRICT handle, int enabled, int refresh_ms);
+
+/**
+ * @brief Forgets the cached values, so the next writes reach the device.
+ *
+ * May be called from any thread, for instance after the device was power cycled.
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure.
+ */
+RRG_API void RRG_InvalidateWriteCache(RRG_Handle *RRG_RESTRICT handle);
+
+/**
+ * @brief Sets how long a flow read queued with `RRG_GetFlowAsync()` may wait for the line.
+ *
+ * A read still queued when the deadline passes is dropped without being sent, and its
+ * callback gets `ERROR_RRG_DEADLINE_EXPIRED`, so a burst of writes (or a slow device on
+ * the same bus) does not leave a backlog of stale reads behind it.
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure.
+ * @param deadline_us Deadline relative to the submission, in microseconds (0: never drop).
+ * @return Returns `RRG_OK` on success, otherwise an error code.
+ */
+RRG_API int RRG_SetTelemetryDeadline(RRG_Handle *RRG_RESTRICT handle, int deadline_us);
+
+/**
+ * @brief Switches the hot operations of the handle to the fast RTU transport, or back to libmodbus.
+ *
+ * The setpoint, gas and flow requests are then sent from templates prepared once for the
+ * slave (`MB_RtuFrame`: only the values and the CRC change per request) and their responses
+ * are read straight from the port, tuned for low latency. This covers `RRG_SetFlow()`,
+ * `RRG_GetFlow()`, `RRG_SetGas()`, their asynchronous variants, the acquisition and the ramp
+ * threads. Other requests, and the handles attached to the same bus that keep the default,
+ * still go through libmodbus on the same port. Errors are reported exactly the same way.
+ *
+ * Call it before starting the background threads of the handle.
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure.
+ * @param enabled Non-zero to use the fast transport, 0 for libmodbus.
+ * @return Returns `RRG_OK` on success, or `ERROR_RRG_NOT_SUPPORTED` if the port cannot be
+ *         driven directly (e.g., on Windows or a MODBUS TCP bus); the handle then keeps using libmodbus.
+ */
+RRG_API int RRG_SetFastTransport(RRG_Handle *RRG_RESTRICT handle, int enabled);
+
+/**
+ * @brief Queues a setpoint write to the I/O worker of the bus and returns immediately.
+ *
+ * Requests of all handles attached to a bus are executed one by one, writes before reads
+ * (`MB_PRIORITY_*`) and in submission order within each class, so a sequence of commands
+ * is sent back to back without waiting for each round trip in the caller, and a setpoint
+ * change never waits behind queued telemetry. The outcome is reported to `callback` only;
+ * it does not change the handle's last error.
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure. It must stay valid
+ *               until the request completes (`RRG_Close()` waits for pending requests).
+ * @param setpoint Desired flow rate in SCCM.
+ * @param callback Optional completion callback (may be `NULL`).
+ * @param user_data Pointer passed to `callback`.
+ * @param request_id Optional pointer that receives the ID of the request.
+ * @return Returns `RRG_OK` if the request was queued, otherwise an error code
+ *         (`ERROR_RRG_QUEUE_FULL` if `MB_BUS_QUEUE_CAPACITY` requests of its class are pending).
+ */
+RRG_API int RRG_SetFlowAsync(RRG_Handle *RRG_RESTRICT handle, float setpoint, RRG_Callback callback,
+                             void *user_data, uint64_t *RRG_RESTRICT request_id);
+
+/**
+ * @brief Queues a flow read to the I/O worker of the bus and returns immediately.
+ *
+ * The measured flow is passed to `callback` as `value`. The read is dropped if it is still
+ * queued after the deadline set with `RRG_SetTelemetryDeadline()`.
+ *
+ * @see RRG_SetFlowAsync()
+ */
+RRG_API int RRG_GetFlowAsync(RRG_Handle *RRG_RESTRICT handle, RRG_Callback callback, void *user_data,
+                             uint64_t *RRG_RESTRICT request_id);
+
+/**
+ * @brief Queues a gas type change to the I/O worker of the bus and returns immediately.
+ *
+ * @see RRG_SetFlowAsync()
+ */
+RRG_API int RRG_SetGasAsync(RRG_Handle *RRG_RESTRICT handle, int gas_id, RRG_Callback callback, void *user_data,
+                            uint64_t *RRG_RESTRICT request_id);
+
+/**
+ * @brief Blocks until the asynchronous request with the given ID has completed.
+ *
+ * Every request submitted on the same bus before it has completed as well, and its
+ * callback has returned (writes submitted later may have completed too).
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure.
+ * @param request_id ID returned by one of the `RRG_*Async()` functions.
+ * @return Returns `RRG_OK` on success, otherwise an error code.
+ */
+RRG_API int RRG_Wait(RRG_Handle *RRG_RESTRICT handle, uint64_t request_id);
+
 /**
  * @brief Closes the connection to the gas regulator and frees resources.
  *
- * This function terminates the MODBUS-RTU communication session and releases
- * any allocated memory or handles.
+ * This function waits for the asynchronous requests pending on the bus, stops the
+ * acquisition thread (if any), releases its samples and detaches the handle from its bus. The MODBUS-RTU communication session is
+ * terminated once no other handle uses the bus.
  *
  * @param handle Pointer to an initialized `RRG_Handle` structure.
  */
 RRG_API void RRG_Close(RRG_Handle *RRG_RESTRICT handle);
 
+/**
+ * @brief Starts a background thread that polls the measured flow at a fixed period.
+ *
+ * Every `period_us` microseconds the thread reads the flow (through the bus, so it
+ * interleaves safely with other calls on the handle) and pushes an `RRG_Sample` into
+ * a single-producer/single-consumer lock-free ring of `RRG_DEFAULT_ACQUISITION_CAPACITY`
+ * samples. When the ring is full new samples are dropped until the consumer drains it.
+ * If a read takes longer than the period, the next one starts immediately. Reads yield
+ * the line to waiting writes; one kept waiting for a whole period is dropped and recorded
+ * as a sample with status `ERROR_RRG_DEADLINE_EXPIRED`. With a log set by `RRG_SetFlowLog()`
+ * every sample is also recorded there. With a filter set by `RRG_SetChangeFilter()` the
+ * samples that pass it are also reported as changes. With an interlock set by
+ * `RRG_SetInterlock()` every read also fetches the status register and faults trip it.
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure. It must stay valid
+ *               until `RRG_StopAcquisition()` or `RRG_Close()`.
+ * @param period_us Sampling period in microseconds.
+ * @return Returns `RRG_OK` on success, or an error code (`ERROR_RRG_ACQUISITION_RUNNING`
+ *         if the acquisition is already active).
+ */
+RRG_API int RRG_StartAcquisition(RRG_Handle *RRG_RESTRICT handle, int period_us);
+
+/**
+ * @brief Records the samples of the acquisition thread to a binary log.
+ *
+ * Each sample becomes one `MB_LogRecord` holding the raw flow registers (2103-2104), the
+ * slave ID and the status. The thread collects `RRG_FLOW_LOG_BATCH_RECORDS` records (or
+ * `RRG_FLOW_LOG_FLUSH_INTERVAL_US` worth of them) before appending them in one call, and
+ * appends the rest when it stops. Several handles may share one log with distinct channels.
+ *
+ * The appends write to the disk from the acquisition thread, and starting a new segment
+ * opens and preallocates a file there: with a log, the acquisition of a handle opened in an
+ * arena no longer runs without allocating or blocking (see `MB_LogAppend()`).
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure whose acquisition is stopped.
+ * @param log Log to record to (`NULL` to stop recording). It must stay open until the
+ *            acquisition is stopped or another log is set.
+ * @param channel Channel stored in the records (0-255).
+ * @return Returns `RRG_OK` on success, or an error code (`ERROR_RRG_ACQUISITION_RUNNING`
+ *         if the acquisition is active).
+ */
+RRG_API int RRG_SetFlowLog(RRG_Handle *RRG_RESTRICT handle, MB_Log *log, int channel);
+
+/**
+ * @brief Reports only the meaningful changes of the acquired flow.
+ *
+ * Most samples of a steady flow repeat the previous one within the sensor noise. With a
+ * filter the acquisition thread compares every sample with the last one it reported and
+ * reports it again only past the deadband, when the flow moves faster than the rate
+ * threshold, when the status changes, or when the heartbeat interval passed in silence (so
+ * subscribers can tell a steady flow from a stalled acquisition). Reported samples go to
+ * the callback of the filter and into a second ring of `RRG_DEFAULT_CHANGE_CAPACITY`
+ * entries, drained with `RRG_DrainChanges()`. Every raw sample stays in the sample ring and
+ * in the flow log either way.
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure whose acquisition is stopped.
+ * @param filter Filter to apply from the next `RRG_StartAcquisition()` on (copied), or `NULL`
+ *               to report no changes.
+ * @return Returns `RRG_OK` on success, or an error code (`ERROR_RRG_ACQUISITION_RUNNING`
+ *         if the acquisition is active, `ERROR_RRG_INVALID_PARAMETER` for a negative field).
+ */
+RRG_API int RRG_SetChangeFilter(RRG_Handle *RRG_RESTRICT handle, const RRG_ChangeFilter *RRG_RESTRICT filter);
+
+/**
+ * @brief Reacts to regulator faults from the acquisition thread, without a round trip through the caller.
+ *
+ * With an interlock every acquisition read covers the status register too (2101-2104 in one
+ * request, so no extra round trip). A read that fails or shows a bit of the fault mask
+ * switches the thread to `fault_period_us` until the fault clears, so a fault is confirmed
+ * (and its end noticed) within a few fast reads. When the interlock trips, the action runs
+ * right away on the thread, typically turning a relay off through a bus of its own, and the
+ * trip is recorded with its latency. The reaction time is then bounded by one normal period,
+ * the reads still needed to confirm the fault and the action itself; the trips of
+ * `RRG_GetInterlockStatus()` show what it actually was.
+ *
+ * @code
+ * // Close the supply valve relay on a mass flow overrange or three missed reads.
+ * static int close_valve(void *relay) { return RELAY_TurnOff(relay); }
+ * RRG_Interlock interlock = {RRG_STATUS_MASS_FLOW_OVERRANGE, 3, 1000, close_valve, &relay_handle};
+ * RRG_SetInterlock(&rrg_handle, &interlock);
+ * @endcode
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure whose acquisition is stopped.
+ * @param interlock Interlock to arm from the next `RRG_StartAcquisition()` on (copied), or
+ *                  `NULL` to disarm it.
+ * @return Returns `RRG_OK` on success, or an error code (`ERROR_RRG_ACQUISITION_RUNNING`
+ *         if the acquisition is active, `ERROR_RRG_INVALID_PARAMETER` for a negative field).
+ */
+RRG_API int RRG_SetInterlock(RRG_Handle *RRG_RESTRICT handle, const RRG_Interlock *RRG_RESTRICT interlock);
+
+/**
+ * @brief Copies the state of the interlock of the current (or last) acquisition.
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure.
+ * @param status Pointer to an `RRG_InterlockStatus` structure that receives the state (all
+ *               zero if no acquisition ran with an interlock).
+ * @return Returns `RRG_OK` on success, otherwise an error code.
+ */
+RRG_API int RRG_GetInterlockStatus(RRG_Handle *RRG_RESTRICT handle, RRG_InterlockStatus *RRG_RESTRICT status);
+
+/**
+ * @brief Stops the acquisition thread and waits for it to exit.
+ *
+ * Samples already in the ring stay available to `RRG_DrainSamples()` until the next
+ * `RRG_StartAcquisition()` or `RRG_Close()`.
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure.
+ */
+RRG_API void RRG_StopAcquisition(RRG_Handle *RRG_RESTRICT handle);
+
+/**
+ * @brief Moves up to `max` acquired samples, oldest first, into `samples` without blocking.
+ *
+ * Only one thread may drain a handle at a time (it is the single consumer of the ring).
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure.
+ * @param samples Caller-provided array of at least `max` samples.
+ * @param max Capacity of `samples`.
+ * @return The number of samples copied (0 if none are pending), or `RRG_ERR` on invalid parameters.
+ */
+RRG_API int RRG_DrainSamples(RRG_Handle *RRG_RESTRICT handle, RRG_Sample *RRG_RESTRICT samples, int max) RRG_HOT;
+
+/**
+ * @brief Returns how many samples were dropped because the ring was full.
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure.
+ * @return The number of dropped samples since the acquisition was started.
+ */
+RRG_API uint64_t RRG_GetDroppedSamples(RRG_Handle *RRG_RESTRICT handle);
+
+/**
+ * @brief Moves up to `max` reported flow changes, oldest first, into `changes` without blocking.
+ *
+ * Only one thread may drain the changes of a handle at a time.
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure.
+ * @param changes Caller-provided array of at least `max` changes.
+ * @param max Capacity of `changes`.
+ * @return The number of changes copied (0 if none are pending or no filter is set), or
+ *         `RRG_ERR` on invalid parameters.
+ */
+RRG_API int RRG_DrainChanges(RRG_Handle *RRG_RESTRICT handle, RRG_FlowChange *RRG_RESTRICT changes, int max) RRG_HOT;
+
+/**
+ * @brief Returns how many changes were dropped because the change ring was full.
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure.
+ * @return The number of dropped changes since the acquisition was started.
+ */
+RRG_API uint64_t RRG_GetDroppedChanges(RRG_Handle *RRG_RESTRICT handle);
+
+/**
+ * @brief Starts a real-time thread that streams the setpoints of a profile at a fixed tick.
+ *
+ * Every `tick_us` the thread wakes up on an absolute deadline (`clock_nanosleep()` with
+ * `TIMER_ABSTIME`, so the schedule never drifts), evaluates the profile at the scheduled
+ * time and writes the setpoint if its registers changed since the last write. Every
+ * `read_every` ticks the flow is read back in the same transaction and the tracking error
+ * recorded. Each tick produces an `RRG_RampTick` pushed into a lock-free ring of
+ * `RRG_DEFAULT_RAMP_CAPACITY` entries, drained with `RRG_DrainRampTicks()`.
+ *
+ * The setpoint is always taken from the schedule, not from the time the thread actually ran,
+ * so a late tick does not bend the trajectory. A tick that cannot get the line before the
+ * next one is due is dropped (`ERROR_RRG_DEADLINE_EXPIRED`); after an overrun the ticks
+ * already past are skipped and counted in `RRG_RampStatus::missed_ticks`. Once the time of
+ * the last point is reached, its setpoint is written and the thread exits; the regulator
+ * keeps it.
+ *
+ * The ramp uses the line like `RRG_SetFlow()` would, so safety writes on the bus still go
+ * first, and the commanded setpoint is restored after a reconnect.
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure. It must stay valid until
+ *               `RRG_StopRamp()` or `RRG_Close()`.
+ * @param profile Profile to follow (copied, so it may be released once the call returns).
+ * @param tick_us Control tick in microseconds (at least `RRG_RAMP_MIN_TICK_US`).
+ * @return Returns `RRG_OK` on success, or an error code (`ERROR_RRG_RAMP_RUNNING` if a ramp
+ *         is already running, `ERROR_RRG_FAILED_START_RAMP` if it could not be started).
+ */
+RRG_API int RRG_StartRamp(RRG_Handle *RRG_RESTRICT handle, const RRG_RampProfile *RRG_RESTRICT profile, int tick_us);
+
+/**
+ * @brief Stops the ramp thread and waits for it to exit; the regulator keeps the last setpoint written.
+ *
+ * Ticks already in the ring stay available to `RRG_DrainRampTicks()` until the next
+ * `RRG_StartRamp()` or `RRG_Close()`.
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure.
+ */
+RRG_API void RRG_StopRamp(RRG_Handle *RRG_RESTRICT handle);
+
+/**
+ * @brief Copies the progress and timing statistics of the current (or last) ramp.
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure.
+ * @param status Pointer to an `RRG_RampStatus` structure that receives the statistics
+ *               (all zero if no ramp was started).
+ * @return Returns `RRG_OK` on success, otherwise an error code.
+ */
+RRG_API int RRG_GetRampStatus(RRG_Handle *RRG_RESTRICT handle, RRG_RampStatus *RRG_RESTRICT status);
+
+/**
+ * @brief Moves up to `max` ramp ticks, oldest first, into `ticks` without blocking.
+ *
+ * Only one thread may drain a handle at a time (it is the single consumer of the ring).
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure.
+ * @param ticks Caller-provided array of at least `max` ticks.
+ * @param max Capacity of `ticks`.
+ * @return The number of ticks copied (0 if none are pending), or `RRG_ERR` on invalid parameters.
+ */
+RRG_API int RRG_DrainRampTicks(RRG_Handle *RRG_RESTRICT handle, RRG_RampTick *RRG_RESTRICT ticks, int max);
+
+/**
+ * @brief Copies the performance counters of the handle.
+ *
+ * Every transaction made through the handle, by the caller, the I/O worker of the bus or the
+ * acquisition thread, is counted with its duration. This costs a few relaxed atomic increments
+ * per transaction, so the counters are always on. Writes skipped by the write cache are counted
+ * in `traffic.skipped_writes` only.
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure.
+ * @param stats Pointer to an `RRG_Stats` structure that receives the counters.
+ * @return Returns `RRG_OK` on success, otherwise an error code.
+ */
+RRG_API int RRG_GetStats(const RRG_Handle *RRG_RESTRICT handle, RRG_Stats *RRG_RESTRICT stats);
+
+/**
+ * @brief Resets the performance counters of the handle to zero.
+ *
+ * Transactions completing while the counters are reset may be partially counted.
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure.
+ */
+RRG_API void RRG_ResetStats(RRG_Handle *RRG_RESTRICT handle);
+
 /**
  * @brief Retrieves the description of the last occurred error.
  *
  * This function provides a human-readable description of the last error
- * encountered in the RRG API. It is useful for debugging and logging purposes.
+ * encountered in the RRG API by the calling thread. It is useful for debugging
+ * and logging purposes.
  *
  * @return A string containing the error message.
  */
 RRG_API const char *RRG_GetLastError() RRG_PURE;
 
+/**
+ * @brief Retrieves the description of the last error encountered by the given handle.
+ *
+ * Unlike `RRG_GetLastError()`, which reports the last call made by the calling thread,
+ * this function reports the last operation made through `handle`, whichever thread made it.
+ * Requests issued by the acquisition thread are reported in the samples instead.
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure.
+ * @return A constant character string containing the error message.
+ */
+RRG_API const char *RRG_GetLastErrorEx(const RRG_Handle *RRG_RESTRICT handle);
+
+/**
+ * @brief Retrieves the code of the last error encountered by the given handle.
+ *
+ * @param handle Pointer to an initialized `RRG_Handle` structure.
+ * @param modbus_errno Optional pointer that receives the libmodbus `errno` of the failed
+ *                     request (pass it to `modbus_strerror()`), 0 if there was none.
+ * @return The last error code of the handle, `RRG_OK` if its last operation succeeded.
+ */
+RRG_API int RRG_GetLastErrorCodeEx(const RRG_Handle *RRG_RESTRICT handle, int *RRG_RESTRICT modbus_errno);
+
 RRG_END_DECLS
 
 #endif // !RRG_H
@@ -37,12 +37,134 @@
  */
 #define RRG_DEFAULT_TIMEOUT_MS 50
 
+/**
+ * @def RRG_DEFAULT_ACQUISITION_CAPACITY
+ * @brief Number of samples the acquisition ring buffer holds before new samples are dropped.
+ */
+#define RRG_DEFAULT_ACQUISITION_CAPACITY 8192
+
+/**
+ * @def RRG_ACQUISITION_STOP_POLL_US
+ * @brief Longest time the acquisition thread sleeps before checking for a stop request (in microseconds).
+ */
+#define RRG_ACQUISITION_STOP_POLL_US 10000
+
+/**
+ * @def RRG_DEFAULT_CHANGE_CAPACITY
+ * @brief Number of flow changes the change ring buffer holds before new ones are dropped.
+ */
+#define RRG_DEFAULT_CHANGE_CAPACITY 1024
+
+/**
+ * @def RRG_CHANGE_FIRST
+ * @brief `RRG_FlowChange::reasons`: first sample of the acquisition.
+ */
+#define RRG_CHANGE_FIRST 0x01
+
+/**
+ * @def RRG_CHANGE_STATUS
+ * @brief `RRG_FlowChange::reasons`: the status differs from the last reported sample (a read
+ *        started or stopped failing, or failed differently).
+ */
+#define RRG_CHANGE_STATUS 0x02
+
+/**
+ * @def RRG_CHANGE_DEADBAND
+ * @brief `RRG_FlowChange::reasons`: the flow moved more than the deadband away from the last reported flow.
+ */
+#define RRG_CHANGE_DEADBAND 0x04
+
+/**
+ * @def RRG_CHANGE_RATE
+ * @brief `RRG_FlowChange::reasons`: the flow changes faster than the rate threshold since the previous sample.
+ */
+#define RRG_CHANGE_RATE 0x08
+
+/**
+ * @def RRG_CHANGE_HEARTBEAT
+ * @brief `RRG_FlowChange::reasons`: nothing was reported for the heartbeat interval.
+ */
+#define RRG_CHANGE_HEARTBEAT 0x10
+
+/**
+ * @def RRG_INTERLOCK_STATUS
+ * @brief `RRG_InterlockStatus::reasons`: a status bit of `RRG_Interlock::fault_mask` is set.
+ */
+#define RRG_INTERLOCK_STATUS 0x01
+
+/**
+ * @def RRG_INTERLOCK_COMMUNICATION
+ * @brief `RRG_InterlockStatus::reasons`: `RRG_Interlock::max_failed_reads` reads failed in a row.
+ */
+#define RRG_INTERLOCK_COMMUNICATION 0x02
+
+/**
+ * @def RRG_DEFAULT_RAMP_CAPACITY
+ * @brief Number of ramp ticks the ramp ring buffer holds before new ones are dropped.
+ */
+#define RRG_DEFAULT_RAMP_CAPACITY 8192
+
+/**
+ * @def RRG_RAMP_MAX_POINTS
+ * @brief Largest number of points of a ramp profile.
+ */
+#define RRG_RAMP_MAX_POINTS 65536
+
+/**
+ * @def RRG_RAMP_MIN_TICK_US
+ * @brief Shortest control tick of a ramp (in microseconds).
+ */
+#define RRG_RAMP_MIN_TICK_US 100
+
+/**
+ * @def RRG_RAMP_LINEAR
+ * @brief `RRG_RampProfile::interpolation`: the setpoint moves linearly between the points.
+ */
+#define RRG_RAMP_LINEAR 0
+
+/**
+ * @def RRG_RAMP_STEP
+ * @brief `RRG_RampProfile::interpolation`: each point holds its setpoint until the next one
+ *        (an arbitrary table, e.g., one point per tick).
+ */
+#define RRG_RAMP_STEP 1
+
+/**
+ * @def RRG_RAMP_TICK_WRITTEN
+ * @brief `RRG_RampTick::flags`: the setpoint of the tick was written to the regulator.
+ */
+#define RRG_RAMP_TICK_WRITTEN 0x01
+
+/**
+ * @def RRG_RAMP_TICK_READ
+ * @brief `RRG_RampTick::flags`: the flow was read back in the tick (`flow` and `error` are valid).
+ */
+#define RRG_RAMP_TICK_READ 0x02
+
+/**
+ * @def RRG_FLOW_LOG_BATCH_RECORDS
+ * @brief Samples the acquisition thread collects before appending them to its flow log.
+ */
+#define RRG_FLOW_LOG_BATCH_RECORDS 64
+
+/**
+ * @def RRG_FLOW_LOG_FLUSH_INTERVAL_US
+ * @brief Longest time a sample waits in the batch before it is appended to the flow log (in microseconds).
+ */
+#define RRG_FLOW_LOG_FLUSH_INTERVAL_US 1000000
+
 /**
  * @def MODBUS_REGISTER_SETPOINT
  * @brief MODBUS register for setting the flow setpoint (2053-2054).
  */
 #define MODBUS_REGISTER_SETPOINT 2053
 
+/**
+ * @def MODBUS_SETPOINT_REGISTERS_COUNT
+ * @brief Number of 16-bit registers holding the 32-bit flow setpoint.
+ */
+#define MODBUS_SETPOINT_REGISTERS_COUNT 2
+
 /**
  * @def MODBUS_REGISTER_FLOW
  * @brief MODBUS register for reading the current flow (2103).
@@ -55,4 +177,135 @@
  */
 #define MODBUS_REGISTER_GAS 2100
 
+/**
+ * @def MODBUS_REGISTER_STATUS
+ * @brief MODBUS register holding the instrument status bits `RRG_STATUS_*` (2101, read-only).
+ */
+#define MODBUS_REGISTER_STATUS 2101
+
+/**
+ * @def RRG_STATUS_MASS_FLOW_OVERRANGE
+ * @brief Status register bit: mass flow overrange (MOV).
+ */
+#define RRG_STATUS_MASS_FLOW_OVERRANGE 0x01
+
+/**
+ * @def RRG_STATUS_TEMPERATURE_OVERRANGE
+ * @brief Status register bit: temperature overrange (TOV).
+ */
+#define RRG_STATUS_TEMPERATURE_OVERRANGE 0x02
+
+/**
+ * @def RRG_STATUS_TOTALIZER_OVERRANGE
+ * @brief Status register bit: totalizer overrange (OVR).
+ */
+#define RRG_STATUS_TOTALIZER_OVERRANGE 0x04
+
+/**
+ * @def RRG_STATUS_VALVE_FROZEN
+ * @brief Status register bit: the valve is frozen by the user.
+ */
+#define RRG_STATUS_VALVE_FROZEN 0x08
+
+/**
+ * @def RRG_STATUS_VALVE_THERMAL_MANAGEMENT
+ * @brief Status register bit: valve thermal management is active (VTM).
+ */
+#define RRG_STATUS_VALVE_THERMAL_MANAGEMENT 0x10
+
+/**
+ * @def MODBUS_FLOW_REGISTERS_COUNT
+ * @brief Number of 16-bit registers holding the 32-bit flow (2103-2104).
+ */
+#define MODBUS_FLOW_REGISTERS_COUNT 2
+
+/**
+ * @def RRG_READ_PLAN_MAX_GAP
+ * @brief Largest run of unused registers a batched read may span between two values.
+ *
+ * The device answers the whole block 2100-2104, so the gas type, the status and the flow are
+ * read in one request across the temperature (2102); the setpoint (2053) is far enough to stay
+ * a separate request.
+ */
+#define RRG_READ_PLAN_MAX_GAP 4
+
+/**
+ * @def RRG_SNAPSHOT_WITH_SETPOINT
+ * @brief `RRG_ReadSnapshot()` flag: also read back the setpoint registers (2053-2054).
+ */
+#define RRG_SNAPSHOT_WITH_SETPOINT 0x01
+
+/**
+ * @def RRG_GROUP_BROADCAST
+ * @brief `RRG_SetFlowGroup()` flag: send a setpoint shared by the whole group as one broadcast
+ *        (slave 0). Every slave on the line receives it, so only set it when all of them are
+ *        regulators (e.g., no relay shares the port).
+ */
+#define RRG_GROUP_BROADCAST 0x01
+
+/**
+ * @def RRG_GROUP_VERIFY
+ * @brief `RRG_SetFlowGroup()` flag: read every setpoint back after the writes, in one sweep,
+ *        and write it again to the regulators that do not hold it.
+ */
+#define RRG_GROUP_VERIFY 0x02
+
+/**
+ * @def RRG_MANY_SERIAL
+ * @brief `RRG_GetFlowMany()` flag: read the buses one after the other on the calling thread
+ *        instead of handing them to their I/O workers.
+ */
+#define RRG_MANY_SERIAL 0x01
+
+/**
+ * @def RRG_SETPOINT_WRITE_MODE_AUTO
+ * @brief Write the setpoint with a single "Write Multiple Registers" (0x10) frame and
+ *        permanently fall back to two "Write Single Register" (0x06) frames if the
+ *        device answers with an "Illegal Function" exception.
+ */
+#define RRG_SETPOINT_WRITE_MODE_AUTO 0
+
+/**
+ * @def RRG_SETPOINT_WRITE_MODE_MULTIPLE
+ * @brief Always write the setpoint with one "Write Multiple Registers" (0x10) frame.
+ */
+#define RRG_SETPOINT_WRITE_MODE_MULTIPLE 1
+
+/**
+ * @def RRG_SETPOINT_WRITE_MODE_SINGLE
+ * @brief Always write the setpoint with two "Write Single Register" (0x06) frames
+ *        (for firmware that does not support function code 0x10).
+ */
+#define RRG_SETPOINT_WRITE_MODE_SINGLE 2
+
+/**
+ * @def RRG_STATS_OP_SET_FLOW
+ * @brief Index of the setpoint writes (`RRG_SetFlow()`, `RRG_SetFlowAsync()`) in `RRG_Stats.latency`.
+ */
+#define RRG_STATS_OP_SET_FLOW 0
+
+/**
+ * @def RRG_STATS_OP_GET_FLOW
+ * @brief Index of the flow reads (`RRG_GetFlow()`, `RRG_GetFlowAsync()`, acquisition) in `RRG_Stats.latency`.
+ */
+#define RRG_STATS_OP_GET_FLOW 1
+
+/**
+ * @def RRG_STATS_OP_SET_GAS
+ * @brief Index of the gas type writes (`RRG_SetGas()`, `RRG_SetGasAsync()`) in `RRG_Stats.latency`.
+ */
+#define RRG_STATS_OP_SET_GAS 2
+
+/**
+ * @def RRG_STATS_OP_READ_SNAPSHOT
+ * @brief Index of the telemetry reads (`RRG_ReadSnapshot()`) in `RRG_Stats.latency`.
+ */
+#define RRG_STATS_OP_READ_SNAPSHOT 3
+
+/**
+ * @def RRG_STATS_OP_COUNT
+ * @brief Number of operations with their own latency histogram.
+ */
+#define RRG_STATS_OP_COUNT 4
+
 #endif // !RRG_CONSTANTS_H
@@ -1,6 +1,8 @@
 #ifndef RRG_ERRORS_H
 #define RRG_ERRORS_H
 
+#include "rrg_preprocessor_macros.h"
+
 /**
  * @def MODBUS_ERR
  * @brief General error code for libmodbus failures.
@@ -8,9 +10,11 @@
 #define MODBUS_ERR -1
 
 /**
- * @brief Global variable to store the last occurred error code.
+ * @brief Last error code of the calling thread.
+ *
+ * The variable is thread-local, so threads driving different devices never see each other's errors.
  */
-extern int RRG_GlobalError;
+extern RRG_THREAD_LOCAL int RRG_GlobalError;
 
 /**
  * @def RRG_OK
@@ -66,10 +70,77 @@ extern int RRG_GlobalError;
  */
 #define ERROR_RRG_INVALID_PARAMETER -1007
 
-/// @brief Resets the global 'RRG_GlobalError' to the status OK.
+/**
+ * @def ERROR_RRG_PORT_CONFIG_MISMATCH
+ * @brief The serial port is already open by another handle with different serial settings, or
+ *        its bus was built in another arena.
+ */
+#define ERROR_RRG_PORT_CONFIG_MISMATCH -1008
+
+/**
+ * @def ERROR_RRG_ACQUISITION_RUNNING
+ * @brief The acquisition thread of the handle is already running.
+ */
+#define ERROR_RRG_ACQUISITION_RUNNING -1009
+
+/**
+ * @def ERROR_RRG_FAILED_START_ACQUISITION
+ * @brief Failed to allocate the sample ring or to start the acquisition thread.
+ */
+#define ERROR_RRG_FAILED_START_ACQUISITION -1010
+
+/**
+ * @def ERROR_RRG_QUEUE_FULL
+ * @brief The asynchronous request queue of the bus is full.
+ */
+#define ERROR_RRG_QUEUE_FULL -1011
+
+/**
+ * @def ERROR_RRG_FAILED_START_WORKER
+ * @brief Failed to start the I/O worker thread of the bus.
+ */
+#define ERROR_RRG_FAILED_START_WORKER -1012
+
+/**
+ * @def ERROR_RRG_DEADLINE_EXPIRED
+ * @brief The deadline of a read passed before it could be sent, so it was dropped.
+ */
+#define ERROR_RRG_DEADLINE_EXPIRED -1013
+
+/**
+ * @def ERROR_RRG_LINK_DOWN
+ * @brief The serial port was lost and the bus is reopening it in the background.
+ */
+#define ERROR_RRG_LINK_DOWN -1014
+
+/**
+ * @def ERROR_RRG_RAMP_RUNNING
+ * @brief A ramp is already running on the handle.
+ */
+#define ERROR_RRG_RAMP_RUNNING -1015
+
+/**
+ * @def ERROR_RRG_FAILED_START_RAMP
+ * @brief Failed to allocate the ramp engine or start its thread.
+ */
+#define ERROR_RRG_FAILED_START_RAMP -1016
+
+/**
+ * @def ERROR_RRG_NOT_SUPPORTED
+ * @brief The port cannot be driven by the fast RTU transport; libmodbus stays in use.
+ */
+#define ERROR_RRG_NOT_SUPPORTED -1017
+
+/**
+ * @def ERROR_RRG_NO_RESPONSE
+ * @brief The regulator did not answer the liveness probe of `RRG_Init()`.
+ */
+#define ERROR_RRG_NO_RESPONSE -1018
+
+/// @brief Resets the thread-local 'RRG_GlobalError' to the status OK.
 static inline void _resetGlobalError() { RRG_GlobalError = RRG_OK; }
 
-/// @brief Sets the global 'RRG_GlobalError' to the specified error status.
+/// @brief Sets the thread-local 'RRG_GlobalError' to the specified error status.
 static inline void _setGlobalError(int error_code) { RRG_GlobalError = error_code; }
 
 #endif // !RRG_ERRORS_H
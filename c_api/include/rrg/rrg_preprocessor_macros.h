@@ -10,6 +10,15 @@
 #define RRG_RESTRICT
 #endif
 
+/* Cross-platform thread-local storage class for per-thread error state. */
+#if defined(_MSC_VER)
+#define RRG_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__) || defined(__clang__)
+#define RRG_THREAD_LOCAL __thread
+#else
+#define RRG_THREAD_LOCAL _Thread_local
+#endif
+
 /* Cross-platform shared library export macros */
 #if defined(_MSC_VER) // Windows (Microsoft Visual Studio)
 #if defined(RRG_DLL_EXPORTS)
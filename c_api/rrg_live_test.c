@@ -4,6 +4,7 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "mb_ports.h"
 #include "rrg.h"
 
 #define INPUT_BUFFER_SIZE 32
@@ -27,24 +28,12 @@ void handle_sigint(int sig)
  */
 char *get_active_serial_port()
 {
-    static char port[32];
+    static MB_PortName port;
 
-    FILE *fp = popen("ls /dev/ttyUSB* 2>/dev/null", "r"); // Get active USB serial devices (Linux).
-    if (!fp)
-    {
-        printf("Error: Unable to execute system command.\n");
+    // The scan is cached by the bus library and only redone when a device is plugged in or removed.
+    if (MB_EnumeratePorts(&port, 1) < 1)
         return NULL;
-    }
-
-    if (fgets(port, sizeof(port), fp) != NULL)
-    {
-        port[strcspn(port, "\n")] = '\0'; // Remove newline character.
-        pclose(fp);
-        return port;
-    }
-
-    pclose(fp);
-    return NULL;
+    return port.name;
 }
 
 int main()
@@ -68,10 +57,12 @@ int main()
             continue;
         }
 
+        memset(&config, 0, sizeof(config));
         config.port = port;
         config.baudrate = RRG_DEFAULT_BAUDRATE;
         config.slave_id = 1;
         config.timeout = RRG_DEFAULT_TIMEOUT_MS;
+        config.setpoint_write_mode = RRG_SETPOINT_WRITE_MODE_AUTO;
 
         printf("Found active port: %s\n", port);
 
@@ -0,0 +1,65 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mb_arena.h"
+#include "mb_platform.h"
+
+// Arenas are only carved while devices are opened: one lock for all of them is enough.
+static MB_Mutex g_arena_lock = MB_MUTEX_INITIALIZER;
+
+int MB_ArenaInit(MB_Arena *MB_RESTRICT arena, void *MB_RESTRICT storage, size_t size)
+{
+    // 1. Validate input parameters.
+    if (unlikely(!arena || !storage))
+    {
+        MB_DEBUG_MSG("Invalid arena storage")
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return MB_ERR;
+    }
+
+    // 2. Start at the first aligned byte and fault every page in now, not on the hot path.
+    size_t skip = (MB_ARENA_ALIGNMENT - (uintptr_t)storage % MB_ARENA_ALIGNMENT) % MB_ARENA_ALIGNMENT;
+    arena->base = (unsigned char *)storage + (skip < size ? skip : size);
+    arena->size = skip < size ? size - skip : 0;
+    arena->used = 0;
+    memset(arena->base, 0, arena->size);
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+void *MB_ArenaAlloc(MB_Arena *arena, size_t size)
+{
+    if (unlikely(!arena))
+    {
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return NULL;
+    }
+
+    // Round every block up to the alignment, so the next one starts aligned too.
+    size_t rounded = (size + MB_ARENA_ALIGNMENT - 1) / MB_ARENA_ALIGNMENT * MB_ARENA_ALIGNMENT;
+    void *block = NULL;
+    _mbMutexLock(&g_arena_lock);
+    if (rounded >= size && rounded <= arena->size - arena->used)
+    {
+        block = arena->base + arena->used;
+        arena->used += rounded;
+    }
+    _mbMutexUnlock(&g_arena_lock);
+    if (unlikely(!block))
+    {
+        MB_DEBUG_MSG("Arena exhausted")
+        _setBusGlobalError(ERROR_MB_OUT_OF_MEMORY);
+    }
+    return block;
+}
+
+size_t MB_ArenaUsed(const MB_Arena *arena)
+{
+    if (!arena)
+        return 0;
+    _mbMutexLock(&g_arena_lock);
+    size_t used = arena->used;
+    _mbMutexUnlock(&g_arena_lock);
+    return used;
+}
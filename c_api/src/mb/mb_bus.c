@@ -0,0 +1,1445 @@
+#ifdef _WIN32
+#include "modbus.h"
+#else
+#include <modbus/modbus.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "mb_alloc.h"
+#include "mb_bus.h"
+#include "mb_platform.h"
+#include "mb_rtu.h"
+#include "mb_sim.h"
+
+// Thread-local error variable definition.
+MB_THREAD_LOCAL int MB_GlobalError = MB_OK;
+
+/**
+ * @struct MB_BusRequest
+ * @brief Slot of the asynchronous request queue of a bus.
+ */
+typedef struct
+{
+    MB_BusJob job;       ///< Function executed by the worker.
+    uint64_t id;         ///< Request ID handed out by `MB_BusSubmit()`.
+    int64_t deadline_ns; ///< Monotonic time after which the request is dropped (0 for none).
+    union
+    {
+        unsigned char bytes[MB_BUS_REQUEST_PAYLOAD_SIZE];
+        void *align_ptr;
+        double align_double;
+        int64_t align_int;
+    } payload; ///< Copy of the job arguments.
+} MB_BusRequest;
+
+/**
+ * @struct MB_BusQueue
+ * @brief Circular FIFO of the pending requests of one priority class.
+ */
+typedef struct
+{
+    MB_BusRequest slots[MB_BUS_QUEUE_CAPACITY]; ///< Pending requests.
+    size_t head;                                ///< Index of the oldest pending request.
+    size_t count;                               ///< Number of pending requests.
+} MB_BusQueue;
+
+/**
+ * @struct MB_SlaveTiming
+ * @brief Response timeout state of one slave on the bus.
+ */
+typedef struct
+{
+    int base_timeout_us; ///< Timeout set with `MB_BusSetSlaveTimeout()`.
+    int timeout_us;      ///< Response timeout in effect for the slave.
+    int byte_timeout_us; ///< Inter-character timeout in effect for the slave.
+    int adaptive;        ///< Non-zero if the timeout follows the measured latency.
+    int samples;         ///< Number of round trips measured since adaptive mode was enabled.
+    int backed_off;      ///< Non-zero after a timeout doubled the estimate, until the next response.
+    int64_t srtt_us;     ///< Smoothed round-trip time.
+    int64_t rttvar_us;   ///< Smoothed mean deviation of the round-trip time.
+} MB_SlaveTiming;
+
+/**
+ * @struct MB_BusOpening
+ * @brief Port a thread is opening without holding the registry lock.
+ */
+typedef struct MB_BusOpening
+{
+    const char *port;           ///< Port name.
+    struct MB_BusOpening *next; ///< Next port being opened.
+} MB_BusOpening;
+
+struct MB_Bus
+{
+    MB_Bus *next;          ///< Next bus in the process-wide registry.
+    char *port;            ///< Copy of the port name, used as the registry key.
+    MB_Arena *arena;       ///< Arena the bus was allocated from (`NULL`: the heap).
+    int baudrate;          ///< Serial settings the port was opened with.
+    char parity;           ///< Parity the port was opened with.
+    int data_bits;         ///< Data bits the port was opened with.
+    int stop_bits;         ///< Stop bits the port was opened with.
+    int transport;         ///< `MB_TRANSPORT_*` of the bus.
+    int timeout_us;        ///< Default response timeout, which also bounds a connection to a gateway.
+    int refcount;          ///< Number of users (owner + attached handles), protected by the registry lock.
+    int64_t idle_since_ns; ///< Time the last user released the lingering bus (0 while in use), registry lock.
+
+    modbus_t *ctx;                           ///< The only libmodbus context of the port (`NULL` for RTU over TCP).
+    MB_Mutex lock;                           ///< Protects the line state and the slave timings.
+    MB_Mutex gate_lock;                      ///< Protects the ownership of the line.
+    MB_Cond gate_cond;                       ///< Signalled when the line is released.
+    int line_busy;                           ///< Non-zero while a transaction owns the line.
+    int line_waiting[MB_PRIORITY_COUNT];     ///< Threads waiting for the line, per priority class.
+    int current_slave;                       ///< Slave currently selected in `ctx`.
+    int current_timeout_us;                  ///< Response timeout currently set in `ctx`.
+    int current_byte_timeout_us;             ///< Byte timeout currently set in `ctx`.
+    int64_t transaction_start_ns;            ///< Start of the current transaction (monotonic clock).
+    int fast_rtu;                            ///< Non-zero once `rtu` is bound to the port (always for RTU over TCP).
+    MB_RtuPort rtu;                          ///< Port state of the fast RTU transport, used by the line owner.
+    MB_Sim *sim;                             ///< Line answering the frames instead of `rtu` (`MB_TRANSPORT_SIM`).
+    MB_SlaveTiming slaves[MB_MAX_SLAVE_ID + 1]; ///< Per-slave timeouts.
+
+    MB_Mutex queue_lock;                         ///< Protects the request queue and the worker state.
+    MB_Cond queue_cond;                          ///< Signalled when a request is queued or the worker must stop.
+    MB_Cond done_cond;                           ///< Signalled when a request completes.
+    MB_BusQueue queues[MB_PRIORITY_COUNT];       ///< Pending requests, per priority class.
+    size_t queue_count;                          ///< Number of pending requests of all classes.
+    uint64_t last_request_id;                    ///< ID given to the most recent request.
+    uint64_t running_request_id;                 ///< ID of the request the worker is running (0 if none).
+    MB_Thread worker;                            ///< I/O worker thread (valid while `worker_started`).
+    int worker_started;                          ///< Non-zero once the worker thread was started.
+    int worker_stopping;                         ///< Non-zero when the worker must exit after draining the queue.
+
+    int link_down;                               ///< Non-zero while the port is lost (accessed atomically).
+    uint64_t reconnects;                         ///< Number of times the port was reopened (accessed atomically).
+    MB_Mutex keeper_lock;                        ///< Protects the reconnect thread state.
+    MB_Cond keeper_cond;                         ///< Signalled when the link goes down or the keeper must stop.
+    MB_Thread keeper;                            ///< Reconnect thread (valid while `keeper_started`).
+    int keeper_started;                          ///< Non-zero once the reconnect thread was started.
+    int keeper_stopping;                         ///< Non-zero when the reconnect thread must exit.
+    MB_Mutex listener_lock;                      ///< Protects the listeners; held while they run.
+    MB_BusListener *listeners;                   ///< Callbacks run after a reconnect.
+};
+
+// Registry of open buses. Any number of device libraries share it through this library.
+static MB_Bus *g_buses = NULL;
+static MB_Mutex g_buses_lock = MB_MUTEX_INITIALIZER;
+static MB_Cond g_buses_cond = MB_COND_INITIALIZER; ///< Signalled when a port is done opening.
+static MB_BusOpening *g_openings = NULL;            ///< Ports being opened, protected by the registry lock.
+static int64_t g_pool_linger_ns = 0; ///< Time released buses stay open, protected by the registry lock.
+
+MB_THREAD_ROUTINE(_busWorker, arg);
+MB_THREAD_ROUTINE(_busKeeper, arg);
+
+/// @brief Applies a response timeout given in microseconds to the context.
+/// libmodbus rejects a microsecond part of one second or more, so whole seconds go apart.
+static int _setResponseTimeout(modbus_t *ctx, int timeout_us)
+{
+    return modbus_set_response_timeout(ctx, (uint32_t)(timeout_us / 1000000), (uint32_t)(timeout_us % 1000000));
+}
+
+/// @brief Applies an inter-character timeout given in microseconds to the context.
+static int _setByteTimeout(modbus_t *ctx, int timeout_us)
+{
+    return modbus_set_byte_timeout(ctx, (uint32_t)(timeout_us / 1000000), (uint32_t)(timeout_us % 1000000));
+}
+
+/// @brief Resets the timing state of a slave to the configured timeout.
+static void _resetSlaveTiming(MB_SlaveTiming *MB_RESTRICT slave, int timeout_us, int adaptive)
+{
+    slave->base_timeout_us = timeout_us;
+    slave->timeout_us = timeout_us;
+    slave->adaptive = adaptive;
+    slave->byte_timeout_us = adaptive ? timeout_us : MB_DEFAULT_BYTE_TIMEOUT_US;
+    slave->samples = 0;
+    slave->backed_off = 0;
+    slave->srtt_us = 0;
+    slave->rttvar_us = 0;
+}
+
+/// @brief Feeds the outcome of a transaction into the adaptive timeout of the slave.
+static void _updateSlaveTiming(MB_SlaveTiming *MB_RESTRICT slave, int outcome, int64_t rtt_us)
+{
+    if (outcome == MB_TRANSACTION_TIMEOUT)
+    {
+        // Give a slave that slowed down one longer chance, but do not keep growing for a dead one.
+        if (slave->samples >= MB_ADAPTIVE_TIMEOUT_WARMUP && !slave->backed_off)
+        {
+            slave->timeout_us = slave->timeout_us > MB_ADAPTIVE_TIMEOUT_MAX_US / 2 ? MB_ADAPTIVE_TIMEOUT_MAX_US
+                                                                                  : slave->timeout_us * 2;
+            slave->byte_timeout_us = slave->timeout_us;
+            slave->backed_off = 1;
+        }
+        return;
+    }
+    if (outcome != MB_TRANSACTION_OK)
+        return;
+
+    // 1. Jacobson/Karels estimator: gains of 1/8 for the mean and 1/4 for the deviation.
+    if (slave->samples == 0)
+    {
+        slave->srtt_us = rtt_us;
+        slave->rttvar_us = rtt_us / 2;
+    }
+    else
+    {
+        int64_t error = rtt_us - slave->srtt_us;
+        slave->srtt_us += error / 8;
+        slave->rttvar_us += ((error < 0 ? -error : error) - slave->rttvar_us) / 4;
+    }
+    slave->backed_off = 0;
+    if (++slave->samples < MB_ADAPTIVE_TIMEOUT_WARMUP)
+        return;
+
+    // 2. Mean plus four deviations approximates the tail latency; bound it and add the margin.
+    int64_t timeout_us = slave->srtt_us + 4 * slave->rttvar_us + MB_ADAPTIVE_TIMEOUT_MARGIN_US;
+    if (timeout_us < MB_ADAPTIVE_TIMEOUT_MIN_US)
+        timeout_us = MB_ADAPTIVE_TIMEOUT_MIN_US;
+    if (timeout_us > MB_ADAPTIVE_TIMEOUT_MAX_US)
+        timeout_us = MB_ADAPTIVE_TIMEOUT_MAX_US;
+    slave->timeout_us = (int)timeout_us;
+    slave->byte_timeout_us = (int)timeout_us;
+}
+
+/// @brief Splits a gateway endpoint ("host:port", "[address]:port" or "host") into its host and TCP
+/// port. Returns non-zero on success, 0 if the endpoint is malformed or too long.
+static int _splitEndpoint(const char *MB_RESTRICT endpoint, char *MB_RESTRICT host, const char **MB_RESTRICT service)
+{
+    const char *host_start = endpoint, *host_end, *separator;
+    if (*endpoint == '[')
+    {
+        // Bracketed IPv6 address, as in URLs.
+        host_start = endpoint + 1;
+        host_end = strchr(host_start, ']');
+        if (!host_end || (host_end[1] && host_end[1] != ':'))
+            return 0;
+        separator = host_end[1] ? host_end + 1 : NULL;
+    }
+    else
+    {
+        // A bare IPv6 address has several colons and cannot carry a port.
+        separator = strchr(endpoint, ':');
+        if (separator && strchr(separator + 1, ':'))
+            separator = NULL;
+        host_end = separator ? separator : endpoint + strlen(endpoint);
+    }
+
+    size_t host_length = (size_t)(host_end - host_start);
+    if (host_length == 0 || host_length >= MB_ENDPOINT_HOST_MAX || (separator && !separator[1]))
+        return 0;
+    memcpy(host, host_start, host_length);
+    host[host_length] = '\0';
+    *service = separator ? separator + 1 : MB_TCP_DEFAULT_SERVICE;
+    return 1;
+}
+
+/// @brief Connects an RTU-over-TCP bus to its gateway. Returns `MB_OK` or `MB_ERR`.
+static int _connectRtuOverTcp(MB_Bus *bus)
+{
+    char host[MB_ENDPOINT_HOST_MAX];
+    const char *service;
+    if (!_splitEndpoint(bus->port, host, &service))
+    {
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return MB_ERR;
+    }
+    return MB_RtuOpenTcp(&bus->rtu, host, service, bus->timeout_us);
+}
+
+/// @brief Creates the libmodbus context of an RTU or TCP bus. Returns `NULL` with the bus error set on failure.
+static modbus_t *_createContext(const MB_BusConfig *MB_RESTRICT config)
+{
+    modbus_t *ctx = NULL;
+    if (config->transport == MB_TRANSPORT_RTU)
+        ctx = modbus_new_rtu(config->port, config->baudrate, config->parity, config->data_bits, config->stop_bits);
+    else
+    {
+        char host[MB_ENDPOINT_HOST_MAX];
+        const char *service;
+        if (!_splitEndpoint(config->port, host, &service))
+        {
+            MB_DEBUG_MSG("Malformed gateway endpoint")
+            _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+            return NULL;
+        }
+        ctx = modbus_new_tcp_pi(host, service);
+    }
+    if (unlikely(!ctx))
+    {
+        MB_MODBUS_DEBUG_MSG;
+        _setBusGlobalError(ERROR_MB_FAILED_CREATE_CONTEXT);
+    }
+    return ctx;
+}
+
+/// @brief Creates, configures and connects a new bus for the given configuration.
+static MB_Bus *_createBus(const MB_BusConfig *MB_RESTRICT config)
+{
+    MB_Arena *arena = config->arena;
+    MB_Bus *bus = _mbAlloc(arena, sizeof(*bus));
+    size_t port_len = strlen(config->port) + 1;
+    char *port = _mbAlloc(arena, port_len);
+    if (unlikely(!bus || !port))
+    {
+        _mbFree(arena, bus);
+        _mbFree(arena, port);
+        _setBusGlobalError(ERROR_MB_OUT_OF_MEMORY);
+        return NULL;
+    }
+    memcpy(port, config->port, port_len);
+    bus->port = port;
+    bus->arena = arena;
+    bus->timeout_us = config->timeout * 1000;
+
+    // 1. RTU over TCP has no libmodbus backend: the bus frames its requests itself on the connection.
+    if (config->transport == MB_TRANSPORT_RTU_OVER_TCP)
+    {
+        if (_connectRtuOverTcp(bus) != MB_OK)
+        {
+            _mbFree(arena, bus);
+            _mbFree(arena, port);
+            return NULL;
+        }
+        bus->fast_rtu = 1;
+    }
+    else if (config->transport == MB_TRANSPORT_SIM)
+    {
+        // A simulated line takes the frames of the fast transport, without a port.
+        if (MB_SimAttach(config->port, &bus->sim) != MB_OK)
+        {
+            _mbFree(arena, bus);
+            _mbFree(arena, port);
+            return NULL;
+        }
+        bus->fast_rtu = 1;
+    }
+    else
+    {
+        // 2. Otherwise initialize the MODBUS-RTU or MODBUS TCP context of the line.
+        modbus_t *ctx = _createContext(config);
+        if (unlikely(!ctx))
+        {
+            _mbFree(arena, bus);
+            _mbFree(arena, port);
+            return NULL;
+        }
+
+        // 3. Configure the default response timeout.
+        if (unlikely(_setResponseTimeout(ctx, config->timeout * 1000) == MODBUS_ERR))
+        {
+            MB_MODBUS_DEBUG_MSG;
+            modbus_free(ctx);
+            _mbFree(arena, bus);
+            _mbFree(arena, port);
+            _setBusGlobalError(ERROR_MB_FAILED_SET_TIMEOUT);
+            return NULL;
+        }
+
+        // 4. Open the serial port or the connection to the gateway.
+        if (modbus_connect(ctx) == MODBUS_ERR)
+        {
+            MB_MODBUS_DEBUG_MSG;
+            modbus_free(ctx);
+            _mbFree(arena, bus);
+            _mbFree(arena, port);
+            _setBusGlobalError(ERROR_MB_FAILED_CONNECT);
+            return NULL;
+        }
+        bus->ctx = ctx;
+    }
+
+    bus->baudrate = config->baudrate;
+    bus->parity = config->parity;
+    bus->data_bits = config->data_bits;
+    bus->stop_bits = config->stop_bits;
+    bus->transport = config->transport;
+    bus->refcount = 1;
+    bus->current_slave = -1;
+    bus->current_timeout_us = config->timeout * 1000;
+    bus->current_byte_timeout_us = MB_DEFAULT_BYTE_TIMEOUT_US;
+    for (int slave = 0; slave <= MB_MAX_SLAVE_ID; ++slave)
+        _resetSlaveTiming(&bus->slaves[slave], config->timeout * 1000, 0);
+    _mbMutexInit(&bus->lock);
+    _mbMutexInit(&bus->gate_lock);
+    _mbCondInit(&bus->gate_cond);
+    _mbMutexInit(&bus->queue_lock);
+    _mbCondInit(&bus->queue_cond);
+    _mbCondInit(&bus->done_cond);
+    _mbMutexInit(&bus->keeper_lock);
+    _mbCondInit(&bus->keeper_cond);
+    _mbMutexInit(&bus->listener_lock);
+    return bus;
+}
+
+/// @brief Stops the threads of a bus nobody can reach anymore, closes its port and frees it.
+static void _destroyBus(MB_Bus *bus)
+{
+    // 1. Let the worker finish the queue and exit, and stop reconnecting.
+    _mbMutexLock(&bus->queue_lock);
+    int worker_started = bus->worker_started;
+    bus->worker_stopping = 1;
+    _mbCondBroadcast(&bus->queue_cond);
+    _mbMutexUnlock(&bus->queue_lock);
+    if (worker_started)
+        _mbThreadJoin(bus->worker);
+
+    _mbMutexLock(&bus->keeper_lock);
+    int keeper_started = bus->keeper_started;
+    bus->keeper_stopping = 1;
+    _mbCondBroadcast(&bus->keeper_cond);
+    _mbMutexUnlock(&bus->keeper_lock);
+    if (keeper_started)
+        _mbThreadJoin(bus->keeper);
+
+    // 2. Close the port and free resources.
+    if (bus->ctx)
+    {
+        modbus_close(bus->ctx);
+        modbus_free(bus->ctx);
+    }
+    else if (bus->sim)
+        MB_SimRelease(bus->sim);
+    else
+        MB_RtuClosePort(&bus->rtu);
+    _mbMutexDestroy(&bus->listener_lock);
+    _mbCondDestroy(&bus->keeper_cond);
+    _mbMutexDestroy(&bus->keeper_lock);
+    _mbCondDestroy(&bus->done_cond);
+    _mbCondDestroy(&bus->queue_cond);
+    _mbMutexDestroy(&bus->queue_lock);
+    _mbCondDestroy(&bus->gate_cond);
+    _mbMutexDestroy(&bus->gate_lock);
+    _mbMutexDestroy(&bus->lock);
+    MB_Arena *arena = bus->arena;
+    _mbFree(arena, bus->port);
+    _mbFree(arena, bus);
+}
+
+/// @brief Unlinks from the registry the idle buses that lingered past `expiry_ns` (all idle buses if
+/// `expiry_ns` is 0) and returns them as a list. The registry lock must be held.
+static MB_Bus *_takeIdleBuses(int64_t expiry_ns)
+{
+    MB_Bus *expired = NULL;
+    for (MB_Bus **it = &g_buses; *it;)
+    {
+        MB_Bus *bus = *it;
+        if (bus->refcount == 0 && (!expiry_ns || bus->idle_since_ns <= expiry_ns))
+        {
+            *it = bus->next;
+            bus->next = expired;
+            expired = bus;
+        }
+        else
+            it = &bus->next;
+    }
+    return expired;
+}
+
+/// @brief Unlinks a bus from the registry. The registry lock must be held.
+static void _unlinkBus(MB_Bus *bus)
+{
+    MB_Bus **link = &g_buses;
+    while (*link && *link != bus)
+        link = &(*link)->next;
+    if (*link)
+        *link = bus->next;
+}
+
+/// @brief Returns non-zero if another thread is opening `port`. The registry lock must be held.
+static int _isOpening(const char *port)
+{
+    for (const MB_BusOpening *it = g_openings; it; it = it->next)
+        if (strcmp(it->port, port) == 0)
+            return 1;
+    return 0;
+}
+
+/// @brief Destroys a list of unlinked buses, e.g., returned by `_takeIdleBuses()`. The registry lock must not
+/// be held, as it joins their threads.
+static void _destroyBuses(MB_Bus *list)
+{
+    while (list)
+    {
+        MB_Bus *next = list->next;
+        _destroyBus(list);
+        list = next;
+    }
+}
+
+/// @brief Starts the I/O worker and the reconnect thread of the bus if they are not running yet.
+/// Returns `MB_OK` or `ERROR_MB_FAILED_START_WORKER`.
+static int _startBusThreads(MB_Bus *bus)
+{
+    _mbMutexLock(&bus->queue_lock);
+    if (!bus->worker_started && _mbThreadCreate(&bus->worker, _busWorker, bus) == 0)
+        bus->worker_started = 1;
+    int started = bus->worker_started;
+    _mbMutexUnlock(&bus->queue_lock);
+
+    _mbMutexLock(&bus->keeper_lock);
+    if (!bus->keeper_started && _mbThreadCreate(&bus->keeper, _busKeeper, bus) == 0)
+        bus->keeper_started = 1;
+    started &= bus->keeper_started;
+    _mbMutexUnlock(&bus->keeper_lock);
+    return started ? MB_OK : ERROR_MB_FAILED_START_WORKER;
+}
+
+/// @brief Hands the bus opened (or shared) for `config` to the caller. A device opened with an
+/// arena must not create anything on first use later, so the threads of its bus start now.
+static int _openedBus(const MB_BusConfig *MB_RESTRICT config, MB_Bus *opened, MB_Bus **MB_RESTRICT bus)
+{
+    int status = config->arena ? _startBusThreads(opened) : MB_OK;
+    if (unlikely(status != MB_OK))
+    {
+        MB_BusClose(opened);
+        _setBusGlobalError(status);
+        return MB_ERR;
+    }
+    *bus = opened;
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+int MB_BusOpen(const MB_BusConfig *MB_RESTRICT config, MB_Bus **MB_RESTRICT bus)
+{
+    // 1. Validate input parameters.
+    if (unlikely(!config || !config->port || !bus || config->timeout < 0 || config->timeout > MB_MAX_TIMEOUT_MS ||
+                 config->transport < MB_TRANSPORT_RTU || config->transport > MB_TRANSPORT_SIM))
+    {
+        MB_DEBUG_MSG("Invalid bus configuration")
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return MB_ERR;
+    }
+
+    _mbMutexLock(&g_buses_lock);
+
+    // 2. Unlink the idle buses that lingered too long; they are closed once the registry is unlocked,
+    // since closing a bus joins its threads.
+    MB_Bus *stale = _takeIdleBuses(_mbMonotonicNs() - g_pool_linger_ns);
+
+    // 3. Reuse the bus if the port is already open (or still lingering), once a thread opening it is done.
+    while (_isOpening(config->port))
+        _mbCondWait(&g_buses_cond, &g_buses_lock);
+    for (MB_Bus **link = &g_buses; *link; link = &(*link)->next)
+    {
+        MB_Bus *it = *link;
+        if (strcmp(it->port, config->port) != 0)
+            continue;
+
+        // A bus built in an arena only serves devices of that arena: the storage of another one
+        // may be reused while the bus is still in use.
+        if (it->baudrate != config->baudrate || it->parity != config->parity ||
+            it->data_bits != config->data_bits || it->stop_bits != config->stop_bits ||
+            it->transport != config->transport || (it->arena && it->arena != config->arena))
+        {
+            if (it->refcount == 0)
+            {
+                // An idle bus holds the port with other settings: close it before opening a new one.
+                *link = it->next;
+                it->next = stale;
+                stale = it;
+                break;
+            }
+            _mbMutexUnlock(&g_buses_lock);
+            _destroyBuses(stale);
+            MB_DEBUG_MSG("Port is already open with different settings or from another arena")
+            _setBusGlobalError(ERROR_MB_CONFIG_MISMATCH);
+            return MB_ERR;
+        }
+
+        ++it->refcount;
+        it->idle_since_ns = 0;
+        _mbMutexUnlock(&g_buses_lock);
+        _destroyBuses(stale);
+        return _openedBus(config, it, bus);
+    }
+
+    // 4. Otherwise open the port and register the new bus. The registry is unlocked meanwhile, so
+    // devices on other ports open in parallel (a connection to a gateway may take the whole timeout).
+    // The stale buses are closed first, as one of them may still hold the port.
+    MB_BusOpening opening = {config->port, g_openings};
+    g_openings = &opening;
+    _mbMutexUnlock(&g_buses_lock);
+    _destroyBuses(stale);
+    MB_Bus *created = _createBus(config);
+    _mbMutexLock(&g_buses_lock);
+    MB_BusOpening **link = &g_openings;
+    while (*link != &opening)
+        link = &(*link)->next;
+    *link = opening.next;
+    _mbCondBroadcast(&g_buses_cond);
+    if (unlikely(!created))
+    {
+        _mbMutexUnlock(&g_buses_lock);
+        return MB_ERR;
+    }
+    created->next = g_buses;
+    g_buses = created;
+    _mbMutexUnlock(&g_buses_lock);
+    return _openedBus(config, created, bus);
+}
+
+void MB_BusRetain(MB_Bus *bus)
+{
+    if (!bus)
+        return;
+
+    _mbMutexLock(&g_buses_lock);
+    ++bus->refcount;
+    _mbMutexUnlock(&g_buses_lock);
+}
+
+void MB_BusClose(MB_Bus *bus)
+{
+    if (!bus)
+        return;
+
+    // 1. Drop the reference; the last one leaves the bus idle in the registry, or unlinks it
+    // if the pool does not linger. A bus built in an arena never lingers: its storage may be
+    // reused as soon as its devices are closed.
+    _mbMutexLock(&g_buses_lock);
+    if (--bus->refcount > 0)
+    {
+        _mbMutexUnlock(&g_buses_lock);
+        return;
+    }
+    if (bus->arena)
+        _unlinkBus(bus);
+    int64_t now_ns = _mbMonotonicNs();
+    bus->idle_since_ns = now_ns;
+    MB_Bus *expired = _takeIdleBuses(g_pool_linger_ns ? now_ns - g_pool_linger_ns : now_ns);
+    if (bus->arena)
+    {
+        bus->next = expired;
+        expired = bus;
+    }
+    _mbMutexUnlock(&g_buses_lock);
+
+    // 2. Nobody can reach the unlinked buses anymore: close them.
+    _destroyBuses(expired);
+}
+
+void MB_BusSetPoolLinger(int linger_ms)
+{
+    _mbMutexLock(&g_buses_lock);
+    g_pool_linger_ns = linger_ms > 0 ? (int64_t)linger_ms * 1000000 : 0;
+    _mbMutexUnlock(&g_buses_lock);
+}
+
+void MB_BusFlushPool(void)
+{
+    _mbMutexLock(&g_buses_lock);
+    MB_Bus *idle = _takeIdleBuses(0);
+    _mbMutexUnlock(&g_buses_lock);
+    _destroyBuses(idle);
+}
+
+void *MB_BusGetContext(MB_Bus *bus) { return bus ? bus->ctx : NULL; }
+
+int MB_BusSetSlaveTimeout(MB_Bus *bus, int slave_id, int timeout)
+{
+    if (unlikely(!bus || slave_id < 0 || slave_id > MB_MAX_SLAVE_ID || timeout < 0 || timeout > MB_MAX_TIMEOUT_MS))
+    {
+        MB_DEBUG_MSG("Invalid slave timeout parameters")
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return MB_ERR;
+    }
+
+    _mbMutexLock(&bus->lock);
+    MB_SlaveTiming *slave = &bus->slaves[slave_id];
+    _resetSlaveTiming(slave, timeout * 1000, slave->adaptive);
+    _mbMutexUnlock(&bus->lock);
+
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+int MB_BusSetAdaptiveTimeout(MB_Bus *bus, int slave_id, int enabled)
+{
+    if (unlikely(!bus || slave_id < 0 || slave_id > MB_MAX_SLAVE_ID))
+    {
+        MB_DEBUG_MSG("Invalid slave timeout parameters")
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return MB_ERR;
+    }
+
+    _mbMutexLock(&bus->lock);
+    MB_SlaveTiming *slave = &bus->slaves[slave_id];
+    _resetSlaveTiming(slave, slave->base_timeout_us, enabled != 0);
+    _mbMutexUnlock(&bus->lock);
+
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+int MB_BusGetSlaveTimeoutUs(MB_Bus *bus, int slave_id)
+{
+    if (unlikely(!bus || slave_id < 0 || slave_id > MB_MAX_SLAVE_ID))
+    {
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return MB_ERR;
+    }
+
+    _mbMutexLock(&bus->lock);
+    int timeout_us = bus->slaves[slave_id].timeout_us;
+    _mbMutexUnlock(&bus->lock);
+
+    _resetBusGlobalError();
+    return timeout_us;
+}
+
+/// @brief Waits until the line is free and no thread of a more urgent class waits for it, then takes it.
+static void _acquireLine(MB_Bus *bus, int priority)
+{
+    _mbMutexLock(&bus->gate_lock);
+    ++bus->line_waiting[priority];
+    for (;;)
+    {
+        int yield = bus->line_busy;
+        for (int more_urgent = 0; more_urgent < priority && !yield; ++more_urgent)
+            yield = bus->line_waiting[more_urgent] > 0;
+        if (!yield)
+            break;
+        _mbCondWait(&bus->gate_cond, &bus->gate_lock);
+    }
+    --bus->line_waiting[priority];
+    bus->line_busy = 1;
+    _mbMutexUnlock(&bus->gate_lock);
+
+    _mbMutexLock(&bus->lock);
+}
+
+/// @brief Gives the line up and wakes the waiters, so the most urgent one can take it.
+static void _releaseLine(MB_Bus *bus)
+{
+    _mbMutexUnlock(&bus->lock);
+
+    _mbMutexLock(&bus->gate_lock);
+    bus->line_busy = 0;
+    _mbCondBroadcast(&bus->gate_cond);
+    _mbMutexUnlock(&bus->gate_lock);
+}
+
+/// @brief Selects a slave in the context of a locked line and applies its timeouts if they differ
+/// from the ones in effect. Returns `MB_OK` or an error code.
+static int _selectSlave(MB_Bus *MB_RESTRICT bus, int slave_id)
+{
+    // The context keeps the slave, so this is skipped for back-to-back requests. Without a
+    // context (RTU over TCP) the frames take the slave and timeouts from the bus.
+    const MB_SlaveTiming *slave = &bus->slaves[slave_id];
+    if (!bus->ctx)
+    {
+        bus->current_slave = slave_id;
+        bus->current_timeout_us = slave->timeout_us;
+        bus->current_byte_timeout_us = slave->byte_timeout_us;
+        return MB_OK;
+    }
+    if (bus->current_slave != slave_id)
+    {
+        if (unlikely(modbus_set_slave(bus->ctx, slave_id) == MODBUS_ERR))
+        {
+            MB_MODBUS_DEBUG_MSG;
+            return ERROR_MB_FAILED_SET_SLAVE;
+        }
+        bus->current_slave = slave_id;
+    }
+
+    if (bus->current_timeout_us != slave->timeout_us)
+    {
+        if (unlikely(_setResponseTimeout(bus->ctx, slave->timeout_us) == MODBUS_ERR))
+        {
+            MB_MODBUS_DEBUG_MSG;
+            return ERROR_MB_FAILED_SET_TIMEOUT;
+        }
+        bus->current_timeout_us = slave->timeout_us;
+    }
+    if (bus->current_byte_timeout_us != slave->byte_timeout_us)
+    {
+        if (unlikely(_setByteTimeout(bus->ctx, slave->byte_timeout_us) == MODBUS_ERR))
+        {
+            MB_MODBUS_DEBUG_MSG;
+            return ERROR_MB_FAILED_SET_TIMEOUT;
+        }
+        bus->current_byte_timeout_us = slave->byte_timeout_us;
+    }
+    return MB_OK;
+}
+
+/// @brief Reopens the port of a bus whose link is down. Returns non-zero on success.
+static int _reopenPort(MB_Bus *bus)
+{
+    // The line is taken like a safety write would, so no transaction runs on the closed context.
+    _acquireLine(bus, MB_PRIORITY_SAFETY);
+    int reopened;
+    MB_Sim *sim;
+    if (bus->sim)
+    {
+        // A simulated line comes back when one is opened again under the name; until then
+        // the requests keep failing on the closed one.
+        reopened = MB_SimAttach(bus->port, &sim) == MB_OK;
+        if (reopened)
+        {
+            MB_SimRelease(bus->sim);
+            bus->sim = sim;
+        }
+    }
+    else if (!bus->ctx)
+    {
+        // A new connection to the gateway starts with no stale bytes.
+        MB_RtuClosePort(&bus->rtu);
+        reopened = _connectRtuOverTcp(bus) == MB_OK;
+    }
+    else
+    {
+        modbus_close(bus->ctx);
+        reopened = modbus_connect(bus->ctx) != MODBUS_ERR;
+        if (reopened)
+        {
+            // Whatever the adapter buffered before it went away belongs to no request.
+            modbus_flush(bus->ctx);
+            if (bus->fast_rtu)
+                bus->fast_rtu = MB_RtuOpenPort(&bus->rtu, modbus_get_socket(bus->ctx)) == MB_OK;
+        }
+    }
+    if (reopened)
+    {
+        _mbAtomicIncU64(&bus->reconnects);
+        _mbAtomicStoreInt(&bus->link_down, 0);
+    }
+    _releaseLine(bus);
+    return reopened;
+}
+
+/// @brief Reconnect thread: reopens the port whenever the link goes down, retrying with an
+/// exponential backoff, and lets the listeners restore the state of their devices.
+MB_THREAD_ROUTINE(_busKeeper, arg)
+{
+    MB_Bus *bus = arg;
+    int backoff_ms = 0;
+
+    _mbMutexLock(&bus->keeper_lock);
+    for (;;)
+    {
+        while (!bus->keeper_stopping && !_mbAtomicLoadInt(&bus->link_down))
+            _mbCondWait(&bus->keeper_cond, &bus->keeper_lock);
+        if (bus->keeper_stopping)
+            break;
+        _mbMutexUnlock(&bus->keeper_lock);
+
+        // 1. The first attempt is immediate: a glitch of the adapter is usually over by now.
+        int reopened = _reopenPort(bus);
+        if (reopened)
+        {
+            _mbMutexLock(&bus->listener_lock);
+            for (MB_BusListener *listener = bus->listeners; listener; listener = listener->next)
+                listener->on_reconnect(listener->user_data);
+            _mbMutexUnlock(&bus->listener_lock);
+        }
+
+        // 2. Otherwise wait before the next attempt, twice as long every time, unless the bus closes.
+        _mbMutexLock(&bus->keeper_lock);
+        if (reopened)
+        {
+            backoff_ms = 0;
+            continue;
+        }
+        backoff_ms = !backoff_ms                                  ? MB_RECONNECT_MIN_BACKOFF_MS
+                     : backoff_ms > MB_RECONNECT_MAX_BACKOFF_MS / 2 ? MB_RECONNECT_MAX_BACKOFF_MS
+                                                                  : backoff_ms * 2;
+        int64_t retry_ns = _mbMonotonicNs() + (int64_t)backoff_ms * 1000000;
+        while (!bus->keeper_stopping && _mbMonotonicNs() < retry_ns)
+            _mbCondWaitUntilNs(&bus->keeper_cond, &bus->keeper_lock, retry_ns);
+    }
+    _mbMutexUnlock(&bus->keeper_lock);
+    MB_THREAD_RETURN;
+}
+
+/// @brief Marks the link of the bus down and wakes its reconnect thread, starting it on first use.
+static void _markLinkDown(MB_Bus *bus)
+{
+    _mbAtomicStoreInt(&bus->link_down, 1);
+    _mbMutexLock(&bus->keeper_lock);
+    if (unlikely(!bus->keeper_started && !bus->keeper_stopping))
+    {
+        if (_mbThreadCreate(&bus->keeper, _busKeeper, bus) == 0)
+            bus->keeper_started = 1;
+        else
+            _mbAtomicStoreInt(&bus->link_down, 0); // Nobody would reconnect: let requests time out as before.
+    }
+    _mbCondBroadcast(&bus->keeper_cond);
+    _mbMutexUnlock(&bus->keeper_lock);
+}
+
+int MB_BusAddListener(MB_Bus *MB_RESTRICT bus, MB_BusListener *MB_RESTRICT listener)
+{
+    if (unlikely(!bus || !listener || !listener->on_reconnect))
+    {
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return MB_ERR;
+    }
+
+    _mbMutexLock(&bus->listener_lock);
+    listener->next = bus->listeners;
+    bus->listeners = listener;
+    _mbMutexUnlock(&bus->listener_lock);
+
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+void MB_BusRemoveListener(MB_Bus *MB_RESTRICT bus, MB_BusListener *MB_RESTRICT listener)
+{
+    if (!bus || !listener)
+        return;
+
+    // The lock is held while the listeners run, so none is running once it is taken.
+    _mbMutexLock(&bus->listener_lock);
+    for (MB_BusListener **it = &bus->listeners; *it; it = &(*it)->next)
+    {
+        if (*it == listener)
+        {
+            *it = listener->next;
+            break;
+        }
+    }
+    _mbMutexUnlock(&bus->listener_lock);
+    listener->next = NULL;
+}
+
+int MB_BusIsLinkUp(MB_Bus *bus) { return bus && !_mbAtomicLoadInt(&bus->link_down); }
+
+uint64_t MB_BusGetReconnectCount(MB_Bus *bus) { return bus ? _mbAtomicLoadU64(&bus->reconnects) : 0; }
+
+void *MB_BusBeginTransaction(MB_Bus *bus, int slave_id, int priority, int64_t deadline_ns)
+{
+    // 1. Validate input parameters.
+    if (unlikely(!bus || slave_id < 0 || slave_id > MB_MAX_SLAVE_ID || priority < 0 ||
+                 priority >= MB_PRIORITY_COUNT))
+    {
+        MB_DEBUG_MSG("Invalid transaction parameters")
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return NULL;
+    }
+
+    _acquireLine(bus, priority);
+
+    // 2. Fail fast while the port is being reopened: the request could only time out.
+    if (unlikely(_mbAtomicLoadInt(&bus->link_down)))
+    {
+        _releaseLine(bus);
+        _setBusGlobalError(ERROR_MB_LINK_DOWN);
+        return NULL;
+    }
+
+    // 3. A request that got the line too late (e.g., a read whose polling slot has passed) is dropped.
+    if (deadline_ns && _mbMonotonicNs() > deadline_ns)
+    {
+        _releaseLine(bus);
+        _setBusGlobalError(ERROR_MB_DEADLINE_EXPIRED);
+        return NULL;
+    }
+
+    // 4. Select the slave and apply its timeouts.
+    int error_code = _selectSlave(bus, slave_id);
+    if (unlikely(error_code != MB_OK))
+    {
+        _releaseLine(bus);
+        _setBusGlobalError(error_code);
+        return NULL;
+    }
+
+    bus->transaction_start_ns = _mbMonotonicNs();
+    return bus->ctx ? (void *)bus->ctx : (void *)bus;
+}
+
+int64_t MB_BusEndTransaction(MB_Bus *bus, int outcome)
+{
+    if (!bus)
+        return 0;
+
+    // The slave selected in the context is the one the transaction talked to.
+    int64_t elapsed_ns = _mbMonotonicNs() - bus->transaction_start_ns;
+    MB_SlaveTiming *slave = &bus->slaves[bus->current_slave];
+    if (slave->adaptive)
+        _updateSlaveTiming(slave, outcome, elapsed_ns / 1000);
+    if (unlikely(outcome == MB_TRANSACTION_LINK_LOST))
+        _mbAtomicStoreInt(&bus->link_down, 1); // Before the release, so the next owner fails fast.
+    _releaseLine(bus);
+    if (unlikely(outcome == MB_TRANSACTION_LINK_LOST))
+        _markLinkDown(bus);
+    return elapsed_ns;
+}
+
+int MB_BusSwitchSlave(MB_Bus *MB_RESTRICT bus, int slave_id, int outcome, int64_t *MB_RESTRICT elapsed_ns)
+{
+    // 1. Validate input parameters.
+    if (unlikely(!bus || !elapsed_ns || slave_id < 0 || slave_id > MB_MAX_SLAVE_ID))
+    {
+        MB_DEBUG_MSG("Invalid transaction parameters")
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return MB_ERR;
+    }
+
+    // 2. Close the part addressed to the current slave, exactly like `MB_BusEndTransaction()`
+    // does, but keep the line.
+    int64_t now_ns = _mbMonotonicNs();
+    *elapsed_ns = now_ns - bus->transaction_start_ns;
+    MB_SlaveTiming *slave = &bus->slaves[bus->current_slave];
+    if (slave->adaptive)
+        _updateSlaveTiming(slave, outcome, *elapsed_ns / 1000);
+    bus->transaction_start_ns = now_ns;
+    if (unlikely(outcome == MB_TRANSACTION_LINK_LOST))
+    {
+        // The reconnect thread waits for the line, which the caller still holds.
+        _markLinkDown(bus);
+        _setBusGlobalError(ERROR_MB_LINK_DOWN);
+        return MB_ERR;
+    }
+
+    // 3. Address the next slave.
+    int error_code = _selectSlave(bus, slave_id);
+    if (unlikely(error_code != MB_OK))
+    {
+        _setBusGlobalError(error_code);
+        return MB_ERR;
+    }
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+int MB_BusEnableFastRtu(MB_Bus *bus)
+{
+    // 1. Validate input parameters.
+    if (unlikely(!bus))
+    {
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return MB_ERR;
+    }
+
+    // 2. MODBUS TCP frames have another header and no CRC.
+    if (bus->transport == MB_TRANSPORT_TCP)
+    {
+        _setBusGlobalError(ERROR_MB_NOT_SUPPORTED);
+        return MB_ERR;
+    }
+
+    // 3. Bind the port while no transaction runs, so none sees it half tuned.
+    _acquireLine(bus, MB_PRIORITY_SAFETY);
+    int status = bus->fast_rtu ? MB_OK : MB_RtuOpenPort(&bus->rtu, modbus_get_socket(bus->ctx));
+    int error_code = MB_GetLastErrorCode();
+    bus->fast_rtu = status == MB_OK;
+    _releaseLine(bus);
+    _setBusGlobalError(status == MB_OK ? MB_OK : error_code);
+    return status;
+}
+
+int MB_BusRtuExecute(MB_Bus *MB_RESTRICT bus, MB_RtuFrame *MB_RESTRICT frame, const uint16_t *MB_RESTRICT payload,
+                     uint16_t *MB_RESTRICT dest)
+{
+    // 1. Validate input parameters.
+    if (unlikely(!bus || !frame))
+    {
+        errno = EINVAL;
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return MB_ERR;
+    }
+    if (unlikely(!bus->fast_rtu))
+    {
+        errno = ENOTSUP;
+        _setBusGlobalError(ERROR_MB_NOT_SUPPORTED);
+        return MB_ERR;
+    }
+
+    // 2. The selected slave's timeouts are the ones `MB_BusBeginTransaction()` applied to the context.
+    if (bus->sim)
+        return MB_SimExecute(bus->sim, frame, payload, dest);
+    return MB_RtuExecute(&bus->rtu, frame, payload, dest, bus->current_timeout_us, bus->current_byte_timeout_us);
+}
+
+/// @brief Runs a request framed by the bus (RTU over TCP, simulated line) once `prepared` says the frame is valid.
+static int _busRequest(MB_Bus *MB_RESTRICT bus, int prepared, MB_RtuFrame *MB_RESTRICT frame,
+                       const uint16_t *MB_RESTRICT payload, uint16_t *MB_RESTRICT dest)
+{
+    if (unlikely(prepared != MB_OK))
+    {
+        errno = EINVAL;
+        return MB_ERR;
+    }
+    if (bus->sim)
+        return MB_SimExecute(bus->sim, frame, payload, dest);
+    return MB_RtuExecute(&bus->rtu, frame, payload, dest, bus->current_timeout_us, bus->current_byte_timeout_us);
+}
+
+int MB_BusReadRegisters(MB_Bus *MB_RESTRICT bus, int addr, int count, uint16_t *MB_RESTRICT dest)
+{
+    if (likely(bus->ctx))
+        return modbus_read_registers(bus->ctx, addr, count, dest);
+    MB_RtuFrame frame;
+    return _busRequest(bus, MB_RtuPrepareRead(&frame, bus->current_slave, addr, count), &frame, NULL, dest);
+}
+
+int MB_BusReadInputRegisters(MB_Bus *MB_RESTRICT bus, int addr, int count, uint16_t *MB_RESTRICT dest)
+{
+    if (likely(bus->ctx))
+        return modbus_read_input_registers(bus->ctx, addr, count, dest);
+    MB_RtuFrame frame;
+    return _busRequest(bus, MB_RtuPrepareReadInput(&frame, bus->current_slave, addr, count), &frame, NULL, dest);
+}
+
+int MB_BusWriteRegister(MB_Bus *bus, int addr, uint16_t value)
+{
+    if (likely(bus->ctx))
+        return modbus_write_register(bus->ctx, addr, value);
+    MB_RtuFrame frame;
+    return _busRequest(bus, MB_RtuPrepareWrite(&frame, bus->current_slave, addr, 1, 0), &frame, &value, NULL);
+}
+
+int MB_BusWriteRegisters(MB_Bus *MB_RESTRICT bus, int addr, int count, const uint16_t *MB_RESTRICT regs)
+{
+    if (likely(bus->ctx))
+        return modbus_write_registers(bus->ctx, addr, count, regs);
+    MB_RtuFrame frame;
+    return _busRequest(bus, MB_RtuPrepareWrite(&frame, bus->current_slave, addr, count, 1), &frame, regs, NULL);
+}
+
+int MB_BusProbe(MB_Bus *bus, int slave_id, int addr, int timeout_ms)
+{
+    // 1. Validate input parameters.
+    if (unlikely(!bus || addr < 0 || addr > 0xFFFF || timeout_ms <= 0 || timeout_ms > MB_MAX_TIMEOUT_MS))
+    {
+        MB_DEBUG_MSG("Invalid probe parameters")
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return MB_ERR;
+    }
+    if (!MB_BusBeginTransaction(bus, slave_id, MB_PRIORITY_SETPOINT, 0))
+        return MB_ERR;
+
+    // 2. Wait for the answer for the probe timeout instead of the one of the slave. The context is
+    // marked as holding no known timeout, so the next transaction applies the one of its slave again.
+    int timeout_us = timeout_ms * 1000;
+    bus->current_timeout_us = timeout_us;
+    if (bus->ctx && unlikely(_setResponseTimeout(bus->ctx, timeout_us) == MODBUS_ERR))
+    {
+        MB_MODBUS_DEBUG_MSG;
+        bus->current_timeout_us = -1;
+        MB_BusEndTransaction(bus, MB_TRANSACTION_SKIPPED);
+        _setBusGlobalError(ERROR_MB_FAILED_SET_TIMEOUT);
+        return MB_ERR;
+    }
+
+    // 3. Any answer proves the slave alive, an exception response (e.g., an unmapped register) too.
+    uint16_t value;
+    int answered = MB_BusReadRegisters(bus, addr, 1, &value) != MB_ERR || (errno >= EMBXILFUN && errno <= EMBXGTAR);
+    int saved_errno = errno;
+    if (bus->ctx)
+        bus->current_timeout_us = -1;
+
+    // 4. A missed probe says nothing about the normal timeout, so it does not feed the adaptive one.
+    int outcome = MB_TRANSACTION_OK;
+    if (!answered)
+        outcome = _mbIsLinkError(saved_errno) ? MB_TRANSACTION_LINK_LOST : MB_TRANSACTION_SKIPPED;
+    MB_BusEndTransaction(bus, outcome);
+    errno = saved_errno;
+    if (!answered)
+    {
+        _setBusGlobalError(outcome == MB_TRANSACTION_LINK_LOST ? ERROR_MB_LINK_DOWN : ERROR_MB_NO_RESPONSE);
+        return MB_ERR;
+    }
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+/// @brief Returns the time the line takes to carry `bytes` characters with the serial settings of the bus.
+static int64_t _frameTimeNs(const MB_Bus *MB_RESTRICT bus, int bytes)
+{
+    // Start bit, data bits, parity bit if any, stop bits.
+    int bits = 1 + bus->data_bits + (bus->parity == 'N' ? 0 : 1) + bus->stop_bits;
+    return bus->baudrate > 0 ? (int64_t)bytes * bits * 1000000000LL / bus->baudrate : 0;
+}
+
+int MB_BusBroadcastRegisters(MB_Bus *MB_RESTRICT bus, int addr, int count, const uint16_t *MB_RESTRICT regs)
+{
+    // 1. Validate input parameters.
+    if (unlikely(!bus || !regs || addr < 0 || addr > 0xFFFF || count < 1 || count > MB_BROADCAST_MAX_REGISTERS))
+    {
+        MB_DEBUG_MSG("Invalid broadcast parameters")
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return MB_ERR;
+    }
+
+    // 2. Build the request addressed to slave 0: "Write Single Register" (0x06) for one
+    // register, "Write Multiple Registers" (0x10) otherwise. libmodbus appends the CRC.
+    uint8_t frame[7 + 2 * MB_BROADCAST_MAX_REGISTERS];
+    int length = 0;
+    frame[length++] = 0;
+    frame[length++] = count == 1 ? 0x06 : 0x10;
+    frame[length++] = (uint8_t)(addr >> 8);
+    frame[length++] = (uint8_t)addr;
+    if (count > 1)
+    {
+        frame[length++] = (uint8_t)(count >> 8);
+        frame[length++] = (uint8_t)count;
+        frame[length++] = (uint8_t)(2 * count);
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        frame[length++] = (uint8_t)(regs[i] >> 8);
+        frame[length++] = (uint8_t)regs[i];
+    }
+
+    // 3. Send it without waiting for a response: slaves never answer a broadcast. Without a
+    // context (RTU over TCP) the bus frames it itself, CRC included.
+    int64_t sent_ns = _mbMonotonicNs();
+    MB_RtuFrame rtu_frame;
+    int sent = bus->ctx ? modbus_send_raw_request(bus->ctx, frame, length) != MODBUS_ERR
+                        : _busRequest(bus, MB_RtuPrepareWrite(&rtu_frame, 0, addr, count, count > 1), &rtu_frame, regs,
+                                      NULL) != MB_ERR;
+    if (unlikely(!sent))
+    {
+        MB_MODBUS_DEBUG_MSG;
+        _setBusGlobalError(ERROR_MB_FAILED_BROADCAST);
+        return MB_ERR;
+    }
+
+    // 4. Keep the line quiet until the frame is out (CRC included) and every slave had the
+    // turnaround delay to apply it; the next request would be ignored otherwise.
+    _mbSleepUntilNs(sent_ns + _frameTimeNs(bus, length + 2) + MB_BROADCAST_TURNAROUND_US * 1000LL);
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+/// @brief I/O worker loop: executes queued requests, most urgent class first, until the bus is closed.
+MB_THREAD_ROUTINE(_busWorker, arg)
+{
+    MB_Bus *bus = arg;
+    MB_BusRequest request;
+
+    _mbMutexLock(&bus->queue_lock);
+    for (;;)
+    {
+        while (bus->queue_count == 0 && !bus->worker_stopping)
+            _mbCondWait(&bus->queue_cond, &bus->queue_lock);
+        if (bus->queue_count == 0)
+            break;
+
+        // 1. Copy the oldest request of the most urgent class out so its slot can be reused.
+        MB_BusQueue *queue = bus->queues;
+        while (queue->count == 0)
+            ++queue;
+        request = queue->slots[queue->head];
+        queue->head = (queue->head + 1) % MB_BUS_QUEUE_CAPACITY;
+        --queue->count;
+        --bus->queue_count;
+        bus->running_request_id = request.id;
+        _mbMutexUnlock(&bus->queue_lock);
+
+        // 2. Run the job without holding the queue: it may submit follow-up requests.
+        int expired = request.deadline_ns && _mbMonotonicNs() > request.deadline_ns;
+        request.job(request.payload.bytes, request.id, expired ? ERROR_MB_DEADLINE_EXPIRED : MB_OK);
+
+        _mbMutexLock(&bus->queue_lock);
+        bus->running_request_id = 0;
+        _mbCondBroadcast(&bus->done_cond);
+    }
+    _mbMutexUnlock(&bus->queue_lock);
+    MB_THREAD_RETURN;
+}
+
+int MB_BusSubmit(MB_Bus *MB_RESTRICT bus, MB_BusJob job, const void *MB_RESTRICT payload, size_t size,
+                 int priority, int64_t deadline_ns, uint64_t *MB_RESTRICT request_id)
+{
+    // 1. Validate input parameters.
+    if (unlikely(!bus || !job || size > MB_BUS_REQUEST_PAYLOAD_SIZE || (size && !payload) || priority < 0 ||
+                 priority >= MB_PRIORITY_COUNT))
+    {
+        MB_DEBUG_MSG("Invalid request parameters")
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return MB_ERR;
+    }
+
+    _mbMutexLock(&bus->queue_lock);
+
+    // 2. Refuse the request instead of blocking the caller when the queue of its class is full.
+    MB_BusQueue *queue = &bus->queues[priority];
+    if (unlikely(queue->count == MB_BUS_QUEUE_CAPACITY))
+    {
+        _mbMutexUnlock(&bus->queue_lock);
+        _setBusGlobalError(ERROR_MB_QUEUE_FULL);
+        return MB_ERR;
+    }
+
+    // 3. Start the worker on first use, so buses used only synchronously never own a thread.
+    if (unlikely(!bus->worker_started))
+    {
+        if (_mbThreadCreate(&bus->worker, _busWorker, bus) != 0)
+        {
+            _mbMutexUnlock(&bus->queue_lock);
+            _setBusGlobalError(ERROR_MB_FAILED_START_WORKER);
+            return MB_ERR;
+        }
+        bus->worker_started = 1;
+    }
+
+    // 4. Enqueue a copy of the payload and wake the worker.
+    MB_BusRequest *slot = &queue->slots[(queue->head + queue->count) % MB_BUS_QUEUE_CAPACITY];
+    slot->job = job;
+    slot->id = ++bus->last_request_id;
+    slot->deadline_ns = deadline_ns;
+    if (size)
+        memcpy(slot->payload.bytes, payload, size);
+    ++queue->count;
+    ++bus->queue_count;
+    if (request_id)
+        *request_id = slot->id;
+    _mbCondBroadcast(&bus->queue_cond);
+    _mbMutexUnlock(&bus->queue_lock);
+
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+/// @brief Tells whether a request with an ID up to `request_id` is still queued or running.
+static int _hasPendingUpTo(const MB_Bus *bus, uint64_t request_id)
+{
+    if (bus->running_request_id && bus->running_request_id <= request_id)
+        return 1;
+    // IDs grow within a class, so the oldest request of each class is the only candidate.
+    for (int priority = 0; priority < MB_PRIORITY_COUNT; ++priority)
+    {
+        const MB_BusQueue *queue = &bus->queues[priority];
+        if (queue->count && queue->slots[queue->head].id <= request_id)
+            return 1;
+    }
+    return 0;
+}
+
+int MB_BusWait(MB_Bus *bus, uint64_t request_id)
+{
+    if (unlikely(!bus))
+    {
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return MB_ERR;
+    }
+
+    _mbMutexLock(&bus->queue_lock);
+    if (request_id > bus->last_request_id)
+    {
+        _mbMutexUnlock(&bus->queue_lock);
+        MB_DEBUG_MSG("Unknown request ID")
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return MB_ERR;
+    }
+    while (_hasPendingUpTo(bus, request_id))
+        _mbCondWait(&bus->done_cond, &bus->queue_lock);
+    _mbMutexUnlock(&bus->queue_lock);
+
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+int MB_BusFlush(MB_Bus *bus)
+{
+    if (unlikely(!bus))
+    {
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return MB_ERR;
+    }
+
+    _mbMutexLock(&bus->queue_lock);
+    uint64_t last_request_id = bus->last_request_id;
+    _mbMutexUnlock(&bus->queue_lock);
+    return MB_BusWait(bus, last_request_id);
+}
+
+uint64_t MB_LatencyBucketLowerUs(int bucket)
+{
+    if (bucket < 0 || bucket > MB_LATENCY_BUCKETS)
+        return 0;
+    if (bucket < MB_LATENCY_LINEAR_US)
+        return (uint64_t)bucket;
+
+    // Inverse of the bucket selection: `MB_LATENCY_SUB_BUCKETS` steps per power of two.
+    int index = bucket - MB_LATENCY_LINEAR_US;
+    int log2 = MB_LATENCY_SUB_BUCKET_BITS + 1 + index / MB_LATENCY_SUB_BUCKETS;
+    return (uint64_t)(MB_LATENCY_SUB_BUCKETS + index % MB_LATENCY_SUB_BUCKETS) << (log2 - MB_LATENCY_SUB_BUCKET_BITS);
+}
+
+uint64_t MB_LatencyPercentileUs(const MB_LatencyHistogram *histogram, double quantile)
+{
+    if (!histogram || histogram->count == 0)
+        return 0;
+    if (quantile < 0.0)
+        quantile = 0.0;
+    if (quantile > 1.0)
+        quantile = 1.0;
+
+    // Walk the buckets until the cumulative count reaches the rank of the quantile.
+    uint64_t rank = (uint64_t)(quantile * (double)histogram->count + 0.5), seen = 0;
+    if (rank == 0)
+        rank = 1;
+    for (int i = 0; i < MB_LATENCY_BUCKETS; ++i)
+    {
+        seen += histogram->buckets[i];
+        if (seen >= rank)
+            return MB_LatencyBucketLowerUs(i + 1);
+    }
+    return MB_LatencyBucketLowerUs(MB_LATENCY_BUCKETS);
+}
+
+const char *MB_GetLastError()
+{
+    switch (MB_GlobalError)
+    {
+    case MB_OK:
+        return "No error.";
+    case ERROR_MB_FAILED_CONNECT:
+        return "Error: Connection to the serial port or gateway failed.";
+    case ERROR_MB_FAILED_CREATE_CONTEXT:
+        return "Error: Failed to create a MODBUS context.";
+    case ERROR_MB_FAILED_SET_SLAVE:
+        return "Error: Failed to set MODBUS slave ID.";
+    case ERROR_MB_FAILED_SET_TIMEOUT:
+        return "Error: Failed to set MODBUS response timeout.";
+    case ERROR_MB_INVALID_PARAMETER:
+        return "Error: Invalid parameter provided to function.";
+    case ERROR_MB_CONFIG_MISMATCH:
+        return "Error: Port is already open with different settings or from another arena.";
+    case ERROR_MB_OUT_OF_MEMORY:
+        return "Error: Failed to allocate memory for the bus.";
+    case ERROR_MB_QUEUE_FULL:
+        return "Error: The request queue of the bus is full.";
+    case ERROR_MB_FAILED_START_WORKER:
+        return "Error: Failed to start the I/O worker thread of the bus.";
+    case ERROR_MB_FAILED_READ:
+        return "Error: A polled register read failed.";
+    case ERROR_MB_POLLER_RUNNING:
+        return "Error: The poller is running.";
+    case ERROR_MB_POLLER_FULL:
+        return "Error: The poller cannot take more jobs or buses.";
+    case ERROR_MB_FAILED_START_POLLER:
+        return "Error: Failed to start the poller.";
+    case ERROR_MB_FAILED_SET_AFFINITY:
+        return "Error: Failed to pin a poller thread to its CPU core.";
+    case ERROR_MB_DEADLINE_EXPIRED:
+        return "Error: The deadline of the request passed before it could be sent.";
+    case ERROR_MB_FAILED_OPEN_LOG:
+        return "Error: Failed to create a segment file of the binary log.";
+    case ERROR_MB_FAILED_WRITE_LOG:
+        return "Error: Failed to write records to the binary log.";
+    case ERROR_MB_FAILED_BROADCAST:
+        return "Error: Failed to send a broadcast request on the line.";
+    case ERROR_MB_LINK_DOWN:
+        return "Error: The port or gateway connection was lost; the bus is reconnecting.";
+    case ERROR_MB_NOT_SUPPORTED:
+        return "Error: The operation is not supported by the port or transport of the bus.";
+    case ERROR_MB_NO_RESPONSE:
+        return "Error: The slave did not answer the probe request.";
+    case ERROR_MB_FAILED_READ_LOG:
+        return "Error: Failed to read records from the binary log.";
+    default:
+        return "Unknown error occurred.";
+    }
+}
+
+int MB_GetLastErrorCode() { return MB_GlobalError; }
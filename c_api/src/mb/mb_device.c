@@ -0,0 +1,46 @@
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "mb_device.h"
+
+int MB_DeviceOpen(const MB_DeviceConfig *MB_RESTRICT config, MB_Bus **MB_RESTRICT bus)
+{
+    // 1. Validate input parameters.
+    if (unlikely(!config || !bus || config->slave_id < 0 || config->slave_id > MB_MAX_SLAVE_ID ||
+                 config->probe_timeout < 0))
+    {
+        MB_DEBUG_MSG("Invalid device configuration")
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return MB_ERR;
+    }
+
+    // 2. Open the bus of the port, or share the one another handle (of any device type) opened.
+    MB_Bus *opened = NULL;
+    if (MB_BusOpen(&config->bus, &opened) != MB_OK)
+        return MB_ERR;
+
+    // 3. Configure the response timeout of this slave only: other slaves on the bus keep theirs.
+    if (unlikely(MB_BusSetSlaveTimeout(opened, config->slave_id, config->bus.timeout) != MB_OK ||
+                 MB_BusSetAdaptiveTimeout(opened, config->slave_id, config->adaptive_timeout) != MB_OK))
+    {
+        MB_BusClose(opened);
+        _setBusGlobalError(ERROR_MB_FAILED_SET_TIMEOUT);
+        return MB_ERR;
+    }
+
+    // 4. Check that the slave answers, waiting no longer than the probe timeout.
+    if (config->probe_timeout > 0 &&
+        MB_BusProbe(opened, config->slave_id, config->probe_address, config->probe_timeout) != MB_OK)
+    {
+        int error_code = MB_GetLastErrorCode();
+        int saved_errno = errno;
+        MB_BusClose(opened);
+        _setBusGlobalError(error_code);
+        errno = saved_errno;
+        return MB_ERR;
+    }
+    *bus = opened;
+    _resetBusGlobalError();
+    return MB_OK;
+}
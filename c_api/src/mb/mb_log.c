@@ -0,0 +1,382 @@
+#define _POSIX_C_SOURCE 200809L // posix_fallocate(), fileno(), fseeko()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "mb_bus.h"
+#include "mb_log.h"
+#include "mb_platform.h"
+
+_Static_assert(sizeof(MB_LogRecord) == 24, "MB_LogRecord is part of the file format");
+_Static_assert(sizeof(MB_LogSegmentHeader) == 64, "MB_LogSegmentHeader is part of the file format");
+
+#ifdef _WIN32
+#define MB_LOG_PATH_SEPARATOR "\\"
+#define _mbFileSeek _fseeki64
+#else
+#define MB_LOG_PATH_SEPARATOR "/"
+#define _mbFileSeek fseeko
+#endif
+
+// Records `MB_LogRead()` takes from a segment file at a time.
+#define MB_LOG_READ_CHUNK_RECORDS 1024
+
+struct MB_Log
+{
+    MB_Mutex lock;                    ///< Serializes the appends of all threads.
+    FILE *file;                       ///< Current segment (`NULL` if the last rotation failed).
+    MB_LogSegmentHeader header;       ///< Header of the current segment, rewritten after every batch.
+    char directory[MB_LOG_MAX_PATH];  ///< Directory of the segments.
+    char prefix[MB_LOG_MAX_PATH];     ///< File name prefix of the segments.
+    uint64_t capacity;                ///< Records per segment.
+    int max_segments;                 ///< Segments kept on disk (0: all).
+    uint64_t next_sequence;           ///< Number of the next segment to create.
+    uint64_t oldest_sequence;         ///< Oldest segment that may still be on disk.
+    uint64_t total_count;             ///< Records appended since the log was opened.
+};
+
+/// @brief Builds the path of segment `sequence`. Returns 0 on success, -1 if it does not fit.
+static int _segmentPath(const MB_Log *MB_RESTRICT log, uint64_t sequence, char *MB_RESTRICT path)
+{
+    int length = snprintf(path, MB_LOG_MAX_PATH, "%s" MB_LOG_PATH_SEPARATOR "%s-%06llu.mblog", log->directory,
+                          log->prefix, (unsigned long long)sequence);
+    return length > 0 && length < MB_LOG_MAX_PATH ? 0 : -1;
+}
+
+/// @brief Parses the sequence number out of a segment file name of the log. Returns 0 on a match.
+static int _parseSegmentName(const MB_Log *MB_RESTRICT log, const char *MB_RESTRICT name,
+                             uint64_t *MB_RESTRICT sequence)
+{
+    size_t prefix_length = strlen(log->prefix);
+    if (strncmp(name, log->prefix, prefix_length) != 0 || name[prefix_length] != '-')
+        return -1;
+    const char *digits = name + prefix_length + 1;
+    char *end;
+    unsigned long long value = strtoull(digits, &end, 10);
+    if (end == digits || strcmp(end, ".mblog") != 0)
+        return -1;
+    *sequence = value;
+    return 0;
+}
+
+/// @brief Finds the segments of earlier runs, so numbering continues after them and rotation prunes them.
+static void _scanSegments(MB_Log *log)
+{
+    uint64_t sequence, first = UINT64_MAX, last = 0;
+    int found = 0;
+#ifdef _WIN32
+    char pattern[MB_LOG_MAX_PATH];
+    WIN32_FIND_DATAA entry;
+    snprintf(pattern, sizeof(pattern), "%s\\%s-*.mblog", log->directory, log->prefix);
+    HANDLE search = FindFirstFileA(pattern, &entry);
+    if (search != INVALID_HANDLE_VALUE)
+    {
+        do
+            if (_parseSegmentName(log, entry.cFileName, &sequence) == 0)
+            {
+                first = sequence < first ? sequence : first;
+                last = sequence > last ? sequence : last;
+                found = 1;
+            }
+        while (FindNextFileA(search, &entry));
+        FindClose(search);
+    }
+#else
+    DIR *directory = opendir(log->directory);
+    if (directory)
+    {
+        for (struct dirent *entry = readdir(directory); entry; entry = readdir(directory))
+            if (_parseSegmentName(log, entry->d_name, &sequence) == 0)
+            {
+                first = sequence < first ? sequence : first;
+                last = sequence > last ? sequence : last;
+                found = 1;
+            }
+        closedir(directory);
+    }
+#endif
+    log->next_sequence = found ? last + 1 : 0;
+    log->oldest_sequence = found ? first : 0;
+}
+
+/// @brief Grows the file to `size` bytes, reserving the blocks where the file system supports it.
+static int _reserveFile(FILE *file, int64_t size)
+{
+#ifdef _WIN32
+    return _chsize_s(_fileno(file), size) == 0 ? 0 : -1;
+#else
+    // posix_fallocate() allocates the blocks up front, so appends never extend the file or hit
+    // a full disk halfway through a segment; file systems without it get a sparse file instead.
+    if (posix_fallocate(fileno(file), 0, (off_t)size) == 0)
+        return 0;
+    return ftruncate(fileno(file), (off_t)size) == 0 ? 0 : -1;
+#endif
+}
+
+/// @brief Rewrites the header of the current segment and hands the written records to the OS.
+static int _syncHeader(MB_Log *log)
+{
+    int64_t end = (int64_t)sizeof(MB_LogSegmentHeader) + (int64_t)(log->header.count * sizeof(MB_LogRecord));
+    if (_mbFileSeek(log->file, 0, SEEK_SET) != 0 || fwrite(&log->header, sizeof(log->header), 1, log->file) != 1 ||
+        _mbFileSeek(log->file, end, SEEK_SET) != 0 || fflush(log->file) != 0)
+        return -1;
+    return 0;
+}
+
+/// @brief Closes the current segment, if any.
+static void _closeSegment(MB_Log *log)
+{
+    if (log->file)
+    {
+        fclose(log->file);
+        log->file = NULL;
+    }
+}
+
+/// @brief Deletes the oldest segments so that at most `max_segments` remain once the next one exists.
+static void _pruneSegments(MB_Log *log)
+{
+    char path[MB_LOG_MAX_PATH];
+    if (log->max_segments <= 0)
+        return;
+    while (log->oldest_sequence + (uint64_t)log->max_segments <= log->next_sequence)
+    {
+        if (_segmentPath(log, log->oldest_sequence, path) == 0)
+            remove(path);
+        ++log->oldest_sequence;
+    }
+}
+
+/// @brief Creates and preallocates the next segment. Returns `MB_OK` or `ERROR_MB_FAILED_OPEN_LOG`.
+static int _openSegment(MB_Log *log)
+{
+    // 1. Make room for the new segment.
+    char path[MB_LOG_MAX_PATH];
+    _closeSegment(log);
+    _pruneSegments(log);
+    if (_segmentPath(log, log->next_sequence, path) != 0)
+        return ERROR_MB_FAILED_OPEN_LOG;
+
+    // 2. Create the file at its full size.
+    FILE *file = fopen(path, "wb+");
+    if (!file)
+        return ERROR_MB_FAILED_OPEN_LOG;
+    if (_reserveFile(file, (int64_t)sizeof(MB_LogSegmentHeader) + (int64_t)(log->capacity * sizeof(MB_LogRecord))) != 0)
+    {
+        fclose(file);
+        remove(path);
+        return ERROR_MB_FAILED_OPEN_LOG;
+    }
+
+    // 3. Write the empty header.
+    memset(&log->header, 0, sizeof(log->header));
+    memcpy(log->header.magic, MB_LOG_MAGIC, sizeof(log->header.magic));
+    log->header.version = MB_LOG_VERSION;
+    log->header.record_size = sizeof(MB_LogRecord);
+    log->header.capacity = log->capacity;
+    log->header.sequence = log->next_sequence;
+    log->header.mono_origin_ns = _mbMonotonicNs();
+    log->header.wall_origin_ns = _mbRealtimeNs();
+    log->file = file;
+    if (_syncHeader(log) != 0)
+    {
+        _closeSegment(log);
+        remove(path);
+        return ERROR_MB_FAILED_OPEN_LOG;
+    }
+    ++log->next_sequence;
+    return MB_OK;
+}
+
+int MB_LogOpen(const MB_LogConfig *MB_RESTRICT config, MB_Log **MB_RESTRICT log)
+{
+    // 1. Validate input parameters.
+    if (!config || !log || !config->directory || !config->prefix || !config->prefix[0] ||
+        config->segment_records < 0 || config->max_segments < 0 || strlen(config->directory) >= MB_LOG_MAX_PATH ||
+        strlen(config->prefix) >= MB_LOG_MAX_PATH)
+    {
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return ERROR_MB_INVALID_PARAMETER;
+    }
+
+    // 2. Set up the writer and continue the numbering of the segments already on disk.
+    MB_Log *opened = calloc(1, sizeof(MB_Log));
+    if (!opened)
+    {
+        _setBusGlobalError(ERROR_MB_OUT_OF_MEMORY);
+        return ERROR_MB_OUT_OF_MEMORY;
+    }
+    strcpy(opened->directory, config->directory);
+    strcpy(opened->prefix, config->prefix);
+    opened->capacity = config->segment_records ? (uint64_t)config->segment_records : MB_LOG_DEFAULT_SEGMENT_RECORDS;
+    opened->max_segments = config->max_segments;
+    _scanSegments(opened);
+
+    // 3. Create the first segment.
+    int error_code = _openSegment(opened);
+    if (error_code != MB_OK)
+    {
+        free(opened);
+        _setBusGlobalError(error_code);
+        return error_code;
+    }
+    _mbMutexInit(&opened->lock);
+    *log = opened;
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+int MB_LogAppend(MB_Log *MB_RESTRICT log, const MB_LogRecord *MB_RESTRICT records, int count)
+{
+    // 1. Validate input parameters.
+    if (!log || (!records && count > 0) || count < 0)
+    {
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return ERROR_MB_INVALID_PARAMETER;
+    }
+
+    // 2. Write the batch, starting a new segment whenever the current one is full.
+    int error_code = MB_OK;
+    _mbMutexLock(&log->lock);
+    size_t written = 0;
+    while (written < (size_t)count && error_code == MB_OK)
+    {
+        if (!log->file || log->header.count == log->capacity)
+        {
+            error_code = _openSegment(log);
+            continue;
+        }
+        size_t room = (size_t)(log->capacity - log->header.count), chunk = (size_t)count - written;
+        chunk = chunk < room ? chunk : room;
+        if (fwrite(records + written, sizeof(MB_LogRecord), chunk, log->file) != chunk)
+            error_code = ERROR_MB_FAILED_WRITE_LOG;
+        else
+        {
+            log->header.count += chunk;
+            log->total_count += chunk;
+            written += chunk;
+            // A full segment is finalized right away, so readers see its last records.
+            if (log->header.count == log->capacity && _syncHeader(log) != 0)
+                error_code = ERROR_MB_FAILED_WRITE_LOG;
+        }
+    }
+
+    // 3. Publish the new record count of the current segment.
+    if (error_code == MB_OK && log->file && _syncHeader(log) != 0)
+        error_code = ERROR_MB_FAILED_WRITE_LOG;
+    if (error_code == ERROR_MB_FAILED_WRITE_LOG)
+        _closeSegment(log); // The position in the file is unknown: continue in a fresh segment.
+    _mbMutexUnlock(&log->lock);
+
+    if (error_code != MB_OK)
+    {
+        _setBusGlobalError(error_code);
+        return error_code;
+    }
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+uint64_t MB_LogGetRecordCount(MB_Log *log)
+{
+    if (!log)
+        return 0;
+    _mbMutexLock(&log->lock);
+    uint64_t count = log->total_count;
+    _mbMutexUnlock(&log->lock);
+    return count;
+}
+
+/// @brief Reads the records of `channel` (-1: all) of one segment into `records` past `*count`.
+/// Returns `MB_OK`, or `ERROR_MB_FAILED_READ_LOG` if the file breaks off; no valid segment counts nothing.
+static int _readSegment(const char *MB_RESTRICT path, int channel, MB_LogRecord *MB_RESTRICT records,
+                        size_t capacity, size_t *MB_RESTRICT count)
+{
+    // 1. Take the segment if it is one of this format.
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return MB_OK; // Pruned by a writer since the scan.
+    MB_LogSegmentHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, MB_LOG_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != MB_LOG_VERSION || header.record_size != sizeof(MB_LogRecord))
+    {
+        fclose(file);
+        return MB_OK;
+    }
+
+    // 2. Copy the records of the channel; a segment being written is read up to its current count.
+    uint64_t left = header.count < header.capacity ? header.count : header.capacity;
+    MB_LogRecord chunk[MB_LOG_READ_CHUNK_RECORDS];
+    int error_code = MB_OK;
+    while (left > 0)
+    {
+        size_t wanted = left < MB_LOG_READ_CHUNK_RECORDS ? (size_t)left : MB_LOG_READ_CHUNK_RECORDS;
+        if (fread(chunk, sizeof(MB_LogRecord), wanted, file) != wanted)
+        {
+            error_code = ERROR_MB_FAILED_READ_LOG;
+            break;
+        }
+        for (size_t i = 0; i < wanted; ++i)
+            if (channel < 0 || chunk[i].channel == channel)
+            {
+                if (*count < capacity)
+                    records[*count] = chunk[i];
+                ++*count;
+            }
+        left -= wanted;
+    }
+    fclose(file);
+    return error_code;
+}
+
+int MB_LogRead(const MB_LogConfig *MB_RESTRICT config, int channel, MB_LogRecord *MB_RESTRICT records,
+               size_t capacity, size_t *MB_RESTRICT count)
+{
+    // 1. Validate input parameters.
+    if (!config || !count || !config->directory || !config->prefix || !config->prefix[0] || channel < -1 ||
+        channel > 0xFF || (!records && capacity > 0) || strlen(config->directory) >= MB_LOG_MAX_PATH ||
+        strlen(config->prefix) >= MB_LOG_MAX_PATH)
+    {
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return ERROR_MB_INVALID_PARAMETER;
+    }
+
+    // 2. Find the segments the way a writer continuing the log would.
+    MB_Log log = {0};
+    strcpy(log.directory, config->directory);
+    strcpy(log.prefix, config->prefix);
+    _scanSegments(&log);
+
+    // 3. Read them in order; numbers missing in between were pruned.
+    char path[MB_LOG_MAX_PATH];
+    int error_code = log.next_sequence > 0 ? MB_OK : ERROR_MB_FAILED_READ_LOG;
+    *count = 0;
+    for (uint64_t sequence = log.oldest_sequence; sequence < log.next_sequence && error_code == MB_OK; ++sequence)
+        if (_segmentPath(&log, sequence, path) == 0)
+            error_code = _readSegment(path, channel, records, capacity, count);
+    if (error_code != MB_OK)
+    {
+        _setBusGlobalError(error_code);
+        return error_code;
+    }
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+void MB_LogClose(MB_Log *log)
+{
+    if (!log)
+        return;
+    _closeSegment(log);
+    _mbMutexDestroy(&log->lock);
+    free(log);
+}
@@ -0,0 +1,358 @@
+#define _GNU_SOURCE // pthread_setaffinity_np()
+
+#ifdef _WIN32
+#include "modbus.h"
+#else
+#include <modbus/modbus.h>
+#endif
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mb_poller.h"
+#include "mb_platform.h"
+#include "mb_ring.h"
+
+/**
+ * @struct MB_PollerJob
+ * @brief Job of a poller with its schedule.
+ */
+typedef struct
+{
+    MB_PollJob job;  ///< Copy of the job passed to `MB_PollerAddJob()`.
+    int worker;      ///< Index of the worker of the job's bus.
+    int64_t next_ns; ///< Next deadline, touched by the worker only.
+} MB_PollerJob;
+
+/**
+ * @struct MB_PollWorker
+ * @brief I/O thread of one bus with its sample ring.
+ */
+typedef struct
+{
+    MB_Poller *poller;    ///< Poller the worker belongs to.
+    MB_Bus *bus;          ///< Bus polled by the worker (the poller holds a reference to it).
+    int cpu;              ///< Core to pin the thread to, or -1.
+    MB_Thread thread;     ///< I/O thread.
+    MB_Ring ring;         ///< SPSC ring of `MB_PollSample`: the thread produces, `MB_PollerDrain()` consumes.
+    int64_t watermark_ns; ///< No sample stamped before this time is still to come (accessed atomically).
+} MB_PollWorker;
+
+struct MB_Poller
+{
+    MB_PollerJob jobs[MB_POLLER_MAX_JOBS];      ///< Jobs, indexed by job ID.
+    int job_count;                              ///< Number of jobs.
+    MB_PollWorker workers[MB_POLLER_MAX_BUSES]; ///< One worker per distinct bus.
+    int worker_count;                           ///< Number of workers.
+    size_t capacity;                            ///< Samples per ring.
+    int started;                                ///< Non-zero once the rings are allocated.
+    int running;                                ///< Non-zero while the threads must keep polling (accessed atomically).
+};
+
+/// @brief Returns the index of the worker polling `bus`, or -1.
+static inline int _findWorker(const MB_Poller *MB_RESTRICT poller, const MB_Bus *MB_RESTRICT bus)
+{
+    for (int i = 0; i < poller->worker_count; ++i)
+        if (poller->workers[i].bus == bus)
+            return i;
+    return -1;
+}
+
+/// @brief Returns the job of the worker with the earliest deadline.
+static inline MB_PollerJob *_nextJob(MB_Poller *MB_RESTRICT poller, int worker)
+{
+    MB_PollerJob *next = NULL;
+    for (int i = 0; i < poller->job_count; ++i)
+    {
+        MB_PollerJob *job = &poller->jobs[i];
+        if (job->worker == worker && (!next || job->next_ns < next->next_ns))
+            next = job;
+    }
+    return next;
+}
+
+/// @brief Polling loop of the I/O thread of one bus.
+MB_THREAD_ROUTINE(_pollWorkerThread, arg)
+{
+    MB_PollWorker *worker = arg;
+    MB_Poller *poller = worker->poller;
+    const int index = (int)(worker - poller->workers);
+    const int64_t stop_poll_ns = MB_POLLER_STOP_POLL_US * 1000LL;
+
+    while (_mbAtomicLoadInt(&poller->running))
+    {
+        // 1. Wait for the earliest deadline. No sample of this worker will be stamped before
+        // it, which lets the consumer hand out older samples of the other buses meanwhile.
+        MB_PollerJob *job = _nextJob(poller, index);
+        int64_t now = _mbMonotonicNs();
+        _mbAtomicStoreReleaseI64(&worker->watermark_ns, job->next_ns > now ? job->next_ns : now);
+        while (now < job->next_ns && _mbAtomicLoadInt(&poller->running))
+        {
+            _mbSleepUntilNs(job->next_ns - now > stop_poll_ns ? now + stop_poll_ns : job->next_ns);
+            now = _mbMonotonicNs();
+        }
+        if (!_mbAtomicLoadInt(&poller->running))
+            break;
+
+        // 2. Read the register set in a bus transaction and publish the sample; a full ring
+        // drops it instead of blocking the bus. The read yields the line to waiting writes,
+        // and is dropped (`ERROR_MB_DEADLINE_EXPIRED`) if that delays it by a whole period.
+        MB_PollSample sample;
+        memset(&sample, 0, sizeof(sample));
+        sample.t_ns = _mbMonotonicNs();
+        sample.job_id = (int32_t)(job - poller->jobs);
+        if (likely(MB_BusBeginTransaction(worker->bus, job->job.slave_id, MB_PRIORITY_TELEMETRY,
+                                          sample.t_ns + job->job.period_us * 1000LL)))
+        {
+            int count = job->job.register_count;
+            int result =
+                job->job.input_registers
+                    ? MB_BusReadInputRegisters(worker->bus, job->job.first_register, count, sample.registers)
+                    : MB_BusReadRegisters(worker->bus, job->job.first_register, count, sample.registers);
+            if (unlikely(result != count))
+            {
+                sample.status = ERROR_MB_FAILED_READ;
+                sample.modbus_errno = errno;
+            }
+            MB_BusEndTransaction(worker->bus, sample.status == MB_OK                 ? MB_TRANSACTION_OK
+                                              : sample.modbus_errno == ETIMEDOUT       ? MB_TRANSACTION_TIMEOUT
+                                              : _mbIsLinkError(sample.modbus_errno) ? MB_TRANSACTION_LINK_LOST
+                                                                                       : MB_TRANSACTION_FAILED);
+        }
+        else
+            sample.status = MB_GetLastErrorCode();
+        _mbRingPush(&worker->ring, &sample);
+
+        // 3. Schedule the next read on absolute deadlines; after an overrun restart from now.
+        job->next_ns += job->job.period_us * 1000LL;
+        now = _mbMonotonicNs();
+        if (job->next_ns < now)
+            job->next_ns = now;
+    }
+
+    // The worker is done: it no longer holds the merged stream back.
+    _mbAtomicStoreReleaseI64(&worker->watermark_ns, INT64_MAX);
+    MB_THREAD_RETURN;
+}
+
+int MB_PollerCreate(int capacity, MB_Poller **MB_RESTRICT poller)
+{
+    // 1. Validate input parameters.
+    if (!poller || capacity < 0)
+    {
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return ERROR_MB_INVALID_PARAMETER;
+    }
+
+    // 2. Allocate an empty poller.
+    MB_Poller *created = calloc(1, sizeof(MB_Poller));
+    if (!created)
+    {
+        _setBusGlobalError(ERROR_MB_OUT_OF_MEMORY);
+        return ERROR_MB_OUT_OF_MEMORY;
+    }
+    created->capacity = capacity ? (size_t)capacity : MB_POLLER_DEFAULT_CAPACITY;
+    *poller = created;
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+int MB_PollerAddJob(MB_Poller *MB_RESTRICT poller, const MB_PollJob *MB_RESTRICT job, int *MB_RESTRICT job_id)
+{
+    // 1. Validate input parameters.
+    int error_code = MB_OK;
+    if (!poller || !job || !job->bus || job->slave_id < 1 || job->slave_id > MB_MAX_SLAVE_ID ||
+        job->register_count < 1 || job->register_count > MB_POLL_MAX_REGISTERS || job->first_register < 0 ||
+        job->first_register + job->register_count > 0x10000 || job->period_us <= 0)
+        error_code = ERROR_MB_INVALID_PARAMETER;
+    else if (_mbAtomicLoadInt(&poller->running))
+        error_code = ERROR_MB_POLLER_RUNNING;
+    else if (poller->job_count == MB_POLLER_MAX_JOBS ||
+             (_findWorker(poller, job->bus) < 0 && poller->worker_count == MB_POLLER_MAX_BUSES))
+        error_code = ERROR_MB_POLLER_FULL;
+    if (error_code != MB_OK)
+    {
+        _setBusGlobalError(error_code);
+        return error_code;
+    }
+
+    // 2. A new bus gets its own worker, which keeps the bus open.
+    int worker = _findWorker(poller, job->bus);
+    if (worker < 0)
+    {
+        worker = poller->worker_count++;
+        memset(&poller->workers[worker], 0, sizeof(MB_PollWorker));
+        poller->workers[worker].poller = poller;
+        poller->workers[worker].bus = job->bus;
+        poller->workers[worker].cpu = -1;
+        MB_BusRetain(job->bus);
+    }
+
+    // 3. Append the job.
+    MB_PollerJob *added = &poller->jobs[poller->job_count];
+    added->job = *job;
+    added->worker = worker;
+    if (job_id)
+        *job_id = poller->job_count;
+    ++poller->job_count;
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+int MB_PollerSetCpu(MB_Poller *MB_RESTRICT poller, MB_Bus *MB_RESTRICT bus, int cpu)
+{
+    // 1. Validate input parameters.
+    int worker = poller && bus ? _findWorker(poller, bus) : -1;
+    int error_code = MB_OK;
+    if (worker < 0 || cpu < -1)
+        error_code = ERROR_MB_INVALID_PARAMETER;
+    else if (_mbAtomicLoadInt(&poller->running))
+        error_code = ERROR_MB_POLLER_RUNNING;
+    if (error_code != MB_OK)
+    {
+        _setBusGlobalError(error_code);
+        return error_code;
+    }
+
+    // 2. Remember the core; it is applied when the thread starts.
+    poller->workers[worker].cpu = cpu;
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+/// @brief Stops the threads of the first `count` workers.
+static void _stopWorkers(MB_Poller *poller, int count)
+{
+    _mbAtomicStoreInt(&poller->running, 0);
+    for (int i = 0; i < count; ++i)
+        _mbThreadJoin(poller->workers[i].thread);
+}
+
+int MB_PollerStart(MB_Poller *poller)
+{
+    // 1. Validate input parameters.
+    int error_code = MB_OK;
+    if (!poller || poller->job_count == 0)
+        error_code = ERROR_MB_INVALID_PARAMETER;
+    else if (_mbAtomicLoadInt(&poller->running))
+        error_code = ERROR_MB_POLLER_RUNNING;
+    if (error_code != MB_OK)
+    {
+        _setBusGlobalError(error_code);
+        return error_code;
+    }
+
+    // 2. Start from empty rings: samples left from a previous run are discarded.
+    for (int i = 0; i < poller->worker_count && poller->started; ++i)
+        _mbRingDestroy(&poller->workers[i].ring);
+    poller->started = 0;
+    for (int i = 0; i < poller->worker_count; ++i)
+        if (_mbRingInit(&poller->workers[i].ring, sizeof(MB_PollSample), poller->capacity, NULL) != 0)
+        {
+            while (i-- > 0)
+                _mbRingDestroy(&poller->workers[i].ring);
+            _setBusGlobalError(ERROR_MB_FAILED_START_POLLER);
+            return ERROR_MB_FAILED_START_POLLER;
+        }
+    poller->started = 1;
+
+    // 3. Every job is due right away; no worker may be overtaken before it took its first sample.
+    int64_t now = _mbMonotonicNs();
+    for (int i = 0; i < poller->job_count; ++i)
+        poller->jobs[i].next_ns = now;
+    for (int i = 0; i < poller->worker_count; ++i)
+        poller->workers[i].watermark_ns = now;
+
+    // 4. Spawn one thread per bus and pin it if requested.
+    _mbAtomicStoreInt(&poller->running, 1);
+    for (int i = 0; i < poller->worker_count; ++i)
+    {
+        MB_PollWorker *worker = &poller->workers[i];
+        if (unlikely(_mbThreadCreate(&worker->thread, _pollWorkerThread, worker) != 0))
+            error_code = ERROR_MB_FAILED_START_POLLER;
+        else if (worker->cpu >= 0 && _mbThreadSetAffinity(worker->thread, worker->cpu) != 0)
+            error_code = ERROR_MB_FAILED_SET_AFFINITY;
+        if (unlikely(error_code != MB_OK))
+        {
+            _stopWorkers(poller, error_code == ERROR_MB_FAILED_SET_AFFINITY ? i + 1 : i);
+            _setBusGlobalError(error_code);
+            return error_code;
+        }
+    }
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+void MB_PollerStop(MB_Poller *poller)
+{
+    if (poller && _mbAtomicLoadInt(&poller->running))
+        _stopWorkers(poller, poller->worker_count);
+}
+
+int MB_PollerDrain(MB_Poller *MB_RESTRICT poller, MB_PollSample *MB_RESTRICT samples, int max)
+{
+    // 1. Validate input parameters.
+    if (unlikely(!poller || !samples || max < 0))
+    {
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return MB_ERR;
+    }
+    if (!poller->started)
+        return 0;
+
+    // 2. Samples stamped up to the lowest watermark can no longer be overtaken by an older one.
+    int64_t watermark = INT64_MAX;
+    for (int i = 0; i < poller->worker_count; ++i)
+    {
+        int64_t worker_watermark = _mbAtomicLoadAcquireI64(&poller->workers[i].watermark_ns);
+        if (worker_watermark < watermark)
+            watermark = worker_watermark;
+    }
+
+    // 3. Merge the per-bus rings (each one is already in order), oldest sample first.
+    int count = 0;
+    while (count < max)
+    {
+        const MB_PollSample *oldest = NULL;
+        MB_Ring *source = NULL;
+        for (int i = 0; i < poller->worker_count; ++i)
+        {
+            const MB_PollSample *head = _mbRingPeek(&poller->workers[i].ring);
+            if (head && head->t_ns <= watermark && (!oldest || head->t_ns < oldest->t_ns))
+            {
+                oldest = head;
+                source = &poller->workers[i].ring;
+            }
+        }
+        if (!oldest)
+            break;
+        samples[count++] = *oldest;
+        _mbRingSkip(source);
+    }
+    return count;
+}
+
+uint64_t MB_PollerGetDroppedSamples(MB_Poller *poller)
+{
+    uint64_t dropped = 0;
+    if (poller && poller->started)
+        for (int i = 0; i < poller->worker_count; ++i)
+            dropped += _mbAtomicLoadU64(&poller->workers[i].ring.dropped);
+    return dropped;
+}
+
+void MB_PollerDestroy(MB_Poller *poller)
+{
+    if (!poller)
+        return;
+
+    MB_PollerStop(poller);
+    for (int i = 0; i < poller->worker_count; ++i)
+    {
+        if (poller->started)
+            _mbRingDestroy(&poller->workers[i].ring);
+        MB_BusClose(poller->workers[i].bus);
+    }
+    free(poller);
+}
@@ -0,0 +1,160 @@
+#define _POSIX_C_SOURCE 200809L // struct stat::st_mtim
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#include "mb_ports.h"
+#include "mb_platform.h"
+
+// Cached result of the last scan, protected by `g_ports_lock`.
+static MB_Mutex g_ports_lock = MB_MUTEX_INITIALIZER;
+static MB_PortName g_ports[MB_MAX_PORTS];
+static int g_port_count = 0;
+static int g_ports_scanned = 0;
+static int64_t g_ports_stamp = 0; ///< Modification time of `/dev` (POSIX) or time of the scan (Windows).
+
+#ifndef _WIN32
+// Device nodes of serial adapters and on-board UARTs.
+static const char *const PORT_PREFIXES[] = {"ttyUSB", "ttyACM", "ttyAMA", "ttyXRUSB", "rfcomm",
+                                            "cu.usbserial", "cu.usbmodem"};
+#endif
+
+/// @brief Compares port names with their digit runs as numbers, so "ttyUSB2" sorts before "ttyUSB10".
+static int _comparePortNames(const void *lhs, const void *rhs)
+{
+    const char *a = ((const MB_PortName *)lhs)->name, *b = ((const MB_PortName *)rhs)->name;
+    while (*a && *b)
+    {
+        if (isdigit((unsigned char)*a) && isdigit((unsigned char)*b))
+        {
+            char *a_end, *b_end;
+            unsigned long long a_value = strtoull(a, &a_end, 10), b_value = strtoull(b, &b_end, 10);
+            if (a_value != b_value)
+                return a_value < b_value ? -1 : 1;
+            a = a_end;
+            b = b_end;
+            continue;
+        }
+        if (*a != *b)
+            return (unsigned char)*a < (unsigned char)*b ? -1 : 1;
+        ++a;
+        ++b;
+    }
+    return (unsigned char)*a - (unsigned char)*b;
+}
+
+/// @brief Appends a port to the cache unless it is full or the name does not fit.
+static void _addPort(const char *prefix, const char *name)
+{
+    if (g_port_count < MB_MAX_PORTS)
+    {
+        int length = snprintf(g_ports[g_port_count].name, MB_PORT_NAME_MAX, "%s%s", prefix, name);
+        if (length > 0 && length < MB_PORT_NAME_MAX)
+            ++g_port_count;
+    }
+}
+
+#ifdef _WIN32
+/// @brief Returns non-zero if the cached list is outdated; `stamp` receives the time of the scan to come.
+static int _portsChanged(int64_t *stamp)
+{
+    *stamp = _mbMonotonicNs();
+    return !g_ports_scanned || *stamp - g_ports_stamp >= MB_PORT_SCAN_CACHE_MS * 1000000LL;
+}
+
+/// @brief Lists the "COMn" devices known to the object manager.
+static void _scanPorts(void)
+{
+    // Large enough for the names of every DOS device of a busy machine.
+    static char devices[65536];
+    g_port_count = 0;
+    if (QueryDosDeviceA(NULL, devices, (DWORD)sizeof(devices)) == 0)
+        return;
+    for (const char *device = devices; *device; device += strlen(device) + 1)
+    {
+        if (strncmp(device, "COM", 3) != 0 || !device[3])
+            continue;
+        const char *digit = device + 3;
+        while (isdigit((unsigned char)*digit))
+            ++digit;
+        if (!*digit)
+            _addPort("", device);
+    }
+}
+#else
+/// @brief Returns non-zero if the cached list is outdated; `stamp` receives the modification time of `/dev`.
+static int _portsChanged(int64_t *stamp)
+{
+    // udev (or devfs) creates and removes the nodes in /dev, so its modification time moves on hotplug.
+    struct stat info;
+    if (stat("/dev", &info) != 0)
+    {
+        *stamp = 0;
+        return 1;
+    }
+#ifdef __APPLE__
+    *stamp = (int64_t)info.st_mtimespec.tv_sec * 1000000000LL + info.st_mtimespec.tv_nsec;
+#else
+    *stamp = (int64_t)info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+#endif
+    return !g_ports_scanned || *stamp != g_ports_stamp;
+}
+
+/// @brief Lists the serial device nodes of `/dev`.
+static void _scanPorts(void)
+{
+    g_port_count = 0;
+    DIR *directory = opendir("/dev");
+    if (!directory)
+        return;
+    for (struct dirent *entry = readdir(directory); entry; entry = readdir(directory))
+    {
+        for (size_t i = 0; i < sizeof(PORT_PREFIXES) / sizeof(PORT_PREFIXES[0]); ++i)
+        {
+            if (strncmp(entry->d_name, PORT_PREFIXES[i], strlen(PORT_PREFIXES[i])) == 0)
+            {
+                _addPort("/dev/", entry->d_name);
+                break;
+            }
+        }
+    }
+    closedir(directory);
+}
+#endif
+
+int MB_EnumeratePorts(MB_PortName *ports, int max)
+{
+    // 1. Validate input parameters.
+    if (max < 0 || (max > 0 && !ports))
+    {
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return MB_ERR;
+    }
+
+    // 2. Scan again only if the set of devices may have changed since the last call.
+    _mbMutexLock(&g_ports_lock);
+    int64_t stamp;
+    if (_portsChanged(&stamp))
+    {
+        _scanPorts();
+        qsort(g_ports, (size_t)g_port_count, sizeof(MB_PortName), _comparePortNames);
+        g_ports_stamp = stamp;
+        g_ports_scanned = 1;
+    }
+
+    // 3. Copy the cached list out.
+    int count = g_port_count < max ? g_port_count : max;
+    if (count)
+        memcpy(ports, g_ports, (size_t)count * sizeof(MB_PortName));
+    _mbMutexUnlock(&g_ports_lock);
+
+    _resetBusGlobalError();
+    return count;
+}
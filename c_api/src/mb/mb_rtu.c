@@ -0,0 +1,509 @@
+#ifdef __linux__
+#define _GNU_SOURCE // ppoll()
+#endif
+
+#ifdef _WIN32
+#include "modbus.h"
+#else
+#include <modbus/modbus.h>
+#endif
+
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/serial.h>
+#endif
+#endif
+
+#include "mb_rtu.h"
+#include "mb_platform.h"
+
+// CRC-16/MODBUS (reflected polynomial 0xA001) of every byte value.
+static const uint16_t CRC16_TABLE[256] = {
+    0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
+    0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
+    0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
+    0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
+    0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
+    0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
+    0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
+    0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
+    0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
+    0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+    0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
+    0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
+    0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
+    0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
+    0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
+    0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
+    0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
+    0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
+    0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
+    0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+    0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
+    0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
+    0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
+    0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
+    0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
+    0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
+    0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
+    0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
+    0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
+    0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+    0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
+    0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040,
+};
+
+uint16_t MB_RtuCrc16(uint16_t crc, const uint8_t *MB_RESTRICT data, size_t length)
+{
+    for (size_t i = 0; i < length; ++i)
+        crc = (uint16_t)((crc >> 8) ^ CRC16_TABLE[(crc ^ data[i]) & 0xFF]);
+    return crc;
+}
+
+/// @brief Stores `crc` at `offset` of a frame, low byte first.
+static inline void _putCrc(uint8_t *frame, size_t offset, uint16_t crc)
+{
+    frame[offset] = (uint8_t)crc;
+    frame[offset + 1] = (uint8_t)(crc >> 8);
+}
+
+/// @brief Fills the part common to every request: slave address, function code and start address.
+static void _putHeader(MB_RtuFrame *MB_RESTRICT frame, int slave_id, int function, int addr)
+{
+    frame->request[0] = (uint8_t)slave_id;
+    frame->request[1] = (uint8_t)function;
+    frame->request[2] = (uint8_t)(addr >> 8);
+    frame->request[3] = (uint8_t)addr;
+    frame->function = (uint8_t)function;
+}
+
+/// @brief Tells whether a function code reads registers (the others write them).
+static inline int _isRead(int function) { return function == 0x03 || function == 0x04; }
+
+/// @brief Prepares a read request with the given function code (0x03 or 0x04).
+static int _prepareRead(MB_RtuFrame *MB_RESTRICT frame, int slave_id, int function, int addr, int count)
+{
+    // 1. Validate input parameters.
+    if (unlikely(!frame || slave_id < 0 || slave_id > MB_MAX_SLAVE_ID || addr < 0 || count < 1 ||
+                 count > MODBUS_MAX_READ_REGISTERS || addr + count > 0x10000))
+    {
+        MB_DEBUG_MSG("Invalid read request parameters")
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return MB_ERR;
+    }
+
+    // 2. Nothing varies between two reads: the CRC is final.
+    _putHeader(frame, slave_id, function, addr);
+    frame->request[4] = (uint8_t)(count >> 8);
+    frame->request[5] = (uint8_t)count;
+    frame->request_size = MB_RTU_READ_REQUEST_SIZE;
+    frame->payload_offset = MB_RTU_READ_REQUEST_SIZE - 2;
+    frame->register_count = (uint8_t)count;
+    frame->header_crc = MB_RtuCrc16(0xFFFF, frame->request, frame->payload_offset);
+    frame->response_size = MB_RTU_READ_RESPONSE_SIZE(count);
+    _putCrc(frame->request, frame->payload_offset, frame->header_crc);
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+int MB_RtuPrepareRead(MB_RtuFrame *MB_RESTRICT frame, int slave_id, int addr, int count)
+{
+    return _prepareRead(frame, slave_id, 0x03, addr, count);
+}
+
+int MB_RtuPrepareReadInput(MB_RtuFrame *MB_RESTRICT frame, int slave_id, int addr, int count)
+{
+    return _prepareRead(frame, slave_id, 0x04, addr, count);
+}
+
+int MB_RtuPrepareWrite(MB_RtuFrame *MB_RESTRICT frame, int slave_id, int addr, int count, int multiple)
+{
+    // 1. Validate input parameters.
+    if (unlikely(!frame || slave_id < 0 || slave_id > MB_MAX_SLAVE_ID || addr < 0 || count < 1 ||
+                 count > (multiple ? MB_RTU_FRAME_MAX_REGISTERS : 1) || addr + count > 0x10000))
+    {
+        MB_DEBUG_MSG("Invalid write request parameters")
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return MB_ERR;
+    }
+
+    // 2. Encode everything but the register values, and the CRC of it.
+    _putHeader(frame, slave_id, multiple ? 0x10 : 0x06, addr);
+    if (multiple)
+    {
+        frame->request[4] = (uint8_t)(count >> 8);
+        frame->request[5] = (uint8_t)count;
+        frame->request[6] = (uint8_t)(2 * count);
+        frame->payload_offset = 7;
+        frame->request_size = (uint8_t)MB_RTU_WRITE_MULTIPLE_REQUEST_SIZE(count);
+        frame->response_size = MB_RTU_WRITE_MULTIPLE_RESPONSE_SIZE;
+    }
+    else
+    {
+        frame->payload_offset = 4;
+        frame->request_size = MB_RTU_WRITE_SINGLE_SIZE;
+        frame->response_size = MB_RTU_WRITE_SINGLE_SIZE;
+    }
+    frame->register_count = (uint8_t)count;
+    frame->header_crc = MB_RtuCrc16(0xFFFF, frame->request, frame->payload_offset);
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+#ifdef _WIN32
+int MB_RtuOpenPort(MB_RtuPort *MB_RESTRICT port, int fd)
+{
+    // libmodbus drives Windows ports through a HANDLE it does not expose.
+    (void)port;
+    (void)fd;
+    _setBusGlobalError(ERROR_MB_NOT_SUPPORTED);
+    return MB_ERR;
+}
+
+int MB_RtuOpenTcp(MB_RtuPort *MB_RESTRICT port, const char *MB_RESTRICT host, const char *MB_RESTRICT service,
+                  int timeout_us)
+{
+    // Sockets are no file descriptors there, and libmodbus keeps its own.
+    (void)port;
+    (void)host;
+    (void)service;
+    (void)timeout_us;
+    _setBusGlobalError(ERROR_MB_NOT_SUPPORTED);
+    return MB_ERR;
+}
+
+void MB_RtuClosePort(MB_RtuPort *port) { (void)port; }
+
+int MB_RtuExecute(MB_RtuPort *MB_RESTRICT port, MB_RtuFrame *MB_RESTRICT frame, const uint16_t *MB_RESTRICT payload,
+                  uint16_t *MB_RESTRICT dest, int timeout_us, int byte_timeout_us)
+{
+    (void)port;
+    (void)frame;
+    (void)payload;
+    (void)dest;
+    (void)timeout_us;
+    (void)byte_timeout_us;
+    errno = ENOTSUP;
+    _setBusGlobalError(ERROR_MB_NOT_SUPPORTED);
+    return MB_ERR;
+}
+#else
+int MB_RtuOpenPort(MB_RtuPort *MB_RESTRICT port, int fd)
+{
+    // 1. Validate input parameters: a context without a descriptor (e.g., not connected) cannot be driven.
+    if (unlikely(!port))
+    {
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return MB_ERR;
+    }
+    if (unlikely(fd < 0))
+    {
+        _setBusGlobalError(ERROR_MB_NOT_SUPPORTED);
+        return MB_ERR;
+    }
+
+    // 2. Reads return whatever arrived at once; the waits are made with poll(). A socket needs no tuning.
+    port->stream = !isatty(fd);
+    struct termios tio;
+    if (!port->stream && tcgetattr(fd, &tio) == 0 && (tio.c_cc[VMIN] != 0 || tio.c_cc[VTIME] != 0))
+    {
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 0;
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+
+#ifdef __linux__
+    // 3. USB adapters otherwise batch received bytes (up to 16 ms with the FTDI latency timer).
+    struct serial_struct serial;
+    if (!port->stream && ioctl(fd, TIOCGSERIAL, &serial) == 0 && !(serial.flags & ASYNC_LOW_LATENCY))
+    {
+        serial.flags |= ASYNC_LOW_LATENCY;
+        ioctl(fd, TIOCSSERIAL, &serial);
+    }
+#endif
+
+    // 4. Whatever is pending belongs to no request of this transport.
+    port->fd = fd;
+    port->dirty = 1;
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+/// @brief Connects a non-blocking socket to one address within `timeout_us`. Returns 0 on success,
+/// -1 with `errno` set otherwise.
+static int _connectSocket(int fd, const struct addrinfo *address, int timeout_us)
+{
+    if (connect(fd, address->ai_addr, address->ai_addrlen) == 0)
+        return 0;
+    if (errno != EINPROGRESS)
+        return -1;
+
+    struct pollfd pfd = {fd, POLLOUT, 0};
+    int ready;
+    while ((ready = poll(&pfd, 1, (timeout_us + 999) / 1000)) < 0 && errno == EINTR)
+        ;
+    if (ready == 0)
+        errno = ETIMEDOUT;
+    if (ready <= 0)
+        return -1;
+
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0)
+        return -1;
+    errno = error;
+    return error ? -1 : 0;
+}
+
+int MB_RtuOpenTcp(MB_RtuPort *MB_RESTRICT port, const char *MB_RESTRICT host, const char *MB_RESTRICT service,
+                  int timeout_us)
+{
+    // 1. Validate input parameters.
+    if (unlikely(!port || !host || !service || timeout_us < 0))
+    {
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return MB_ERR;
+    }
+
+    // 2. Resolve the gateway.
+    struct addrinfo hints, *addresses = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, service, &hints, &addresses) != 0)
+    {
+        MB_DEBUG_MSG("Failed to resolve the gateway address")
+        errno = EHOSTUNREACH;
+        _setBusGlobalError(ERROR_MB_FAILED_CONNECT);
+        return MB_ERR;
+    }
+
+    // 3. Connect to the first address that answers.
+    int fd = -1;
+    for (const struct addrinfo *address = addresses; address && fd < 0; address = address->ai_next)
+    {
+        fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (fd < 0)
+            continue;
+        if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0 || _connectSocket(fd, address, timeout_us) != 0)
+        {
+            int error = errno;
+            close(fd);
+            errno = error;
+            fd = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+    if (fd < 0)
+    {
+        MB_DEBUG_MSG("Failed to connect to the gateway")
+        _setBusGlobalError(ERROR_MB_FAILED_CONNECT);
+        return MB_ERR;
+    }
+
+    // 4. Requests are single small frames: do not hold them back to coalesce segments.
+    int enabled = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+#ifdef SO_NOSIGPIPE
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof(enabled));
+#endif
+    return MB_RtuOpenPort(port, fd);
+}
+
+void MB_RtuClosePort(MB_RtuPort *port)
+{
+    if (!port)
+        return;
+    if (port->stream && port->fd >= 0)
+        close(port->fd);
+    port->fd = -1;
+}
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // SO_NOSIGPIPE is set on the socket instead.
+#endif
+
+/// @brief Writes the whole request. Returns non-zero on success, 0 with `errno` set otherwise.
+static int _sendFrame(const MB_RtuPort *MB_RESTRICT port, const uint8_t *MB_RESTRICT data, size_t size,
+                      int timeout_us)
+{
+    // A closed connection reports EPIPE instead of killing the process with SIGPIPE.
+    int fd = port->fd;
+    while (size)
+    {
+        ssize_t written = port->stream ? send(fd, data, size, MSG_NOSIGNAL) : write(fd, data, size);
+        if (written > 0)
+        {
+            data += written;
+            size -= (size_t)written;
+            continue;
+        }
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written < 0 && errno != EAGAIN)
+            return 0;
+
+        // The output buffer of a non-blocking port is full: wait for room.
+        struct pollfd pfd = {fd, POLLOUT, 0};
+        if (poll(&pfd, 1, (timeout_us + 999) / 1000) <= 0)
+        {
+            errno = ETIMEDOUT;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/// @brief Waits up to `timeout_us` for received bytes. Returns 1 if some are pending, 0 on
+/// timeout, and -1 with `errno` set if the port failed (e.g., the adapter was unplugged).
+static int _waitReadable(int fd, int timeout_us)
+{
+    struct pollfd pfd = {fd, POLLIN, 0};
+    int ready;
+    do
+    {
+#ifdef __linux__
+        struct timespec timeout = {timeout_us / 1000000, (long)(timeout_us % 1000000) * 1000L};
+        ready = ppoll(&pfd, 1, &timeout, NULL);
+#else
+        ready = poll(&pfd, 1, (timeout_us + 999) / 1000);
+#endif
+    } while (ready < 0 && errno == EINTR);
+
+    if (ready > 0 && !(pfd.revents & POLLIN))
+    {
+        errno = pfd.revents & POLLNVAL ? EBADF : EIO;
+        return -1;
+    }
+    return ready;
+}
+
+/// @brief Drops the received bytes that belong to no request.
+static void _flushInput(const MB_RtuPort *MB_RESTRICT port)
+{
+    if (!port->stream)
+    {
+        tcflush(port->fd, TCIFLUSH);
+        return;
+    }
+    uint8_t discard[MB_RTU_MAX_ADU_SIZE];
+    while (recv(port->fd, discard, sizeof(discard), MSG_DONTWAIT) > 0)
+        ;
+}
+
+/// @brief Marks the port for a flush before the next request, as part of the response may still arrive.
+static inline int _failExchange(MB_RtuPort *MB_RESTRICT port)
+{
+    port->dirty = 1;
+    return MB_ERR;
+}
+
+int MB_RtuExecute(MB_RtuPort *MB_RESTRICT port, MB_RtuFrame *MB_RESTRICT frame, const uint16_t *MB_RESTRICT payload,
+                  uint16_t *MB_RESTRICT dest, int timeout_us, int byte_timeout_us)
+{
+    // 1. Patch the register values of a write and finish the CRC from the one of the header.
+    size_t crc_offset = (size_t)frame->request_size - 2;
+    if (!_isRead(frame->function))
+    {
+        uint8_t *values = frame->request + frame->payload_offset;
+        for (int i = 0; i < frame->register_count; ++i)
+        {
+            values[2 * i] = (uint8_t)(payload[i] >> 8);
+            values[2 * i + 1] = (uint8_t)payload[i];
+        }
+        _putCrc(frame->request, crc_offset, MB_RtuCrc16(frame->header_crc, values, 2u * frame->register_count));
+    }
+
+    // 2. Drop the tail of a response that came too late for a previous request.
+    if (port->dirty)
+    {
+        _flushInput(port);
+        port->dirty = 0;
+    }
+
+    // 3. Send the request. Slaves never answer a broadcast.
+    if (unlikely(!_sendFrame(port, frame->request, frame->request_size, timeout_us)))
+        return _failExchange(port);
+    if (frame->request[0] == 0)
+        return frame->register_count;
+
+    // 4. Receive the response: its size is known from the request, unless the slave answers
+    // with an exception (slave, function | 0x80, code, CRC).
+    uint8_t *response = port->response;
+    size_t expected = frame->response_size, received = 0;
+    int wait_us = timeout_us;
+    while (received < expected)
+    {
+        int ready = _waitReadable(port->fd, wait_us);
+        if (ready <= 0)
+        {
+            if (ready == 0)
+                errno = ETIMEDOUT;
+            return _failExchange(port);
+        }
+        ssize_t count = read(port->fd, response + received, MB_RTU_MAX_ADU_SIZE - received);
+        if (count <= 0)
+        {
+            if (count < 0 && (errno == EINTR || errno == EAGAIN))
+                continue;
+            if (count == 0)
+                errno = EIO; // Readable without data: the device hung up.
+            return _failExchange(port);
+        }
+        received += (size_t)count;
+        if (received >= 2 && (response[1] & 0x80))
+            expected = 5;
+        wait_us = byte_timeout_us;
+    }
+    if (unlikely(received > expected))
+        port->dirty = 1; // Extra bytes of noise or of a stale response: flush before the next request.
+
+    // 5. Check the frame, then what it answers.
+    uint16_t crc = (uint16_t)(response[expected - 2] | (response[expected - 1] << 8));
+    if (unlikely(MB_RtuCrc16(0xFFFF, response, expected - 2) != crc))
+    {
+        errno = EMBBADCRC;
+        return _failExchange(port);
+    }
+    if (unlikely(response[0] != frame->request[0]))
+    {
+        errno = EMBBADSLAVE;
+        return _failExchange(port);
+    }
+    if (response[1] == (frame->function | 0x80))
+    {
+        errno = response[2] > 0 && response[2] < MODBUS_EXCEPTION_MAX ? MODBUS_ENOBASE + response[2] : EMBUNKEXC;
+        return MB_ERR;
+    }
+    int valid;
+    if (_isRead(frame->function))
+        valid = response[1] == frame->function && response[2] == 2 * frame->register_count;
+    else if (frame->function == 0x06)
+        valid = memcmp(response, frame->request, MB_RTU_WRITE_SINGLE_SIZE - 2) == 0; // Echo of the request.
+    else
+        valid = response[1] == 0x10 && memcmp(response + 2, frame->request + 2, 4) == 0; // Address and count.
+    if (unlikely(!valid))
+    {
+        errno = EMBBADDATA;
+        return _failExchange(port);
+    }
+
+    // 6. Decode the registers of a read.
+    if (_isRead(frame->function))
+        for (int i = 0; i < frame->register_count; ++i)
+            dest[i] = (uint16_t)((response[3 + 2 * i] << 8) | response[4 + 2 * i]);
+    return frame->register_count;
+}
+#endif
@@ -0,0 +1,574 @@
+#ifdef _WIN32
+#include "modbus.h"
+#else
+#include <modbus/modbus.h>
+#endif
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mb_device.h"
+#include "mb_platform.h"
+#include "mb_sim.h"
+
+// Registers of the MODBUS address space, all of which a simulated slave answers.
+#define MB_SIM_REGISTERS 65536
+
+/**
+ * @struct MB_SimDevice
+ * @brief State of one simulated slave: its register image and the model of its value.
+ */
+typedef struct
+{
+    MB_SimSlave desc;                  ///< Description given to `MB_SimAddSlave()`.
+    MB_LogRecord *recording;           ///< Records replayed as the value (`NULL` if none).
+    size_t record_count;               ///< Number of records of `recording`.
+    int64_t period_ns;                 ///< Length of one pass over the recording, the mean record interval included.
+    int64_t origin_ns;                 ///< Simulated time the replay started at.
+    int64_t clock_ns;                  ///< Simulated time of the slave at speed 0.
+    int following;                     ///< Non-zero once a setpoint write started the lag.
+    unsigned setpoint_written;         ///< Setpoint words written through a bus so far (bit i: word i).
+    double value;                      ///< Raw value while following.
+    double target;                     ///< Raw setpoint while following.
+    int64_t updated_ns;                ///< Simulated time `value` was computed for.
+    uint16_t regs[MB_SIM_REGISTERS];   ///< Register image.
+} MB_SimDevice;
+
+struct MB_Sim
+{
+    MB_Mutex lock;                                ///< Serializes the requests of all buses on the line.
+    char name[MB_SIM_NAME_MAX];                   ///< Name the line is registered under.
+    double speed;                                 ///< Simulated seconds per real second (0: per read).
+    int64_t base_mono_ns;                         ///< Monotonic clock when `speed` was last set...
+    int64_t base_sim_ns;                          ///< ...and the simulated time at the same moment.
+    int64_t step_ns;                              ///< Time a read advances at speed 0 without a recording.
+    int loop;                                     ///< Non-zero to restart the recordings at their end.
+    int latency_us;                               ///< Time every request takes.
+    int closed;                                   ///< Non-zero once the owner closed the line.
+    int references;                               ///< Owner and attached buses (guarded by `g_sim_lock`).
+    uint64_t requests;                            ///< Requests answered or failed (accessed atomically).
+    MB_SimDevice *slaves[MB_SIM_MAX_SLAVES];      ///< Slaves in the order they were added.
+    int slave_count;                              ///< Number of slaves.
+    struct MB_Sim *next;                          ///< Next open line of the registry.
+};
+
+// Lines are only looked up when buses connect: one lock for the registry and the references is enough.
+static MB_Mutex g_sim_lock = MB_MUTEX_INITIALIZER;
+static MB_Sim *g_sims = NULL;
+
+/// @brief Returns the slave `slave_id` of the line, or `NULL` if there is none (lock held).
+static inline MB_SimDevice *_simFindSlave(MB_Sim *sim, int slave_id)
+{
+    for (int i = 0; i < sim->slave_count; ++i)
+        if (sim->slaves[i]->desc.slave_id == slave_id)
+            return sim->slaves[i];
+    return NULL;
+}
+
+/// @brief Returns the simulated time of a slave (lock held).
+static inline int64_t _simNow(const MB_Sim *sim, const MB_SimDevice *device)
+{
+    if (sim->speed <= 0.0)
+        return device->clock_ns;
+    return sim->base_sim_ns + (int64_t)((double)(_mbMonotonicNs() - sim->base_mono_ns) * sim->speed);
+}
+
+/// @brief Decodes the raw value of `width` registers (high word first).
+static inline double _simDecode(const MB_SimSlave *desc, const uint16_t *regs)
+{
+    if (desc->width == 1)
+        return desc->flags & MB_REGISTER_SIGNED ? (double)(int16_t)regs[0] : (double)regs[0];
+    uint32_t raw = ((uint32_t)regs[0] << 16) | regs[1];
+    return desc->flags & MB_REGISTER_SIGNED ? (double)(int32_t)raw : (double)raw;
+}
+
+/// @brief Encodes a raw value into `width` registers, rounded to the nearest count and saturated.
+static inline void _simEncode(const MB_SimSlave *desc, double value, uint16_t *regs)
+{
+    const int bits = desc->width == 1 ? 16 : 32;
+    const double max = (double)((1LL << (desc->flags & MB_REGISTER_SIGNED ? bits - 1 : bits)) - 1);
+    const double min = desc->flags & MB_REGISTER_SIGNED ? -max - 1.0 : 0.0;
+    value = value < min ? min : value > max ? max : value;
+    int64_t raw = (int64_t)(value < 0.0 ? value - 0.5 : value + 0.5);
+    if (desc->width == 1)
+        regs[0] = (uint16_t)raw;
+    else
+    {
+        regs[0] = (uint16_t)((uint32_t)raw >> 16);
+        regs[1] = (uint16_t)raw;
+    }
+}
+
+/// @brief Moves the lagging value of a slave to simulated time `now_ns` (lock held).
+static inline void _simFollow(MB_SimDevice *device, int64_t now_ns)
+{
+    // Without a time constant the setpoint is reached at once, even at the time it was written.
+    int64_t elapsed_ns = now_ns - device->updated_ns;
+    if (device->desc.time_constant_ms <= 0)
+        device->value = device->target;
+    else if (elapsed_ns > 0)
+        device->value += (device->target - device->value) *
+                         (1.0 - exp(-(double)elapsed_ns / ((double)device->desc.time_constant_ms * 1e6)));
+    if (elapsed_ns > 0)
+        device->updated_ns = now_ns;
+}
+
+/// @brief Returns the index of the record replayed at simulated time `now_ns` (lock held, recording loaded).
+static inline size_t _simRecordAt(const MB_Sim *sim, const MB_SimDevice *device, int64_t now_ns)
+{
+    const MB_LogRecord *records = device->recording;
+    int64_t offset_ns = now_ns - device->origin_ns;
+    if (offset_ns < 0)
+        offset_ns = 0;
+    if (sim->loop)
+        offset_ns %= device->period_ns;
+
+    // Last record at or before the offset: the value the device showed at that time.
+    size_t low = 0, high = device->record_count;
+    while (high - low > 1)
+    {
+        size_t middle = low + (high - low) / 2;
+        if (records[middle].t_ns - records[0].t_ns <= offset_ns)
+            low = middle;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+/**
+ * @brief Refreshes the value registers of a slave for a read covering them, then advances its clock
+ * at speed 0. Returns 0, or -1 if the replayed read failed (lock held).
+ */
+static int _simUpdateValue(MB_Sim *sim, MB_SimDevice *device)
+{
+    // 1. Compute the value at the current simulated time.
+    const MB_SimSlave *desc = &device->desc;
+    int64_t now_ns = _simNow(sim, device);
+    int64_t step_ns = sim->step_ns;
+    int result = 0;
+    if (device->following)
+    {
+        _simFollow(device, now_ns);
+        _simEncode(desc, device->value, device->regs + desc->value_address);
+    }
+    else if (device->recording)
+    {
+        size_t index = _simRecordAt(sim, device, now_ns);
+        const MB_LogRecord *record = device->recording + index;
+        if (record->status != MB_OK)
+            result = -1;
+        else
+            memcpy(device->regs + desc->value_address, record->registers, desc->width * sizeof(uint16_t));
+
+        // At speed 0 the next read shows the next record, or the first one again.
+        const int64_t offset_ns = record->t_ns - device->recording[0].t_ns;
+        if (index + 1 < device->record_count)
+            step_ns = device->recording[index + 1].t_ns - record->t_ns;
+        else if (sim->loop)
+            step_ns = device->period_ns - offset_ns;
+    }
+
+    // 2. Each read of the value is one step of the clock of the slave at speed 0.
+    if (sim->speed <= 0.0)
+        device->clock_ns += step_ns > 0 ? step_ns : 0;
+    return result;
+}
+
+/// @brief Writes registers through the bus (lock held). The lag starts once every register of the setpoint was
+/// written, in one request or in several (e.g., one "Write Single Register" per word), and any later setpoint
+/// write retargets it, as a device applying each register as it comes would.
+static void _simWrite(MB_Sim *sim, MB_SimDevice *device, int addr, int count, const uint16_t *values)
+{
+    const MB_SimSlave *desc = &device->desc;
+    memcpy(device->regs + addr, values, (size_t)count * sizeof(uint16_t));
+    unsigned touched = 0;
+    for (int i = 0; i < desc->width; ++i)
+        if (addr <= desc->setpoint_address + i && desc->setpoint_address + i < addr + count)
+            touched |= 1u << i;
+    device->setpoint_written |= touched;
+    if (!touched || device->setpoint_written != (1u << desc->width) - 1)
+        return;
+
+    // Start from the value the slave shows now, replayed or written, then follow the new setpoint.
+    int64_t now_ns = _simNow(sim, device);
+    if (device->following)
+        _simFollow(device, now_ns);
+    else
+    {
+        device->value = _simDecode(desc, device->regs + desc->value_address);
+        device->updated_ns = now_ns;
+        device->following = 1;
+    }
+    device->target = _simDecode(desc, device->regs + desc->setpoint_address);
+}
+
+int MB_SimOpen(const MB_SimConfig *MB_RESTRICT config, MB_Sim **MB_RESTRICT sim)
+{
+    // 1. Validate input parameters.
+    if (unlikely(!config || !sim || !config->name || !config->name[0] ||
+                 strlen(config->name) >= MB_SIM_NAME_MAX || !(config->speed >= 0.0) || config->step_us < 0 ||
+                 config->latency_us < 0))
+    {
+        MB_DEBUG_MSG("Invalid simulated line configuration")
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return ERROR_MB_INVALID_PARAMETER;
+    }
+
+    // 2. Create the line, its clock starting now.
+    MB_Sim *opened = calloc(1, sizeof(MB_Sim));
+    if (unlikely(!opened))
+    {
+        _setBusGlobalError(ERROR_MB_OUT_OF_MEMORY);
+        return ERROR_MB_OUT_OF_MEMORY;
+    }
+    _mbMutexInit(&opened->lock);
+    strcpy(opened->name, config->name);
+    opened->speed = config->speed;
+    opened->base_mono_ns = _mbMonotonicNs();
+    opened->step_ns = (int64_t)(config->step_us > 0 ? config->step_us : MB_SIM_DEFAULT_STEP_US) * 1000;
+    opened->loop = config->loop;
+    opened->latency_us = config->latency_us;
+    opened->references = 1;
+
+    // 3. Register it, unless another open line has the name.
+    _mbMutexLock(&g_sim_lock);
+    for (MB_Sim *other = g_sims; other; other = other->next)
+        if (strcmp(other->name, opened->name) == 0)
+        {
+            _mbMutexUnlock(&g_sim_lock);
+            _mbMutexDestroy(&opened->lock);
+            free(opened);
+            MB_DEBUG_MSG("Simulated line name already taken")
+            _setBusGlobalError(ERROR_MB_CONFIG_MISMATCH);
+            return ERROR_MB_CONFIG_MISMATCH;
+        }
+    opened->next = g_sims;
+    g_sims = opened;
+    _mbMutexUnlock(&g_sim_lock);
+    *sim = opened;
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+int MB_SimAddSlave(MB_Sim *MB_RESTRICT sim, const MB_SimSlave *MB_RESTRICT slave)
+{
+    // 1. Validate input parameters.
+    if (unlikely(!sim || !slave || slave->slave_id < 1 || slave->slave_id > MB_MAX_SLAVE_ID || slave->width > 2 ||
+                 slave->value_address + slave->width > MB_SIM_REGISTERS ||
+                 slave->setpoint_address + slave->width > MB_SIM_REGISTERS || slave->time_constant_ms < 0))
+    {
+        MB_DEBUG_MSG("Invalid simulated slave")
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return ERROR_MB_INVALID_PARAMETER;
+    }
+
+    // 2. Create it with an empty register image.
+    MB_SimDevice *device = calloc(1, sizeof(MB_SimDevice));
+    if (unlikely(!device))
+    {
+        _setBusGlobalError(ERROR_MB_OUT_OF_MEMORY);
+        return ERROR_MB_OUT_OF_MEMORY;
+    }
+    device->desc = *slave;
+
+    // 3. Put it on the line, unless the address is taken or the line is full.
+    _mbMutexLock(&sim->lock);
+    if (sim->slave_count == MB_SIM_MAX_SLAVES || _simFindSlave(sim, slave->slave_id))
+    {
+        _mbMutexUnlock(&sim->lock);
+        free(device);
+        MB_DEBUG_MSG("Slave address taken or simulated line full")
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return ERROR_MB_INVALID_PARAMETER;
+    }
+    device->clock_ns = sim->speed > 0.0 ? _simNow(sim, device) : 0;
+    sim->slaves[sim->slave_count++] = device;
+    _mbMutexUnlock(&sim->lock);
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+int MB_SimSetRegisters(MB_Sim *MB_RESTRICT sim, int slave_id, int addr, int count, const uint16_t *MB_RESTRICT regs)
+{
+    if (unlikely(!sim || !regs || addr < 0 || count < 1 || addr + count > MB_SIM_REGISTERS))
+    {
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return ERROR_MB_INVALID_PARAMETER;
+    }
+    _mbMutexLock(&sim->lock);
+    MB_SimDevice *device = _simFindSlave(sim, slave_id);
+    if (device)
+        memcpy(device->regs + addr, regs, (size_t)count * sizeof(uint16_t));
+    _mbMutexUnlock(&sim->lock);
+    if (unlikely(!device))
+    {
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return ERROR_MB_INVALID_PARAMETER;
+    }
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+int MB_SimGetRegisters(MB_Sim *MB_RESTRICT sim, int slave_id, int addr, int count, uint16_t *MB_RESTRICT dest)
+{
+    if (unlikely(!sim || !dest || addr < 0 || count < 1 || addr + count > MB_SIM_REGISTERS))
+    {
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return ERROR_MB_INVALID_PARAMETER;
+    }
+    _mbMutexLock(&sim->lock);
+    MB_SimDevice *device = _simFindSlave(sim, slave_id);
+    if (device)
+        memcpy(dest, device->regs + addr, (size_t)count * sizeof(uint16_t));
+    _mbMutexUnlock(&sim->lock);
+    if (unlikely(!device))
+    {
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return ERROR_MB_INVALID_PARAMETER;
+    }
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+int MB_SimLoadRecording(MB_Sim *MB_RESTRICT sim, int slave_id, const MB_LogRecord *MB_RESTRICT records, size_t count)
+{
+    // 1. Validate input parameters: the records must be in time order.
+    int valid = sim && records && count > 0;
+    for (size_t i = 1; valid && i < count; ++i)
+        valid = records[i].t_ns >= records[i - 1].t_ns;
+    if (unlikely(!valid))
+    {
+        MB_DEBUG_MSG("Invalid recording")
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return ERROR_MB_INVALID_PARAMETER;
+    }
+
+    // 2. Copy the records, so the caller may free them.
+    MB_LogRecord *copy = malloc(count * sizeof(MB_LogRecord));
+    if (unlikely(!copy))
+    {
+        _setBusGlobalError(ERROR_MB_OUT_OF_MEMORY);
+        return ERROR_MB_OUT_OF_MEMORY;
+    }
+    memcpy(copy, records, count * sizeof(MB_LogRecord));
+    const int64_t span_ns = copy[count - 1].t_ns - copy[0].t_ns;
+    const int64_t period_ns = count > 1 ? span_ns + span_ns / (int64_t)(count - 1) : 0;
+
+    // 3. Replace the model of the value of the slave, from its current simulated time; every
+    //    successful read must hold the whole value.
+    _mbMutexLock(&sim->lock);
+    MB_SimDevice *device = _simFindSlave(sim, slave_id);
+    int error_code = device && device->desc.width > 0 ? MB_OK : ERROR_MB_INVALID_PARAMETER;
+    for (size_t i = 0; error_code == MB_OK && i < count; ++i)
+        if (copy[i].status == MB_OK && copy[i].register_count < device->desc.width)
+            error_code = ERROR_MB_INVALID_PARAMETER;
+    if (error_code == MB_OK)
+    {
+        free(device->recording);
+        device->recording = copy;
+        device->record_count = count;
+        device->period_ns = period_ns > 0 ? period_ns : sim->step_ns;
+        device->origin_ns = _simNow(sim, device);
+        device->following = 0;
+        device->setpoint_written = 0;
+        copy = NULL;
+    }
+    _mbMutexUnlock(&sim->lock);
+    free(copy);
+    if (unlikely(error_code != MB_OK))
+    {
+        MB_DEBUG_MSG("No simulated value, or records narrower than it")
+        _setBusGlobalError(error_code);
+        return error_code;
+    }
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+int MB_SimLoadLog(MB_Sim *MB_RESTRICT sim, int slave_id, const MB_LogConfig *MB_RESTRICT config, int channel)
+{
+    // 1. Validate input parameters.
+    if (unlikely(!sim || !config || channel < 0 || channel > 0xFF))
+    {
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return ERROR_MB_INVALID_PARAMETER;
+    }
+
+    // 2. Count the records of the channel, then read them.
+    size_t count = 0;
+    int error_code = MB_LogRead(config, channel, NULL, 0, &count);
+    if (error_code != MB_OK)
+        return error_code;
+    if (count == 0)
+    {
+        _setBusGlobalError(ERROR_MB_FAILED_READ_LOG);
+        return ERROR_MB_FAILED_READ_LOG;
+    }
+    MB_LogRecord *records = malloc(count * sizeof(MB_LogRecord));
+    if (unlikely(!records))
+    {
+        _setBusGlobalError(ERROR_MB_OUT_OF_MEMORY);
+        return ERROR_MB_OUT_OF_MEMORY;
+    }
+    size_t read = 0;
+    error_code = MB_LogRead(config, channel, records, count, &read);
+
+    // 3. Replay what was read; a writer may have appended since the count.
+    if (error_code == MB_OK)
+        error_code = MB_SimLoadRecording(sim, slave_id, records, read < count ? read : count);
+    free(records);
+    return error_code;
+}
+
+int MB_SimSetSpeed(MB_Sim *sim, double speed)
+{
+    if (unlikely(!sim || !(speed >= 0.0)))
+    {
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return ERROR_MB_INVALID_PARAMETER;
+    }
+
+    // Carry the simulated time over: the slaves leave or join the shared clock where it is.
+    _mbMutexLock(&sim->lock);
+    int64_t now_ns = 0;
+    if (sim->speed > 0.0)
+        now_ns = _simNow(sim, NULL);
+    else
+        for (int i = 0; i < sim->slave_count; ++i)
+            now_ns = sim->slaves[i]->clock_ns > now_ns ? sim->slaves[i]->clock_ns : now_ns;
+    for (int i = 0; i < sim->slave_count; ++i)
+        sim->slaves[i]->clock_ns = now_ns;
+    sim->base_sim_ns = now_ns;
+    sim->base_mono_ns = _mbMonotonicNs();
+    sim->speed = speed;
+    _mbMutexUnlock(&sim->lock);
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+uint64_t MB_SimGetRequestCount(MB_Sim *sim) { return sim ? _mbAtomicLoadU64(&sim->requests) : 0; }
+
+int MB_SimAttach(const char *MB_RESTRICT name, MB_Sim **MB_RESTRICT sim)
+{
+    if (unlikely(!name || !sim))
+    {
+        _setBusGlobalError(ERROR_MB_INVALID_PARAMETER);
+        return ERROR_MB_INVALID_PARAMETER;
+    }
+    _mbMutexLock(&g_sim_lock);
+    MB_Sim *found = g_sims;
+    while (found && strcmp(found->name, name) != 0)
+        found = found->next;
+    if (found)
+        ++found->references;
+    _mbMutexUnlock(&g_sim_lock);
+    if (!found)
+    {
+        errno = ENOENT;
+        _setBusGlobalError(ERROR_MB_FAILED_CONNECT);
+        return ERROR_MB_FAILED_CONNECT;
+    }
+    *sim = found;
+    _resetBusGlobalError();
+    return MB_OK;
+}
+
+void MB_SimRelease(MB_Sim *sim)
+{
+    if (!sim)
+        return;
+    _mbMutexLock(&g_sim_lock);
+    int last = --sim->references == 0;
+    _mbMutexUnlock(&g_sim_lock);
+    if (!last)
+        return;
+    for (int i = 0; i < sim->slave_count; ++i)
+    {
+        free(sim->slaves[i]->recording);
+        free(sim->slaves[i]);
+    }
+    _mbMutexDestroy(&sim->lock);
+    free(sim);
+}
+
+void MB_SimClose(MB_Sim *sim)
+{
+    if (!sim)
+        return;
+
+    // 1. Unregister the name, so a new line may take it.
+    _mbMutexLock(&g_sim_lock);
+    for (MB_Sim **link = &g_sims; *link; link = &(*link)->next)
+        if (*link == sim)
+        {
+            *link = sim->next;
+            break;
+        }
+    _mbMutexUnlock(&g_sim_lock);
+
+    // 2. Unplug the buses still attached, then drop the reference of the owner.
+    _mbMutexLock(&sim->lock);
+    sim->closed = 1;
+    _mbMutexUnlock(&sim->lock);
+    MB_SimRelease(sim);
+}
+
+int MB_SimExecute(MB_Sim *MB_RESTRICT sim, const MB_RtuFrame *MB_RESTRICT frame, const uint16_t *MB_RESTRICT payload,
+                  uint16_t *MB_RESTRICT dest)
+{
+    // 1. Take the time of the line, as a real exchange would.
+    const int is_read = frame->function == 0x03 || frame->function == 0x04;
+    const int slave_id = frame->request[0];
+    const int addr = (frame->request[2] << 8) | frame->request[3];
+    const int count = frame->register_count;
+    _mbAtomicIncU64(&sim->requests);
+    if (sim->latency_us > 0 && slave_id != 0)
+        _mbSleepUntilNs(_mbMonotonicNs() + (int64_t)sim->latency_us * 1000);
+    if (unlikely((is_read && (!dest || slave_id == 0)) || (!is_read && !payload)))
+    {
+        errno = EINVAL;
+        return MB_ERR;
+    }
+
+    // 2. Answer the request as its slave would, or not at all.
+    _mbMutexLock(&sim->lock);
+    int result = count;
+    if (unlikely(sim->closed))
+    {
+        errno = ENOTCONN;
+        result = MB_ERR;
+    }
+    else if (unlikely(addr + count > MB_SIM_REGISTERS))
+    {
+        errno = EMBXILADD;
+        result = MB_ERR;
+    }
+    else if (slave_id == 0)
+        for (int i = 0; i < sim->slave_count; ++i)
+            _simWrite(sim, sim->slaves[i], addr, count, payload);
+    else
+    {
+        MB_SimDevice *device = _simFindSlave(sim, slave_id);
+        const MB_SimSlave *desc = device ? &device->desc : NULL;
+        if (unlikely(!device))
+        {
+            errno = ETIMEDOUT;
+            result = MB_ERR;
+        }
+        else if (!is_read)
+            _simWrite(sim, device, addr, count, payload);
+        else if (desc->width > 0 && addr < desc->value_address + desc->width && desc->value_address < addr + count &&
+                 _simUpdateValue(sim, device) != 0)
+        {
+            errno = ETIMEDOUT; // The recorded read failed as well.
+            result = MB_ERR;
+        }
+        else
+            memcpy(dest, device->regs + addr, (size_t)count * sizeof(uint16_t));
+    }
+    _mbMutexUnlock(&sim->lock);
+    return result;
+}
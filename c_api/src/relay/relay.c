@@ -4,114 +4,410 @@
 #include <modbus/modbus.h>
 #endif
 
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "relay.h"
 #include "relay_constants.h"
+#include "mb_alloc.h"
+#include "mb_bus.h"
+#include "mb_device_io.h"
+#include "mb_platform.h"
+
+// Thread-local error variable definition.
+RELAY_THREAD_LOCAL int RELAY_GlobalError = RELAY_OK;
+
+/// @brief Register map of the relay: one on/off register (0 or 1).
+static const MB_RegisterDesc RELAY_REGISTER_STATE = {MODBUS_REGISTER_TURN_ON_OFF, 1, MB_REGISTER_RW, 1};
+
+/**
+ * @struct Relay_Request
+ * @brief Payload of an asynchronous request, copied into the bus queue.
+ */
+typedef struct
+{
+    Relay_Handle *handle;    ///< Handle the request was submitted through.
+    uint16_t value;          ///< Value to write to the on/off register.
+    Relay_Callback callback; ///< Completion callback (may be `NULL`).
+    void *user_data;         ///< Pointer passed to the callback.
+} Relay_Request;
+
+/// @brief Translates an `ERROR_MB_*` code into the matching relay error code.
+static int _fromBusError(int bus_error)
+{
+    switch (bus_error)
+    {
+    case ERROR_MB_FAILED_CONNECT:
+        return ERROR_RELAY_FAILED_CONNECT;
+    case ERROR_MB_FAILED_CREATE_CONTEXT:
+    case ERROR_MB_OUT_OF_MEMORY:
+        return ERROR_RELAY_FAILED_CREATE_CONTEXT;
+    case ERROR_MB_FAILED_SET_SLAVE:
+        return ERROR_RELAY_FAILED_SET_SLAVE;
+    case ERROR_MB_FAILED_SET_TIMEOUT:
+        return ERROR_RELAY_FAILED_SET_TIMEOUT;
+    case ERROR_MB_CONFIG_MISMATCH:
+        return ERROR_RELAY_PORT_CONFIG_MISMATCH;
+    case ERROR_MB_QUEUE_FULL:
+        return ERROR_RELAY_QUEUE_FULL;
+    case ERROR_MB_FAILED_START_WORKER:
+        return ERROR_RELAY_FAILED_START_WORKER;
+    case ERROR_MB_LINK_DOWN:
+        return ERROR_RELAY_LINK_DOWN;
+    case ERROR_MB_NOT_SUPPORTED:
+        return ERROR_RELAY_NOT_SUPPORTED;
+    case ERROR_MB_NO_RESPONSE:
+        return ERROR_RELAY_NO_RESPONSE;
+    default:
+        return ERROR_RELAY_INVALID_PARAMETER;
+    }
+}
 
-// Global error variable definition.
-int RELAY_GlobalError = RELAY_OK;
+/// @brief Forgets the shadow register: the next write reaches the relay.
+static inline void _invalidateWriteCache(Relay_Handle *RELAY_RESTRICT handle)
+{
+    _mbShadowInvalidate(&handle->shadow_state);
+}
+
+/// @brief Returns non-zero if the relay is known to hold `value` already, so writing it can be skipped.
+static inline int _isShadowed(const Relay_Handle *RELAY_RESTRICT handle, uint16_t value)
+{
+    return handle->write_cache && _mbShadowMatches(&handle->shadow_state, handle->cache_refresh_ns, &value, 1);
+}
+
+/// @brief Records the outcome of an operation in the handle and in the calling thread's error.
+/// After a failure the state of the relay is unknown, so the write cache is invalidated as well.
+static inline int _setHandleError(Relay_Handle *RELAY_RESTRICT handle, int error_code, int modbus_errno)
+{
+    if (error_code != RELAY_OK)
+        _invalidateWriteCache(handle);
+    _mbAtomicStoreInt(&handle->last_modbus_errno, error_code == RELAY_OK ? 0 : modbus_errno);
+    _mbAtomicStoreInt(&handle->last_error, error_code);
+    _setGlobalError(error_code);
+    return error_code == RELAY_OK ? RELAY_OK : RELAY_ERR;
+}
+
+/// @brief Writes `value` to the on/off register within an open transaction. Returns `RELAY_OK` or an error code.
+static inline int _writeRegister(Relay_Handle *RELAY_RESTRICT handle, uint16_t value)
+{
+    MB_RtuFrame *frame = _mbAtomicLoadInt(&handle->fast_transport) ? handle->rtu_frame : NULL;
+    if (!(frame ? _mbRtuRequest(handle->bus, &handle->stats.traffic, frame, &value, NULL)
+                : _mbWriteRegister(handle->bus, &handle->stats.traffic, RELAY_REGISTER_STATE.address, value)))
+    {
+        RELAY_MODBUS_DEBUG_MSG;
+        return ERROR_RELAY_FAILED_WRITE_REGISTER;
+    }
+    if (handle->write_cache)
+        _mbShadowUpdate(&handle->shadow_state, &value, RELAY_REGISTER_STATE.width);
+    return RELAY_OK;
+}
+
+/// @brief Ends a transaction made on the line and counts it under the operation matching `value`.
+static inline void _finishTransaction(Relay_Handle *RELAY_RESTRICT handle, uint16_t value, int error_code)
+{
+    _mbFinishTransaction(handle->bus, &handle->stats.traffic,
+                         &handle->stats.latency[value ? RELAY_STATS_OP_TURN_ON : RELAY_STATS_OP_TURN_OFF],
+                         error_code == RELAY_OK);
+}
+
+/// @brief Ends a transaction in which the write cache made the request unnecessary.
+static inline void _skipTransaction(Relay_Handle *RELAY_RESTRICT handle)
+{
+    _mbSkipTransaction(handle->bus, &handle->stats.traffic);
+}
+
+/// @brief Returns the bus priority class of a state change: switching off is a safety action
+/// that goes ahead of setpoint writes and telemetry on the bus.
+static inline int _statePriority(uint16_t value) { return value ? MB_PRIORITY_SETPOINT : MB_PRIORITY_SAFETY; }
+
+/// @brief Writes `value` to the on/off register of the relay within one bus transaction.
+static int _writeState(Relay_Handle *RELAY_RESTRICT handle, uint16_t value)
+{
+    modbus_t *ctx = MB_BusBeginTransaction(handle->bus, handle->slave_id, _statePriority(value), 0);
+    if (unlikely(!ctx))
+        return _setHandleError(handle, _fromBusError(MB_GetLastErrorCode()), errno);
+
+    // The relay already holds the state: nothing goes on the line.
+    if (_isShadowed(handle, value))
+    {
+        _skipTransaction(handle);
+        return _setHandleError(handle, RELAY_OK, 0);
+    }
+
+    int error_code = _writeRegister(handle, value);
+
+    // The outcome is stored while the bus is still held, so `errno` still belongs to the request.
+    int status = _setHandleError(handle, error_code, errno);
+    _finishTransaction(handle, value, error_code);
+    return status;
+}
 
 int RELAY_Init(const Relay_Config *RELAY_RESTRICT config, Relay_Handle *RELAY_RESTRICT handle)
 {
     // 1. Validate input parameters.
     RELAY_CHECK_PTR_WITH_RETURN(config);
     RELAY_CHECK_PTR_WITH_RETURN(handle);
-
-    // 2. Initialize MODBUS-RTU context using default serial configuration.
-    modbus_t *ctx = modbus_new_rtu(
-        config->port, config->baudrate, RELAY_DEFAULT_PARITY,
-        RELAY_DEFAULT_DATA_BITS, RELAY_DEFAULT_STOP_BITS);
-    if (unlikely(!ctx))
+    if (unlikely(config->slave_id < 0 || config->slave_id > MB_MAX_SLAVE_ID))
     {
-        RELAY_MODBUS_DEBUG_MSG;
-        _setGlobalError(ERROR_RELAY_FAILED_CREATE_CONTEXT);
-        return RELAY_ERR;
+        RELAY_DEBUG_MSG("Slave ID is out of range")
+        return _setHandleError(handle, ERROR_RELAY_FAILED_SET_SLAVE, 0);
     }
-
-    // 3. Set MODBUS slave ID and check for errors.
-    if (unlikely(modbus_set_slave(ctx, config->slave_id) == MODBUS_ERR))
+    if (unlikely(config->write_cache_refresh_ms < 0))
     {
-        RELAY_MODBUS_DEBUG_MSG;
-        modbus_free(ctx);
-        _setGlobalError(ERROR_RELAY_FAILED_SET_SLAVE);
+        RELAY_DEBUG_MSG("Write cache refresh interval must not be negative")
+        return _setHandleError(handle, ERROR_RELAY_INVALID_PARAMETER, 0);
+    }
+
+    // 2. Open the bus of the port using default serial configuration and set the timeout of the
+    // slave. If another handle (RRG or relay) already uses the port, its bus is reused.
+    MB_DeviceConfig device_config = {{config->port, config->baudrate, RELAY_DEFAULT_PARITY, RELAY_DEFAULT_DATA_BITS,
+                                      RELAY_DEFAULT_STOP_BITS, config->timeout, config->transport, config->arena},
+                                     config->slave_id,
+                                     config->adaptive_timeout,
+                                     MODBUS_REGISTER_TURN_ON_OFF,
+                                     config->probe_timeout};
+    MB_Bus *bus = NULL;
+    if (MB_DeviceOpen(&device_config, &bus) != MB_OK)
+        return _setHandleError(handle, _fromBusError(MB_GetLastErrorCode()), errno);
+
+    // 3. Attach the handle; it takes its own reference, so the one from `MB_BusOpen()` is dropped.
+    int status = RELAY_Attach(bus, config->slave_id, handle);
+    MB_BusClose(bus);
+    if (status != RELAY_OK)
+        return status;
+    handle->arena = config->arena;
+
+    // 4. Enable the write cache if requested.
+    if (config->write_cache && RELAY_SetWriteCache(handle, 1, config->write_cache_refresh_ms) != RELAY_OK)
         return RELAY_ERR;
+
+    // 5. Bypass libmodbus if requested and possible; libmodbus still works on any port.
+    if (config->fast_transport && RELAY_SetFastTransport(handle, 1) != RELAY_OK)
+    {
+        RELAY_DEBUG_MSG("Fast RTU transport unavailable, using libmodbus")
+        return _setHandleError(handle, RELAY_OK, 0);
     }
+    return RELAY_OK;
+}
 
-    // 4. Configure response timeout and check for errors.
-    if (unlikely(modbus_set_response_timeout(ctx, 0, config->timeout * 1000) == MODBUS_ERR))
+int RELAY_Attach(MB_Bus *RELAY_RESTRICT bus, int slave_id, Relay_Handle *RELAY_RESTRICT handle)
+{
+    // 1. Validate input parameters.
+    RELAY_CHECK_PTR_WITH_RETURN(bus);
+    RELAY_CHECK_PTR_WITH_RETURN(handle);
+    if (unlikely(slave_id < 0 || slave_id > MB_MAX_SLAVE_ID))
     {
-        RELAY_MODBUS_DEBUG_MSG;
-        modbus_free(ctx);
-        _setGlobalError(ERROR_RELAY_FAILED_SET_TIMEOUT);
-        return RELAY_ERR;
+        RELAY_DEBUG_MSG("Slave ID is out of range")
+        return _setHandleError(handle, ERROR_RELAY_FAILED_SET_SLAVE, 0);
     }
 
-    // 5. Attempt to connect to the MODBUS device.
-    if (modbus_connect(ctx) == MODBUS_ERR)
+    // 2. Bind the handle to the bus and keep the bus alive while the handle exists.
+    MB_BusRetain(bus);
+    handle->bus = bus;
+    handle->modbus_ctx = MB_BusGetContext(bus);
+    handle->slave_id = slave_id;
+    handle->rtu_frame = NULL;
+    handle->arena = NULL;
+    handle->fast_transport = 0;
+    handle->write_cache = 0;
+    handle->cache_refresh_ns = 0;
+    _invalidateWriteCache(handle);
+    memset(&handle->stats, 0, sizeof(handle->stats));
+    return _setHandleError(handle, RELAY_OK, 0);
+}
+
+int RELAY_SetWriteCache(Relay_Handle *RELAY_RESTRICT handle, int enabled, int refresh_ms)
+{
+    // 1. Validate input parameters.
+    RELAY_CHECK_PTR_WITH_RETURN(handle);
+    if (unlikely(refresh_ms < 0))
     {
-        RELAY_MODBUS_DEBUG_MSG;
-        modbus_free(ctx);
-        _setGlobalError(ERROR_RELAY_FAILED_CONNECT);
-        return RELAY_ERR;
+        RELAY_DEBUG_MSG("Write cache refresh interval must not be negative")
+        return _setHandleError(handle, ERROR_RELAY_INVALID_PARAMETER, 0);
     }
 
-    // 6. Store the context in the handle and check it on NULL.
-    handle->modbus_ctx = ctx;
-    RELAY_CHECK_PTR_WITH_RETURN(handle->modbus_ctx);
+    // 2. Start from an empty cache: states written while it was disabled are not tracked.
+    handle->write_cache = 0;
+    _invalidateWriteCache(handle);
+    handle->cache_refresh_ns = refresh_ms * 1000000LL;
+    handle->write_cache = enabled != 0;
+    return _setHandleError(handle, RELAY_OK, 0);
+}
 
-    _resetGlobalError();
-    return RELAY_OK;
+void RELAY_InvalidateWriteCache(Relay_Handle *RELAY_RESTRICT handle)
+{
+    if (handle)
+        _invalidateWriteCache(handle);
 }
 
-int RELAY_TurnOn(Relay_Handle *RELAY_RESTRICT handle)
+int RELAY_SetFastTransport(Relay_Handle *RELAY_RESTRICT handle, int enabled)
 {
     // 1. Validate input parameters.
     RELAY_CHECK_PTR_WITH_RETURN(handle);
-    RELAY_CHECK_PTR_WITH_RETURN(handle->modbus_ctx);
+    RELAY_CHECK_PTR_WITH_RETURN(handle->bus);
+    if (!enabled)
+    {
+        _mbAtomicStoreInt(&handle->fast_transport, 0);
+        return _setHandleError(handle, RELAY_OK, 0);
+    }
 
-    // 2. Write 1 to MODBUS register 512.
-    if (modbus_write_register(handle->modbus_ctx, MODBUS_REGISTER_TURN_ON_OFF, 1) == MODBUS_ERR)
+    // 2. The bus must be able to drive its port directly.
+    if (MB_BusEnableFastRtu(handle->bus) != MB_OK)
+        return _setHandleError(handle, _fromBusError(MB_GetLastErrorCode()), 0);
+
+    // 3. Prepare the template once; it stays valid until the handle is closed.
+    if (!handle->rtu_frame)
     {
-        RELAY_MODBUS_DEBUG_MSG;
-        _setGlobalError(ERROR_RELAY_FAILED_WRITE_REGISTER);
-        return RELAY_ERR;
+        MB_RtuFrame *frame = _mbAlloc(handle->arena, sizeof(*frame));
+        if (unlikely(!frame))
+            return _setHandleError(handle, ERROR_RELAY_FAILED_CREATE_CONTEXT, 0);
+        MB_RtuPrepareWrite(frame, handle->slave_id, RELAY_REGISTER_STATE.address, RELAY_REGISTER_STATE.width, 0);
+        handle->rtu_frame = frame;
     }
+    _mbAtomicStoreInt(&handle->fast_transport, 1);
+    return _setHandleError(handle, RELAY_OK, 0);
+}
 
-    // 3. If everything is fine after modbus operation, resetting global error code to 0.
-    _resetGlobalError();
-    return RELAY_OK;
+int RELAY_TurnOn(Relay_Handle *RELAY_RESTRICT handle)
+{
+    // 1. Validate input parameters.
+    RELAY_CHECK_PTR_WITH_RETURN(handle);
+    RELAY_CHECK_PTR_WITH_RETURN(handle->bus);
+
+    // 2. Write 1 to MODBUS register 512.
+    return _writeState(handle, 1);
 }
 
 int RELAY_TurnOff(Relay_Handle *RELAY_RESTRICT handle)
 {
     // 1. Validate input parameters.
     RELAY_CHECK_PTR_WITH_RETURN(handle);
-    RELAY_CHECK_PTR_WITH_RETURN(handle->modbus_ctx);
+    RELAY_CHECK_PTR_WITH_RETURN(handle->bus);
 
     // 2. Write 0 to MODBUS register 512.
-    if (modbus_write_register(handle->modbus_ctx, MODBUS_REGISTER_TURN_ON_OFF, 0) == MODBUS_ERR)
+    return _writeState(handle, 0);
+}
+
+/// @brief Executes an asynchronous request on the I/O worker of the bus.
+static void _requestJob(void *payload, uint64_t request_id, int status)
+{
+    Relay_Request *request = payload;
+    Relay_Handle *handle = request->handle;
+
+    // 1. Run the write in its own transaction, like the synchronous call would
+    // (a state the relay already holds is skipped the same way).
+    int error_code;
+    modbus_t *ctx = status == MB_OK
+                        ? MB_BusBeginTransaction(handle->bus, handle->slave_id, _statePriority(request->value), 0)
+                        : NULL;
+    if (unlikely(!ctx))
+        error_code = _fromBusError(status == MB_OK ? MB_GetLastErrorCode() : status);
+    else if (_isShadowed(handle, request->value))
     {
-        RELAY_MODBUS_DEBUG_MSG;
-        _setGlobalError(ERROR_RELAY_FAILED_WRITE_REGISTER);
-        return RELAY_ERR;
+        error_code = RELAY_OK;
+        _skipTransaction(handle);
+    }
+    else
+    {
+        error_code = _writeRegister(handle, request->value);
+        _finishTransaction(handle, request->value, error_code);
     }
+    if (error_code != RELAY_OK)
+        _invalidateWriteCache(handle);
 
-    // 3. If everything is fine after modbus operation, resetting global error code to 0.
-    _resetGlobalError();
-    return RELAY_OK;
+    // 2. Report the outcome after the bus is released, so the callback may submit more work.
+    if (request->callback)
+        request->callback(handle, request_id, error_code, request->user_data);
+}
+
+/// @brief Queues a state change to the I/O worker of the handle's bus and records the outcome of the submission.
+static int _submitState(Relay_Handle *RELAY_RESTRICT handle, uint16_t value, Relay_Callback callback,
+                        void *user_data, uint64_t *RELAY_RESTRICT request_id)
+{
+    Relay_Request request = {handle, value, callback, user_data};
+    if (MB_BusSubmit(handle->bus, _requestJob, &request, sizeof(request), _statePriority(value), 0, request_id) !=
+        MB_OK)
+        return _setHandleError(handle, _fromBusError(MB_GetLastErrorCode()), 0);
+    return _setHandleError(handle, RELAY_OK, 0);
+}
+
+int RELAY_TurnOnAsync(Relay_Handle *RELAY_RESTRICT handle, Relay_Callback callback, void *user_data,
+                      uint64_t *RELAY_RESTRICT request_id)
+{
+    // 1. Validate input parameters.
+    RELAY_CHECK_PTR_WITH_RETURN(handle);
+    RELAY_CHECK_PTR_WITH_RETURN(handle->bus);
+
+    // 2. Queue the write of 1 to MODBUS register 512.
+    return _submitState(handle, 1, callback, user_data, request_id);
+}
+
+int RELAY_TurnOffAsync(Relay_Handle *RELAY_RESTRICT handle, Relay_Callback callback, void *user_data,
+                       uint64_t *RELAY_RESTRICT request_id)
+{
+    // 1. Validate input parameters.
+    RELAY_CHECK_PTR_WITH_RETURN(handle);
+    RELAY_CHECK_PTR_WITH_RETURN(handle->bus);
+
+    // 2. Queue the write of 0 to MODBUS register 512.
+    return _submitState(handle, 0, callback, user_data, request_id);
+}
+
+int RELAY_Wait(Relay_Handle *RELAY_RESTRICT handle, uint64_t request_id)
+{
+    // 1. Validate input parameters.
+    RELAY_CHECK_PTR_WITH_RETURN(handle);
+    RELAY_CHECK_PTR_WITH_RETURN(handle->bus);
+
+    // 2. Block until the worker has gone past the request.
+    if (MB_BusWait(handle->bus, request_id) != MB_OK)
+        return _setHandleError(handle, ERROR_RELAY_INVALID_PARAMETER, 0);
+    return _setHandleError(handle, RELAY_OK, 0);
 }
 
 void RELAY_Close(Relay_Handle *RELAY_RESTRICT handle)
 {
-    if (handle && handle->modbus_ctx)
+    if (handle && handle->bus)
+    {
+        // Queued requests point to the handle: let them complete before it goes away.
+        MB_BusFlush(handle->bus);
+
+        // The port itself is closed only when no other handle is attached to the bus.
+        MB_BusClose(handle->bus);
+        handle->bus = NULL;
+        handle->modbus_ctx = NULL;
+    }
+    if (handle)
     {
-        modbus_close(handle->modbus_ctx);
-        modbus_free(handle->modbus_ctx);
+        _mbFree(handle->arena, handle->rtu_frame);
+        handle->rtu_frame = NULL;
+        handle->fast_transport = 0;
     }
 }
 
-const char *RELAY_GetLastError()
+int RELAY_GetStats(const Relay_Handle *RELAY_RESTRICT handle, Relay_Stats *RELAY_RESTRICT stats)
 {
-    switch (RELAY_GlobalError)
+    // 1. Validate input parameters.
+    RELAY_CHECK_PTR_WITH_RETURN(handle);
+    RELAY_CHECK_PTR_WITH_RETURN(stats);
+
+    // 2. Copy the counters one by one; the I/O worker may be updating them.
+    _mbLoadCounters((uint64_t *)stats, (const uint64_t *)&handle->stats, sizeof(*stats) / sizeof(uint64_t));
+    return RELAY_OK;
+}
+
+void RELAY_ResetStats(Relay_Handle *RELAY_RESTRICT handle)
+{
+    if (handle)
+        _mbResetCounters((uint64_t *)&handle->stats, sizeof(handle->stats) / sizeof(uint64_t));
+}
+
+/// @brief Returns the description of a relay error code.
+static const char *_errorToString(int error_code)
+{
+    switch (error_code)
     {
     case RELAY_OK:
         return "No error.";
@@ -127,7 +423,33 @@ const char *RELAY_GetLastError()
         return "Error: Failed to write a MODBUS register.";
     case ERROR_RELAY_INVALID_PARAMETER:
         return "Error: Invalid parameter provided to function.";
+    case ERROR_RELAY_PORT_CONFIG_MISMATCH:
+        return "Error: Port is already open with different settings or from another arena.";
+    case ERROR_RELAY_QUEUE_FULL:
+        return "Error: The request queue of the bus is full.";
+    case ERROR_RELAY_FAILED_START_WORKER:
+        return "Error: Failed to start the I/O worker thread of the bus.";
+    case ERROR_RELAY_LINK_DOWN:
+        return "Error: The port or gateway connection was lost; the bus is reconnecting.";
+    case ERROR_RELAY_NOT_SUPPORTED:
+        return "Error: The port cannot be driven by the fast RTU transport.";
+    case ERROR_RELAY_NO_RESPONSE:
+        return "Error: The relay did not answer the probe request.";
     default:
         return "Unknown error occurred.";
     }
 }
+
+const char *RELAY_GetLastError() { return _errorToString(RELAY_GlobalError); }
+
+const char *RELAY_GetLastErrorEx(const Relay_Handle *RELAY_RESTRICT handle)
+{
+    return _errorToString(handle ? _mbAtomicLoadInt(&handle->last_error) : ERROR_RELAY_INVALID_PARAMETER);
+}
+
+int RELAY_GetLastErrorCodeEx(const Relay_Handle *RELAY_RESTRICT handle, int *RELAY_RESTRICT modbus_errno)
+{
+    if (modbus_errno)
+        *modbus_errno = handle ? _mbAtomicLoadInt(&handle->last_modbus_errno) : 0;
+    return handle ? _mbAtomicLoadInt(&handle->last_error) : ERROR_RELAY_INVALID_PARAMETER;
+}
@@ -4,149 +4,1875 @@
 #include <modbus/modbus.h>
 #endif
 
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "rrg.h"
 #include "rrg_constants.h"
+#include "mb_alloc.h"
+#include "mb_bus.h"
+#include "mb_device_io.h"
+#include "mb_platform.h"
+#include "mb_ring.h"
 
-// Global error variable definition.
-int RRG_GlobalError = RRG_OK;
+// Thread-local error variable definition.
+RRG_THREAD_LOCAL int RRG_GlobalError = RRG_OK;
 
-int RRG_Init(const RRG_Config *RRG_RESTRICT config, RRG_Handle *RRG_RESTRICT handle)
+/**
+ * @enum RRG_Register
+ * @brief Entries of the register map of the regulator, in address order.
+ */
+typedef enum
 {
-    // 1. Validate input parameters.
-    RRG_CHECK_PTR_WITH_RETURN(config);
-    RRG_CHECK_PTR_WITH_RETURN(handle);
+    RRG_REGISTER_SETPOINT,
+    RRG_REGISTER_GAS,
+    RRG_REGISTER_STATUS,
+    RRG_REGISTER_FLOW,
+    RRG_REGISTER_COUNT
+} RRG_Register;
+
+/// @brief Register map of the regulator: flow values are signed 32-bit integers in thousandths of SCCM.
+static const MB_RegisterDesc RRG_REGISTERS[RRG_REGISTER_COUNT] = {
+    [RRG_REGISTER_SETPOINT] = {MODBUS_REGISTER_SETPOINT, MODBUS_SETPOINT_REGISTERS_COUNT,
+                               MB_REGISTER_RW | MB_REGISTER_SIGNED, 1000},
+    [RRG_REGISTER_GAS] = {MODBUS_REGISTER_GAS, 1, MB_REGISTER_RW, 1},
+    [RRG_REGISTER_STATUS] = {MODBUS_REGISTER_STATUS, 1, MB_REGISTER_READ, 1},
+    [RRG_REGISTER_FLOW] = {MODBUS_REGISTER_FLOW, MODBUS_FLOW_REGISTERS_COUNT,
+                           MB_REGISTER_READ | MB_REGISTER_SIGNED, 1000},
+};
+
+/// @brief Bit of a register map entry in the `fields` of a read plan.
+#define RRG_FIELD(reg) (1u << (reg))
+
+/**
+ * @struct RRG_RtuFrames
+ * @brief Request templates of the hot operations for the fast RTU transport.
+ */
+typedef struct
+{
+    MB_RtuFrame flow;             ///< Read of the measured flow (registers 2103-2104).
+    MB_RtuFrame setpoint;         ///< "Write Multiple Registers" of the setpoint pair.
+    MB_RtuFrame setpoint_half[2]; ///< "Write Single Register" of each half, for devices without 0x10.
+    MB_RtuFrame gas;              ///< Write of the gas type register.
+} RRG_RtuFrames;
+
+/**
+ * @struct RRG_Acquisition
+ * @brief State of the background acquisition engine of one handle.
+ */
+typedef struct
+{
+    MB_Ring ring;                         ///< SPSC ring of `RRG_Sample`, drained by `RRG_DrainSamples()`.
+    MB_Thread thread;                     ///< Polling thread.
+    int running;                          ///< Non-zero while the thread must keep polling (accessed atomically).
+    int64_t period_ns;                    ///< Sampling period.
+    RRG_Handle *handle;                   ///< Handle the thread polls.
+    MB_Log *log;                          ///< Log of the samples (`NULL`: none), fixed while the thread runs.
+    int filter_enabled;                   ///< Non-zero when the samples passing `filter` are reported as changes.
+    RRG_ChangeFilter filter;              ///< Change filter, fixed while the thread runs.
+    MB_Ring changes;                      ///< SPSC ring of `RRG_FlowChange` (filter only), see `RRG_DrainChanges()`.
+    MB_ReadSpan read;                     ///< Registers of one read: the flow, after the status with an interlock.
+    int flow_offset;                      ///< Position of the flow registers in `read`.
+    int status_offset;                    ///< Position of the status register in `read` (-1 without an interlock).
+    int interlock_enabled;                ///< Non-zero when `interlock` is armed.
+    RRG_Interlock interlock;              ///< Interlock, fixed while the thread runs.
+    int64_t fault_period_ns;              ///< Sampling period while a fault is suspected.
+    MB_Mutex interlock_lock;              ///< Protects `interlock_status`.
+    RRG_InterlockStatus interlock_status; ///< State of the interlock, updated by the thread.
+} RRG_Acquisition;
+
+/**
+ * @struct RRG_ChangeState
+ * @brief What the change filter of the acquisition thread compares each sample with.
+ */
+typedef struct
+{
+    RRG_Sample reported; ///< Last reported sample.
+    RRG_Sample previous; ///< Previous successful sample, the base of the slope.
+    int has_reported;    ///< Non-zero once a sample was reported.
+    int has_previous;    ///< Non-zero once a sample succeeded.
+} RRG_ChangeState;
+
+/**
+ * @struct RRG_Ramp
+ * @brief State of the setpoint ramp engine of one handle.
+ */
+typedef struct
+{
+    MB_Ring ring;           ///< SPSC ring of `RRG_RampTick`: the thread produces, `RRG_DrainRampTicks()` consumes.
+    MB_Thread thread;       ///< Ramp thread.
+    int running;            ///< Non-zero while the thread must keep streaming (accessed atomically).
+    int joinable;           ///< Non-zero until the thread is joined.
+    int64_t tick_ns;        ///< Control tick.
+    int interpolation;      ///< `RRG_RAMP_LINEAR` or `RRG_RAMP_STEP`.
+    int read_every;         ///< Ticks between two flow reads (0: never).
+    int point_count;        ///< Number of points of the profile.
+    RRG_RampPoint *points;  ///< Copy of the profile.
+    RRG_Handle *handle;     ///< Handle the thread drives.
+    MB_Mutex status_lock;   ///< Protects `status` and the sums.
+    RRG_RampStatus status;  ///< Statistics, without the averages.
+    double late_sum_ns;     ///< Sum of the wake-up lateness of all ticks.
+    double abs_error_sum;   ///< Sum of the absolute tracking errors of all reads.
+} RRG_Ramp;
+
+/**
+ * @enum RRG_RequestOp
+ * @brief Operations that can be queued with the `RRG_*Async()` functions.
+ */
+typedef enum
+{
+    RRG_REQUEST_SET_FLOW,
+    RRG_REQUEST_GET_FLOW,
+    RRG_REQUEST_SET_GAS
+} RRG_RequestOp;
+
+/**
+ * @struct RRG_Request
+ * @brief Payload of an asynchronous request, copied into the bus queue.
+ */
+typedef struct
+{
+    RRG_Handle *handle;    ///< Handle the request was submitted through.
+    RRG_RequestOp op;      ///< Operation to perform.
+    float value;           ///< Setpoint for `RRG_REQUEST_SET_FLOW`.
+    int gas_id;            ///< Gas ID for `RRG_REQUEST_SET_GAS`.
+    int64_t deadline_ns;   ///< Monotonic time after which the request is dropped (0 for none).
+    RRG_Callback callback; ///< Completion callback (may be `NULL`).
+    void *user_data;       ///< Pointer passed to the callback.
+} RRG_Request;
+
+/// @brief Converts a big-endian register pair (high word first) into a value in SCCM.
+static inline float _registersToFlow(const uint16_t *RRG_RESTRICT regs)
+{
+    return (float)_mbRegisterDecode(&RRG_REGISTERS[RRG_REGISTER_FLOW], regs);
+}
+
+/// @brief Translates an `ERROR_MB_*` code into the matching RRG error code.
+static int _fromBusError(int bus_error)
+{
+    switch (bus_error)
+    {
+    case ERROR_MB_FAILED_CONNECT:
+        return ERROR_RRG_FAILED_CONNECT;
+    case ERROR_MB_FAILED_CREATE_CONTEXT:
+    case ERROR_MB_OUT_OF_MEMORY:
+        return ERROR_RRG_FAILED_CREATE_CONTEXT;
+    case ERROR_MB_FAILED_SET_SLAVE:
+        return ERROR_RRG_FAILED_SET_SLAVE;
+    case ERROR_MB_FAILED_SET_TIMEOUT:
+        return ERROR_RRG_FAILED_SET_TIMEOUT;
+    case ERROR_MB_CONFIG_MISMATCH:
+        return ERROR_RRG_PORT_CONFIG_MISMATCH;
+    case ERROR_MB_QUEUE_FULL:
+        return ERROR_RRG_QUEUE_FULL;
+    case ERROR_MB_FAILED_START_WORKER:
+        return ERROR_RRG_FAILED_START_WORKER;
+    case ERROR_MB_DEADLINE_EXPIRED:
+        return ERROR_RRG_DEADLINE_EXPIRED;
+    case ERROR_MB_LINK_DOWN:
+        return ERROR_RRG_LINK_DOWN;
+    case ERROR_MB_NOT_SUPPORTED:
+        return ERROR_RRG_NOT_SUPPORTED;
+    case ERROR_MB_NO_RESPONSE:
+        return ERROR_RRG_NO_RESPONSE;
+    default:
+        return ERROR_RRG_INVALID_PARAMETER;
+    }
+}
+
+/// @brief Forgets the shadow registers: the next writes reach the device.
+static inline void _invalidateWriteCache(RRG_Handle *RRG_RESTRICT handle)
+{
+    _mbShadowInvalidate(&handle->shadow_setpoint);
+    _mbShadowInvalidate(&handle->shadow_gas);
+}
 
-    // 2. Initialize MODBUS-RTU context using default serial configuration.
-    modbus_t *ctx = modbus_new_rtu(
-        config->port, config->baudrate, RRG_DEFAULT_PARITY,
-        RRG_DEFAULT_DATA_BITS, RRG_DEFAULT_STOP_BITS);
+/// @brief Returns non-zero if the device is known to hold `regs` already, so writing them can be skipped.
+static inline int _isShadowed(const RRG_Handle *RRG_RESTRICT handle, const RRG_ShadowRegister *RRG_RESTRICT shadow,
+                              const uint16_t *RRG_RESTRICT regs, int count)
+{
+    return handle->write_cache && _mbShadowMatches(shadow, handle->cache_refresh_ns, regs, count);
+}
+
+/// @brief Stores a value confirmed by the device (written or read back) in a shadow register.
+static inline void _updateShadow(const RRG_Handle *RRG_RESTRICT handle, RRG_ShadowRegister *RRG_RESTRICT shadow,
+                                 const uint16_t *RRG_RESTRICT regs, int count)
+{
+    if (handle->write_cache)
+        _mbShadowUpdate(shadow, regs, count);
+}
+
+/// @brief Records the outcome of an operation in the handle and in the calling thread's error.
+/// After a failure the state of the device is unknown, so the write cache is invalidated as well.
+static inline int _setHandleError(RRG_Handle *RRG_RESTRICT handle, int error_code, int modbus_errno)
+{
+    if (error_code != RRG_OK)
+        _invalidateWriteCache(handle);
+    _mbAtomicStoreInt(&handle->last_modbus_errno, error_code == RRG_OK ? 0 : modbus_errno);
+    _mbAtomicStoreInt(&handle->last_error, error_code);
+    _setGlobalError(error_code);
+    return error_code == RRG_OK ? RRG_OK : RRG_ERR;
+}
+
+/// @brief Starts a bus transaction of the given `MB_PRIORITY_*` class for the handle's slave,
+/// recording the error on failure.
+static inline modbus_t *_beginTransaction(RRG_Handle *RRG_RESTRICT handle, int priority)
+{
+    modbus_t *ctx = MB_BusBeginTransaction(handle->bus, handle->slave_id, priority, 0);
     if (unlikely(!ctx))
+        _setHandleError(handle, _fromBusError(MB_GetLastErrorCode()), errno);
+    return ctx;
+}
+
+/// @brief Ends a transaction made on the line without touching the handle's error, and counts it under `op`.
+static inline void _finishTransaction(RRG_Handle *RRG_RESTRICT handle, int op, int error_code)
+{
+    _mbFinishTransaction(handle->bus, &handle->stats.traffic, &handle->stats.latency[op], error_code == RRG_OK);
+}
+
+/// @brief Records the outcome of the transaction and ends it.
+/// The outcome is stored while the bus is still held, so `errno` still belongs to the request.
+static inline int _endTransaction(RRG_Handle *RRG_RESTRICT handle, int op, int error_code)
+{
+    int status = _setHandleError(handle, error_code, errno);
+    _finishTransaction(handle, op, error_code);
+    return status;
+}
+
+/// @brief Ends a transaction in which the write cache made every request unnecessary.
+static inline int _skipTransaction(RRG_Handle *RRG_RESTRICT handle)
+{
+    int status = _setHandleError(handle, RRG_OK, 0);
+    _mbSkipTransaction(handle->bus, &handle->stats.traffic);
+    return status;
+}
+
+/// @brief Returns the request templates if the handle uses the fast RTU transport, `NULL` for libmodbus.
+static inline RRG_RtuFrames *_rtuFrames(RRG_Handle *RRG_RESTRICT handle)
+{
+    return _mbAtomicLoadInt(&handle->fast_transport) ? handle->rtu_frames : NULL;
+}
+
+/// @brief Writes the setpoint register pair within an open transaction. Returns `RRG_OK` or an error code.
+static int _writeSetpoint(RRG_Handle *RRG_RESTRICT handle, const uint16_t *RRG_RESTRICT regs)
+{
+    MB_TrafficCounters *traffic = &handle->stats.traffic;
+    RRG_RtuFrames *frames = _rtuFrames(handle);
+    const MB_RegisterDesc *desc = &RRG_REGISTERS[RRG_REGISTER_SETPOINT];
+
+    // Function code 0x10 updates both halves atomically on the device side.
+    if (handle->setpoint_write_mode != RRG_SETPOINT_WRITE_MODE_SINGLE)
     {
-        RRG_MODBUS_DEBUG_MSG;
-        _setGlobalError(ERROR_RRG_FAILED_CREATE_CONTEXT);
-        return RRG_ERR;
+        if (frames ? _mbRtuRequest(handle->bus, traffic, &frames->setpoint, regs, NULL)
+                   : _mbWriteRegisters(handle->bus, traffic, desc->address, desc->width, regs))
+        {
+            _updateShadow(handle, &handle->shadow_setpoint, regs, desc->width);
+            return RRG_OK;
+        }
+
+        // Only an "Illegal Function" exception in auto mode justifies the fallback:
+        // any other failure (timeout, CRC, ...) is reported as is.
+        if (handle->setpoint_write_mode != RRG_SETPOINT_WRITE_MODE_AUTO || errno != EMBXILFUN)
+        {
+            RRG_MODBUS_DEBUG_MSG;
+            return ERROR_RRG_FAILED_WRITE_REGISTER;
+        }
+
+        RRG_DEBUG_MSG("Device rejected function code 0x10, falling back to single register writes")
+        handle->setpoint_write_mode = RRG_SETPOINT_WRITE_MODE_SINGLE;
+        _mbAtomicIncU64(&traffic->retries);
     }
 
-    // 3. Set MODBUS slave ID and check for errors.
-    if (unlikely(modbus_set_slave(ctx, config->slave_id) == MODBUS_ERR))
+    // Fallback: write the two halves with separate "Write Single Register" requests.
+    for (int i = 0; i < desc->width; ++i)
     {
-        RRG_MODBUS_DEBUG_MSG;
-        modbus_free(ctx);
-        _setGlobalError(ERROR_RRG_FAILED_SET_SLAVE);
-        return RRG_ERR;
+        if (!(frames ? _mbRtuRequest(handle->bus, traffic, &frames->setpoint_half[i], &regs[i], NULL)
+                     : _mbWriteRegister(handle->bus, traffic, desc->address + i, regs[i])))
+        {
+            RRG_MODBUS_DEBUG_MSG;
+            return ERROR_RRG_FAILED_WRITE_REGISTER;
+        }
     }
+    _updateShadow(handle, &handle->shadow_setpoint, regs, desc->width);
+    return RRG_OK;
+}
 
-    // 4. Configure response timeout and check for errors.
-    if (unlikely(modbus_set_response_timeout(ctx, 0, config->timeout * 1000) == MODBUS_ERR))
+/// @brief Reads `count` registers starting at `addr` within an open transaction. Returns `RRG_OK` or an error code.
+static inline int _readRegisters(RRG_Handle *RRG_RESTRICT handle, int addr, int count, uint16_t *RRG_RESTRICT dest)
+{
+    if (!_mbReadRegisters(handle->bus, &handle->stats.traffic, addr, count, dest))
     {
         RRG_MODBUS_DEBUG_MSG;
-        modbus_free(ctx);
-        _setGlobalError(ERROR_RRG_FAILED_SET_TIMEOUT);
-        return RRG_ERR;
+        return ERROR_RRG_FAILED_READ_REGISTER;
     }
+    return RRG_OK;
+}
 
-    // 5. Attempt to connect to the MODBUS device.
-    if (modbus_connect(ctx) == MODBUS_ERR)
+/// @brief Reads the 32-bit flow value from registers 2103-2104 within an open transaction.
+static inline int _readFlow(RRG_Handle *RRG_RESTRICT handle, float *RRG_RESTRICT flow)
+{
+    uint16_t data[MODBUS_FLOW_REGISTERS_COUNT];
+    RRG_RtuFrames *frames = _rtuFrames(handle);
+    int error_code = RRG_OK;
+    if (!frames)
+        error_code = _readRegisters(handle, MODBUS_REGISTER_FLOW, MODBUS_FLOW_REGISTERS_COUNT, data);
+    else if (!_mbRtuRequest(handle->bus, &handle->stats.traffic, &frames->flow, NULL, data))
     {
         RRG_MODBUS_DEBUG_MSG;
-        modbus_free(ctx);
-        _setGlobalError(ERROR_RRG_FAILED_CONNECT);
-        return RRG_ERR;
+        error_code = ERROR_RRG_FAILED_READ_REGISTER;
     }
+    if (error_code == RRG_OK)
+        *flow = _registersToFlow(data);
+    return error_code;
+}
 
-    // 6. Store the context in the handle and check it on NULL.
-    handle->modbus_ctx = ctx;
-    RRG_CHECK_PTR_WITH_RETURN(handle->modbus_ctx);
+/// @brief Converts a setpoint in SCCM into the big-endian register pair (high word first).
+static inline void _setpointToRegisters(float setpoint, uint16_t *RRG_RESTRICT regs)
+{
+    // The MODBUS protocol stores 32-bit values across two 16-bit registers, high word first,
+    // here as an integer with three decimal places.
+    _mbRegisterEncode(&RRG_REGISTERS[RRG_REGISTER_SETPOINT], setpoint, regs);
+}
 
-    _resetGlobalError();
+/// @brief Writes the gas ID register within an open transaction. Returns `RRG_OK` or an error code.
+static inline int _writeGas(RRG_Handle *RRG_RESTRICT handle, uint16_t gas_reg)
+{
+    RRG_RtuFrames *frames = _rtuFrames(handle);
+    if (!(frames ? _mbRtuRequest(handle->bus, &handle->stats.traffic, &frames->gas, &gas_reg, NULL)
+                 : _mbWriteRegister(handle->bus, &handle->stats.traffic, MODBUS_REGISTER_GAS, gas_reg)))
+    {
+        RRG_MODBUS_DEBUG_MSG;
+        return ERROR_RRG_FAILED_WRITE_REGISTER;
+    }
+    _updateShadow(handle, &handle->shadow_gas, &gas_reg, 1);
     return RRG_OK;
 }
 
-int RRG_SetFlow(RRG_Handle *RRG_RESTRICT handle, float setpoint)
+/// @brief Remembers the value last commanded to a register (pair), before it is sent, so that it
+/// can be written again after the bus reopens a lost port.
+static inline void _rememberCommand(int64_t *RRG_RESTRICT command, const uint16_t *RRG_RESTRICT regs, int count)
+{
+    uint32_t value = count > 1 ? ((uint32_t)regs[0] << 16) | regs[1] : regs[0];
+    _mbAtomicStoreReleaseI64(command, ((int64_t)1 << 32) | value);
+}
+
+/// @brief Bus listener: writes the last commanded gas and setpoint back once the bus has reopened
+/// a lost port. The regulator may have lost power with the adapter, so nothing it held is trusted.
+static void _restoreCommands(void *user_data)
+{
+    RRG_Handle *handle = user_data;
+    _invalidateWriteCache(handle);
+    int64_t gas = _mbAtomicLoadAcquireI64(&handle->command_gas);
+    int64_t setpoint = _mbAtomicLoadAcquireI64(&handle->command_setpoint);
+    if (!gas && !setpoint)
+        return;
+
+    // The handle's error belongs to the application's calls: the outcome only shows in the statistics.
+    modbus_t *ctx = MB_BusBeginTransaction(handle->bus, handle->slave_id, MB_PRIORITY_SETPOINT, 0);
+    if (!ctx)
+        return;
+    int error_code = gas ? _writeGas(handle, (uint16_t)gas) : RRG_OK;
+    if (setpoint && error_code == RRG_OK)
+    {
+        uint16_t regs[MODBUS_SETPOINT_REGISTERS_COUNT] = {(uint16_t)(setpoint >> 16), (uint16_t)setpoint};
+        error_code = _writeSetpoint(handle, regs);
+    }
+    _finishTransaction(handle, gas && !setpoint ? RRG_STATS_OP_SET_GAS : RRG_STATS_OP_SET_FLOW, error_code);
+    if (error_code != RRG_OK)
+        _invalidateWriteCache(handle);
+}
+
+/// @brief Allocates an idle acquisition engine with its sample ring and, if `with_changes` is
+/// non-zero, its change ring, from the arena of the handle when it has one.
+static RRG_Acquisition *_allocAcquisition(RRG_Handle *RRG_RESTRICT handle, int with_changes)
+{
+    RRG_Acquisition *acq = _mbAlloc(handle->arena, sizeof(*acq));
+    if (unlikely(!acq))
+        return NULL;
+    if (unlikely(_mbRingInit(&acq->ring, sizeof(RRG_Sample), RRG_DEFAULT_ACQUISITION_CAPACITY, handle->arena) != 0 ||
+                 (with_changes && _mbRingInit(&acq->changes, sizeof(RRG_FlowChange), RRG_DEFAULT_CHANGE_CAPACITY,
+                                              handle->arena) != 0)))
+    {
+        _mbRingDestroy(&acq->ring);
+        _mbFree(handle->arena, acq);
+        return NULL;
+    }
+    _mbMutexInit(&acq->interlock_lock);
+    return acq;
+}
+
+int RRG_Init(const RRG_Config *RRG_RESTRICT config, RRG_Handle *RRG_RESTRICT handle)
 {
     // 1. Validate input parameters.
+    RRG_CHECK_PTR_WITH_RETURN(config);
     RRG_CHECK_PTR_WITH_RETURN(handle);
-    RRG_CHECK_PTR_WITH_RETURN(handle->modbus_ctx);
+    if (unlikely(config->setpoint_write_mode < RRG_SETPOINT_WRITE_MODE_AUTO ||
+                 config->setpoint_write_mode > RRG_SETPOINT_WRITE_MODE_SINGLE))
+    {
+        RRG_DEBUG_MSG("Unknown setpoint write mode")
+        return _setHandleError(handle, ERROR_RRG_INVALID_PARAMETER, 0);
+    }
+    if (unlikely(config->write_cache_refresh_ms < 0))
+    {
+        RRG_DEBUG_MSG("Write cache refresh interval must not be negative")
+        return _setHandleError(handle, ERROR_RRG_INVALID_PARAMETER, 0);
+    }
+    if (unlikely(config->slave_id < 0 || config->slave_id > MB_MAX_SLAVE_ID))
+    {
+        RRG_DEBUG_MSG("Slave ID is out of range")
+        return _setHandleError(handle, ERROR_RRG_FAILED_SET_SLAVE, 0);
+    }
 
-    // 2. Convert the floating-point setpoint value to an integer representation.
-    // The MODBUS protocol stores 32-bit values across two 16-bit registers.
-    // - The high 16 bits (most significant) are stored in one register.
-    // - The low 16 bits (least significant) are stored in another register.
-    int value = (int)(setpoint * 1000), // Convert setpoint to an integer with three decimal places.
-        reg_high = value >> 16,         // Extract the upper 16 bits (shift right by 16).
-        reg_low = value & 0xFFFF;       // Extract the lower 16 bits (mask with 0xFFFF).
+    // 2. Open the bus of the port using default serial configuration and set the timeout of the
+    // slave. If another handle (RRG or relay) already uses the port, its bus is reused. The
+    // status register is a cheap probe: one register every regulator has.
+    MB_DeviceConfig device_config = {{config->port, config->baudrate, RRG_DEFAULT_PARITY, RRG_DEFAULT_DATA_BITS,
+                                      RRG_DEFAULT_STOP_BITS, config->timeout, config->transport, config->arena},
+                                     config->slave_id,
+                                     config->adaptive_timeout,
+                                     MODBUS_REGISTER_STATUS,
+                                     config->probe_timeout};
+    MB_Bus *bus = NULL;
+    if (MB_DeviceOpen(&device_config, &bus) != MB_OK)
+        return _setHandleError(handle, _fromBusError(MB_GetLastErrorCode()), errno);
 
-    // 3. Write setpoint to MODBUS register 2053-2054.
-    if (modbus_write_register(handle->modbus_ctx, MODBUS_REGISTER_SETPOINT, reg_high) == MODBUS_ERR)
+    // 3. Attach the handle; it takes its own reference, so the one from `MB_BusOpen()` is dropped.
+    int status = RRG_Attach(bus, config->slave_id, handle);
+    MB_BusClose(bus);
+    if (status != RRG_OK)
+        return status;
+    handle->setpoint_write_mode = config->setpoint_write_mode;
+
+    // 4. With an arena, reserve the acquisition engine now: starting it later allocates nothing.
+    handle->arena = config->arena;
+    if (handle->arena && unlikely(!(handle->acquisition = _allocAcquisition(handle, 1))))
     {
-        RRG_MODBUS_DEBUG_MSG;
-        _setGlobalError(ERROR_RRG_FAILED_WRITE_REGISTER);
+        RRG_Close(handle);
+        return _setHandleError(handle, ERROR_RRG_FAILED_START_ACQUISITION, 0);
+    }
+
+    // 5. Enable the write cache if requested.
+    if (config->write_cache && RRG_SetWriteCache(handle, 1, config->write_cache_refresh_ms) != RRG_OK)
         return RRG_ERR;
+
+    // 6. Bypass libmodbus if requested and possible; a port that cannot be driven directly is
+    // no reason to fail, as libmodbus still works on it.
+    if (config->fast_transport && RRG_SetFastTransport(handle, 1) != RRG_OK)
+    {
+        RRG_DEBUG_MSG("Fast RTU transport unavailable, using libmodbus")
+        return _setHandleError(handle, RRG_OK, 0);
     }
-    if (modbus_write_register(handle->modbus_ctx, MODBUS_REGISTER_SETPOINT + 1, reg_low) == MODBUS_ERR)
+    return RRG_OK;
+}
+
+int RRG_Attach(MB_Bus *RRG_RESTRICT bus, int slave_id, RRG_Handle *RRG_RESTRICT handle)
+{
+    // 1. Validate input parameters.
+    RRG_CHECK_PTR_WITH_RETURN(bus);
+    RRG_CHECK_PTR_WITH_RETURN(handle);
+    if (unlikely(slave_id < 0 || slave_id > MB_MAX_SLAVE_ID))
     {
-        RRG_MODBUS_DEBUG_MSG;
-        _setGlobalError(ERROR_RRG_FAILED_WRITE_REGISTER);
+        RRG_DEBUG_MSG("Slave ID is out of range")
+        return _setHandleError(handle, ERROR_RRG_FAILED_SET_SLAVE, 0);
+    }
+
+    // 2. Bind the handle to the bus and keep the bus alive while the handle exists.
+    MB_BusRetain(bus);
+    handle->bus = bus;
+    handle->modbus_ctx = MB_BusGetContext(bus);
+    handle->slave_id = slave_id;
+    handle->setpoint_write_mode = RRG_SETPOINT_WRITE_MODE_AUTO;
+    handle->acquisition = NULL;
+    handle->ramp = NULL;
+    handle->rtu_frames = NULL;
+    handle->arena = NULL;
+    handle->fast_transport = 0;
+    handle->write_cache = 0;
+    handle->cache_refresh_ns = 0;
+    handle->telemetry_deadline_ns = 0;
+    handle->flow_log = NULL;
+    handle->flow_log_channel = 0;
+    handle->change_filter_enabled = 0;
+    memset(&handle->change_filter, 0, sizeof(handle->change_filter));
+    handle->interlock_enabled = 0;
+    memset(&handle->interlock, 0, sizeof(handle->interlock));
+    _invalidateWriteCache(handle);
+    memset(&handle->stats, 0, sizeof(handle->stats));
+
+    // 3. Restore the commanded values whenever the bus recovers from a lost port.
+    handle->command_setpoint = 0;
+    handle->command_gas = 0;
+    handle->reconnect_listener.on_reconnect = _restoreCommands;
+    handle->reconnect_listener.user_data = handle;
+    MB_BusAddListener(bus, &handle->reconnect_listener);
+    return _setHandleError(handle, RRG_OK, 0);
+}
+
+int RRG_SetWriteCache(RRG_Handle *RRG_RESTRICT handle, int enabled, int refresh_ms)
+{
+    // 1. Validate input parameters.
+    RRG_CHECK_PTR_WITH_RETURN(handle);
+    if (unlikely(refresh_ms < 0))
+    {
+        RRG_DEBUG_MSG("Write cache refresh interval must not be negative")
+        return _setHandleError(handle, ERROR_RRG_INVALID_PARAMETER, 0);
+    }
+
+    // 2. Start from an empty cache: values written while it was disabled are not tracked.
+    handle->write_cache = 0;
+    _invalidateWriteCache(handle);
+    handle->cache_refresh_ns = refresh_ms * 1000000LL;
+    handle->write_cache = enabled != 0;
+    return _setHandleError(handle, RRG_OK, 0);
+}
+
+int RRG_SetTelemetryDeadline(RRG_Handle *RRG_RESTRICT handle, int deadline_us)
+{
+    // 1. Validate input parameters.
+    RRG_CHECK_PTR_WITH_RETURN(handle);
+    if (unlikely(deadline_us < 0))
+    {
+        RRG_DEBUG_MSG("Telemetry deadline must not be negative")
+        return _setHandleError(handle, ERROR_RRG_INVALID_PARAMETER, 0);
+    }
+
+    // 2. Store the relative deadline; it applies to the reads queued from now on.
+    handle->telemetry_deadline_ns = deadline_us * 1000LL;
+    return _setHandleError(handle, RRG_OK, 0);
+}
+
+void RRG_InvalidateWriteCache(RRG_Handle *RRG_RESTRICT handle)
+{
+    if (handle)
+        _invalidateWriteCache(handle);
+}
+
+int RRG_SetFastTransport(RRG_Handle *RRG_RESTRICT handle, int enabled)
+{
+    // 1. Validate input parameters.
+    RRG_CHECK_PTR_WITH_RETURN(handle);
+    RRG_CHECK_PTR_WITH_RETURN(handle->bus);
+    if (!enabled)
+    {
+        _mbAtomicStoreInt(&handle->fast_transport, 0);
+        return _setHandleError(handle, RRG_OK, 0);
+    }
+
+    // 2. The bus must be able to drive its port directly.
+    if (MB_BusEnableFastRtu(handle->bus) != MB_OK)
+        return _setHandleError(handle, _fromBusError(MB_GetLastErrorCode()), 0);
+
+    // 3. Prepare the templates once; they stay valid until the handle is closed, so a thread
+    // that saw the transport enabled can still finish its request after it is disabled.
+    if (!handle->rtu_frames)
+    {
+        RRG_RtuFrames *frames = _mbAlloc(handle->arena, sizeof(*frames));
+        if (unlikely(!frames))
+            return _setHandleError(handle, ERROR_RRG_FAILED_CREATE_CONTEXT, 0);
+        const MB_RegisterDesc *setpoint = &RRG_REGISTERS[RRG_REGISTER_SETPOINT];
+        MB_RtuPrepareRead(&frames->flow, handle->slave_id, MODBUS_REGISTER_FLOW, MODBUS_FLOW_REGISTERS_COUNT);
+        MB_RtuPrepareWrite(&frames->setpoint, handle->slave_id, setpoint->address, setpoint->width, 1);
+        for (int i = 0; i < setpoint->width; ++i)
+            MB_RtuPrepareWrite(&frames->setpoint_half[i], handle->slave_id, setpoint->address + i, 1, 0);
+        MB_RtuPrepareWrite(&frames->gas, handle->slave_id, MODBUS_REGISTER_GAS, 1, 0);
+        handle->rtu_frames = frames;
+    }
+    _mbAtomicStoreInt(&handle->fast_transport, 1);
+    return _setHandleError(handle, RRG_OK, 0);
+}
+
+int RRG_SetFlow(RRG_Handle *RRG_RESTRICT handle, float setpoint)
+{
+    // 1. Validate input parameters.
+    RRG_CHECK_PTR_WITH_RETURN(handle);
+    RRG_CHECK_PTR_WITH_RETURN(handle->bus);
+
+    // 2. Convert the floating-point setpoint value to the register pair.
+    uint16_t regs[MODBUS_SETPOINT_REGISTERS_COUNT];
+    _setpointToRegisters(setpoint, regs);
+    _rememberCommand(&handle->command_setpoint, regs, MODBUS_SETPOINT_REGISTERS_COUNT);
+
+    // 3. Write setpoint to MODBUS registers 2053-2054 while holding the bus, unless the device holds it already.
+    modbus_t *ctx = _beginTransaction(handle, MB_PRIORITY_SETPOINT);
+    if (unlikely(!ctx))
         return RRG_ERR;
+    if (_isShadowed(handle, &handle->shadow_setpoint, regs, MODBUS_SETPOINT_REGISTERS_COUNT))
+        return _skipTransaction(handle);
+    return _endTransaction(handle, RRG_STATS_OP_SET_FLOW, _writeSetpoint(handle, regs));
+}
+
+/**
+ * @struct RRG_GroupPart
+ * @brief Part of a group transaction addressed to one regulator, counted once the line moves on.
+ */
+typedef struct
+{
+    RRG_Handle *handle; ///< Regulator the part is addressed to (`NULL` for a broadcast).
+    int error_code;     ///< Outcome of the part.
+    int skipped;        ///< Non-zero if nothing expecting a response was sent.
+    int op;             ///< `RRG_STATS_OP_*` under which the latency of the part is recorded.
+} RRG_GroupPart;
+
+/// @brief Classifies a part of a group transaction for the adaptive timeout (reads `errno` of its last request).
+static inline int _groupPartOutcome(const RRG_GroupPart *RRG_RESTRICT part)
+{
+    return part->skipped ? MB_TRANSACTION_SKIPPED : _mbTransactionOutcome(part->error_code == RRG_OK);
+}
+
+/// @brief Counts a finished part of a group transaction, which took `elapsed_ns`, in its regulator's statistics.
+static inline void _countGroupPart(const RRG_GroupPart *RRG_RESTRICT part, int64_t elapsed_ns)
+{
+    if (!part->handle)
+        return;
+    if (part->skipped)
+    {
+        _mbAtomicIncU64(&part->handle->stats.traffic.skipped_writes);
+        return;
     }
+    _mbCountTransaction(&part->handle->stats.traffic, part->error_code == RRG_OK);
+    _mbRecordLatency(&part->handle->stats.latency[part->op], elapsed_ns);
+}
 
-    _resetGlobalError();
+/// @brief Ends the current part of a group transaction and addresses the slave of `handle`.
+/// Returns `RRG_OK` or the error code of the selection.
+static int _nextGroupPart(MB_Bus *RRG_RESTRICT bus, RRG_GroupPart *RRG_RESTRICT part, RRG_Handle *RRG_RESTRICT handle)
+{
+    int64_t elapsed_ns = 0;
+    int status = MB_BusSwitchSlave(bus, handle->slave_id, _groupPartOutcome(part), &elapsed_ns);
+    _countGroupPart(part, elapsed_ns);
+    part->handle = handle;
+    part->error_code = status == MB_OK ? RRG_OK : _fromBusError(MB_GetLastErrorCode());
+    part->skipped = 0;
+    return part->error_code;
+}
+
+/// @brief Broadcasts the setpoint register pair to every slave of the bus of `handle`, whose
+/// statistics count the frames. Returns `RRG_OK` or an error code.
+static int _broadcastSetpoint(RRG_Handle *RRG_RESTRICT handle, const uint16_t *RRG_RESTRICT regs, int single)
+{
+    // A group with any regulator in single mode gets the halves as two "Write Single Register" frames.
+    const MB_RegisterDesc *desc = &RRG_REGISTERS[RRG_REGISTER_SETPOINT];
+    int width = single ? 1 : desc->width;
+    for (int i = 0; i < desc->width; i += width)
+    {
+        int sent = MB_BusBroadcastRegisters(handle->bus, desc->address + i, width, regs + i) == MB_OK;
+        _mbCountRequest(&handle->stats.traffic,
+                        width == 1 ? MB_RTU_WRITE_SINGLE_SIZE : MB_RTU_WRITE_MULTIPLE_REQUEST_SIZE(width), 0, sent,
+                        errno);
+        if (!sent)
+        {
+            RRG_MODBUS_DEBUG_MSG;
+            return ERROR_RRG_FAILED_WRITE_REGISTER;
+        }
+    }
     return RRG_OK;
 }
 
+/// @brief Reports the outcome of every regulator of a group and returns the status of the group call.
+static int _groupStatus(RRG_Handle *const *RRG_RESTRICT handles, int count, int *RRG_RESTRICT statuses)
+{
+    int error_code = RRG_OK;
+    for (int i = 0; i < count; ++i)
+    {
+        if (statuses)
+            statuses[i] = _mbAtomicLoadInt(&handles[i]->last_error);
+        if (error_code == RRG_OK)
+            error_code = _mbAtomicLoadInt(&handles[i]->last_error);
+    }
+    _setGlobalError(error_code);
+    return error_code == RRG_OK ? RRG_OK : RRG_ERR;
+}
+
+int RRG_SetFlowGroup(RRG_Handle *const *RRG_RESTRICT handles, const float *RRG_RESTRICT setpoints, int count,
+                     int flags, int *RRG_RESTRICT statuses)
+{
+    // 1. Validate input parameters: the whole group must share one bus.
+    RRG_CHECK_PTR_WITH_RETURN(handles);
+    RRG_CHECK_PTR_WITH_RETURN(setpoints);
+    MB_Bus *bus = count > 0 && handles[0] ? handles[0]->bus : NULL;
+    int shared = 1, single = 0;
+    for (int i = 0; bus && i < count; ++i)
+    {
+        if (unlikely(!handles[i] || handles[i]->bus != bus))
+            bus = NULL;
+        else
+        {
+            shared &= setpoints[i] == setpoints[0];
+            single |= handles[i]->setpoint_write_mode == RRG_SETPOINT_WRITE_MODE_SINGLE;
+        }
+    }
+    if (unlikely(!bus))
+    {
+        RRG_DEBUG_MSG("Regulators of a group must share one bus")
+        _setGlobalError(ERROR_RRG_INVALID_PARAMETER);
+        return RRG_ERR;
+    }
+    int broadcast = (flags & RRG_GROUP_BROADCAST) && shared;
+
+    // 2. Take the line once for the whole group.
+    uint16_t regs[MODBUS_SETPOINT_REGISTERS_COUNT];
+    for (int i = 0; i < count; ++i)
+    {
+        _setpointToRegisters(setpoints[i], regs);
+        _rememberCommand(&handles[i]->command_setpoint, regs, MODBUS_SETPOINT_REGISTERS_COUNT);
+    }
+    modbus_t *ctx = MB_BusBeginTransaction(bus, broadcast ? 0 : handles[0]->slave_id, MB_PRIORITY_SETPOINT, 0);
+    if (unlikely(!ctx))
+    {
+        int error_code = _fromBusError(MB_GetLastErrorCode());
+        for (int i = 0; i < count; ++i)
+            _setHandleError(handles[i], error_code, errno);
+        return _groupStatus(handles, count, statuses);
+    }
+    RRG_GroupPart part = {broadcast ? NULL : handles[0], RRG_OK, broadcast, RRG_STATS_OP_SET_FLOW};
+
+    // 3. Write the setpoints: one broadcast frame for a shared value, unless every regulator
+    // holds it already, otherwise one write per regulator with no gap between them.
+    if (broadcast)
+    {
+        _setpointToRegisters(setpoints[0], regs);
+        int held = 1;
+        for (int i = 0; i < count; ++i)
+            held &= _isShadowed(handles[i], &handles[i]->shadow_setpoint, regs, MODBUS_SETPOINT_REGISTERS_COUNT);
+        int error_code = held ? RRG_OK : _broadcastSetpoint(handles[0], regs, single);
+        for (int i = 0; i < count; ++i)
+        {
+            // Nothing confirms that a regulator applied the broadcast: only the verification may cache it.
+            if (!held)
+                _mbShadowInvalidate(&handles[i]->shadow_setpoint);
+            _setHandleError(handles[i], error_code, errno);
+        }
+    }
+    else
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            RRG_Handle *handle = handles[i];
+            int error_code = i ? _nextGroupPart(bus, &part, handle) : RRG_OK;
+            _setpointToRegisters(setpoints[i], regs);
+            if (error_code == RRG_OK)
+            {
+                if (_isShadowed(handle, &handle->shadow_setpoint, regs, MODBUS_SETPOINT_REGISTERS_COUNT))
+                    part.skipped = 1;
+                else
+                    error_code = part.error_code = _writeSetpoint(handle, regs);
+            }
+            _setHandleError(handle, error_code, errno);
+        }
+    }
+
+    // 4. Verification sweep: read every setpoint back and write it again where it differs.
+    for (int i = 0; (flags & RRG_GROUP_VERIFY) && i < count; ++i)
+    {
+        RRG_Handle *handle = handles[i];
+        if (_mbAtomicLoadInt(&handle->last_error) != RRG_OK)
+            continue;
+        uint16_t held[MODBUS_SETPOINT_REGISTERS_COUNT];
+        int error_code = _nextGroupPart(bus, &part, handle);
+        if (error_code == RRG_OK)
+            error_code = _readRegisters(handle, MODBUS_REGISTER_SETPOINT, MODBUS_SETPOINT_REGISTERS_COUNT, held);
+        _setpointToRegisters(setpoints[i], regs);
+        if (error_code == RRG_OK && memcmp(held, regs, sizeof(regs)) == 0)
+            _updateShadow(handle, &handle->shadow_setpoint, held, MODBUS_SETPOINT_REGISTERS_COUNT);
+        else if (error_code == RRG_OK)
+        {
+            RRG_DEBUG_MSG("Setpoint read back differs, writing it to the regulator again")
+            _mbAtomicIncU64(&handle->stats.traffic.retries);
+            error_code = _writeSetpoint(handle, regs);
+        }
+        part.error_code = error_code;
+        _setHandleError(handle, error_code, errno);
+    }
+
+    // 5. Release the line and report the outcome of every regulator.
+    int64_t elapsed_ns = MB_BusEndTransaction(bus, _groupPartOutcome(&part));
+    _countGroupPart(&part, elapsed_ns);
+    return _groupStatus(handles, count, statuses);
+}
+
 int RRG_GetFlow(RRG_Handle *RRG_RESTRICT handle, float *RRG_RESTRICT flow)
 {
     // 1. Validate input parameters.
     RRG_CHECK_PTR_WITH_RETURN(handle);
-    RRG_CHECK_PTR_WITH_RETURN(handle->modbus_ctx);
+    RRG_CHECK_PTR_WITH_RETURN(handle->bus);
     RRG_CHECK_PTR_WITH_RETURN(flow);
 
-    // 2. Read 32-bit flow value from MODBUS register 2103.
-    uint16_t data[2];
-    if (modbus_read_registers(handle->modbus_ctx, MODBUS_REGISTER_FLOW, 2, data) == MODBUS_ERR)
+    // 2. Read 32-bit flow value from MODBUS register 2103 and convert it to float.
+    modbus_t *ctx = _beginTransaction(handle, MB_PRIORITY_TELEMETRY);
+    if (unlikely(!ctx))
+        return RRG_ERR;
+    return _endTransaction(handle, RRG_STATS_OP_GET_FLOW, _readFlow(handle, flow));
+}
+
+int RRG_ConvertRaw(const uint16_t *RRG_RESTRICT regs, size_t count, float *RRG_RESTRICT flows)
+{
+    RRG_CHECK_PTR_WITH_RETURN(regs);
+    RRG_CHECK_PTR_WITH_RETURN(flows);
+    _mbRegisterDecodeMany(&RRG_REGISTERS[RRG_REGISTER_FLOW], regs, count, flows);
+    return RRG_OK;
+}
+
+int RRG_SimAddRegulator(MB_Sim *RRG_RESTRICT sim, int slave_id, int time_constant_ms)
+{
+    // The flow and the setpoint share their encoding, which the slave decodes both with.
+    const MB_RegisterDesc *flow = &RRG_REGISTERS[RRG_REGISTER_FLOW];
+    const MB_SimSlave slave = {.slave_id = slave_id,
+                               .value_address = flow->address,
+                               .setpoint_address = RRG_REGISTERS[RRG_REGISTER_SETPOINT].address,
+                               .width = flow->width,
+                               .flags = flow->flags & MB_REGISTER_SIGNED,
+                               .time_constant_ms = time_constant_ms};
+    if (MB_SimAddSlave(sim, &slave) != MB_OK)
     {
-        RRG_MODBUS_DEBUG_MSG;
-        _setGlobalError(ERROR_RRG_FAILED_READ_REGISTER);
+        int error_code = _fromBusError(MB_GetLastErrorCode());
+        _setGlobalError(error_code);
+        return error_code;
+    }
+    _setGlobalError(RRG_OK);
+    return RRG_OK;
+}
+
+/**
+ * @struct RRG_FlowManyWait
+ * @brief Completion of the buses an `RRG_GetFlowMany()` call handed to their I/O workers.
+ */
+typedef struct
+{
+    MB_Mutex lock; ///< Protects `pending`.
+    MB_Cond done;  ///< Signaled when `pending` drops to 0.
+    int pending;   ///< Buses still being read by their workers.
+} RRG_FlowManyWait;
+
+/**
+ * @struct RRG_FlowGroupJob
+ * @brief Payload of the job reading the regulators of one bus for `RRG_GetFlowMany()`.
+ */
+typedef struct
+{
+    RRG_Handle *const *handles; ///< Handles of the call, all buses.
+    float *flows;               ///< Flows of the call.
+    int *statuses;              ///< Outcomes of the call.
+    MB_Bus *bus;                ///< Bus whose regulators the job reads.
+    RRG_FlowManyWait *wait;     ///< Completion the job signals.
+    int first;                  ///< Index of the first regulator of the bus.
+    int count;                  ///< Number of handles of the call.
+} RRG_FlowGroupJob;
+
+/// @brief Reads the flow of the regulators of `handles` attached to the bus of `handles[first]`,
+/// in one transaction of its line. `bus_status` is the status the bus worker handed to the job.
+static void _readFlowGroup(const RRG_FlowGroupJob *RRG_RESTRICT job, int bus_status)
+{
+    // 1. Take the line once; a failure is the outcome of every regulator of the bus.
+    MB_Bus *bus = job->bus;
+    RRG_Handle *const *handles = job->handles;
+    modbus_t *ctx = NULL;
+    if (bus_status == MB_OK)
+        ctx = MB_BusBeginTransaction(bus, handles[job->first]->slave_id, MB_PRIORITY_TELEMETRY, 0);
+    if (unlikely(!ctx))
+    {
+        int error_code = _fromBusError(bus_status == MB_OK ? MB_GetLastErrorCode() : bus_status);
+        int modbus_errno = errno;
+        for (int i = job->first; i < job->count; ++i)
+        {
+            if (handles[i]->bus != bus)
+                continue;
+            job->flows[i] = 0.0f;
+            job->statuses[i] = error_code;
+            _setHandleError(handles[i], error_code, modbus_errno);
+        }
+        return;
+    }
+
+    // 2. Read the slaves back to back.
+    RRG_GroupPart part = {handles[job->first], RRG_OK, 0, RRG_STATS_OP_GET_FLOW};
+    for (int i = job->first; i < job->count; ++i)
+    {
+        RRG_Handle *handle = handles[i];
+        if (handle->bus != bus)
+            continue;
+        int error_code = i != job->first ? _nextGroupPart(bus, &part, handle) : RRG_OK;
+        if (error_code == RRG_OK)
+            error_code = part.error_code = _readFlow(handle, &job->flows[i]);
+        if (error_code != RRG_OK)
+            job->flows[i] = 0.0f;
+        job->statuses[i] = error_code;
+        _setHandleError(handle, error_code, errno);
+    }
+
+    // 3. Release the line.
+    int64_t elapsed_ns = MB_BusEndTransaction(bus, _groupPartOutcome(&part));
+    _countGroupPart(&part, elapsed_ns);
+}
+
+/// @brief Returns non-zero if `handles[index]` is the first of `handles` attached to its bus.
+static inline int _isFirstOnBus(RRG_Handle *const *RRG_RESTRICT handles, int index)
+{
+    for (int i = 0; i < index; ++i)
+        if (handles[i]->bus == handles[index]->bus)
+            return 0;
+    return 1;
+}
+
+/// @brief Bus worker job of `RRG_GetFlowMany()`: reads one bus and signals its completion.
+static void _flowGroupJob(void *payload, uint64_t request_id, int status)
+{
+    (void)request_id;
+    const RRG_FlowGroupJob *job = (const RRG_FlowGroupJob *)payload;
+    _readFlowGroup(job, status);
+    _mbMutexLock(&job->wait->lock);
+    if (--job->wait->pending == 0)
+        _mbCondBroadcast(&job->wait->done);
+    _mbMutexUnlock(&job->wait->lock);
+}
+
+int RRG_GetFlowMany(RRG_Handle *const *RRG_RESTRICT handles, int count, float *RRG_RESTRICT flows,
+                    int *RRG_RESTRICT statuses, int flags)
+{
+    // 1. Validate input parameters.
+    RRG_CHECK_PTR_WITH_RETURN(handles);
+    RRG_CHECK_PTR_WITH_RETURN(flows);
+    RRG_CHECK_PTR_WITH_RETURN(statuses);
+    int valid = count >= 0;
+    for (int i = 0; valid && i < count; ++i)
+        valid = handles[i] && handles[i]->bus;
+    if (unlikely(!valid))
+    {
+        RRG_DEBUG_MSG("Invalid regulator list")
+        _setGlobalError(ERROR_RRG_INVALID_PARAMETER);
         return RRG_ERR;
     }
 
-    // 3. Convert MODBUS data to float.
-    *flow = ((data[0] << 16) | data[1]) / 1000.0;
+    // 2. Hand every other bus to its I/O worker, so the lines work at the same time; a bus
+    // whose queue is full is read on the calling thread instead.
+    RRG_FlowManyWait wait;
+    _mbMutexInit(&wait.lock);
+    _mbCondInit(&wait.done);
+    wait.pending = 0;
+    for (int i = 1; !(flags & RRG_MANY_SERIAL) && i < count; ++i)
+    {
+        if (!_isFirstOnBus(handles, i))
+            continue;
+        RRG_FlowGroupJob job = {handles, flows, statuses, handles[i]->bus, &wait, i, count};
+        _mbMutexLock(&wait.lock);
+        ++wait.pending;
+        _mbMutexUnlock(&wait.lock);
+        if (MB_BusSubmit(job.bus, _flowGroupJob, &job, sizeof(job), MB_PRIORITY_TELEMETRY, 0, NULL) == MB_OK)
+            continue;
+        _mbMutexLock(&wait.lock);
+        --wait.pending;
+        _mbMutexUnlock(&wait.lock);
+        _readFlowGroup(&job, MB_OK);
+    }
 
-    _resetGlobalError();
-    return RRG_OK;
+    // 3. Read the bus of the first regulator here (every bus in order with `RRG_MANY_SERIAL`).
+    for (int i = 0; i < count && (i == 0 || (flags & RRG_MANY_SERIAL)); ++i)
+    {
+        if (_isFirstOnBus(handles, i))
+        {
+            RRG_FlowGroupJob job = {handles, flows, statuses, handles[i]->bus, &wait, i, count};
+            _readFlowGroup(&job, MB_OK);
+        }
+    }
+
+    // 4. Wait for the workers and report the first failure.
+    _mbMutexLock(&wait.lock);
+    while (wait.pending > 0)
+        _mbCondWait(&wait.done, &wait.lock);
+    _mbMutexUnlock(&wait.lock);
+    _mbCondDestroy(&wait.done);
+    _mbMutexDestroy(&wait.lock);
+    int error_code = RRG_OK;
+    for (int i = 0; error_code == RRG_OK && i < count; ++i)
+        error_code = statuses[i];
+    _setGlobalError(error_code);
+    return error_code == RRG_OK ? RRG_OK : RRG_ERR;
 }
 
-int RRG_SetGas(RRG_Handle *RRG_RESTRICT handle, int gas_id)
+int RRG_ReadSnapshot(RRG_Handle *RRG_RESTRICT handle, RRG_Snapshot *RRG_RESTRICT snapshot, int flags)
 {
     // 1. Validate input parameters.
     RRG_CHECK_PTR_WITH_RETURN(handle);
-    RRG_CHECK_PTR_WITH_RETURN(handle->modbus_ctx);
+    RRG_CHECK_PTR_WITH_RETURN(handle->bus);
+    RRG_CHECK_PTR_WITH_RETURN(snapshot);
+
+    modbus_t *ctx = _beginTransaction(handle, MB_PRIORITY_TELEMETRY);
+    if (unlikely(!ctx))
+        return RRG_ERR;
 
-    // 2. Write gas ID to MODBUS register 2100.
-    if (modbus_write_register(handle->modbus_ctx, MODBUS_REGISTER_GAS, gas_id) == MODBUS_ERR)
+    // 2. Read the gas type, the status and the flow, plus the setpoint on demand, in as few requests
+    // as the register map allows: the planner merges 2100-2104 into one read, the setpoint costs a second.
+    uint32_t fields = RRG_FIELD(RRG_REGISTER_GAS) | RRG_FIELD(RRG_REGISTER_STATUS) | RRG_FIELD(RRG_REGISTER_FLOW);
+    if (flags & RRG_SNAPSHOT_WITH_SETPOINT)
+        fields |= RRG_FIELD(RRG_REGISTER_SETPOINT);
+    MB_ReadPlan plan;
+    uint16_t data[MB_PLAN_MAX_REGISTERS];
+    _mbPlanReads(RRG_REGISTERS, RRG_REGISTER_COUNT, fields, RRG_READ_PLAN_MAX_GAP, &plan);
+    int error_code = RRG_OK;
+    if (!_mbReadPlan(handle->bus, &handle->stats.traffic, &plan, data))
     {
         RRG_MODBUS_DEBUG_MSG;
-        _setGlobalError(ERROR_RRG_FAILED_WRITE_REGISTER);
-        return RRG_ERR;
+        error_code = ERROR_RRG_FAILED_READ_REGISTER;
     }
+    const uint16_t *gas = _mbPlanLocate(&plan, data, &RRG_REGISTERS[RRG_REGISTER_GAS]),
+                   *status = _mbPlanLocate(&plan, data, &RRG_REGISTERS[RRG_REGISTER_STATUS]),
+                   *flow = _mbPlanLocate(&plan, data, &RRG_REGISTERS[RRG_REGISTER_FLOW]),
+                   *setpoint = _mbPlanLocate(&plan, data, &RRG_REGISTERS[RRG_REGISTER_SETPOINT]);
+    if (error_code == RRG_OK)
+    {
+        // A read back confirms what the device holds, including changes made by another master.
+        _updateShadow(handle, &handle->shadow_gas, gas, 1);
+        if (setpoint)
+            _updateShadow(handle, &handle->shadow_setpoint, setpoint, MODBUS_SETPOINT_REGISTERS_COUNT);
+    }
+    if (_endTransaction(handle, RRG_STATS_OP_READ_SNAPSHOT, error_code) != RRG_OK)
+        return RRG_ERR;
 
-    _resetGlobalError();
+    // 3. Decode the registers.
+    snapshot->gas_id = gas[0];
+    snapshot->flow = _registersToFlow(flow);
+    snapshot->instrument_status = status[0];
+    snapshot->flags = 0;
+    if (setpoint)
+    {
+        snapshot->setpoint = _registersToFlow(setpoint);
+        snapshot->flags |= RRG_SNAPSHOT_WITH_SETPOINT;
+    }
     return RRG_OK;
 }
 
+int RRG_SetGas(RRG_Handle *RRG_RESTRICT handle, int gas_id)
+{
+    // 1. Validate input parameters.
+    RRG_CHECK_PTR_WITH_RETURN(handle);
+    RRG_CHECK_PTR_WITH_RETURN(handle->bus);
+
+    // 2. Write gas ID to MODBUS register 2100, unless the device holds it already.
+    uint16_t gas_reg = (uint16_t)gas_id;
+    _rememberCommand(&handle->command_gas, &gas_reg, 1);
+    modbus_t *ctx = _beginTransaction(handle, MB_PRIORITY_SETPOINT);
+    if (unlikely(!ctx))
+        return RRG_ERR;
+    if (_isShadowed(handle, &handle->shadow_gas, &gas_reg, 1))
+        return _skipTransaction(handle);
+    return _endTransaction(handle, RRG_STATS_OP_SET_GAS, _writeGas(handle, gas_reg));
+}
+
+/// @brief Executes an asynchronous request on the I/O worker of the bus.
+static void _requestJob(void *payload, uint64_t request_id, int status)
+{
+    RRG_Request *request = payload;
+    RRG_Handle *handle = request->handle;
+    float value = request->value;
+
+    // 1. Run the operation in its own transaction, like the synchronous call would
+    // (writes of values the device already holds are skipped the same way).
+    // A read whose deadline passed in the queue is only reported, without touching the line.
+    int error_code, skipped = 0, op;
+    int priority = request->op == RRG_REQUEST_GET_FLOW ? MB_PRIORITY_TELEMETRY : MB_PRIORITY_SETPOINT;
+    uint16_t regs[MODBUS_SETPOINT_REGISTERS_COUNT];
+    if (request->op == RRG_REQUEST_SET_FLOW)
+    {
+        // Commands are remembered in the order they reach the line, like the synchronous ones.
+        _setpointToRegisters(value, regs);
+        _rememberCommand(&handle->command_setpoint, regs, MODBUS_SETPOINT_REGISTERS_COUNT);
+    }
+    else if (request->op == RRG_REQUEST_SET_GAS)
+    {
+        regs[0] = (uint16_t)request->gas_id;
+        _rememberCommand(&handle->command_gas, regs, 1);
+    }
+    modbus_t *ctx = status == MB_OK ? MB_BusBeginTransaction(handle->bus, handle->slave_id, priority,
+                                                             request->deadline_ns)
+                                    : NULL;
+    if (unlikely(!ctx))
+        error_code = _fromBusError(status == MB_OK ? MB_GetLastErrorCode() : status);
+    else
+    {
+        switch (request->op)
+        {
+        case RRG_REQUEST_SET_FLOW:
+            op = RRG_STATS_OP_SET_FLOW;
+            skipped = _isShadowed(handle, &handle->shadow_setpoint, regs, MODBUS_SETPOINT_REGISTERS_COUNT);
+            error_code = skipped ? RRG_OK : _writeSetpoint(handle, regs);
+            break;
+        case RRG_REQUEST_GET_FLOW:
+            op = RRG_STATS_OP_GET_FLOW;
+            error_code = _readFlow(handle, &value);
+            break;
+        default:
+            op = RRG_STATS_OP_SET_GAS;
+            skipped = _isShadowed(handle, &handle->shadow_gas, regs, 1);
+            error_code = skipped ? RRG_OK : _writeGas(handle, regs[0]);
+            break;
+        }
+        if (skipped)
+        {
+            MB_BusEndTransaction(handle->bus, MB_TRANSACTION_SKIPPED);
+            _mbAtomicIncU64(&handle->stats.traffic.skipped_writes);
+        }
+        else
+            _finishTransaction(handle, op, error_code);
+    }
+    // A dropped read says nothing about the device, so the cache stays valid then.
+    if (error_code != RRG_OK && error_code != ERROR_RRG_DEADLINE_EXPIRED)
+        _invalidateWriteCache(handle);
+
+    // 2. Report the outcome after the bus is released, so the callback may submit more work.
+    if (request->callback)
+        request->callback(handle, request_id, error_code, value, request->user_data);
+}
+
+/// @brief Queues the request to the I/O worker of the handle's bus and records the outcome of the submission.
+/// Writes go ahead of the reads queued on the bus.
+static int _submitRequest(RRG_Handle *RRG_RESTRICT handle, const RRG_Request *RRG_RESTRICT request,
+                          uint64_t *RRG_RESTRICT request_id)
+{
+    int priority = request->op == RRG_REQUEST_GET_FLOW ? MB_PRIORITY_TELEMETRY : MB_PRIORITY_SETPOINT;
+    if (MB_BusSubmit(handle->bus, _requestJob, request, sizeof(*request), priority, request->deadline_ns,
+                     request_id) != MB_OK)
+        return _setHandleError(handle, _fromBusError(MB_GetLastErrorCode()), 0);
+    return _setHandleError(handle, RRG_OK, 0);
+}
+
+int RRG_SetFlowAsync(RRG_Handle *RRG_RESTRICT handle, float setpoint, RRG_Callback callback,
+                     void *user_data, uint64_t *RRG_RESTRICT request_id)
+{
+    // 1. Validate input parameters.
+    RRG_CHECK_PTR_WITH_RETURN(handle);
+    RRG_CHECK_PTR_WITH_RETURN(handle->bus);
+
+    // 2. Queue the write; the conversion happens on the worker.
+    RRG_Request request = {handle, RRG_REQUEST_SET_FLOW, setpoint, 0, 0, callback, user_data};
+    return _submitRequest(handle, &request, request_id);
+}
+
+int RRG_GetFlowAsync(RRG_Handle *RRG_RESTRICT handle, RRG_Callback callback, void *user_data,
+                     uint64_t *RRG_RESTRICT request_id)
+{
+    // 1. Validate input parameters.
+    RRG_CHECK_PTR_WITH_RETURN(handle);
+    RRG_CHECK_PTR_WITH_RETURN(handle->bus);
+
+    // 2. Queue the read, to be dropped if it cannot be sent within the telemetry deadline.
+    int64_t deadline_ns = handle->telemetry_deadline_ns ? _mbMonotonicNs() + handle->telemetry_deadline_ns : 0;
+    RRG_Request request = {handle, RRG_REQUEST_GET_FLOW, 0.0f, 0, deadline_ns, callback, user_data};
+    return _submitRequest(handle, &request, request_id);
+}
+
+int RRG_SetGasAsync(RRG_Handle *RRG_RESTRICT handle, int gas_id, RRG_Callback callback, void *user_data,
+                    uint64_t *RRG_RESTRICT request_id)
+{
+    // 1. Validate input parameters.
+    RRG_CHECK_PTR_WITH_RETURN(handle);
+    RRG_CHECK_PTR_WITH_RETURN(handle->bus);
+
+    // 2. Queue the write.
+    RRG_Request request = {handle, RRG_REQUEST_SET_GAS, (float)gas_id, gas_id, 0, callback, user_data};
+    return _submitRequest(handle, &request, request_id);
+}
+
+int RRG_Wait(RRG_Handle *RRG_RESTRICT handle, uint64_t request_id)
+{
+    // 1. Validate input parameters.
+    RRG_CHECK_PTR_WITH_RETURN(handle);
+    RRG_CHECK_PTR_WITH_RETURN(handle->bus);
+
+    // 2. Block until the worker has gone past the request.
+    if (MB_BusWait(handle->bus, request_id) != MB_OK)
+        return _setHandleError(handle, ERROR_RRG_INVALID_PARAMETER, 0);
+    return _setHandleError(handle, RRG_OK, 0);
+}
+
+/// @brief Appends the batched log records of the acquisition thread, if any. Returns the new batch size (0).
+static inline int _flushLogBatch(RRG_Acquisition *RRG_RESTRICT acq, const MB_LogRecord *RRG_RESTRICT batch, int count)
+{
+    // A failed append loses the batch but never stops the acquisition; the log retries with a new segment.
+    if (count > 0)
+        MB_LogAppend(acq->log, batch, count);
+    return 0;
+}
+
+/// @brief Returns the absolute value of `value` (rrg does not link libm).
+static inline float _absFlow(float value) { return value < 0.0f ? -value : value; }
+
+/// @brief Reports `sample` as a change if it passes the filter of the acquisition, and remembers
+/// what the next sample is compared with.
+static void _filterSample(RRG_Acquisition *RRG_RESTRICT acq, RRG_ChangeState *RRG_RESTRICT state,
+                          const RRG_Sample *RRG_RESTRICT sample)
+{
+    // 1. Slope since the previous successful sample.
+    const RRG_ChangeFilter *filter = &acq->filter;
+    RRG_FlowChange change = {sample->t_ns, sample->flow, sample->status, 0.0f, 0};
+    int ok = sample->status == RRG_OK;
+    if (ok && state->has_previous && sample->t_ns > state->previous.t_ns)
+        change.rate = (sample->flow - state->previous.flow) * 1e9f / (float)(sample->t_ns - state->previous.t_ns);
+    if (ok)
+    {
+        state->previous = *sample;
+        state->has_previous = 1;
+    }
+
+    // 2. Collect the reasons to report it; a failed read is always compared by status only.
+    const RRG_Sample *reported = &state->reported;
+    if (!state->has_reported)
+        change.reasons |= RRG_CHANGE_FIRST;
+    else if (sample->status != reported->status)
+        change.reasons |= RRG_CHANGE_STATUS;
+    else if (ok && _absFlow(sample->flow - reported->flow) > filter->deadband)
+        change.reasons |= RRG_CHANGE_DEADBAND;
+    if (ok && filter->rate_threshold > 0.0f && _absFlow(change.rate) > filter->rate_threshold)
+        change.reasons |= RRG_CHANGE_RATE;
+    if (state->has_reported && filter->heartbeat_us > 0 &&
+        sample->t_ns - reported->t_ns >= filter->heartbeat_us * 1000LL)
+        change.reasons |= RRG_CHANGE_HEARTBEAT;
+    if (likely(!change.reasons))
+        return;
+
+    // 3. Publish the change, then hand it to the subscriber.
+    state->reported = *sample;
+    state->has_reported = 1;
+    _mbRingPush(&acq->changes, &change);
+    if (filter->callback)
+        filter->callback(&change, filter->user_data);
+}
+
+/// @brief Updates the interlock with the outcome of a read, and trips it on a fault.
+/// Returns non-zero while a fault is suspected or present (the thread then samples at the fault period).
+static int _checkInterlock(RRG_Acquisition *RRG_RESTRICT acq, const RRG_Sample *RRG_RESTRICT sample,
+                           int instrument_status)
+{
+    // 1. Collect the fault conditions; a read dropped for a busy line tells nothing about the device.
+    const RRG_Interlock *interlock = &acq->interlock;
+    RRG_InterlockStatus *status = &acq->interlock_status;
+    if (sample->status == ERROR_RRG_DEADLINE_EXPIRED)
+        return status->faulted || status->failed_reads > 0;
+    int ok = sample->status == RRG_OK;
+    int failed_reads = ok ? 0 : status->failed_reads + 1;
+    int reasons = 0;
+    if (ok && (instrument_status & interlock->fault_mask))
+        reasons |= RRG_INTERLOCK_STATUS;
+    if (interlock->max_failed_reads > 0 && failed_reads >= interlock->max_failed_reads)
+        reasons |= RRG_INTERLOCK_COMMUNICATION;
+
+    // 2. Trip once per fault: the action runs before anything else, even before the lock is
+    // taken, so a status reader never delays the shutoff.
+    int trip = reasons && !status->faulted;
+    int action_status = 0;
+    int64_t latency_ns = 0;
+    if (unlikely(trip))
+    {
+        if (interlock->action)
+            action_status = interlock->action(interlock->target);
+        latency_ns = _mbMonotonicNs() - sample->t_ns;
+    }
+
+    // 3. Publish the state; a clean read re-arms the interlock.
+    _mbMutexLock(&acq->interlock_lock);
+    if (ok)
+        status->instrument_status = instrument_status;
+    status->failed_reads = failed_reads;
+    if (unlikely(trip))
+    {
+        status->faulted = 1;
+        status->reasons = reasons;
+        status->action_status = action_status;
+        status->trips++;
+        status->last_trip_ns = sample->t_ns;
+        status->last_latency_ns = latency_ns;
+        if (latency_ns > status->max_latency_ns)
+            status->max_latency_ns = latency_ns;
+        _mbRecordLatency(&status->latency, latency_ns);
+    }
+    else if (ok && !reasons)
+        status->faulted = 0;
+    _mbMutexUnlock(&acq->interlock_lock);
+    return status->faulted || failed_reads > 0;
+}
+
+/// @brief Polling loop of the acquisition thread.
+MB_THREAD_ROUTINE(_acquisitionThread, arg)
+{
+    RRG_Acquisition *acq = arg;
+    const int64_t stop_poll_ns = RRG_ACQUISITION_STOP_POLL_US * 1000LL;
+    const int64_t log_flush_ns = RRG_FLOW_LOG_FLUSH_INTERVAL_US * 1000LL;
+    int64_t deadline = _mbMonotonicNs();
+    MB_LogRecord batch[RRG_FLOW_LOG_BATCH_RECORDS];
+    int batch_count = 0;
+    RRG_ChangeState change_state;
+    memset(&change_state, 0, sizeof(change_state));
+    int64_t period_ns = acq->period_ns;
+
+    while (_mbAtomicLoadInt(&acq->running))
+    {
+        // 1. Take one sample (with the status register if an interlock watches it).
+        // The outcome goes into the sample only: the handle's error keeps reporting the owner's calls.
+        // A failure still invalidates the write cache, as the device may have been reset.
+        // The read yields to any write waiting for the line, and is dropped if that delays it
+        // by a whole period: a late sample is worth less than the next one taken on time.
+        RRG_Sample sample = {_mbMonotonicNs(), 0.0f, RRG_OK};
+        uint16_t data[MB_PLAN_MAX_REGISTERS] = {0};
+        const uint16_t *regs = data + acq->flow_offset;
+        modbus_t *ctx = MB_BusBeginTransaction(acq->handle->bus, acq->handle->slave_id, MB_PRIORITY_TELEMETRY,
+                                               sample.t_ns + period_ns);
+        if (likely(ctx))
+        {
+            sample.status = _readRegisters(acq->handle, acq->read.address, acq->read.count, data);
+            _finishTransaction(acq->handle, RRG_STATS_OP_GET_FLOW, sample.status);
+        }
+        else
+            sample.status = _fromBusError(MB_GetLastErrorCode());
+        if (likely(sample.status == RRG_OK))
+            sample.flow = _registersToFlow(regs);
+        else if (sample.status != ERROR_RRG_DEADLINE_EXPIRED)
+            _invalidateWriteCache(acq->handle);
+
+        // 2. React to a fault before anything else, then publish the sample; a full ring drops it
+        // instead of blocking the bus.
+        period_ns = acq->period_ns;
+        if (acq->interlock_enabled && _checkInterlock(acq, &sample, data[acq->status_offset]))
+            period_ns = acq->fault_period_ns;
+        _mbRingPush(&acq->ring, &sample);
+
+        // 3. Batch the raw registers for the log: one append per batch (or per flush interval).
+        if (acq->log)
+        {
+            MB_LogRecord *record = &batch[batch_count++];
+            record->t_ns = sample.t_ns;
+            record->status = sample.status;
+            record->channel = (uint8_t)acq->handle->flow_log_channel;
+            record->slave_id = (uint8_t)acq->handle->slave_id;
+            record->register_count = sample.status == RRG_OK ? 2 : 0;
+            record->reserved = 0;
+            memcpy(record->registers, regs, MODBUS_FLOW_REGISTERS_COUNT * sizeof(uint16_t));
+            memset(record->registers + MODBUS_FLOW_REGISTERS_COUNT, 0,
+                   sizeof(record->registers) - MODBUS_FLOW_REGISTERS_COUNT * sizeof(uint16_t));
+            if (batch_count == RRG_FLOW_LOG_BATCH_RECORDS || sample.t_ns - batch[0].t_ns >= log_flush_ns)
+                batch_count = _flushLogBatch(acq, batch, batch_count);
+        }
+
+        // 4. Report the sample to the subscribers if it is a meaningful change.
+        if (acq->filter_enabled)
+            _filterSample(acq, &change_state, &sample);
+
+        // 5. Sleep until the next absolute deadline. After an overrun the schedule restarts
+        // from now rather than firing a burst of catch-up requests.
+        deadline += period_ns;
+        int64_t now = _mbMonotonicNs();
+        if (deadline < now)
+            deadline = now;
+        while (now < deadline && _mbAtomicLoadInt(&acq->running))
+        {
+            _mbSleepUntilNs(deadline - now > stop_poll_ns ? now + stop_poll_ns : deadline);
+            now = _mbMonotonicNs();
+        }
+    }
+    _flushLogBatch(acq, batch, batch_count);
+    MB_THREAD_RETURN;
+}
+
+/// @brief Stops the acquisition thread (if running) and frees the engine with its samples.
+static void _destroyAcquisition(RRG_Handle *RRG_RESTRICT handle)
+{
+    RRG_Acquisition *acq = handle->acquisition;
+    if (!acq)
+        return;
+
+    RRG_StopAcquisition(handle);
+    _mbRingDestroy(&acq->ring);
+    _mbRingDestroy(&acq->changes);
+    _mbMutexDestroy(&acq->interlock_lock);
+    _mbFree(handle->arena, acq);
+    handle->acquisition = NULL;
+}
+
+int RRG_StartAcquisition(RRG_Handle *RRG_RESTRICT handle, int period_us)
+{
+    // 1. Validate input parameters.
+    RRG_CHECK_PTR_WITH_RETURN(handle);
+    RRG_CHECK_PTR_WITH_RETURN(handle->bus);
+    if (unlikely(period_us <= 0))
+    {
+        RRG_DEBUG_MSG("Acquisition period must be positive")
+        return _setHandleError(handle, ERROR_RRG_INVALID_PARAMETER, 0);
+    }
+    RRG_Acquisition *acq = handle->acquisition;
+    if (acq && _mbAtomicLoadInt(&acq->running))
+        return _setHandleError(handle, ERROR_RRG_ACQUISITION_RUNNING, 0);
+
+    // 2. Start from an empty ring: samples left from a previous run are discarded. A handle with
+    // an arena empties the engine `RRG_Init()` reserved instead of allocating another one.
+    if (handle->arena && acq)
+    {
+        _mbRingReset(&acq->ring);
+        _mbRingReset(&acq->changes);
+        memset(&acq->interlock_status, 0, sizeof(acq->interlock_status));
+    }
+    else
+    {
+        _destroyAcquisition(handle);
+        acq = _allocAcquisition(handle, handle->arena || handle->change_filter_enabled);
+        if (unlikely(!acq))
+            return _setHandleError(handle, ERROR_RRG_FAILED_START_ACQUISITION, 0);
+        handle->acquisition = acq;
+    }
+    acq->period_ns = period_us * 1000LL;
+    acq->handle = handle;
+    acq->log = handle->flow_log;
+    acq->filter_enabled = handle->change_filter_enabled;
+    acq->filter = handle->change_filter;
+    acq->interlock_enabled = handle->interlock_enabled;
+    acq->interlock = handle->interlock;
+    acq->fault_period_ns =
+        acq->interlock.fault_period_us > 0 ? acq->interlock.fault_period_us * 1000LL : acq->period_ns;
+
+    // 3. Plan one request per sample: the flow alone, or from the status on with an interlock.
+    uint32_t fields = RRG_FIELD(RRG_REGISTER_FLOW);
+    if (acq->interlock_enabled)
+        fields |= RRG_FIELD(RRG_REGISTER_STATUS);
+    MB_ReadPlan plan;
+    _mbPlanReads(RRG_REGISTERS, RRG_REGISTER_COUNT, fields, RRG_READ_PLAN_MAX_GAP, &plan);
+    acq->read = plan.spans[0];
+    acq->flow_offset = RRG_REGISTERS[RRG_REGISTER_FLOW].address - acq->read.address;
+    acq->status_offset = acq->interlock_enabled ? RRG_REGISTERS[RRG_REGISTER_STATUS].address - acq->read.address : -1;
+    acq->running = 1;
+
+    // 4. Spawn the polling thread; a heap engine goes away with a failure, a reserved one stays.
+    if (unlikely(_mbThreadCreate(&acq->thread, _acquisitionThread, acq) != 0))
+    {
+        acq->running = 0;
+        if (!handle->arena)
+            _destroyAcquisition(handle);
+        return _setHandleError(handle, ERROR_RRG_FAILED_START_ACQUISITION, 0);
+    }
+    return _setHandleError(handle, RRG_OK, 0);
+}
+
+int RRG_SetFlowLog(RRG_Handle *RRG_RESTRICT handle, MB_Log *log, int channel)
+{
+    // 1. Validate input parameters.
+    RRG_CHECK_PTR_WITH_RETURN(handle);
+    if (unlikely(channel < 0 || channel > 0xFF))
+    {
+        RRG_DEBUG_MSG("Flow log channel must be in 0-255")
+        return _setHandleError(handle, ERROR_RRG_INVALID_PARAMETER, 0);
+    }
+    RRG_Acquisition *acq = handle->acquisition;
+    if (acq && _mbAtomicLoadInt(&acq->running))
+        return _setHandleError(handle, ERROR_RRG_ACQUISITION_RUNNING, 0);
+
+    // 2. The next acquisition thread picks the log up when it starts.
+    handle->flow_log = log;
+    handle->flow_log_channel = channel;
+    return _setHandleError(handle, RRG_OK, 0);
+}
+
+int RRG_SetChangeFilter(RRG_Handle *RRG_RESTRICT handle, const RRG_ChangeFilter *RRG_RESTRICT filter)
+{
+    // 1. Validate input parameters (written so that NaN is rejected too).
+    RRG_CHECK_PTR_WITH_RETURN(handle);
+    if (unlikely(filter && (!(filter->deadband >= 0.0f) || !(filter->rate_threshold >= 0.0f) ||
+                            filter->heartbeat_us < 0)))
+    {
+        RRG_DEBUG_MSG("Change filter thresholds must not be negative")
+        return _setHandleError(handle, ERROR_RRG_INVALID_PARAMETER, 0);
+    }
+    RRG_Acquisition *acq = handle->acquisition;
+    if (acq && _mbAtomicLoadInt(&acq->running))
+        return _setHandleError(handle, ERROR_RRG_ACQUISITION_RUNNING, 0);
+
+    // 2. The next acquisition thread picks the filter up when it starts.
+    handle->change_filter_enabled = filter != NULL;
+    if (filter)
+        handle->change_filter = *filter;
+    else
+        memset(&handle->change_filter, 0, sizeof(handle->change_filter));
+    return _setHandleError(handle, RRG_OK, 0);
+}
+
+int RRG_SetInterlock(RRG_Handle *RRG_RESTRICT handle, const RRG_Interlock *RRG_RESTRICT interlock)
+{
+    // 1. Validate input parameters.
+    RRG_CHECK_PTR_WITH_RETURN(handle);
+    if (unlikely(interlock && (interlock->fault_mask < 0 || interlock->max_failed_reads < 0 ||
+                               interlock->fault_period_us < 0)))
+    {
+        RRG_DEBUG_MSG("Interlock fields must not be negative")
+        return _setHandleError(handle, ERROR_RRG_INVALID_PARAMETER, 0);
+    }
+    RRG_Acquisition *acq = handle->acquisition;
+    if (acq && _mbAtomicLoadInt(&acq->running))
+        return _setHandleError(handle, ERROR_RRG_ACQUISITION_RUNNING, 0);
+
+    // 2. The next acquisition thread arms the interlock when it starts.
+    handle->interlock_enabled = interlock != NULL;
+    if (interlock)
+        handle->interlock = *interlock;
+    else
+        memset(&handle->interlock, 0, sizeof(handle->interlock));
+    return _setHandleError(handle, RRG_OK, 0);
+}
+
+int RRG_GetInterlockStatus(RRG_Handle *RRG_RESTRICT handle, RRG_InterlockStatus *RRG_RESTRICT status)
+{
+    // 1. Validate input parameters.
+    RRG_CHECK_PTR_WITH_RETURN(handle);
+    RRG_CHECK_PTR_WITH_RETURN(status);
+
+    // 2. Copy the state under the lock, so a trip is never seen half recorded.
+    RRG_Acquisition *acq = handle->acquisition;
+    memset(status, 0, sizeof(*status));
+    if (acq && acq->interlock_enabled)
+    {
+        _mbMutexLock(&acq->interlock_lock);
+        *status = acq->interlock_status;
+        _mbMutexUnlock(&acq->interlock_lock);
+    }
+    return _setHandleError(handle, RRG_OK, 0);
+}
+
+void RRG_StopAcquisition(RRG_Handle *RRG_RESTRICT handle)
+{
+    RRG_Acquisition *acq = handle ? handle->acquisition : NULL;
+    if (acq && _mbAtomicLoadInt(&acq->running))
+    {
+        _mbAtomicStoreInt(&acq->running, 0);
+        _mbThreadJoin(acq->thread);
+    }
+}
+
+int RRG_DrainSamples(RRG_Handle *RRG_RESTRICT handle, RRG_Sample *RRG_RESTRICT samples, int max)
+{
+    // 1. Validate input parameters.
+    RRG_CHECK_PTR_WITH_RETURN(handle);
+    RRG_CHECK_PTR_WITH_RETURN(samples);
+    if (unlikely(max < 0))
+        return _setHandleError(handle, ERROR_RRG_INVALID_PARAMETER, 0);
+
+    // 2. Nothing was ever acquired: nothing to drain.
+    RRG_Acquisition *acq = handle->acquisition;
+    if (!acq)
+        return 0;
+    return (int)_mbRingPop(&acq->ring, samples, (size_t)max);
+}
+
+uint64_t RRG_GetDroppedSamples(RRG_Handle *RRG_RESTRICT handle)
+{
+    RRG_Acquisition *acq = handle ? handle->acquisition : NULL;
+    return acq ? _mbAtomicLoadU64(&acq->ring.dropped) : 0;
+}
+
+int RRG_DrainChanges(RRG_Handle *RRG_RESTRICT handle, RRG_FlowChange *RRG_RESTRICT changes, int max)
+{
+    // 1. Validate input parameters.
+    RRG_CHECK_PTR_WITH_RETURN(handle);
+    RRG_CHECK_PTR_WITH_RETURN(changes);
+    if (unlikely(max < 0))
+        return _setHandleError(handle, ERROR_RRG_INVALID_PARAMETER, 0);
+
+    // 2. No acquisition ran with a filter: nothing to drain.
+    RRG_Acquisition *acq = handle->acquisition;
+    if (!acq || !acq->filter_enabled)
+        return 0;
+    return (int)_mbRingPop(&acq->changes, changes, (size_t)max);
+}
+
+uint64_t RRG_GetDroppedChanges(RRG_Handle *RRG_RESTRICT handle)
+{
+    RRG_Acquisition *acq = handle ? handle->acquisition : NULL;
+    return acq && acq->filter_enabled ? _mbAtomicLoadU64(&acq->changes.dropped) : 0;
+}
+
+/// @brief Evaluates the profile `t_us` after the start of the ramp. `cursor` keeps the current
+/// segment between calls, as ticks only move forward.
+static float _rampSetpointAt(const RRG_Ramp *RRG_RESTRICT ramp, int64_t t_us, int *RRG_RESTRICT cursor)
+{
+    const RRG_RampPoint *points = ramp->points;
+    int i = *cursor;
+    while (i + 1 < ramp->point_count && points[i + 1].t_us <= t_us)
+        ++i;
+    *cursor = i;
+
+    // Before the first point its setpoint is held, and so is the last one after the end.
+    if (t_us <= points[i].t_us || i + 1 == ramp->point_count || ramp->interpolation == RRG_RAMP_STEP)
+        return points[i].setpoint;
+    double fraction = (double)(t_us - points[i].t_us) / (double)(points[i + 1].t_us - points[i].t_us);
+    return (float)(points[i].setpoint + (points[i + 1].setpoint - points[i].setpoint) * fraction);
+}
+
+/// @brief Accounts a tick (and the ticks skipped before it) in the statistics of the ramp.
+static void _recordRampTick(RRG_Ramp *RRG_RESTRICT ramp, const RRG_RampTick *RRG_RESTRICT tick, uint64_t skipped)
+{
+    _mbMutexLock(&ramp->status_lock);
+    RRG_RampStatus *status = &ramp->status;
+    ++status->ticks;
+    status->missed_ticks += skipped + (tick->status == ERROR_RRG_DEADLINE_EXPIRED);
+    status->last_status = tick->status;
+    if (tick->late_ns > status->max_late_ns)
+        status->max_late_ns = tick->late_ns;
+    ramp->late_sum_ns += (double)tick->late_ns;
+    if (tick->flags & RRG_RAMP_TICK_WRITTEN)
+        ++status->writes;
+    if (tick->flags & RRG_RAMP_TICK_READ)
+    {
+        float abs_error = tick->error < 0.0f ? -tick->error : tick->error;
+        ++status->reads;
+        if (abs_error > status->max_abs_error)
+            status->max_abs_error = abs_error;
+        ramp->abs_error_sum += abs_error;
+    }
+    _mbMutexUnlock(&ramp->status_lock);
+}
+
+/// @brief Ramp thread: streams the setpoints of the profile on a fixed grid of absolute deadlines.
+MB_THREAD_ROUTINE(_rampThread, arg)
+{
+    RRG_Ramp *ramp = arg;
+    RRG_Handle *handle = ramp->handle;
+    const int64_t stop_poll_ns = RRG_ACQUISITION_STOP_POLL_US * 1000LL;
+    const int64_t end_us = ramp->points[ramp->point_count - 1].t_us;
+    const int64_t start_ns = _mbMonotonicNs();
+    uint16_t written[MODBUS_SETPOINT_REGISTERS_COUNT];
+    int have_written = 0, cursor = 0;
+    uint64_t tick_index = 0, skipped = 0;
+
+    while (_mbAtomicLoadInt(&ramp->running))
+    {
+        // 1. Evaluate the profile at the scheduled time of the tick, whenever the thread woke up.
+        int64_t deadline_ns = start_ns + (int64_t)tick_index * ramp->tick_ns;
+        int64_t t_us = (deadline_ns - start_ns) / 1000;
+        int last = t_us >= end_us;
+        RRG_RampTick tick = {deadline_ns, _mbMonotonicNs() - deadline_ns, _rampSetpointAt(ramp, t_us, &cursor),
+                             0.0f, 0.0f, RRG_OK, 0, 0};
+        uint16_t regs[MODBUS_SETPOINT_REGISTERS_COUNT];
+        _setpointToRegisters(tick.setpoint, regs);
+        int write = !have_written || memcmp(regs, written, sizeof(regs)) != 0;
+        int read = ramp->read_every && tick_index % (uint64_t)ramp->read_every == 0;
+
+        // 2. Write the setpoint and read the flow back in one transaction. It is dropped if the
+        // line is not free before the next tick is due, except for the final setpoint.
+        if (write || read)
+        {
+            if (write)
+                _rememberCommand(&handle->command_setpoint, regs, MODBUS_SETPOINT_REGISTERS_COUNT);
+            modbus_t *ctx = MB_BusBeginTransaction(handle->bus, handle->slave_id, MB_PRIORITY_SETPOINT,
+                                                   last ? 0 : deadline_ns + ramp->tick_ns);
+            if (unlikely(!ctx))
+                tick.status = _fromBusError(MB_GetLastErrorCode());
+            else
+            {
+                if (write && (tick.status = _writeSetpoint(handle, regs)) == RRG_OK)
+                    tick.flags |= RRG_RAMP_TICK_WRITTEN;
+                if (read && tick.status == RRG_OK && (tick.status = _readFlow(handle, &tick.flow)) == RRG_OK)
+                {
+                    tick.flags |= RRG_RAMP_TICK_READ;
+                    tick.error = tick.flow - tick.setpoint;
+                }
+                _finishTransaction(handle, write ? RRG_STATS_OP_SET_FLOW : RRG_STATS_OP_GET_FLOW, tick.status);
+            }
+            if (tick.flags & RRG_RAMP_TICK_WRITTEN)
+                memcpy(written, regs, sizeof(regs));
+            // A failed write leaves the device state unknown: write again on the next tick.
+            have_written = write ? (tick.flags & RRG_RAMP_TICK_WRITTEN) != 0 : have_written;
+            if (tick.status != RRG_OK && tick.status != ERROR_RRG_DEADLINE_EXPIRED)
+                _invalidateWriteCache(handle);
+        }
+        _mbRingPush(&ramp->ring, &tick);
+        _recordRampTick(ramp, &tick, skipped);
+
+        // 3. The ramp is complete once the regulator holds the final setpoint.
+        if (last && have_written)
+            break;
+
+        // 4. Sleep until the next deadline of the grid. After an overrun the ticks already past
+        // are skipped rather than fired in a burst: only the most recent one still runs.
+        ++tick_index;
+        int64_t now = _mbMonotonicNs();
+        uint64_t due = (uint64_t)((now - start_ns) / ramp->tick_ns);
+        skipped = due > tick_index ? due - tick_index : 0;
+        tick_index += skipped;
+        deadline_ns = start_ns + (int64_t)tick_index * ramp->tick_ns;
+        while (now < deadline_ns && _mbAtomicLoadInt(&ramp->running))
+        {
+            _mbSleepUntilNs(deadline_ns - now > stop_poll_ns ? now + stop_poll_ns : deadline_ns);
+            now = _mbMonotonicNs();
+        }
+    }
+
+    _mbMutexLock(&ramp->status_lock);
+    ramp->status.running = 0;
+    _mbMutexUnlock(&ramp->status_lock);
+    _mbAtomicStoreInt(&ramp->running, 0);
+    MB_THREAD_RETURN;
+}
+
+/// @brief Stops the ramp thread (if running) and frees the engine with its ticks.
+static void _destroyRamp(RRG_Handle *RRG_RESTRICT handle)
+{
+    RRG_Ramp *ramp = handle->ramp;
+    if (!ramp)
+        return;
+
+    RRG_StopRamp(handle);
+    _mbMutexDestroy(&ramp->status_lock);
+    _mbRingDestroy(&ramp->ring);
+    free(ramp->points);
+    free(ramp);
+    handle->ramp = NULL;
+}
+
+int RRG_StartRamp(RRG_Handle *RRG_RESTRICT handle, const RRG_RampProfile *RRG_RESTRICT profile, int tick_us)
+{
+    // 1. Validate input parameters: the points must move forward in time.
+    RRG_CHECK_PTR_WITH_RETURN(handle);
+    RRG_CHECK_PTR_WITH_RETURN(handle->bus);
+    RRG_CHECK_PTR_WITH_RETURN(profile);
+    int valid = profile->points && profile->point_count >= 1 && profile->point_count <= RRG_RAMP_MAX_POINTS &&
+                (profile->interpolation == RRG_RAMP_LINEAR || profile->interpolation == RRG_RAMP_STEP) &&
+                profile->read_every >= 0 && tick_us >= RRG_RAMP_MIN_TICK_US;
+    for (int i = 1; valid && i < profile->point_count; ++i)
+        valid = profile->points[i].t_us > profile->points[i - 1].t_us;
+    if (unlikely(!valid || profile->points[0].t_us < 0))
+    {
+        RRG_DEBUG_MSG("Invalid ramp profile or tick")
+        return _setHandleError(handle, ERROR_RRG_INVALID_PARAMETER, 0);
+    }
+    RRG_Ramp *ramp = handle->ramp;
+    if (ramp && _mbAtomicLoadInt(&ramp->running))
+        return _setHandleError(handle, ERROR_RRG_RAMP_RUNNING, 0);
+
+    // 2. Start from an empty ring and fresh statistics, with a private copy of the profile.
+    _destroyRamp(handle);
+    ramp = calloc(1, sizeof(*ramp));
+    RRG_RampPoint *points = malloc((size_t)profile->point_count * sizeof(RRG_RampPoint));
+    if (unlikely(!ramp || !points ||
+                 _mbRingInit(&ramp->ring, sizeof(RRG_RampTick), RRG_DEFAULT_RAMP_CAPACITY, NULL) != 0))
+    {
+        free(points);
+        free(ramp);
+        return _setHandleError(handle, ERROR_RRG_FAILED_START_RAMP, 0);
+    }
+    memcpy(points, profile->points, (size_t)profile->point_count * sizeof(RRG_RampPoint));
+    ramp->points = points;
+    ramp->point_count = profile->point_count;
+    ramp->interpolation = profile->interpolation;
+    ramp->read_every = profile->read_every;
+    ramp->tick_ns = tick_us * 1000LL;
+    ramp->handle = handle;
+    ramp->running = 1;
+    ramp->status.running = 1;
+    _mbMutexInit(&ramp->status_lock);
+
+    // 3. Spawn the ramp thread.
+    if (unlikely(_mbThreadCreate(&ramp->thread, _rampThread, ramp) != 0))
+    {
+        _mbMutexDestroy(&ramp->status_lock);
+        _mbRingDestroy(&ramp->ring);
+        free(points);
+        free(ramp);
+        return _setHandleError(handle, ERROR_RRG_FAILED_START_RAMP, 0);
+    }
+    ramp->joinable = 1;
+    handle->ramp = ramp;
+    return _setHandleError(handle, RRG_OK, 0);
+}
+
+void RRG_StopRamp(RRG_Handle *RRG_RESTRICT handle)
+{
+    // The thread also exits on its own at the end of the profile; it is joined here either way.
+    RRG_Ramp *ramp = handle ? handle->ramp : NULL;
+    if (ramp && ramp->joinable)
+    {
+        _mbAtomicStoreInt(&ramp->running, 0);
+        _mbThreadJoin(ramp->thread);
+        ramp->joinable = 0;
+    }
+}
+
+int RRG_GetRampStatus(RRG_Handle *RRG_RESTRICT handle, RRG_RampStatus *RRG_RESTRICT status)
+{
+    // 1. Validate input parameters.
+    RRG_CHECK_PTR_WITH_RETURN(handle);
+    RRG_CHECK_PTR_WITH_RETURN(status);
+
+    // 2. Copy the statistics and derive the averages.
+    memset(status, 0, sizeof(*status));
+    RRG_Ramp *ramp = handle->ramp;
+    if (ramp)
+    {
+        _mbMutexLock(&ramp->status_lock);
+        *status = ramp->status;
+        status->mean_late_ns = status->ticks ? ramp->late_sum_ns / (double)status->ticks : 0.0;
+        status->mean_abs_error = status->reads ? (float)(ramp->abs_error_sum / (double)status->reads) : 0.0f;
+        _mbMutexUnlock(&ramp->status_lock);
+    }
+    return _setHandleError(handle, RRG_OK, 0);
+}
+
+int RRG_DrainRampTicks(RRG_Handle *RRG_RESTRICT handle, RRG_RampTick *RRG_RESTRICT ticks, int max)
+{
+    // 1. Validate input parameters.
+    RRG_CHECK_PTR_WITH_RETURN(handle);
+    RRG_CHECK_PTR_WITH_RETURN(ticks);
+    if (unlikely(max < 0))
+        return _setHandleError(handle, ERROR_RRG_INVALID_PARAMETER, 0);
+
+    // 2. Pop what the ramp thread has published so far.
+    RRG_Ramp *ramp = handle->ramp;
+    int count = ramp ? (int)_mbRingPop(&ramp->ring, ticks, (size_t)max) : 0;
+    _setHandleError(handle, RRG_OK, 0);
+    return count;
+}
+
 void RRG_Close(RRG_Handle *RRG_RESTRICT handle)
 {
-    if (handle && handle->modbus_ctx)
+    // Queued requests point to the handle: let them complete before it goes away.
+    if (handle && handle->bus)
+        MB_BusFlush(handle->bus);
+    if (handle)
     {
-        modbus_close(handle->modbus_ctx);
-        modbus_free(handle->modbus_ctx);
+        _destroyAcquisition(handle);
+        _destroyRamp(handle);
     }
+
+    if (handle && handle->bus)
+    {
+        // The port itself is closed only when no other handle is attached to the bus.
+        MB_BusRemoveListener(handle->bus, &handle->reconnect_listener);
+        MB_BusClose(handle->bus);
+        handle->bus = NULL;
+        handle->modbus_ctx = NULL;
+    }
+    if (handle)
+    {
+        _mbFree(handle->arena, handle->rtu_frames);
+        handle->rtu_frames = NULL;
+        handle->fast_transport = 0;
+    }
+}
+
+int RRG_GetStats(const RRG_Handle *RRG_RESTRICT handle, RRG_Stats *RRG_RESTRICT stats)
+{
+    // 1. Validate input parameters.
+    RRG_CHECK_PTR_WITH_RETURN(handle);
+    RRG_CHECK_PTR_WITH_RETURN(stats);
+
+    // 2. Copy the counters one by one; other threads may be updating them.
+    _mbLoadCounters((uint64_t *)stats, (const uint64_t *)&handle->stats, sizeof(*stats) / sizeof(uint64_t));
+    return RRG_OK;
+}
+
+void RRG_ResetStats(RRG_Handle *RRG_RESTRICT handle)
+{
+    if (handle)
+        _mbResetCounters((uint64_t *)&handle->stats, sizeof(handle->stats) / sizeof(uint64_t));
 }
 
-const char *RRG_GetLastError()
+/// @brief Returns the description of an RRG error code.
+static const char *_errorToString(int error_code)
 {
-    switch (RRG_GlobalError)
+    switch (error_code)
     {
     case RRG_OK:
         return "No error.";
@@ -164,7 +1890,43 @@ const char *RRG_GetLastError()
         return "Error: Failed to write a MODBUS register.";
     case ERROR_RRG_INVALID_PARAMETER:
         return "Error: Invalid parameter provided to function.";
+    case ERROR_RRG_PORT_CONFIG_MISMATCH:
+        return "Error: Port is already open with different settings or from another arena.";
+    case ERROR_RRG_ACQUISITION_RUNNING:
+        return "Error: Acquisition is already running.";
+    case ERROR_RRG_FAILED_START_ACQUISITION:
+        return "Error: Failed to start the acquisition thread.";
+    case ERROR_RRG_QUEUE_FULL:
+        return "Error: The request queue of the bus is full.";
+    case ERROR_RRG_FAILED_START_WORKER:
+        return "Error: Failed to start the I/O worker thread of the bus.";
+    case ERROR_RRG_DEADLINE_EXPIRED:
+        return "Error: The deadline of the read passed before it could be sent.";
+    case ERROR_RRG_LINK_DOWN:
+        return "Error: The port or gateway connection was lost; the bus is reconnecting.";
+    case ERROR_RRG_RAMP_RUNNING:
+        return "Error: A ramp is already running.";
+    case ERROR_RRG_FAILED_START_RAMP:
+        return "Error: Failed to start the ramp thread.";
+    case ERROR_RRG_NOT_SUPPORTED:
+        return "Error: The port cannot be driven by the fast RTU transport.";
+    case ERROR_RRG_NO_RESPONSE:
+        return "Error: The regulator did not answer the probe request.";
     default:
         return "Unknown error occurred.";
     }
 }
+
+const char *RRG_GetLastError() { return _errorToString(RRG_GlobalError); }
+
+const char *RRG_GetLastErrorEx(const RRG_Handle *RRG_RESTRICT handle)
+{
+    return _errorToString(handle ? _mbAtomicLoadInt(&handle->last_error) : ERROR_RRG_INVALID_PARAMETER);
+}
+
+int RRG_GetLastErrorCodeEx(const RRG_Handle *RRG_RESTRICT handle, int *RRG_RESTRICT modbus_errno)
+{
+    if (modbus_errno)
+        *modbus_errno = handle ? _mbAtomicLoadInt(&handle->last_modbus_errno) : 0;
+    return handle ? _mbAtomicLoadInt(&handle->last_error) : ERROR_RRG_INVALID_PARAMETER;
+}
@@ -10,13 +10,21 @@ $DIST_DIR = ".\dist"
 $BUILD_DIR = ".\build"
 
 # Set QT_PLUGIN_PATH environment variable (if you need to correctly do it, change the path with yours)
-$env:QT_PLUGIN_PATH = "F:\RRG-Controller\venv\Lib\site-packages\PyQt5\Qt5\plugins"S
+$env:QT_PLUGIN_PATH = "F:\RRG-Controller\venv\Lib\site-packages\PyQt5\Qt5\plugins"
 
 # Clean previous builds
 Write-Host "Cleaning previous builds..."
 if (Test-Path $DIST_DIR) { Remove-Item -Recurse -Force $DIST_DIR }
 if (Test-Path $BUILD_DIR) { Remove-Item -Recurse -Force $BUILD_DIR }
 
+# Build the libraries from this tree; build.ps1 copies them to ui\resources, where the wrappers load them
+Write-Host "Building libraries..."
+& .\build.ps1
+if ($LASTEXITCODE -ne 0) {
+    Write-Host "Library build failed. Exiting..."
+    exit 1
+}
+
 # Create executable with PyInstaller directly from python
 # Recommended to use venv if you have problems with PyQt5 like this with encoding: https://github.com/pyinstaller/pyinstaller/issues/7385
 # Steps to resolve:
@@ -35,8 +43,9 @@ python -m PyInstaller --noconfirm `
 					  --add-data "ui;ui\" `
 					  --add-data "c_api;c_api\" `
 					  --add-data "ui/config;config\" `
-					  --add-binary "ui/resources/relay.dll;./" `
-					  --add-binary "ui/resources/rrg.dll;./" `
+					  --add-binary "ui/resources/librelay.dll;ui/resources/" `
+					  --add-binary "ui/resources/librrg.dll;ui/resources/" `
+					  --add-binary "ui/resources/libmb.dll;ui/resources/" `
 					  --paths "ui" `
 					  $MAIN_SCRIPT
 
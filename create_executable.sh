@@ -26,6 +26,7 @@ pyinstaller --noconfirm \
             --add-data "ui/config:config/" \
             --add-binary "ui/resources/librelay.so:ui/resources/" \
             --add-binary "ui/resources/librrg.so:ui/resources/" \
+            --add-binary "ui/resources/libmb.so:ui/resources/" \
             --paths "ui" \
             "$MAIN_SCRIPT"
 
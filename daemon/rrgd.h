@@ -0,0 +1,79 @@
+#ifndef RRGD_H
+#define RRGD_H
+
+/*
+ * Shared definitions of the device daemon. The regulator and relay channels live in separate
+ * translation units because their public headers cannot be included together; each keeps
+ * the handles of its channels and is driven by channel index from the main loop.
+ */
+
+#include <stdint.h>
+
+#include "mb_arena.h"
+#include "rrgd_shm.h"
+
+/**
+ * @struct RRGD_DeviceSpec
+ * @brief Device given on the command line (`port[,baudrate[,slave_id[,transport]]]`).
+ */
+typedef struct
+{
+    char port[RRGD_PORT_NAME_MAX]; ///< Serial port, or "host:port" of a gateway.
+    int baudrate;                  ///< Baud rate of a serial line.
+    int slave_id;                  ///< MODBUS address of the device.
+    int transport;                 ///< One of `MB_TRANSPORT_*`.
+    int timeout;                   ///< Response timeout (in milliseconds).
+    MB_Arena *arena;               ///< Storage of the device state (`NULL`: the heap).
+} RRGD_DeviceSpec;
+
+/**
+ * @brief Opens a regulator and starts its acquisition.
+ *
+ * @param channel Channel index (0 to `RRGD_MAX_CHANNELS` - 1), unused by any other device.
+ * @param spec Device to open.
+ * @param period_us Sampling period of the acquisition thread.
+ * @return `RRG_OK` on success, otherwise the error code (reported on `stderr`).
+ */
+int RRGD_RrgOpen(int channel, const RRGD_DeviceSpec *spec, int period_us);
+
+/**
+ * @brief Moves the samples acquired since the last call into `samples`.
+ * @param dropped Receives the number of samples the acquisition dropped so far.
+ * @return The number of samples copied.
+ */
+int RRGD_RrgDrain(int channel, RRGD_Sample *samples, int max, uint64_t *dropped);
+
+/// @brief Writes the setpoint of a regulator. Returns `RRG_OK` or the error code.
+int RRGD_RrgSetFlow(int channel, float setpoint);
+
+/// @brief Reads the flow of a regulator on the bus. Returns `RRG_OK` or the error code.
+int RRGD_RrgGetFlow(int channel, float *flow);
+
+/// @brief Selects the gas of a regulator. Returns `RRG_OK` or the error code.
+int RRGD_RrgSetGas(int channel, int gas_id);
+
+/// @brief Returns the message of the last error of a regulator channel.
+const char *RRGD_RrgError(int channel);
+
+/// @brief Stops the acquisition of a regulator and closes it.
+void RRGD_RrgClose(int channel);
+
+/**
+ * @brief Opens a relay.
+ *
+ * @param channel Channel index (0 to `RRGD_MAX_CHANNELS` - 1), unused by any other device.
+ * @param spec Device to open.
+ * @return `RELAY_OK` on success, otherwise the error code (reported on `stderr`).
+ */
+int RRGD_RelayOpen(int channel, const RRGD_DeviceSpec *spec);
+
+/// @brief Turns a relay on (`on` non-zero) or off. Returns `RELAY_OK` or the error code.
+int RRGD_RelaySet(int channel, int on);
+
+/// @brief Returns the message of the last error of a relay channel.
+const char *RRGD_RelayError(int channel);
+
+/// @brief Closes a relay.
+void RRGD_RelayClose(int channel);
+
+#endif // !RRGD_H
@@ -0,0 +1,570 @@
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "mb_bus.h"
+#include "mb_platform.h"
+#include "rrgd.h"
+
+#define RRGD_DEFAULT_SOCKET_PATH "/tmp/rrgd.sock"
+#define RRGD_DEFAULT_PERIOD_US 10000
+#define RRGD_DEFAULT_TIMEOUT_MS 50
+#define RRGD_DEFAULT_BAUDRATE 38400
+#define RRGD_DEFAULT_SLAVE_ID 1
+#define RRGD_MAX_CLIENTS 16
+#define RRGD_COMMAND_MAX 256
+#define RRGD_PUBLISH_BATCH 256
+#define RRGD_ARENA_SIZE (8 << 20)
+#define RRGD_MAX_GAS_ID 65535 // The gas register holds one 16-bit word.
+
+/**
+ * @struct RRGD_Client
+ * @brief Connection of a command client with its partial command line.
+ */
+typedef struct
+{
+    int fd;                      ///< Connected socket (-1 if the slot is free).
+    size_t length;               ///< Bytes of `line` received so far.
+    char line[RRGD_COMMAND_MAX]; ///< Command being received.
+} RRGD_Client;
+
+static volatile sig_atomic_t g_stop = 0;
+
+// Storage of the devices with `-L`: enough for a bus and an acquisition per channel.
+static unsigned char g_arena_storage[RRGD_ARENA_SIZE];
+
+/**
+ * @brief Signal handler for `SIGINT` and `SIGTERM`.
+ * @param sig Signal number.
+ */
+static void handle_stop(int sig)
+{
+    (void)sig;
+    g_stop = 1;
+}
+
+static void print_usage(const char *program)
+{
+    printf("Usage: %s [options] -r DEVICE [-r DEVICE ...] [-l DEVICE ...]\n"
+           "  -r DEVICE   Gas flow regulator: port[,baudrate[,slave_id[,transport]]] (repeatable).\n"
+           "  -l DEVICE   Relay, same format (repeatable).\n"
+           "              transport is rtu (default), tcp or rtu_over_tcp; port is then \"host:port\".\n"
+           "  -p US       Sampling period of the regulators in microseconds (default %d).\n"
+           "  -t MS       Response timeout in milliseconds (default %d).\n"
+           "  -m NAME     Shared-memory segment (default " RRGD_DEFAULT_SHM_NAME ").\n"
+           "  -S PATH     Command socket (default " RRGD_DEFAULT_SOCKET_PATH ").\n"
+           "  -L          Lock the memory and open the devices on static storage (no allocation once serving).\n"
+           "Commands, one line each: ping | set_flow CH SCCM | get_flow CH | set_gas CH ID | relay CH on|off\n",
+           program, RRGD_DEFAULT_PERIOD_US, RRGD_DEFAULT_TIMEOUT_MS);
+}
+
+/**
+ * @brief Parses a device given as `port[,baudrate[,slave_id[,transport]]]`.
+ * @return 0 on success, -1 on a malformed device.
+ */
+static int parse_device(const char *text, int timeout, RRGD_DeviceSpec *spec)
+{
+    char fields[4][RRGD_PORT_NAME_MAX];
+    int count = 0;
+    const char *cursor = text;
+    memset(fields, 0, sizeof(fields));
+    while (count < 4)
+    {
+        const char *end = strchr(cursor, ',');
+        size_t length = end ? (size_t)(end - cursor) : strlen(cursor);
+        if (length >= RRGD_PORT_NAME_MAX)
+            return -1;
+        memcpy(fields[count++], cursor, length);
+        if (!end)
+            break;
+        cursor = end + 1;
+    }
+    if (!fields[0][0] || (count == 4 && strchr(cursor, ',')))
+        return -1;
+
+    memset(spec, 0, sizeof(*spec));
+    memcpy(spec->port, fields[0], sizeof(spec->port));
+    spec->baudrate = count > 1 && fields[1][0] ? atoi(fields[1]) : RRGD_DEFAULT_BAUDRATE;
+    spec->slave_id = count > 2 && fields[2][0] ? atoi(fields[2]) : RRGD_DEFAULT_SLAVE_ID;
+    spec->timeout = timeout;
+    if (count < 4 || !fields[3][0] || strcmp(fields[3], "rtu") == 0)
+        spec->transport = MB_TRANSPORT_RTU;
+    else if (strcmp(fields[3], "tcp") == 0)
+        spec->transport = MB_TRANSPORT_TCP;
+    else if (strcmp(fields[3], "rtu_over_tcp") == 0)
+        spec->transport = MB_TRANSPORT_RTU_OVER_TCP;
+    else
+        return -1;
+    return spec->baudrate > 0 && spec->slave_id >= 0 ? 0 : -1;
+}
+
+/**
+ * @brief Creates the shared-memory segment, replacing the one of a previous run.
+ *
+ * The old segment is unlinked rather than reused, so readers still mapping it keep a
+ * consistent (stale) copy instead of watching it being cleared.
+ *
+ * @return The mapped segment, or `NULL` on failure (`errno` is set).
+ */
+static RRGD_Segment *create_segment(const char *name)
+{
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+        return NULL;
+    void *address = MAP_FAILED;
+    if (ftruncate(fd, sizeof(RRGD_Segment)) == 0)
+        address = mmap(NULL, sizeof(RRGD_Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED)
+    {
+        shm_unlink(name);
+        return NULL;
+    }
+    return address;
+}
+
+/**
+ * @brief Binds the command socket, refusing to take over the socket of a running daemon.
+ * @return The listening socket, or -1 on failure.
+ */
+static int open_command_socket(const char *path)
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+
+    // A socket left by a daemon that died is stale; one that accepts connections is not.
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, (struct sockaddr *)&address, sizeof(address)) == 0)
+    {
+        close(fd);
+        errno = EADDRINUSE;
+        return -1;
+    }
+    close(fd);
+    unlink(path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    if (fcntl(fd, F_SETFL, O_NONBLOCK) != 0 || bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(fd, RRGD_MAX_CLIENTS) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/// @brief Starts updating a snapshot: readers retry until `end_snapshot()`.
+static void begin_snapshot(RRGD_Channel *channel)
+{
+    __atomic_store_n(&channel->sequence, channel->sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/// @brief Publishes the snapshot updated since `begin_snapshot()`.
+static void end_snapshot(RRGD_Channel *channel)
+{
+    __atomic_store_n(&channel->sequence, channel->sequence + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Moves the samples acquired for a regulator channel into its ring and snapshot.
+ * @return The number of samples published.
+ */
+static int publish_samples(RRGD_Segment *segment, int index)
+{
+    RRGD_Channel *channel = &segment->channels[index];
+    RRGD_Sample batch[RRGD_PUBLISH_BATCH];
+    uint64_t dropped = 0;
+    int total = 0, count;
+    while ((count = RRGD_RrgDrain(index, batch, RRGD_PUBLISH_BATCH, &dropped)) > 0)
+    {
+        // 1. Announce the slots about to be overwritten, then fill them and publish the new head.
+        uint64_t head = channel->head;
+        __atomic_store_n(&channel->reserved, head + (uint64_t)count, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        for (int i = 0; i < count; ++i)
+            channel->ring[(head + (uint64_t)i) % RRGD_RING_CAPACITY] = batch[i];
+        __atomic_store_n(&channel->head, head + (uint64_t)count, __ATOMIC_RELEASE);
+
+        // 2. The newest sample becomes the snapshot.
+        const RRGD_Sample *last = &batch[count - 1];
+        begin_snapshot(channel);
+        channel->snapshot.t_ns = last->t_ns;
+        channel->snapshot.flow = last->flow;
+        channel->snapshot.status = last->status;
+        channel->snapshot.samples += (uint64_t)count;
+        channel->snapshot.dropped = dropped;
+        end_snapshot(channel);
+        total += count;
+        if (count < RRGD_PUBLISH_BATCH)
+            break;
+    }
+    return total;
+}
+
+/// @brief Records the outcome of a command in the snapshot of its channel.
+static void record_command(RRGD_Channel *channel, int status, int flag, float setpoint, int value)
+{
+    begin_snapshot(channel);
+    RRGD_Snapshot *snapshot = &channel->snapshot;
+    snapshot->t_ns = _mbMonotonicNs();
+    snapshot->status = status;
+    ++snapshot->commands;
+    if (status == 0)
+    {
+        snapshot->flags |= flag;
+        if (flag == RRGD_SNAPSHOT_SETPOINT)
+            snapshot->setpoint = setpoint;
+        else if (flag == RRGD_SNAPSHOT_GAS)
+            snapshot->gas_id = value;
+        else if (flag == RRGD_SNAPSHOT_RELAY)
+            snapshot->relay_on = value;
+    }
+    end_snapshot(channel);
+}
+
+/**
+ * @brief Parses a setpoint argument: the whole text must be a finite number.
+ * @return 0 on success, -1 on a malformed argument.
+ */
+static int parse_setpoint(const char *text, float *setpoint)
+{
+    char *end = NULL;
+    errno = 0;
+    float value = strtof(text, &end);
+    if (end == text || *end != '\0' || errno == ERANGE || !isfinite(value))
+        return -1;
+    *setpoint = value;
+    return 0;
+}
+
+/**
+ * @brief Parses a gas ID argument: the whole text must be an integer from 0 to `RRGD_MAX_GAS_ID`.
+ * @return 0 on success, -1 on a malformed argument.
+ */
+static int parse_gas_id(const char *text, int *gas_id)
+{
+    char *end = NULL;
+    errno = 0;
+    long value = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || value < 0 || value > RRGD_MAX_GAS_ID)
+        return -1;
+    *gas_id = (int)value;
+    return 0;
+}
+
+/**
+ * @brief Runs one command line and formats its reply ("ok[ VALUE]" or "error CODE MESSAGE").
+ */
+static void run_command(RRGD_Segment *segment, const char *line, char *reply, size_t reply_size)
+{
+    char verb[32], argument[32];
+    int index = -1, status = 0;
+    int fields = sscanf(line, "%31s %d %31s", verb, &index, argument);
+    if (fields >= 1 && strcmp(verb, "ping") == 0)
+    {
+        snprintf(reply, reply_size, "ok\n");
+        return;
+    }
+    int kind = fields >= 2 && index >= 0 && index < (int)segment->channel_count ? segment->info[index].kind : 0;
+    RRGD_Channel *channel = kind ? &segment->channels[index] : NULL;
+    const char *message = NULL;
+
+    if (fields < 1)
+        message = "empty command";
+    else if (strcmp(verb, "set_flow") == 0 && kind == RRGD_CHANNEL_RRG && fields == 3)
+    {
+        float setpoint = 0.0f;
+        if (parse_setpoint(argument, &setpoint) != 0)
+            message = "invalid argument";
+        else
+        {
+            status = RRGD_RrgSetFlow(index, setpoint);
+            record_command(channel, status, RRGD_SNAPSHOT_SETPOINT, setpoint, 0);
+            message = status ? RRGD_RrgError(index) : NULL;
+        }
+    }
+    else if (strcmp(verb, "get_flow") == 0 && kind == RRGD_CHANNEL_RRG && fields == 2)
+    {
+        float flow = 0.0f;
+        status = RRGD_RrgGetFlow(index, &flow);
+        if (status == 0)
+        {
+            snprintf(reply, reply_size, "ok %.3f\n", flow);
+            return;
+        }
+        message = RRGD_RrgError(index);
+    }
+    else if (strcmp(verb, "set_gas") == 0 && kind == RRGD_CHANNEL_RRG && fields == 3)
+    {
+        int gas_id = 0;
+        if (parse_gas_id(argument, &gas_id) != 0)
+            message = "invalid argument";
+        else
+        {
+            status = RRGD_RrgSetGas(index, gas_id);
+            record_command(channel, status, RRGD_SNAPSHOT_GAS, 0.0f, gas_id);
+            message = status ? RRGD_RrgError(index) : NULL;
+        }
+    }
+    else if (strcmp(verb, "relay") == 0 && kind == RRGD_CHANNEL_RELAY && fields == 3 &&
+             (strcmp(argument, "on") == 0 || strcmp(argument, "off") == 0))
+    {
+        int on = strcmp(argument, "on") == 0;
+        status = RRGD_RelaySet(index, on);
+        record_command(channel, status, RRGD_SNAPSHOT_RELAY, 0.0f, on);
+        message = status ? RRGD_RelayError(index) : NULL;
+    }
+    else
+        message = "unknown command or channel";
+
+    if (message)
+        snprintf(reply, reply_size, "error %d %s\n", status ? status : -1, message);
+    else
+        snprintf(reply, reply_size, "ok\n");
+}
+
+/**
+ * @brief Reads what a client sent and answers every complete line.
+ * @return 0 while the client stays connected, -1 once it must be dropped.
+ */
+static int serve_client(RRGD_Segment *segment, RRGD_Client *client)
+{
+    ssize_t received = recv(client->fd, client->line + client->length, sizeof(client->line) - client->length, 0);
+    if (received == 0 || (received < 0 && errno != EAGAIN && errno != EINTR))
+        return -1;
+    if (received < 0)
+        return 0;
+    client->length += (size_t)received;
+
+    char *newline;
+    while ((newline = memchr(client->line, '\n', client->length)) != NULL)
+    {
+        *newline = '\0';
+        char reply[RRGD_COMMAND_MAX];
+        run_command(segment, client->line, reply, sizeof(reply));
+        // Replies are short: a client that cannot take one is not reading them and is dropped.
+        size_t reply_length = strlen(reply);
+        if (send(client->fd, reply, reply_length, MSG_DONTWAIT) != (ssize_t)reply_length)
+            return -1;
+        size_t consumed = (size_t)(newline - client->line) + 1;
+        memmove(client->line, newline + 1, client->length - consumed);
+        client->length -= consumed;
+    }
+    // A line longer than the buffer is no command.
+    return client->length < sizeof(client->line) ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+    // 1. Parse the command line.
+    const char *shm_name = RRGD_DEFAULT_SHM_NAME, *socket_path = RRGD_DEFAULT_SOCKET_PATH;
+    const char *devices[RRGD_MAX_CHANNELS];
+    int kinds[RRGD_MAX_CHANNELS];
+    int device_count = 0, period_us = RRGD_DEFAULT_PERIOD_US, timeout = RRGD_DEFAULT_TIMEOUT_MS, opt;
+    int lock_memory = 0;
+    while ((opt = getopt(argc, argv, "r:l:p:t:m:S:Lh")) != -1)
+    {
+        switch (opt)
+        {
+        case 'r':
+        case 'l':
+            if (device_count == RRGD_MAX_CHANNELS)
+            {
+                fprintf(stderr, "At most %d devices are supported.\n", RRGD_MAX_CHANNELS);
+                return 1;
+            }
+            kinds[device_count] = opt == 'r' ? RRGD_CHANNEL_RRG : RRGD_CHANNEL_RELAY;
+            devices[device_count++] = optarg;
+            break;
+        case 'p':
+            period_us = atoi(optarg);
+            break;
+        case 't':
+            timeout = atoi(optarg);
+            break;
+        case 'm':
+            shm_name = optarg;
+            break;
+        case 'S':
+            socket_path = optarg;
+            break;
+        case 'L':
+            lock_memory = 1;
+            break;
+        default:
+            print_usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    RRGD_DeviceSpec specs[RRGD_MAX_CHANNELS];
+    int valid = device_count > 0 && period_us > 0 && timeout > 0;
+    for (int i = 0; i < device_count && valid; ++i)
+        valid = parse_device(devices[i], timeout, &specs[i]) == 0;
+    if (!valid)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // 2. Claim the command socket first: a second daemon must not touch the ports.
+    int listener = open_command_socket(socket_path);
+    if (listener < 0)
+    {
+        perror(socket_path);
+        return 1;
+    }
+    RRGD_Segment *segment = create_segment(shm_name);
+    if (!segment)
+    {
+        perror(shm_name);
+        close(listener);
+        unlink(socket_path);
+        return 1;
+    }
+
+    // 3. Open every device; devices on the same port share its bus. With `-L`, the memory is
+    // locked first, so the storage of the devices and the stacks of their threads stay resident.
+    int status = 0, opened = 0;
+    MB_Arena arena;
+    if (lock_memory)
+    {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        {
+            perror("mlockall");
+            status = 1;
+        }
+        MB_ArenaInit(&arena, g_arena_storage, sizeof(g_arena_storage));
+        for (int i = 0; i < device_count; ++i)
+            specs[i].arena = &arena;
+    }
+    for (; opened < device_count && status == 0; ++opened)
+    {
+        RRGD_ChannelInfo *info = &segment->info[opened];
+        info->kind = kinds[opened];
+        info->slave_id = specs[opened].slave_id;
+        memcpy(info->port, specs[opened].port, sizeof(info->port));
+        status = kinds[opened] == RRGD_CHANNEL_RRG ? RRGD_RrgOpen(opened, &specs[opened], period_us)
+                                                   : RRGD_RelayOpen(opened, &specs[opened]);
+    }
+    if (status != 0 && opened > 0)
+        --opened;
+
+    // 4. Mark the segment ready for readers; the magic number comes last.
+    segment->version = RRGD_SHM_VERSION;
+    segment->channel_count = (uint32_t)opened;
+    segment->ring_capacity = RRGD_RING_CAPACITY;
+    segment->pid = (int64_t)getpid();
+    segment->updated_ns = _mbMonotonicNs();
+    if (status == 0)
+    {
+        __atomic_store_n(&segment->magic, RRGD_SHM_MAGIC, __ATOMIC_RELEASE);
+        printf("Serving %d devices: shared memory %s, commands on %s. Stop with Ctrl+C or SIGTERM.\n", opened,
+               shm_name, socket_path);
+        if (lock_memory)
+            printf("Memory locked, %zu KiB of device storage in use.\n", MB_ArenaUsed(&arena) / 1024);
+        fflush(stdout);
+    }
+
+    // 5. Publish the samples and serve the commands until stopped. Commands run on this
+    // thread; the acquisition keeps buffering meanwhile, so no sample is lost.
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_stop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    RRGD_Client clients[RRGD_MAX_CLIENTS];
+    for (int i = 0; i < RRGD_MAX_CLIENTS; ++i)
+        clients[i].fd = -1;
+    int publish_ms = period_us / 2000;
+    publish_ms = publish_ms < 1 ? 1 : publish_ms > 100 ? 100 : publish_ms;
+    while (status == 0 && !g_stop)
+    {
+        struct pollfd fds[RRGD_MAX_CLIENTS + 1];
+        int slots[RRGD_MAX_CLIENTS + 1];
+        int nfds = 0;
+        fds[nfds].fd = listener;
+        fds[nfds++].events = POLLIN;
+        for (int i = 0; i < RRGD_MAX_CLIENTS; ++i)
+            if (clients[i].fd >= 0)
+            {
+                slots[nfds] = i;
+                fds[nfds].fd = clients[i].fd;
+                fds[nfds++].events = POLLIN;
+            }
+        if (poll(fds, (nfds_t)nfds, publish_ms) < 0 && errno != EINTR)
+        {
+            perror("poll");
+            status = 1;
+            break;
+        }
+
+        for (int i = 1; i < nfds; ++i)
+            if (fds[i].revents && serve_client(segment, &clients[slots[i]]) != 0)
+            {
+                close(clients[slots[i]].fd);
+                clients[slots[i]].fd = -1;
+            }
+        if (fds[0].revents & POLLIN)
+        {
+            int fd = accept(listener, NULL, NULL);
+            int slot = 0;
+            while (fd >= 0 && slot < RRGD_MAX_CLIENTS && clients[slot].fd >= 0)
+                ++slot;
+            if (fd >= 0 && (slot == RRGD_MAX_CLIENTS || fcntl(fd, F_SETFL, O_NONBLOCK) != 0))
+                close(fd);
+            else if (fd >= 0)
+            {
+                clients[slot].fd = fd;
+                clients[slot].length = 0;
+            }
+        }
+
+        for (int i = 0; i < opened; ++i)
+            if (segment->info[i].kind == RRGD_CHANNEL_RRG)
+                publish_samples(segment, i);
+        __atomic_store_n(&segment->updated_ns, _mbMonotonicNs(), __ATOMIC_RELEASE);
+    }
+
+    // 6. Withdraw the segment before the devices go away.
+    __atomic_store_n(&segment->magic, 0u, __ATOMIC_RELEASE);
+    for (int i = 0; i < RRGD_MAX_CLIENTS; ++i)
+        if (clients[i].fd >= 0)
+            close(clients[i].fd);
+    close(listener);
+    unlink(socket_path);
+    for (int i = 0; i < opened; ++i)
+    {
+        if (segment->info[i].kind == RRGD_CHANNEL_RRG)
+            RRGD_RrgClose(i);
+        else
+            RRGD_RelayClose(i);
+    }
+    munmap(segment, sizeof(RRGD_Segment));
+    shm_unlink(shm_name);
+    return status == 0 ? 0 : 1;
+}
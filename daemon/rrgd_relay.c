@@ -0,0 +1,33 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "relay.h"
+#include "rrgd.h"
+
+// Handles of the relay channels, indexed like the channels of the segment.
+static Relay_Handle g_handles[RRGD_MAX_CHANNELS];
+
+int RRGD_RelayOpen(int channel, const RRGD_DeviceSpec *spec)
+{
+    Relay_Config config;
+    memset(&config, 0, sizeof(config));
+    config.port = (char *)spec->port;
+    config.baudrate = spec->baudrate;
+    config.slave_id = spec->slave_id;
+    config.timeout = spec->timeout;
+    config.transport = spec->transport;
+    config.arena = spec->arena;
+    int error_code = RELAY_Init(&config, &g_handles[channel]);
+    if (error_code != RELAY_OK)
+        fprintf(stderr, "RELAY_Init failed on %s: %s\n", spec->port, RELAY_GetLastError());
+    return error_code;
+}
+
+int RRGD_RelaySet(int channel, int on)
+{
+    return on ? RELAY_TurnOn(&g_handles[channel]) : RELAY_TurnOff(&g_handles[channel]);
+}
+
+const char *RRGD_RelayError(int channel) { return RELAY_GetLastErrorEx(&g_handles[channel]); }
+
+void RRGD_RelayClose(int channel) { RELAY_Close(&g_handles[channel]); }
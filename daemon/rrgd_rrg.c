@@ -0,0 +1,61 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "rrg.h"
+#include "rrgd.h"
+
+// The samples are drained straight into the publishing buffer.
+_Static_assert(sizeof(RRGD_Sample) == sizeof(RRG_Sample) && offsetof(RRGD_Sample, flow) == offsetof(RRG_Sample, flow) &&
+                   offsetof(RRGD_Sample, status) == offsetof(RRG_Sample, status),
+               "RRGD_Sample must keep the layout of RRG_Sample");
+
+// Handles of the regulator channels, indexed like the channels of the segment.
+static RRG_Handle g_handles[RRGD_MAX_CHANNELS];
+
+int RRGD_RrgOpen(int channel, const RRGD_DeviceSpec *spec, int period_us)
+{
+    // 1. Open the regulator.
+    RRG_Config config;
+    memset(&config, 0, sizeof(config));
+    config.port = (char *)spec->port;
+    config.baudrate = spec->baudrate;
+    config.slave_id = spec->slave_id;
+    config.timeout = spec->timeout;
+    config.transport = spec->transport;
+    config.arena = spec->arena;
+    RRG_Handle *handle = &g_handles[channel];
+    int error_code = RRG_Init(&config, handle);
+    if (error_code != RRG_OK)
+    {
+        fprintf(stderr, "RRG_Init failed on %s: %s\n", spec->port, RRG_GetLastError());
+        return error_code;
+    }
+
+    // 2. Sample it in the background; the main loop publishes the samples.
+    error_code = RRG_StartAcquisition(handle, period_us);
+    if (error_code != RRG_OK)
+    {
+        fprintf(stderr, "RRG_StartAcquisition failed on %s: %s\n", spec->port, RRG_GetLastErrorEx(handle));
+        RRG_Close(handle);
+    }
+    return error_code;
+}
+
+int RRGD_RrgDrain(int channel, RRGD_Sample *samples, int max, uint64_t *dropped)
+{
+    RRG_Handle *handle = &g_handles[channel];
+    *dropped = RRG_GetDroppedSamples(handle);
+    int count = RRG_DrainSamples(handle, (RRG_Sample *)samples, max);
+    return count > 0 ? count : 0;
+}
+
+int RRGD_RrgSetFlow(int channel, float setpoint) { return RRG_SetFlow(&g_handles[channel], setpoint); }
+
+int RRGD_RrgGetFlow(int channel, float *flow) { return RRG_GetFlow(&g_handles[channel], flow); }
+
+int RRGD_RrgSetGas(int channel, int gas_id) { return RRG_SetGas(&g_handles[channel], gas_id); }
+
+const char *RRGD_RrgError(int channel) { return RRG_GetLastErrorEx(&g_handles[channel]); }
+
+void RRGD_RrgClose(int channel) { RRG_Close(&g_handles[channel]); }
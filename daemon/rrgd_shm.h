@@ -0,0 +1,256 @@
+#ifndef RRGD_SHM_H
+#define RRGD_SHM_H
+
+/*
+ * Layout of the shared-memory segment published by the device daemon (rrgd), and the
+ * functions its readers use. The header is self-contained (POSIX shared memory and GCC/Clang
+ * atomics only), so a client maps the segment and reads telemetry without linking any
+ * library of this project or touching a bus.
+ *
+ * The daemon is the only writer. Every channel holds the latest snapshot of its device,
+ * protected by a seqlock, and a ring of the acquired samples. Readers never block the daemon
+ * or each other: a snapshot read retries while the daemon updates it, and a ring read drops
+ * the samples the daemon overwrote meanwhile.
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @def RRGD_SHM_MAGIC
+ * @brief First word of a ready segment ("RRGD"); it is stored last when the daemon starts.
+ */
+#define RRGD_SHM_MAGIC 0x44475252u
+
+/**
+ * @def RRGD_SHM_VERSION
+ * @brief Version of the segment layout, bumped on every incompatible change.
+ */
+#define RRGD_SHM_VERSION 1u
+
+/**
+ * @def RRGD_DEFAULT_SHM_NAME
+ * @brief Name of the segment passed to `shm_open()` unless the daemon is given another one.
+ */
+#define RRGD_DEFAULT_SHM_NAME "/rrgd"
+
+/**
+ * @def RRGD_MAX_CHANNELS
+ * @brief Largest number of devices (regulators and relays) of one daemon.
+ */
+#define RRGD_MAX_CHANNELS 32
+
+/**
+ * @def RRGD_RING_CAPACITY
+ * @brief Samples kept per channel; a power of two.
+ */
+#define RRGD_RING_CAPACITY 4096
+
+/**
+ * @def RRGD_PORT_NAME_MAX
+ * @brief Size of the port name of a channel, terminating NUL included.
+ */
+#define RRGD_PORT_NAME_MAX 64
+
+/**
+ * @def RRGD_CHANNEL_RRG
+ * @brief `RRGD_ChannelInfo::kind`: gas flow regulator.
+ */
+#define RRGD_CHANNEL_RRG 1
+
+/**
+ * @def RRGD_CHANNEL_RELAY
+ * @brief `RRGD_ChannelInfo::kind`: relay.
+ */
+#define RRGD_CHANNEL_RELAY 2
+
+/**
+ * @def RRGD_SNAPSHOT_SETPOINT
+ * @brief `RRGD_Snapshot::flags`: `setpoint` holds the last setpoint written through the daemon.
+ */
+#define RRGD_SNAPSHOT_SETPOINT 0x01
+
+/**
+ * @def RRGD_SNAPSHOT_GAS
+ * @brief `RRGD_Snapshot::flags`: `gas_id` holds the last gas selected through the daemon.
+ */
+#define RRGD_SNAPSHOT_GAS 0x02
+
+/**
+ * @def RRGD_SNAPSHOT_RELAY
+ * @brief `RRGD_Snapshot::flags`: `relay_on` holds the last state commanded through the daemon.
+ */
+#define RRGD_SNAPSHOT_RELAY 0x04
+
+/**
+ * @struct RRGD_Sample
+ * @brief Acquired flow sample, with the layout of `RRG_Sample`.
+ */
+typedef struct
+{
+    int64_t t_ns;   ///< Monotonic clock timestamp of the request (in nanoseconds).
+    float flow;     ///< Measured flow in SCCM (0 if the read failed).
+    int32_t status; ///< `RRG_OK`, or the error code of the failed read.
+} RRGD_Sample;
+
+/**
+ * @struct RRGD_Snapshot
+ * @brief Latest known state of one device.
+ */
+typedef struct
+{
+    int64_t t_ns;      ///< Time of the last sample or command (monotonic clock, in nanoseconds).
+    float flow;        ///< Flow of the last sample, in SCCM.
+    float setpoint;    ///< Last setpoint written, in SCCM (valid with `RRGD_SNAPSHOT_SETPOINT`).
+    int32_t gas_id;    ///< Last gas selected (valid with `RRGD_SNAPSHOT_GAS`).
+    int32_t relay_on;  ///< Non-zero if the relay was last turned on (valid with `RRGD_SNAPSHOT_RELAY`).
+    int32_t status;    ///< Status of the last sample or command (0 on success).
+    int32_t flags;     ///< `RRGD_SNAPSHOT_*` flags.
+    uint64_t samples;  ///< Samples published to the ring.
+    uint64_t dropped;  ///< Samples the acquisition dropped before the daemon could publish them.
+    uint64_t commands; ///< Commands executed on the device.
+} RRGD_Snapshot;
+
+/**
+ * @struct RRGD_ChannelInfo
+ * @brief Device behind a channel, fixed while the daemon runs.
+ */
+typedef struct
+{
+    int32_t kind;                  ///< `RRGD_CHANNEL_RRG` or `RRGD_CHANNEL_RELAY`.
+    int32_t slave_id;              ///< MODBUS address of the device.
+    char port[RRGD_PORT_NAME_MAX]; ///< Port or gateway endpoint of the device.
+} RRGD_ChannelInfo;
+
+/**
+ * @struct RRGD_Channel
+ * @brief Telemetry of one device: a seqlock protected snapshot and the sample ring.
+ */
+typedef struct
+{
+    uint64_t sequence;                    ///< Seqlock of `snapshot`: odd while the daemon writes it.
+    RRGD_Snapshot snapshot;               ///< Latest state.
+    uint64_t head;                        ///< Samples written so far (published with release semantics).
+    uint64_t reserved;                    ///< Samples written once the current batch is done (stored before it).
+    RRGD_Sample ring[RRGD_RING_CAPACITY]; ///< Sample `i` is in slot `i % RRGD_RING_CAPACITY`.
+} RRGD_Channel;
+
+/**
+ * @struct RRGD_Segment
+ * @brief Whole shared-memory segment.
+ */
+typedef struct
+{
+    uint32_t magic;                           ///< `RRGD_SHM_MAGIC` once the segment is ready.
+    uint32_t version;                         ///< `RRGD_SHM_VERSION`.
+    uint32_t channel_count;                   ///< Channels in use.
+    uint32_t ring_capacity;                   ///< `RRGD_RING_CAPACITY`.
+    int64_t pid;                              ///< Process ID of the daemon.
+    int64_t updated_ns;                       ///< Last time the daemon published (monotonic clock), a liveness beat.
+    RRGD_ChannelInfo info[RRGD_MAX_CHANNELS]; ///< Devices of the channels.
+    RRGD_Channel channels[RRGD_MAX_CHANNELS]; ///< Telemetry of the channels.
+} RRGD_Segment;
+
+/**
+ * @brief Maps the segment of a running daemon read-only.
+ *
+ * @param name Name of the segment (e.g., `RRGD_DEFAULT_SHM_NAME`).
+ * @return The segment, or `NULL` if no compatible daemon published it (`errno` is set).
+ */
+static inline const RRGD_Segment *RRGD_MapSegment(const char *name)
+{
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return NULL;
+    void *address = mmap(NULL, sizeof(RRGD_Segment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED)
+        return NULL;
+    const RRGD_Segment *segment = address;
+    if (__atomic_load_n(&segment->magic, __ATOMIC_ACQUIRE) != RRGD_SHM_MAGIC ||
+        segment->version != RRGD_SHM_VERSION)
+    {
+        munmap(address, sizeof(RRGD_Segment));
+        return NULL;
+    }
+    return segment;
+}
+
+/// @brief Unmaps a segment returned by `RRGD_MapSegment()`.
+static inline void RRGD_UnmapSegment(const RRGD_Segment *segment)
+{
+    if (segment)
+        munmap((void *)segment, sizeof(RRGD_Segment));
+}
+
+/**
+ * @brief Copies the latest snapshot of a channel, retrying while the daemon updates it.
+ */
+static inline void RRGD_ReadSnapshot(const RRGD_Channel *channel, RRGD_Snapshot *snapshot)
+{
+    for (;;)
+    {
+        uint64_t before = __atomic_load_n(&channel->sequence, __ATOMIC_ACQUIRE);
+        if (!(before & 1))
+        {
+            memcpy(snapshot, (const void *)&channel->snapshot, sizeof(*snapshot));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&channel->sequence, __ATOMIC_RELAXED) == before)
+                return;
+        }
+    }
+}
+
+/**
+ * @brief Copies the samples of a channel published after `*cursor`, oldest first.
+ *
+ * Start with `*cursor` = 0 for the whole ring (or `channel->head` for new samples only). A
+ * reader that falls more than `RRGD_RING_CAPACITY` samples behind skips the ones it missed.
+ *
+ * @param cursor Samples consumed so far; advanced past the samples returned and the ones lost.
+ * @param samples Caller-provided array of at least `max` samples.
+ * @param lost Optional pointer that receives the number of samples skipped because the daemon
+ *             overwrote them.
+ * @return The number of samples copied (0 without touching `*cursor` if `max` <= 0).
+ */
+static inline int RRGD_ReadSamples(const RRGD_Channel *channel, uint64_t *cursor, RRGD_Sample *samples, int max,
+                                   uint64_t *lost)
+{
+    // 1. Nothing fits in an empty (or negative) buffer: leave the cursor where it is.
+    if (max <= 0)
+    {
+        if (lost)
+            *lost = 0;
+        return 0;
+    }
+
+    // 2. Start at the oldest sample still in the ring (a restarted daemon counts from 0 again).
+    uint64_t head = __atomic_load_n(&channel->head, __ATOMIC_ACQUIRE);
+    uint64_t start = *cursor <= head ? *cursor : 0;
+    if (head - start > RRGD_RING_CAPACITY)
+        start = head - RRGD_RING_CAPACITY;
+    uint64_t end = head - start > (uint64_t)max ? start + (uint64_t)max : head;
+    for (uint64_t i = start; i < end; ++i)
+        samples[i - start] = channel->ring[i % RRGD_RING_CAPACITY];
+
+    // 3. Drop the samples the daemon started overwriting while they were copied.
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    uint64_t reserved = __atomic_load_n(&channel->reserved, __ATOMIC_RELAXED);
+    uint64_t valid = reserved > RRGD_RING_CAPACITY ? reserved - RRGD_RING_CAPACITY : 0;
+    uint64_t first = start;
+    if (valid > first)
+    {
+        first = valid < end ? valid : end;
+        memmove(samples, samples + (first - start), (size_t)(end - first) * sizeof(RRGD_Sample));
+    }
+    if (lost)
+        *lost = first - (*cursor <= head ? *cursor : 0);
+    *cursor = end;
+    return (int)(end - first);
+}
+
+#endif // !RRGD_SHM_H
@@ -0,0 +1,177 @@
+/*
+ * Devices opened on an arena allocate nothing after their init: the request paths of a
+ * regulator and a relay and the acquisition loop run while every heap allocation of the
+ * process is counted. Runs on a simulated line, without hardware.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mb_platform.h"
+#include "mb_sim.h"
+#include "rrg.h"
+#include "test_arena_alloc.h"
+
+#define TEST_PORT "test-arena-alloc"
+#define TEST_RRG_SLAVE_ID 1
+#define TEST_RELAY_SLAVE_ID 2
+#define TEST_ARENA_SIZE (4 << 20)
+#define TEST_ITERATIONS 200
+#define TEST_ACQUISITION_PERIOD_US 1000
+#define TEST_ACQUISITION_RUN_NS 50000000LL
+#define TEST_SKIPPED 77 // Return code CTest reports as a skipped test.
+
+#define CHECK(condition)                                                                                  \
+    do                                                                                                    \
+    {                                                                                                     \
+        if (!(condition))                                                                                 \
+        {                                                                                                 \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);                 \
+            return 1;                                                                                     \
+        }                                                                                                 \
+    } while (0)
+
+#ifdef __GLIBC__
+
+/*
+ * Counts the heap allocations of the whole process by wrapping the allocator of glibc, which
+ * keeps its own entry points exported (as benchmarks/bench_alloc.c does).
+ */
+
+static int g_counting = 0;
+static uint64_t g_allocations = 0;
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *block, size_t size);
+
+/// @brief Counts one allocation if counting is on.
+static void _countAllocation(void)
+{
+    if (__atomic_load_n(&g_counting, __ATOMIC_RELAXED))
+        __atomic_fetch_add(&g_allocations, 1, __ATOMIC_RELAXED);
+}
+
+void *malloc(size_t size)
+{
+    _countAllocation();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    _countAllocation();
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *block, size_t size)
+{
+    _countAllocation();
+    return __libc_realloc(block, size);
+}
+
+uint64_t TEST_AllocationCount(void) { return __atomic_load_n(&g_allocations, __ATOMIC_RELAXED); }
+
+/// @brief Starts counting the allocations from zero.
+static void _startCounting(void)
+{
+    __atomic_store_n(&g_allocations, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_counting, 1, __ATOMIC_RELAXED);
+}
+
+/// @brief Stops counting; returns the allocations made since `_startCounting()`.
+static uint64_t _stopCounting(void)
+{
+    __atomic_store_n(&g_counting, 0, __ATOMIC_RELAXED);
+    return TEST_AllocationCount();
+}
+
+static unsigned char g_storage[TEST_ARENA_SIZE];
+
+int main(void)
+{
+    // 1. A line with a regulator and a relay, both opened on one arena.
+    MB_SimConfig sim_config = {TEST_PORT, 0.0, 0, 1, 0};
+    MB_SimSlave relay_slave = {TEST_RELAY_SLAVE_ID, 0, 0, 0, 0, 0};
+    MB_Sim *sim = NULL;
+    CHECK(MB_SimOpen(&sim_config, &sim) == MB_OK);
+    CHECK(RRG_SimAddRegulator(sim, TEST_RRG_SLAVE_ID, 10) == RRG_OK);
+    CHECK(MB_SimAddSlave(sim, &relay_slave) == MB_OK);
+
+    MB_Arena arena;
+    CHECK(MB_ArenaInit(&arena, g_storage, sizeof g_storage) == MB_OK);
+    RRG_Config config = {0};
+    config.port = TEST_PORT;
+    config.transport = MB_TRANSPORT_SIM;
+    config.slave_id = TEST_RRG_SLAVE_ID;
+    config.timeout = 100;
+    config.setpoint_write_mode = RRG_SETPOINT_WRITE_MODE_AUTO;
+    config.arena = &arena;
+    RRG_Handle handle;
+    memset(&handle, 0, sizeof handle);
+    CHECK(RRG_Init(&config, &handle) == RRG_OK);
+    void *relay = TEST_RelayOpen(TEST_PORT, TEST_RELAY_SLAVE_ID, &arena);
+    CHECK(relay != NULL);
+
+    // 2. The counter sees the allocations of the libraries: a ramp still copies its profile.
+    RRG_RampPoint points[2] = {{0, 0.0f}, {1000, 1.0f}};
+    RRG_RampProfile profile = {points, 2, RRG_RAMP_LINEAR, 0};
+    _startCounting();
+    int ramp_status = RRG_StartRamp(&handle, &profile, TEST_ACQUISITION_PERIOD_US);
+    uint64_t allocations = _stopCounting();
+    RRG_StopRamp(&handle);
+    CHECK(ramp_status == RRG_OK);
+    CHECK(allocations > 0);
+
+    // 3. The request paths of both devices.
+    int failures = 0;
+    float flow = 0.0f;
+    _startCounting();
+    for (int i = 0; i < TEST_ITERATIONS; ++i)
+    {
+        failures += RRG_SetFlow(&handle, (float)(i % 100) + 0.5f) != RRG_OK;
+        failures += RRG_GetFlow(&handle, &flow) != RRG_OK;
+    }
+    failures += TEST_RelayToggle(relay, TEST_ITERATIONS);
+    allocations = _stopCounting();
+    CHECK(failures == 0);
+    CHECK(allocations == 0);
+
+    // 4. The acquisition loop, with the setpoint written meanwhile. Its thread is created
+    // before counting starts: the C library allocates the thread itself.
+    RRG_Sample samples[64];
+    int drained = 0;
+    CHECK(RRG_StartAcquisition(&handle, TEST_ACQUISITION_PERIOD_US) == RRG_OK);
+    _startCounting();
+    int64_t end_ns = _mbMonotonicNs() + TEST_ACQUISITION_RUN_NS;
+    for (int i = 0; _mbMonotonicNs() < end_ns; ++i)
+    {
+        failures += RRG_SetFlow(&handle, (float)(i % 100) + 0.5f) != RRG_OK;
+        drained += RRG_DrainSamples(&handle, samples, 64);
+        _mbSleepUntilNs(_mbMonotonicNs() + TEST_ACQUISITION_PERIOD_US * 1000LL);
+    }
+    allocations = _stopCounting();
+    RRG_StopAcquisition(&handle);
+    CHECK(failures == 0);
+    CHECK(drained > 0);
+    CHECK(allocations == 0);
+
+    TEST_RelayClose(relay);
+    RRG_Close(&handle);
+    MB_SimClose(sim);
+    printf("test_arena_alloc: OK\n");
+    return 0;
+}
+
+#else // !__GLIBC__
+
+uint64_t TEST_AllocationCount(void) { return 0; }
+
+int main(void)
+{
+    printf("test_arena_alloc: skipped, the allocations are only counted with glibc\n");
+    return TEST_SKIPPED;
+}
+
+#endif // __GLIBC__
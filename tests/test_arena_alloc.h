@@ -0,0 +1,25 @@
+#ifndef TEST_ARENA_ALLOC_H
+#define TEST_ARENA_ALLOC_H
+
+/*
+ * Shared definitions of the allocation test. The regulator and the relay live in separate
+ * translation units because their public headers cannot be included together.
+ */
+
+#include <stdint.h>
+
+#include "mb_arena.h"
+
+/// @brief Returns the number of heap allocations made by the process while counting.
+uint64_t TEST_AllocationCount(void);
+
+/// @brief Opens the relay `slave_id` of the simulated line `port` with storage from `arena`, or returns `NULL`.
+void *TEST_RelayOpen(const char *port, int slave_id, MB_Arena *arena);
+
+/// @brief Turns the relay on and off `cycles` times; returns the number of calls that failed.
+int TEST_RelayToggle(void *relay, int cycles);
+
+/// @brief Closes a relay opened by `TEST_RelayOpen()`.
+void TEST_RelayClose(void *relay);
+
+#endif // !TEST_ARENA_ALLOC_H
@@ -0,0 +1,42 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "mb_bus.h"
+#include "relay.h"
+#include "test_arena_alloc.h"
+
+void *TEST_RelayOpen(const char *port, int slave_id, MB_Arena *arena)
+{
+    Relay_Config config;
+    memset(&config, 0, sizeof(config));
+    config.port = (char *)port;
+    config.transport = MB_TRANSPORT_SIM;
+    config.slave_id = slave_id;
+    config.timeout = 100;
+    config.arena = arena;
+
+    Relay_Handle *handle = malloc(sizeof(Relay_Handle));
+    if (handle && RELAY_Init(&config, handle) != RELAY_OK)
+    {
+        free(handle);
+        handle = NULL;
+    }
+    return handle;
+}
+
+int TEST_RelayToggle(void *relay, int cycles)
+{
+    int failures = 0;
+    for (int i = 0; i < cycles; ++i)
+    {
+        failures += RELAY_TurnOn(relay) != RELAY_OK;
+        failures += RELAY_TurnOff(relay) != RELAY_OK;
+    }
+    return failures;
+}
+
+void TEST_RelayClose(void *relay)
+{
+    RELAY_Close(relay);
+    free(relay);
+}
@@ -0,0 +1,94 @@
+/*
+ * Two arenas on one port: a bus built in an arena is never shared with a device of another
+ * arena, and it is closed with its last device even when the pool lingers, so the arena can
+ * be reused right away. Runs on a simulated line, without hardware.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "mb_arena.h"
+#include "mb_bus.h"
+#include "mb_sim.h"
+#include "rrg.h"
+
+#define TEST_PORT "test-arena-bus"
+#define TEST_ARENA_SIZE (1 << 20)
+
+#define CHECK(condition)                                                                                  \
+    do                                                                                                    \
+    {                                                                                                     \
+        if (!(condition))                                                                                 \
+        {                                                                                                 \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);                 \
+            return 1;                                                                                     \
+        }                                                                                                 \
+    } while (0)
+
+static unsigned char g_storage[2][TEST_ARENA_SIZE];
+
+/// @brief Opens the regulator `slave_id` of the simulated line with storage from `arena`.
+static int _openRegulator(RRG_Handle *handle, int slave_id, MB_Arena *arena)
+{
+    RRG_Config config = {0};
+    config.port = TEST_PORT;
+    config.transport = MB_TRANSPORT_SIM;
+    config.slave_id = slave_id;
+    config.timeout = 100;
+    config.setpoint_write_mode = RRG_SETPOINT_WRITE_MODE_AUTO;
+    config.arena = arena;
+    memset(handle, 0, sizeof *handle);
+    return RRG_Init(&config, handle);
+}
+
+int main(void)
+{
+    // 1. A line with two regulators, and a pool that would keep released buses open.
+    MB_SimConfig sim_config = {TEST_PORT, 0.0, 0, 1, 0};
+    MB_Sim *sim = NULL;
+    CHECK(MB_SimOpen(&sim_config, &sim) == MB_OK);
+    CHECK(RRG_SimAddRegulator(sim, 1, 0) == RRG_OK);
+    CHECK(RRG_SimAddRegulator(sim, 2, 0) == RRG_OK);
+    MB_BusSetPoolLinger(60000);
+
+    MB_Arena arenas[2];
+    CHECK(MB_ArenaInit(&arenas[0], g_storage[0], sizeof g_storage[0]) == MB_OK);
+    CHECK(MB_ArenaInit(&arenas[1], g_storage[1], sizeof g_storage[1]) == MB_OK);
+
+    // 2. The bus built in the first arena serves neither the second arena nor the heap.
+    RRG_Handle first, second;
+    float flow = 0.0f;
+    CHECK(_openRegulator(&first, 1, &arenas[0]) == RRG_OK);
+    size_t used = MB_ArenaUsed(&arenas[0]);
+    CHECK(_openRegulator(&second, 2, &arenas[1]) != RRG_OK);
+    MB_BusConfig bus_config = {0};
+    bus_config.port = TEST_PORT;
+    bus_config.transport = MB_TRANSPORT_SIM;
+    bus_config.timeout = 100;
+    MB_Bus *bus = NULL;
+    CHECK(MB_BusOpen(&bus_config, &bus) == MB_ERR && MB_GetLastErrorCode() == ERROR_MB_CONFIG_MISMATCH);
+    CHECK(MB_ArenaUsed(&arenas[1]) == 0);
+
+    // 3. Once its device is closed the bus is gone: the first arena is reused while the second
+    // one opens its own bus on the port.
+    RRG_Close(&first);
+    CHECK(MB_ArenaInit(&arenas[0], g_storage[0], sizeof g_storage[0]) == MB_OK);
+    CHECK(_openRegulator(&second, 2, &arenas[1]) == RRG_OK);
+    CHECK(RRG_GetFlow(&second, &flow) == RRG_OK);
+    RRG_Close(&second);
+
+    // 4. Reopening in a reinitialized arena takes the same room every time.
+    for (int cycle = 0; cycle < 3; ++cycle)
+    {
+        CHECK(MB_ArenaInit(&arenas[0], g_storage[0], sizeof g_storage[0]) == MB_OK);
+        CHECK(_openRegulator(&first, 1, &arenas[0]) == RRG_OK);
+        CHECK(MB_ArenaUsed(&arenas[0]) == used);
+        CHECK(RRG_GetFlow(&first, &flow) == RRG_OK);
+        RRG_Close(&first);
+    }
+
+    MB_BusFlushPool();
+    MB_SimClose(sim);
+    printf("test_arena_bus: OK\n");
+    return 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * A simulated regulator follows the setpoint whatever the write mode of the handle: one
+ * "Write Multiple Registers" request, or two "Write Single Register" requests of which only
+ * the second completes the setpoint. Runs on a simulated line, without hardware.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "mb_bus.h"
+#include "mb_sim.h"
+#include "rrg.h"
+
+#define TEST_PORT "test-sim-setpoint"
+#define TEST_FLOW_TOLERANCE 0.01f
+#define TEST_HALF_SETPOINT 0x1234
+
+#define CHECK(condition)                                                                                  \
+    do                                                                                                    \
+    {                                                                                                     \
+        if (!(condition))                                                                                 \
+        {                                                                                                 \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);                 \
+            return 1;                                                                                     \
+        }                                                                                                 \
+    } while (0)
+
+/// @brief Returns non-zero if `flow` reads as `expected`.
+static int _isNear(float flow, float expected)
+{
+    return flow > expected - TEST_FLOW_TOLERANCE && flow < expected + TEST_FLOW_TOLERANCE;
+}
+
+/// @brief Writes `setpoint` to the regulator `slave_id` in `write_mode` and checks the flow follows it.
+static int _checkSetpoint(int slave_id, int write_mode, float setpoint)
+{
+    RRG_Config config = {0};
+    config.port = TEST_PORT;
+    config.transport = MB_TRANSPORT_SIM;
+    config.slave_id = slave_id;
+    config.timeout = 100;
+    config.setpoint_write_mode = write_mode;
+    RRG_Handle handle;
+    memset(&handle, 0, sizeof handle);
+    CHECK(RRG_Init(&config, &handle) == RRG_OK);
+
+    // 1. Half a setpoint written through the bus does not move the flow yet.
+    float flow = -1.0f;
+    CHECK(MB_BusBeginTransaction(handle.bus, slave_id, MB_PRIORITY_SETPOINT, 0) != NULL);
+    int written = MB_BusWriteRegister(handle.bus, MODBUS_REGISTER_SETPOINT + 1, TEST_HALF_SETPOINT);
+    MB_BusEndTransaction(handle.bus, written == 1 ? MB_TRANSACTION_OK : MB_TRANSACTION_FAILED);
+    CHECK(written == 1);
+    CHECK(RRG_GetFlow(&handle, &flow) == RRG_OK && _isNear(flow, 0.0f));
+
+    // 2. The whole setpoint does: with no time constant the flow reaches it at once.
+    CHECK(RRG_SetFlow(&handle, setpoint) == RRG_OK);
+    CHECK(RRG_GetFlow(&handle, &flow) == RRG_OK);
+    CHECK(_isNear(flow, setpoint));
+    CHECK(RRG_SetFlow(&handle, 0.0f) == RRG_OK);
+    CHECK(RRG_GetFlow(&handle, &flow) == RRG_OK && _isNear(flow, 0.0f));
+
+    RRG_Close(&handle);
+    return 0;
+}
+
+int main(void)
+{
+    MB_SimConfig sim_config = {TEST_PORT, 0.0, 0, 1, 0};
+    MB_Sim *sim = NULL;
+    CHECK(MB_SimOpen(&sim_config, &sim) == MB_OK);
+    CHECK(RRG_SimAddRegulator(sim, 1, 0) == RRG_OK);
+    CHECK(RRG_SimAddRegulator(sim, 2, 0) == RRG_OK);
+
+    CHECK(_checkSetpoint(1, RRG_SETPOINT_WRITE_MODE_MULTIPLE, 10.0f) == 0);
+    CHECK(_checkSetpoint(2, RRG_SETPOINT_WRITE_MODE_SINGLE, 10.0f) == 0);
+
+    MB_BusFlushPool();
+    MB_SimClose(sim);
+    printf("test_sim_setpoint: OK\n");
+    return 0;
+}
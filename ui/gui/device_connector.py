@@ -0,0 +1,82 @@
+# -*- coding: utf-8 -*-
+"""
+@file device_connector.py
+@brief Connects several devices at once, off the UI thread.
+@details
+Opening a device blocks for up to its probe timeout (and a lot longer for a TCP gateway
+that does not answer), so the connections run in worker threads, one per device. The C
+libraries release the GIL and open different ports in parallel: the start-up time is that
+of the slowest device instead of the sum of all of them. The results come back to the UI
+thread through Qt signals.
+"""
+
+import threading
+import time
+
+from PyQt5 import QtCore
+
+
+class DeviceConnector(QtCore.QObject):
+    """
+    @brief Runs the connect functions of several devices in parallel and reports each of them.
+    @details The signals are emitted by the worker threads; Qt queues them to the thread of the
+    receiving objects, so the slots of a window run on the UI thread. A connector runs one batch
+    at a time.
+    """
+
+    # Device name, when it starts connecting.
+    started = QtCore.pyqtSignal(str)
+    # Device name, result of its connect function and connection time in milliseconds.
+    connected = QtCore.pyqtSignal(str, object, float)
+    # {device name: result} once every device of the batch is done.
+    finished = QtCore.pyqtSignal(dict)
+
+    def __init__(self, parent=None):
+        super().__init__(parent)
+        self._lock = threading.Lock()
+        self._results = {}
+        self._pending = 0
+
+    def is_running(self) -> bool:
+        """
+        @brief Returns True while devices of a batch are still connecting.
+        """
+        with self._lock:
+            return self._pending > 0
+
+    def start(self, jobs) -> bool:
+        """
+        @brief Connects every device of jobs at once.
+        @param jobs Dictionary {device name: function taking no argument that connects it and returns its result}.
+        @return False if a batch is still running (nothing is started), True otherwise.
+        """
+        with self._lock:
+            if self._pending:
+                return False
+            self._results = {}
+            self._pending = len(jobs)
+        if not jobs:
+            self.finished.emit({})
+            return True
+        for name, connect in jobs.items():
+            self.started.emit(name)
+            threading.Thread(target=self._run, args=(name, connect), name=f"connect-{name}", daemon=True).start()
+        return True
+
+    def _run(self, name: str, connect) -> None:
+        """
+        @brief Worker thread: connects one device and reports it; the last one reports the batch.
+        """
+        start = time.perf_counter()
+        try:
+            result = connect()
+        except Exception as e:  # The batch must finish whatever a device does.
+            result = e
+        self.connected.emit(name, result, (time.perf_counter() - start) * 1000.0)
+        with self._lock:
+            self._results[name] = result
+            self._pending -= 1
+            done = self._pending == 0
+            results = dict(self._results) if done else None
+        if done:
+            self.finished.emit(results)
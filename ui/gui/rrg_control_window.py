@@ -1,14 +1,17 @@
 # -*- coding: utf-8 -*-
 
 import os
+import time
 import datetime
 from PyQt5 import QtWidgets, QtCore, QtGui
 from PyQt5.QtWidgets import QMessageBox, QShortcut
 from PyQt5.QtGui import QKeySequence
-import serial.tools.list_ports
-from src.rrg import RRGController
+from src.mb import (MB_TRANSPORT_RTU, MB_TRANSPORT_SIM, MBLog, MBSim, enumerate_ports, flush_pool, set_pool_linger,
+                    transport_from_name)
+from src.rrg import RRGController, FlowHistory, add_simulated_regulator
 from src.relay import RelayController
 from src.config import ConfigLoader
+from .device_connector import DeviceConnector
 from matplotlib.figure import Figure
 from matplotlib.backends.backend_qt5agg import FigureCanvasQTAgg as FigureCanvas
 
@@ -21,6 +24,13 @@ RRG_DEFAULT_TIMEOUT = 50
 RRG_DEFAULT_SLAVE_ID = 1
 
 PLOT_UPDATE_TIME_TICK_MS = 50
+PLOT_HISTORY_CAPACITY = 1 << 21  # About 29 hours of trace at the acquisition period below
+PLOT_DEFAULT_REFRESH_HZ = 60.0  # Redraw limit when the screen does not report its refresh rate
+PLOT_MIN_SPAN_MINUTES = 1.0  # Initial width of the time axis
+PLOT_LIMIT_GROWTH = 0.25  # Headroom added when the trace leaves the axes, as a fraction of their span
+ACQUISITION_PERIOD_US = PLOT_UPDATE_TIME_TICK_MS * 1000
+SIM_DEFAULT_LINE = "sim"  # Name of the simulated line when 'endpoint' names none
+SIM_MIN_ACQUISITION_PERIOD_US = 200  # Fastest sampling of a simulated regulator (the period at sim_speed 0)
 
 
 class RRGControlWindow(QtWidgets.QMainWindow):
@@ -32,6 +42,15 @@ class RRGControlWindow(QtWidgets.QMainWindow):
         self.rrg_controller = RRGController()
         self.relay_controller = RelayController()
         self.config_loader = ConfigLoader()
+        self.rrg_config_dict = {}
+        self.relay_config_dict = {}
+        self.flow_log = None
+        self.sim_lines = {}  # Simulated lines by name, while the devices use them
+        self.device_ports = {}
+        self.device_connector = DeviceConnector(self)
+        self.device_connector.started.connect(self._on_device_connecting)
+        self.device_connector.connected.connect(self._on_device_connected)
+        self.device_connector.finished.connect(self._on_devices_connected)
 
         self.available_ports = self._get_available_ports()
 
@@ -41,17 +60,25 @@ class RRGControlWindow(QtWidgets.QMainWindow):
         QShortcut(QKeySequence("Ctrl+W"), self, activated=self._confirm_close)
         QShortcut(QKeySequence("Ctrl+Q"), self, activated=self._confirm_close)
 
-        if len(self.available_ports) < 2:
+        self._load_config_data()
+
+        # Devices on a gateway or a simulated line need no local port.
+        serial_devices = sum(config.get("transport", "rtu") == "rtu"
+                             for config in (self.rrg_config_dict, self.relay_config_dict))
+        if len(self.available_ports) < serial_devices:
             self._log_message("Not enough serial ports available. UI is disabled.")
             self._disable_ui()
 
-        self._load_config_data()
-
     def closeEvent(self, event: QtGui.QCloseEvent) -> None:
         """
         @brief Overrides the window close event to prompt the user for confirmation
                and safely close connections.
         """
+        # The connecting devices are only known to the UI once their batch is done.
+        if self.device_connector.is_running():
+            self._log_message("Wait for the devices to finish connecting.")
+            event.ignore()
+            return
         reply = QMessageBox.question(
             self,
             "Confirm Exit",
@@ -61,6 +88,7 @@ class RRGControlWindow(QtWidgets.QMainWindow):
         )
         if reply == QMessageBox.Yes:
             self._close_connections()
+            flush_pool()
             event.accept()
         else:
             event.ignore()
@@ -75,51 +103,132 @@ class RRGControlWindow(QtWidgets.QMainWindow):
         self.ax.set_xlabel("Time (minutes)")
         self.ax.set_ylabel("Flow (SCCM)")
         self.ax.set_title("Gas Flow over Time")
+        self.ax.minorticks_on()
+        self.ax.grid(True, which="major", linestyle="-", linewidth=0.8)
+        self.ax.grid(True, which="minor", linestyle="--", linewidth=0.5, alpha=0.5)
+
+        # The trace is the only dynamic artist: it is drawn over a cached background (blitting),
+        # and the axes, labels and grid are redrawn only when the limits have to grow.
+        (self.flow_line,) = self.ax.plot([], [], linestyle="-", linewidth=1.0, animated=True)
+        self.flow_history = FlowHistory(PLOT_HISTORY_CAPACITY)
+        self.plot_background = None
+        self.plot_limits = None  # (xmin, xmax, ymin, ymax) once the first point arrived
+        self.plot_dirty = False
+        self.plot_limits_changed = False
+        self.plot_last_redraw = 0.0
+        screen = QtWidgets.QApplication.primaryScreen()
+        refresh_hz = screen.refreshRate() if screen is not None else 0.0
+        self.plot_min_redraw_interval = 1.0 / (refresh_hz if refresh_hz > 0 else PLOT_DEFAULT_REFRESH_HZ)
+        self.canvas.mpl_connect("draw_event", self._on_canvas_draw)
 
-        self.flow_data = []  # Stores (time in minutes, flow)
         self.start_time = datetime.datetime.now()  # Set start time for reference
+        self.acquisition_t0_ns = None  # Monotonic timestamp of the first acquired sample
+        self.flow_changes_only = False  # The C change filter reports the samples worth showing
 
         # Add the canvas below UI elements
         self.centralWidget().layout().addWidget(self.canvas)
 
+    def _on_canvas_draw(self, _event):
+        """
+        Caches the static part of the graph after every full redraw (resize, new limits)
+        and draws the trace on top of it.
+        """
+        self.plot_background = self.canvas.copy_from_bbox(self.ax.bbox)
+        self.ax.draw_artist(self.flow_line)
+
+    def _grow_plot_limits(self, times, values) -> bool:
+        """
+        Extends the axes with some headroom when new points fall outside of them.
+        @return True if the limits changed, so the static part must be redrawn.
+        """
+        t_last, v_min, v_max = times[-1], values.min(), values.max()
+        if self.plot_limits is None:
+            t_first = self.flow_history.first_time()
+            self.plot_limits = (t_first, t_first + PLOT_MIN_SPAN_MINUTES, v_min - 1.0, v_max + 1.0)
+        xmin, xmax, ymin, ymax = self.plot_limits
+        changed = False
+        if t_last > xmax:
+            xmin = self.flow_history.first_time()
+            xmax = t_last + (t_last - xmin) * PLOT_LIMIT_GROWTH
+            changed = True
+        if v_min < ymin or v_max > ymax:
+            margin = max((max(ymax, v_max) - min(ymin, v_min)) * PLOT_LIMIT_GROWTH, 1.0)
+            ymin = min(ymin, v_min - margin)
+            ymax = max(ymax, v_max + margin)
+            changed = True
+        if changed or self.plot_background is None:
+            self.plot_limits = (xmin, xmax, ymin, ymax)
+            self.ax.set_xlim(xmin, xmax)
+            self.ax.set_ylim(ymin, ymax)
+            return True
+        return False
+
+    def _redraw_flow_line(self):
+        """
+        Shows the visible part of the history as a min/max envelope of about one bucket per
+        pixel column: blits the trace alone, or redraws the whole figure when the axes had to grow.
+        """
+        t_start, t_end = self.ax.get_xlim()
+        times, mins, maxs, _ = self.flow_history.view(t_start, t_end, int(self.ax.bbox.width))
+        self.flow_line.set_data(*FlowHistory.envelope(times, mins, maxs))
+        self.plot_dirty = False
+        self.plot_last_redraw = time.monotonic()
+        if self.plot_background is None or self.plot_limits_changed:
+            self.plot_limits_changed = False
+            self.canvas.draw_idle()  # _on_canvas_draw() draws the trace
+            return
+        self.canvas.restore_region(self.plot_background)
+        self.ax.draw_artist(self.flow_line)
+        self.canvas.blit(self.ax.bbox)
+
     def _update_graph(self):
         """
-        Queries the current flow from the RRG controller, appends the data point,
-        and updates the Matplotlib graph.
+        Drains the flow samples acquired by the C background thread since the last tick,
+        appends them to the history and updates the trace, at most once per screen refresh.
         """
         if self.rrg_controller.IsDisconnected():
             return
 
-        err, flow = self.rrg_controller.GetFlow()
-        current_time = datetime.datetime.now()
-        elapsed_minutes = (
-            current_time - self.start_time
-        ).total_seconds() / 60  # Convert to minutes
-
-        if err == self.rrg_controller.RRG_OK:
-            self.flow_data.append((elapsed_minutes, flow))
-            self.flow_data = self.flow_data[-60:]  # Keep only last 60 data points
-
-            times = [t for t, _ in self.flow_data]
-            flows = [f for _, f in self.flow_data]
-
-            self.ax.clear()
-            self.ax.plot(times, flows, marker="o", linestyle="-")
+        # One C call fills a structured array in place; the columns are processed as a whole.
+        # With a change filter only the reported changes are shown; every raw sample still reaches the flow log.
+        if self.flow_changes_only:
+            err, samples = self.rrg_controller.DrainChangeArray()
+        else:
+            err, samples = self.rrg_controller.DrainSampleArray()
+        if err != self.rrg_controller.RRG_OK:
+            self._rrg_show_error_msg()
+            return
+        if len(samples) > 0:
+            self._append_samples(samples)
 
-            self.ax.set_xlabel("Time (minutes)")
-            self.ax.set_ylabel("Flow (SCCM)")
-            self.ax.set_title("Gas Flow over Time")
+        # Points arriving faster than the screen refreshes are shown together by the next redraw.
+        if self.plot_dirty and time.monotonic() - self.plot_last_redraw >= self.plot_min_redraw_interval:
+            self._redraw_flow_line()
 
-            self.ax.minorticks_on()
-            self.ax.grid(True, which="major", linestyle="-", linewidth=0.8)
-            self.ax.grid(True, which="minor", linestyle="--", linewidth=0.5, alpha=0.5)
+    def _append_samples(self, samples):
+        """
+        Logs the failed reads of a drained batch and appends the successful ones to the history.
+        """
+        if self.acquisition_t0_ns is None:
+            # Anchor the monotonic sample clock to the wall-clock start of the session.
+            offset_ns = (datetime.datetime.now() - self.start_time).total_seconds() * 1e9
+            self.acquisition_t0_ns = samples["t_ns"][0] - offset_ns
+
+        elapsed_minutes = (samples["t_ns"] - self.acquisition_t0_ns) / 60e9  # Convert to minutes
+        ok = samples["status"] == self.rrg_controller.RRG_OK
+        for minutes, status in zip(elapsed_minutes[~ok], samples["status"][~ok]):
+            self._log_message(f"Failed to read flow at {minutes:.2f} [min] (error {status})")
+        if not ok.any():
+            return
 
-            self.canvas.draw()
-            self._log_message(
-                f"Current flow is {flow} [cm3/min] at time moment {elapsed_minutes:.2f} [min]"
-            )
-        else:
-            self._rrg_show_error_msg()
+        # The history copies the points out of the reused drain buffer.
+        times, values = elapsed_minutes[ok], samples["flow"][ok]
+        self.flow_history.append(times, values)
+        if self._grow_plot_limits(times, values):
+            self.plot_limits_changed = True
+        self.plot_dirty = True
+        minutes, flow = self.flow_history.last()
+        self._log_message(f"Current flow is {flow} [cm3/min] at time moment {minutes:.2f} [min]")
 
     def _confirm_close(self):
         """
@@ -134,40 +243,226 @@ class RRGControlWindow(QtWidgets.QMainWindow):
         )
         if reply == QMessageBox.Yes:
             self._close_connections()
+            flush_pool()
             QtWidgets.QApplication.quit()
 
+    @staticmethod
+    def _device_endpoint(combo, config_dict):
+        """
+        @brief Returns the port and transport a device is opened with.
+        @details A local serial port is picked in the toolbar; a device behind a TCP gateway
+        ('transport' other than "rtu") is reached at the 'endpoint' ("host:port") of its config,
+        and a simulated one ("sim") on the line of that name.
+        @raise ValueError If the transport of the config is unknown.
+        """
+        transport = transport_from_name(config_dict.get("transport", "rtu"))
+        if transport == MB_TRANSPORT_RTU:
+            return combo.currentText(), transport
+        if transport == MB_TRANSPORT_SIM:
+            return config_dict.get("endpoint") or SIM_DEFAULT_LINE, transport
+        return config_dict.get("endpoint", ""), transport
+
+    def _open_simulation(self, relay_port, relay_transport, rrg_port, rrg_transport):
+        """
+        @brief Opens the simulated lines of the devices configured with the "sim" transport.
+        @details The regulator replays the flow log of 'sim_replay_directory' ("" = steady 0 SCCM) at
+        'sim_speed' times real time (0 = one recorded sample per read) and follows the setpoints written
+        to it with the time constant 'sim_time_constant_ms'; the relay is a plain register image.
+        @return True on success, False otherwise (the error is logged).
+        """
+        speed = float(self.rrg_config_dict.get("sim_speed", 1.0))
+        for port, transport in ((relay_port, relay_transport), (rrg_port, rrg_transport)):
+            if transport == MB_TRANSPORT_SIM and port not in self.sim_lines:
+                try:
+                    self.sim_lines[port] = MBSim(port, speed)
+                except (RuntimeError, ValueError) as e:
+                    self._log_message(f"Failed to open the simulated line '{port}': {e}")
+                    return False
+        if relay_transport == MB_TRANSPORT_SIM:
+            self.sim_lines[relay_port].add_slave(self.relay_config_dict.get("slave_id", RELAY_DEFAULT_SLAVE_ID))
+        if rrg_transport == MB_TRANSPORT_SIM:
+            sim = self.sim_lines[rrg_port]
+            slave_id = self.rrg_config_dict.get("slave_id", RRG_DEFAULT_SLAVE_ID)
+            add_simulated_regulator(sim, slave_id, self.rrg_config_dict.get("sim_time_constant_ms", 0))
+            directory = self.rrg_config_dict.get("sim_replay_directory")
+            if directory:
+                directory = os.path.join(os.path.dirname(os.path.dirname(__file__)), directory)
+                if not sim.load_log(slave_id, directory, channel=self.rrg_config_dict.get("sim_replay_channel", 0)):
+                    self._log_message(f"Failed to load the flow log to replay from {directory}: "
+                                      f"{sim.get_last_error()}")
+        return True
+
+    def _close_simulation(self):
+        """
+        @brief Closes the simulated lines once the devices on them are turned off.
+        """
+        for sim in self.sim_lines.values():
+            sim.close()
+        self.sim_lines = {}
+
+    def _acquisition_period_us(self) -> int:
+        """
+        @brief Returns the sampling period of the regulator: a simulated one is sampled as much faster as its
+        clock runs, to load the acquisition and the plot at the same rate of simulated samples.
+        """
+        if self.rrg_config_dict.get("transport", "rtu") != "sim":
+            return ACQUISITION_PERIOD_US
+        speed = float(self.rrg_config_dict.get("sim_speed", 1.0))
+        if speed <= 0:
+            return SIM_MIN_ACQUISITION_PERIOD_US
+        return max(int(ACQUISITION_PERIOD_US / speed), SIM_MIN_ACQUISITION_PERIOD_US)
+
     def _open_connections(self):
-        # 1. Connect to the relay
-        relay_port = self.combo_port_1.currentText()
-        relay_err = self.relay_controller.TurnOn(
-            relay_port,
-            self.relay_config_dict.get('baudrate', RELAY_DEFAULT_BAUDRATE),
-            self.relay_config_dict.get('slave_id', RELAY_DEFAULT_SLAVE_ID),
-            self.relay_config_dict.get('timeout', RELAY_DEFAULT_TIMEOUT)
-        )
-        if relay_err != self.relay_controller.RELAY_OK:
-            self._relay_show_error_msg()
+        # Released buses stay open for a while, so turning the devices off and on again is instant.
+        set_pool_linger(self.rrg_config_dict.get("connection_linger_ms", 0))
+        try:
+            relay_port, relay_transport = self._device_endpoint(self.combo_port_1, self.relay_config_dict)
+            rrg_port, rrg_transport = self._device_endpoint(self.combo_port_2, self.rrg_config_dict)
+        except ValueError as e:
+            self._log_message(str(e))
+            QMessageBox.critical(self, "Configuration Error", str(e))
             return
+        if not self._open_simulation(relay_port, relay_transport, rrg_port, rrg_transport):
+            self._close_simulation()
+            return
+
+        # 1. Connect the relay and the Gas Flow Regulator at once, off the UI thread. Nothing on the UI
+        # thread touches the devices until the batch is done.
+        self._set_connecting(True)
+        self.toggle_rrg_button.setText("Connecting...")
+        self.device_ports = {"Relay": relay_port, "RRG": rrg_port}
+        self.device_connector.start({
+            "Relay": lambda: self.relay_controller.TurnOn(
+                relay_port,
+                self.relay_config_dict.get('baudrate', RELAY_DEFAULT_BAUDRATE),
+                self.relay_config_dict.get('slave_id', RELAY_DEFAULT_SLAVE_ID),
+                self.relay_config_dict.get('timeout', RELAY_DEFAULT_TIMEOUT),
+                self.relay_config_dict.get('adaptive_timeout', False),
+                self.relay_config_dict.get('write_cache', False),
+                self.relay_config_dict.get('write_cache_refresh_ms', 0),
+                self.relay_config_dict.get('fast_transport', False),
+                relay_transport,
+                self.relay_config_dict.get('probe_timeout_ms', 0),
+            ),
+            "RRG": lambda: self.rrg_controller.TurnOn(
+                rrg_port,
+                baudrate=self.rrg_config_dict.get("baudrate", RRG_DEFAULT_BAUDRATE),
+                slave_id=self.rrg_config_dict.get("slave_id", RRG_DEFAULT_SLAVE_ID),
+                timeout=self.rrg_config_dict.get("timeout", RRG_DEFAULT_TIMEOUT),
+                adaptive_timeout=self.rrg_config_dict.get("adaptive_timeout", False),
+                write_cache=self.rrg_config_dict.get("write_cache", False),
+                write_cache_refresh_ms=self.rrg_config_dict.get("write_cache_refresh_ms", 0),
+                fast_transport=self.rrg_config_dict.get("fast_transport", False),
+                transport=rrg_transport,
+                probe_timeout=self.rrg_config_dict.get("probe_timeout_ms", 0),
+            ),
+        })
+
+    @QtCore.pyqtSlot(str)
+    def _on_device_connecting(self, name):
+        self._log_message(f"Connecting the {name} device on port {self.device_ports[name]}...")
+
+    @QtCore.pyqtSlot(str, object, float)
+    def _on_device_connected(self, name, error, elapsed_ms):
+        if error == 0:
+            self._log_message(f"{name} device connected on port {self.device_ports[name]} in {elapsed_ms:.0f} ms.")
         else:
-            self._log_message(f"Relay device connected on port {relay_port}.")
-
-        # 2. Connect to the Gas Flow Regulator
-        rrg_port = self.combo_port_2.currentText()
-        rrg_err = self.rrg_controller.TurnOn(
-            "/dev/ttyUSB0",
-            baudrate=self.rrg_config_dict.get("baudrate", RRG_DEFAULT_BAUDRATE),
-            slave_id=self.rrg_config_dict.get("slave_id", RRG_DEFAULT_SLAVE_ID),
-            timeout=self.rrg_config_dict.get("timeout", RRG_DEFAULT_TIMEOUT),
-        )
-        if rrg_err != self.rrg_controller.RRG_OK:
+            self._log_message(f"{name} device failed to connect on port {self.device_ports[name]} "
+                              f"after {elapsed_ms:.0f} ms.")
+
+    @QtCore.pyqtSlot(dict)
+    def _on_devices_connected(self, results):
+        """
+        @brief Starts the acquisition once both devices are connected, or releases them if one failed.
+        """
+        self._set_connecting(False)
+
+        # 2. Without the relay the regulator is not used.
+        if results.get("Relay") != self.relay_controller.RELAY_OK:
+            self._relay_show_error_msg()
+            if self.rrg_controller.IsConnected():
+                self.rrg_controller.TurnOff()
+            self.toggle_rrg_button.setChecked(False)
+            self.toggle_rrg_button.setText("Turn RRG ON")
+            return
+
+        # 3. Start sampling the Gas Flow Regulator.
+        if results.get("RRG") != self.rrg_controller.RRG_OK:
             self._rrg_show_error_msg()
             self.toggle_rrg_button.setChecked(False)
             self.toggle_rrg_button.setText("Turn RRG ON")
+            return
+        self.toggle_rrg_button.setText("Turn RRG OFF")
+        self.acquisition_t0_ns = None
+        self._attach_flow_log()
+        self._set_change_filter()
+        self._set_interlock()
+        if self.rrg_controller.StartAcquisition(self._acquisition_period_us()) != self.rrg_controller.RRG_OK:
+            self._rrg_show_error_msg()
+
+    def _set_connecting(self, connecting: bool):
+        """
+        @brief Disables the controls and the graph updates that use the devices while they connect.
+        """
+        for widget in (self.toggle_rrg_button, self.send_setpoint_button, self.setpoint_line_edit):
+            widget.setEnabled(not connecting)
+        if connecting:
+            self.graph_timer.stop()
         else:
-            self._log_message(
-                f"Gas Flow Regulator device connected on port {rrg_port}."
-            )
-            self.toggle_rrg_button.setText("Turn RRG OFF")
+            self.graph_timer.start(PLOT_UPDATE_TIME_TICK_MS)
+
+    def _attach_flow_log(self):
+        """
+        @brief Records the acquired samples to the binary log set by 'flow_log_directory', if any.
+        @details The log stays open across reconnections and is read back with src.mb.MBLogReader.
+        """
+        directory = self.rrg_config_dict.get("flow_log_directory")
+        if not directory:
+            return
+        if self.flow_log is None:
+            try:
+                self.flow_log = MBLog(
+                    os.path.join(os.path.dirname(os.path.dirname(__file__)), directory),
+                    max_segments=self.rrg_config_dict.get("flow_log_max_segments", 0),
+                )
+            except (OSError, RuntimeError) as e:
+                self._log_message(f"Failed to open the flow log: {e}")
+                return
+        if self.rrg_controller.SetFlowLog(self.flow_log) != self.rrg_controller.RRG_OK:
+            self._rrg_show_error_msg()
+
+    def _set_change_filter(self):
+        """
+        @brief Shows only the flow changes past 'flow_deadband' (with 'flow_rate_threshold' and
+        'flow_heartbeat_ms'), or every sample if no deadband is configured.
+        """
+        deadband = self.rrg_config_dict.get("flow_deadband")
+        error = self.rrg_controller.SetChangeFilter(
+            deadband,
+            self.rrg_config_dict.get("flow_rate_threshold", 0.0),
+            self.rrg_config_dict.get("flow_heartbeat_ms", 0),
+        )
+        self.flow_changes_only = deadband is not None and error == self.rrg_controller.RRG_OK
+        if error != self.rrg_controller.RRG_OK:
+            self._rrg_show_error_msg()
+
+    def _set_interlock(self):
+        """
+        @brief Turns the relay off from the acquisition thread on the faults set by 'interlock_fault_mask'
+        and 'interlock_max_failed_reads', if the relay is connected.
+        """
+        fault_mask = self.rrg_config_dict.get("interlock_fault_mask")
+        relay = self.relay_controller.GetRelay()
+        if fault_mask is None or relay is None:
+            return
+        error = self.rrg_controller.SetInterlock(
+            fault_mask,
+            self.rrg_config_dict.get("interlock_max_failed_reads", 0),
+            self.rrg_config_dict.get("interlock_fault_period_us", 0),
+            relay,
+        )
+        if error != self.rrg_controller.RRG_OK:
+            self._rrg_show_error_msg()
 
     def _close_connections(self):
         """
@@ -183,6 +478,9 @@ class RRGControlWindow(QtWidgets.QMainWindow):
             else:
                 self._log_message("Gas Flow Regulator device disconnected.")
             self.toggle_rrg_button.setText("Turn RRG ON")
+        if self.flow_log is not None:
+            self.flow_log.close()
+            self.flow_log = None
 
         # 2. Turn off the Relay
         if self.relay_controller.IsConnected():
@@ -191,6 +489,7 @@ class RRGControlWindow(QtWidgets.QMainWindow):
                 self._relay_show_error_msg()
             else:
                 self._log_message("Relay device disconnected.")
+        self._close_simulation()
 
     def _load_config_data(self):
         rrg_config_path = os.path.join(
@@ -206,9 +505,8 @@ class RRGControlWindow(QtWidgets.QMainWindow):
             self._log_message(f"Failed to load config: {e}")
 
     def _get_available_ports(self):
-        ports = serial.tools.list_ports.comports()
-        available = [port.device for port in ports]
-        return available
+        # Cached by the bus library: /dev is only scanned again after a device was plugged in or removed.
+        return enumerate_ports()
 
     def _disable_ui(self):
         for widget in self.findChildren(QtWidgets.QWidget):
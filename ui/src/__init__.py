@@ -1,7 +1,8 @@
 # ПНППК/src/__init__.py
 
 from .config import __all__ as config_all
+from .mb import __all__ as mb_all
 from .relay import __all__ as relay_all
 from .rrg import __all__ as rrg_all
 
-__all__ = ["config_all", "relay_all", "rrg_all"]
+__all__ = ["config_all", "mb_all", "relay_all", "rrg_all"]
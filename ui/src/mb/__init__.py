@@ -0,0 +1,48 @@
+# ПНППК/src/mb/__init__.py
+
+from .mb_bus import (
+    MB_TRANSPORT_RTU,
+    MB_TRANSPORT_RTU_OVER_TCP,
+    MB_TRANSPORT_SIM,
+    MB_TRANSPORT_TCP,
+    MBBusListener,
+    enumerate_ports,
+    flush_pool,
+    set_pool_linger,
+    transport_from_name,
+)
+from .mb_log import MB_LOG_RECORD_DTYPE, MBLog, MBLogReader, MBLogSegment
+from .mb_poller import MBPoller, MBPollJob, MBPollSample
+from .mb_sim import MBSim
+from .mb_stats import (
+    MBLatencyHistogram,
+    MBTrafficCounters,
+    latency_bucket_lower_us,
+    latency_percentile_us,
+    stats_to_dict,
+)
+
+__all__ = [
+    "MB_TRANSPORT_RTU",
+    "MB_TRANSPORT_RTU_OVER_TCP",
+    "MB_TRANSPORT_SIM",
+    "MB_TRANSPORT_TCP",
+    "MBBusListener",
+    "enumerate_ports",
+    "flush_pool",
+    "set_pool_linger",
+    "transport_from_name",
+    "MB_LOG_RECORD_DTYPE",
+    "MBLog",
+    "MBLogReader",
+    "MBLogSegment",
+    "MBPoller",
+    "MBPollJob",
+    "MBPollSample",
+    "MBSim",
+    "MBLatencyHistogram",
+    "MBTrafficCounters",
+    "latency_bucket_lower_us",
+    "latency_percentile_us",
+    "stats_to_dict",
+]
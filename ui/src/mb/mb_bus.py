@@ -0,0 +1,120 @@
+# -*- coding: utf-8 -*-
+"""
+@file mb_bus.py
+@brief Python access to the connection pool and the port scan of the bus library (mb_bus.h, mb_ports.h).
+@details
+Buses recover from a lost port on their own: the C library reopens it in the background and
+the device handles write their commanded setpoint and gas back. This module exposes the parts
+the application drives itself:
+  - MB_TRANSPORT_*: The transports of MB_BusConfig::transport, and transport_from_name for config files.
+  - MBBusListener: A ctypes Structure mapping to the C MB_BusListener struct (embedded in handles).
+  - enumerate_ports: The cached serial port scan (no subprocess, rescanned on hotplug only).
+  - set_pool_linger / flush_pool: Keep released buses open so reconnecting to a port is instant.
+"""
+
+import os
+import ctypes
+from ctypes import CFUNCTYPE, POINTER, c_char, c_int, c_void_p
+
+from src.mb.mb_poller import _load_library as _load_bus_library
+
+# Sizes of the port scan, see MB_PORT_NAME_MAX and MB_MAX_PORTS in mb_ports.h.
+MB_PORT_NAME_MAX = 64
+MB_MAX_PORTS = 64
+
+# Transports of a bus, see MB_TRANSPORT_* in mb_bus.h.
+MB_TRANSPORT_RTU = 0
+MB_TRANSPORT_TCP = 1
+MB_TRANSPORT_RTU_OVER_TCP = 2
+MB_TRANSPORT_SIM = 3
+
+# Names of the transports in the configuration files.
+MB_TRANSPORT_NAMES = {
+    "rtu": MB_TRANSPORT_RTU,
+    "tcp": MB_TRANSPORT_TCP,
+    "rtu_over_tcp": MB_TRANSPORT_RTU_OVER_TCP,
+    "sim": MB_TRANSPORT_SIM,
+}
+
+MB_RECONNECT_CALLBACK = CFUNCTYPE(None, c_void_p)
+
+
+class MBBusListener(ctypes.Structure):
+    """
+    @brief Reconnect callback registered by a device handle.
+    Maps to the C structure `MB_BusListener` defined in mb_bus.h.
+    """
+
+
+MBBusListener._fields_ = [
+    ("on_reconnect", MB_RECONNECT_CALLBACK),  # Called on the reconnect thread of the bus
+    ("user_data", c_void_p),                  # Passed to on_reconnect
+    ("next", POINTER(MBBusListener)),         # Next listener of the bus (managed by the bus)
+]
+
+
+class MBPortName(ctypes.Structure):
+    """
+    @brief Name of a serial port.
+    Maps to the C structure `MB_PortName` defined in mb_ports.h.
+    """
+    _fields_ = [
+        ("name", c_char * MB_PORT_NAME_MAX),  # NUL-terminated port name
+    ]
+
+
+def transport_from_name(name: str) -> int:
+    """
+    @brief Converts the transport name of a configuration file into its MB_TRANSPORT_* value.
+    @param name "rtu" (local serial port), "tcp" (MODBUS TCP gateway), "rtu_over_tcp"
+    (serial device server forwarding raw RTU frames) or "sim" (simulated line, see src.mb.mb_sim).
+    @return The MB_TRANSPORT_* value.
+    @raise ValueError If the name is unknown.
+    """
+    try:
+        return MB_TRANSPORT_NAMES[name.lower()]
+    except KeyError:
+        expected = ", ".join(MB_TRANSPORT_NAMES)
+        raise ValueError(f"Unknown MODBUS transport '{name}' (expected one of {expected})") from None
+
+
+def _load_library():
+    """
+    @brief Loads the bus library and declares the pool and port scan functions.
+    @return The loaded library.
+    """
+    lib = _load_bus_library()
+    lib.MB_EnumeratePorts.argtypes = [POINTER(MBPortName), c_int]
+    lib.MB_EnumeratePorts.restype = c_int
+    lib.MB_BusSetPoolLinger.argtypes = [c_int]
+    lib.MB_BusSetPoolLinger.restype = None
+    lib.MB_BusFlushPool.argtypes = []
+    lib.MB_BusFlushPool.restype = None
+    return lib
+
+
+def enumerate_ports() -> list:
+    """
+    @brief Lists the serial ports a device can be opened on, in natural order.
+    @details The scan is cached by the library and redone only when a device is plugged in or
+    removed (on Windows, at most once a second), so calling this from a UI timer is cheap.
+    @return The port names (e.g., ["/dev/ttyUSB0", "/dev/ttyUSB1"] or ["COM3"]).
+    """
+    ports = (MBPortName * MB_MAX_PORTS)()
+    count = _load_library().MB_EnumeratePorts(ports, MB_MAX_PORTS)
+    return [os.fsdecode(ports[i].name) for i in range(max(count, 0))]
+
+
+def set_pool_linger(linger_ms: int) -> None:
+    """
+    @brief Keeps a released bus open for linger_ms, so turning a device off and on again reuses it.
+    @param linger_ms Time an unused bus stays open (0 closes it at once, the default).
+    """
+    _load_library().MB_BusSetPoolLinger(int(linger_ms))
+
+
+def flush_pool() -> None:
+    """
+    @brief Closes every bus kept open by the linger time (e.g., before the application exits).
+    """
+    _load_library().MB_BusFlushPool()
@@ -0,0 +1,191 @@
+# -*- coding: utf-8 -*-
+"""
+@file mb_poller.py
+@brief Python wrapper for the multi-bus polling scheduler of the bus library (mb_poller.h).
+@details
+The poller runs one C I/O thread per serial port, so regulators on several USB-RS485
+adapters are polled in parallel instead of one after another. This module defines:
+  - MBPollJob: A ctypes Structure mapping to the C MB_PollJob struct.
+  - MBPollSample: A ctypes Structure mapping to the C MB_PollSample struct.
+  - MBPoller: Owns an MB_Poller and exposes its jobs and merged sample stream.
+The bus library is loaded on first use, so importing this module never fails.
+"""
+
+import os
+import ctypes
+import logging
+from ctypes import CDLL, POINTER, c_char_p, c_int, c_int32, c_int64, c_uint16, c_uint64, c_void_p
+
+logger = logging.getLogger(__name__)
+
+# Limits of the scheduler, see MB_POLL* in mb_poller.h.
+MB_POLL_MAX_REGISTERS = 16
+MB_OK = 0
+
+_mb_lib = None
+
+
+class MBPollJob(ctypes.Structure):
+    """
+    @brief Register set read periodically from one slave.
+    Maps to the C structure `MB_PollJob` defined in mb_poller.h.
+    """
+    _fields_ = [
+        ("bus", c_void_p),            # MB_Bus of the slave (the `bus` field of a device handle)
+        ("slave_id", c_int),          # Slave address (1-247)
+        ("first_register", c_int),    # Address of the first register to read
+        ("register_count", c_int),    # Number of registers (1 to MB_POLL_MAX_REGISTERS)
+        ("input_registers", c_int),   # Non-zero to read input registers instead of holding registers
+        ("period_us", c_int),         # Polling period in microseconds
+    ]
+
+
+class MBPollSample(ctypes.Structure):
+    """
+    @brief Timestamped result of one read of a polling job.
+    Maps to the C structure `MB_PollSample` defined in mb_poller.h.
+    """
+    _fields_ = [
+        ("t_ns", c_int64),                                # Monotonic timestamp in nanoseconds
+        ("job_id", c_int32),                              # ID returned when the job was added
+        ("status", c_int32),                              # MB_OK (0) or the error code of the failed read
+        ("modbus_errno", c_int32),                        # libmodbus errno of a failed read
+        ("registers", c_uint16 * MB_POLL_MAX_REGISTERS),  # Registers read
+    ]
+
+
+def _load_library():
+    """
+    @brief Loads the bus library from the resources directory and declares the poller functions.
+    @return The loaded library.
+    """
+    global _mb_lib
+    if _mb_lib is not None:
+        return _mb_lib
+
+    lib_filename = "libmb.dll" if os.name == "nt" else "libmb.so"
+    current_dir = os.path.dirname(os.path.abspath(__file__))
+    lib = CDLL(os.path.abspath(os.path.join(current_dir, "../..", "resources", lib_filename)))
+
+    lib.MB_PollerCreate.argtypes = [c_int, POINTER(c_void_p)]
+    lib.MB_PollerCreate.restype = c_int
+    lib.MB_PollerAddJob.argtypes = [c_void_p, POINTER(MBPollJob), POINTER(c_int)]
+    lib.MB_PollerAddJob.restype = c_int
+    lib.MB_PollerSetCpu.argtypes = [c_void_p, c_void_p, c_int]
+    lib.MB_PollerSetCpu.restype = c_int
+    lib.MB_PollerStart.argtypes = [c_void_p]
+    lib.MB_PollerStart.restype = c_int
+    lib.MB_PollerStop.argtypes = [c_void_p]
+    lib.MB_PollerStop.restype = None
+    lib.MB_PollerDrain.argtypes = [c_void_p, POINTER(MBPollSample), c_int]
+    lib.MB_PollerDrain.restype = c_int
+    lib.MB_PollerGetDroppedSamples.argtypes = [c_void_p]
+    lib.MB_PollerGetDroppedSamples.restype = c_uint64
+    lib.MB_PollerDestroy.argtypes = [c_void_p]
+    lib.MB_PollerDestroy.restype = None
+    lib.MB_GetLastError.restype = c_char_p
+    _mb_lib = lib
+    return lib
+
+
+class MBPoller:
+    """
+    @brief Polls register sets on several buses in parallel and merges the results by timestamp.
+    @details
+    Jobs are added while the poller is stopped; each distinct bus gets its own C I/O thread.
+    drain() returns the samples of all buses as one stream ordered by t_ns.
+    """
+
+    def __init__(self, capacity: int = 0):
+        """
+        @brief Creates an empty poller.
+        @param capacity Samples buffered per bus until they are drained (0 = library default).
+        """
+        self._lib = _load_library()
+        self._poller = c_void_p()
+        self._register_counts = []
+        if self._lib.MB_PollerCreate(c_int(capacity), ctypes.byref(self._poller)) != MB_OK:
+            raise RuntimeError(self.get_last_error())
+
+    def add_job(self, bus: int, slave_id: int, first_register: int, register_count: int,
+                period_us: int, input_registers: bool = False) -> int:
+        """
+        @brief Adds a register set to poll; the poller must be stopped.
+        @param bus Address of the MB_Bus (e.g., the `bus` field of an RRG handle).
+        @param slave_id MODBUS slave ID.
+        @param first_register Address of the first register.
+        @param register_count Number of registers (1 to MB_POLL_MAX_REGISTERS).
+        @param period_us Polling period in microseconds.
+        @param input_registers Whether input registers are read instead of holding registers.
+        @return The job ID reported in the samples, or -1 on failure.
+        """
+        job = MBPollJob(bus, slave_id, first_register, register_count, int(bool(input_registers)), period_us)
+        job_id = c_int(-1)
+        if self._lib.MB_PollerAddJob(self._poller, ctypes.byref(job), ctypes.byref(job_id)) != MB_OK:
+            logger.error("Failed to add a polling job. Error: %s", self.get_last_error())
+            return -1
+        self._register_counts.append(register_count)
+        return job_id.value
+
+    def set_cpu(self, bus: int, cpu: int) -> bool:
+        """
+        @brief Pins the I/O thread of a bus to a CPU core (-1 = no pinning), applied by start().
+        @return True on success, False otherwise.
+        """
+        return self._lib.MB_PollerSetCpu(self._poller, c_void_p(bus), c_int(cpu)) == MB_OK
+
+    def start(self) -> bool:
+        """
+        @brief Starts one I/O thread per bus; samples left from a previous run are discarded.
+        @return True on success, False otherwise.
+        """
+        if self._lib.MB_PollerStart(self._poller) != MB_OK:
+            logger.error("Failed to start the poller. Error: %s", self.get_last_error())
+            return False
+        return True
+
+    def stop(self) -> None:
+        """
+        @brief Stops the I/O threads; pending samples stay available to drain().
+        """
+        if self._poller:
+            self._lib.MB_PollerStop(self._poller)
+
+    def drain(self, max_samples: int = 4096) -> list:
+        """
+        @brief Retrieves the samples of all buses taken since the last call without blocking.
+        @param max_samples Maximum number of samples to retrieve in one call.
+        @return A list of (t_ns, job_id, status, registers) tuples ordered by t_ns.
+        """
+        buffer = (MBPollSample * max_samples)()
+        count = self._lib.MB_PollerDrain(self._poller, buffer, c_int(max_samples))
+        if count < 0:
+            logger.error("Failed to drain the poller. Error: %s", self.get_last_error())
+            return []
+        samples = []
+        for i in range(count):
+            sample = buffer[i]
+            registers = list(sample.registers[:self._register_counts[sample.job_id]])
+            samples.append((sample.t_ns, sample.job_id, sample.status, registers))
+        return samples
+
+    def get_dropped_samples(self) -> int:
+        """
+        @brief Returns how many samples were dropped because a C ring buffer was full.
+        """
+        return self._lib.MB_PollerGetDroppedSamples(self._poller)
+
+    def get_last_error(self) -> str:
+        """
+        @brief Retrieves the last error message of the bus library.
+        """
+        error = self._lib.MB_GetLastError()
+        return error.decode("utf-8") if error else ""
+
+    def close(self) -> None:
+        """
+        @brief Stops the poller and releases its buses.
+        """
+        if self._poller:
+            self._lib.MB_PollerDestroy(self._poller)
+            self._poller = c_void_p()
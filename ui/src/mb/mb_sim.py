@@ -0,0 +1,186 @@
+# -*- coding: utf-8 -*-
+"""
+@file mb_sim.py
+@brief Python access to the simulated lines of the bus library (mb_sim.h).
+@details
+A simulated line answers the requests of the buses opened on it by name (transport "sim")
+instead of a serial port, so the device classes, the acquisition and the GUI run unchanged
+without hardware. Its slaves replay recorded binary logs at real time, N times faster or as
+fast as they are polled, and follow written setpoints as a first-order lag. This module defines:
+  - MBSimConfig / MBSimSlave: ctypes Structures mapping to the C MB_SimConfig and MB_SimSlave structs.
+  - MBSim: Owns an MB_Sim line.
+"""
+
+import os
+import ctypes
+from ctypes import POINTER, c_char_p, c_double, c_int, c_size_t, c_uint8, c_uint16, c_uint64, c_void_p
+
+import numpy as np
+
+from src.mb.mb_log import MB_LOG_RECORD_DTYPE, MBLogConfig
+from src.mb.mb_poller import MB_OK, _load_library as _load_bus_library
+
+# Register encoding flag of a simulated value (MB_REGISTER_SIGNED in mb_device.h).
+MB_REGISTER_SIGNED = 0x04
+
+
+class MBSimConfig(ctypes.Structure):
+    """
+    @brief Name and clock of a simulated line.
+    Maps to the C structure `MB_SimConfig` defined in mb_sim.h.
+    """
+    _fields_ = [
+        ("name", c_char_p),      # Name the buses open the line by (their port)
+        ("speed", c_double),     # Simulated seconds per real second, or 0 to advance per read
+        ("step_us", c_int),      # Time a read advances at speed 0 without a recording (0 = default)
+        ("loop", c_int),         # Non-zero to restart the recordings at their end
+        ("latency_us", c_int),   # Time every request takes (0 = answered at once)
+    ]
+
+
+class MBSimSlave(ctypes.Structure):
+    """
+    @brief Simulated slave: a register image with one value that follows a setpoint.
+    Maps to the C structure `MB_SimSlave` defined in mb_sim.h.
+    """
+    _fields_ = [
+        ("slave_id", c_int),             # Address of the slave
+        ("value_address", c_uint16),     # First register of the simulated value
+        ("setpoint_address", c_uint16),  # First register of the setpoint the value follows
+        ("width", c_uint8),              # Registers of the value and the setpoint (0 = plain register image)
+        ("flags", c_uint8),              # MB_REGISTER_SIGNED for two's complement values
+        ("time_constant_ms", c_int),     # Time constant of the lag in simulated time
+    ]
+
+
+def _load_library():
+    """
+    @brief Loads the bus library and declares the simulation functions.
+    @return The loaded library.
+    """
+    lib = _load_bus_library()
+    lib.MB_SimOpen.argtypes = [POINTER(MBSimConfig), POINTER(c_void_p)]
+    lib.MB_SimOpen.restype = c_int
+    lib.MB_SimAddSlave.argtypes = [c_void_p, POINTER(MBSimSlave)]
+    lib.MB_SimAddSlave.restype = c_int
+    lib.MB_SimSetRegisters.argtypes = [c_void_p, c_int, c_int, c_int, POINTER(c_uint16)]
+    lib.MB_SimSetRegisters.restype = c_int
+    lib.MB_SimGetRegisters.argtypes = [c_void_p, c_int, c_int, c_int, POINTER(c_uint16)]
+    lib.MB_SimGetRegisters.restype = c_int
+    lib.MB_SimLoadRecording.argtypes = [c_void_p, c_int, c_void_p, c_size_t]
+    lib.MB_SimLoadRecording.restype = c_int
+    lib.MB_SimLoadLog.argtypes = [c_void_p, c_int, POINTER(MBLogConfig), c_int]
+    lib.MB_SimLoadLog.restype = c_int
+    lib.MB_SimSetSpeed.argtypes = [c_void_p, c_double]
+    lib.MB_SimSetSpeed.restype = c_int
+    lib.MB_SimGetRequestCount.argtypes = [c_void_p]
+    lib.MB_SimGetRequestCount.restype = c_uint64
+    lib.MB_SimClose.argtypes = [c_void_p]
+    lib.MB_SimClose.restype = None
+    return lib
+
+
+class MBSim:
+    """
+    @brief Simulated line, registered under its name while open.
+    @details Devices connect to it with the "sim" transport and the name as their port. Closing it
+    makes their requests fail as if the port was unplugged; a line opened again under the name
+    takes over, and the buses reconnect to it on their own.
+    """
+
+    def __init__(self, name: str, speed: float = 1.0, step_us: int = 0, loop: bool = True, latency_us: int = 0):
+        """
+        @brief Opens the line.
+        @param name Name the devices connect to (their port).
+        @param speed Simulated seconds per real second (e.g., 100 replays a log at 100x), or 0 to move one
+        recorded sample per read.
+        @param step_us Simulated time a read advances at speed 0 without a recording (0 = library default).
+        @param loop Whether the recordings restart at their end instead of holding their last sample.
+        @param latency_us Time every request takes, as on a real line.
+        """
+        self._lib = _load_library()
+        self._sim = c_void_p()
+        self.name = name
+        config = MBSimConfig(name.encode("utf-8"), speed, step_us, 1 if loop else 0, latency_us)
+        if self._lib.MB_SimOpen(ctypes.byref(config), ctypes.byref(self._sim)) != MB_OK:
+            raise RuntimeError(self.get_last_error())
+
+    @property
+    def handle(self) -> c_void_p:
+        """
+        @brief The C MB_Sim pointer (NULL once closed), e.g., for RRG_SimAddRegulator().
+        """
+        return self._sim
+
+    def add_slave(self, slave_id: int, value_address: int = 0, setpoint_address: int = 0, width: int = 0,
+                  signed: bool = False, time_constant_ms: int = 0) -> bool:
+        """
+        @brief Adds a slave; with the default width of 0 it is a plain register image (e.g., a relay).
+        @return True on success, False otherwise.
+        """
+        slave = MBSimSlave(slave_id, value_address, setpoint_address, width,
+                           MB_REGISTER_SIGNED if signed else 0, time_constant_ms)
+        return self._lib.MB_SimAddSlave(self._sim, ctypes.byref(slave)) == MB_OK
+
+    def set_registers(self, slave_id: int, address: int, values) -> bool:
+        """
+        @brief Writes registers of a slave as its firmware would; a setpoint written so starts no lag.
+        @return True on success, False otherwise.
+        """
+        regs = (c_uint16 * len(values))(*values)
+        return self._lib.MB_SimSetRegisters(self._sim, slave_id, address, len(values), regs) == MB_OK
+
+    def get_registers(self, slave_id: int, address: int, count: int):
+        """
+        @brief Reads registers of a slave without advancing its clock.
+        @return The list of register values, or None on failure.
+        """
+        regs = (c_uint16 * count)()
+        if self._lib.MB_SimGetRegisters(self._sim, slave_id, address, count, regs) != MB_OK:
+            return None
+        return list(regs)
+
+    def load_recording(self, slave_id: int, records: np.ndarray) -> bool:
+        """
+        @brief Replays records of one stream (MB_LOG_RECORD_DTYPE, in time order) as the value of a slave.
+        @return True on success, False otherwise.
+        """
+        records = np.ascontiguousarray(records, dtype=MB_LOG_RECORD_DTYPE)
+        return self._lib.MB_SimLoadRecording(self._sim, slave_id, records.ctypes.data_as(c_void_p),
+                                             c_size_t(len(records))) == MB_OK
+
+    def load_log(self, slave_id: int, directory: str, prefix: str = "flow", channel: int = 0) -> bool:
+        """
+        @brief Replays one channel of a binary log (see MBLog) as the value of a slave.
+        @return True on success, False otherwise (e.g., the log has no record of the channel).
+        """
+        config = MBLogConfig(os.fsencode(directory), os.fsencode(prefix), 0, 0)
+        return self._lib.MB_SimLoadLog(self._sim, slave_id, ctypes.byref(config), channel) == MB_OK
+
+    def set_speed(self, speed: float) -> bool:
+        """
+        @brief Changes the speed of the simulated clock; the simulated time goes on from where it is.
+        @return True on success, False otherwise.
+        """
+        return self._lib.MB_SimSetSpeed(self._sim, c_double(speed)) == MB_OK
+
+    def get_request_count(self) -> int:
+        """
+        @brief Returns the number of requests the line answered or failed so far.
+        """
+        return self._lib.MB_SimGetRequestCount(self._sim)
+
+    def get_last_error(self) -> str:
+        """
+        @brief Retrieves the last error message of the bus library.
+        """
+        error = self._lib.MB_GetLastError()
+        return error.decode("utf-8") if error else ""
+
+    def close(self) -> None:
+        """
+        @brief Unregisters the line; the devices still on it lose their link until it is opened again.
+        """
+        if self._sim:
+            self._lib.MB_SimClose(self._sim)
+            self._sim = c_void_p()
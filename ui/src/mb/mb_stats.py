@@ -0,0 +1,105 @@
+# -*- coding: utf-8 -*-
+"""
+@file mb_stats.py
+@brief ctypes mirrors of the performance counters shared by the device libraries.
+@details
+The RRG and relay handles both keep an MB_TrafficCounters block and one
+MB_LatencyHistogram per operation (see mb_bus.h). This module defines:
+  - MBTrafficCounters: A ctypes Structure mapping to the C MB_TrafficCounters struct.
+  - MBLatencyHistogram: A ctypes Structure mapping to the C MB_LatencyHistogram struct.
+  - latency_bucket_lower_us / latency_percentile_us: The bucket arithmetic of mb_bus.c.
+  - stats_to_dict: Converts an RRG_Stats / Relay_Stats mirror into plain Python values.
+"""
+
+import ctypes
+from ctypes import c_uint64
+
+# Histogram layout, see MB_LATENCY_* in mb_bus.h.
+MB_LATENCY_SUB_BUCKET_BITS = 3
+MB_LATENCY_SUB_BUCKETS = 1 << MB_LATENCY_SUB_BUCKET_BITS
+MB_LATENCY_LINEAR_US = 2 * MB_LATENCY_SUB_BUCKETS
+MB_LATENCY_MAX_LOG2_US = 22
+MB_LATENCY_BUCKETS = (MB_LATENCY_LINEAR_US
+                      + (MB_LATENCY_MAX_LOG2_US - MB_LATENCY_SUB_BUCKET_BITS - 1) * MB_LATENCY_SUB_BUCKETS)
+
+
+class MBTrafficCounters(ctypes.Structure):
+    """
+    @brief Request counters of one device handle.
+    Maps to the C structure `MB_TrafficCounters` defined in mb_bus.h.
+    """
+    _fields_ = [
+        ("transactions", c_uint64),    # Transactions made on the line
+        ("failures", c_uint64),        # Transactions that failed, whatever the reason
+        ("timeouts", c_uint64),        # Requests the slave did not answer in time
+        ("crc_errors", c_uint64),      # Responses rejected because of a bad CRC
+        ("exceptions", c_uint64),      # MODBUS exception responses
+        ("retries", c_uint64),         # Requests sent again in another form
+        ("skipped_writes", c_uint64),  # Writes suppressed by the write cache
+        ("bytes_sent", c_uint64),      # RTU request bytes put on the line
+        ("bytes_received", c_uint64),  # RTU response bytes of the successful requests
+    ]
+
+
+class MBLatencyHistogram(ctypes.Structure):
+    """
+    @brief HDR-style log-linear histogram of the duration of one operation.
+    Maps to the C structure `MB_LatencyHistogram` defined in mb_bus.h.
+    """
+    _fields_ = [
+        ("count", c_uint64),                          # Recorded transactions
+        ("total_us", c_uint64),                       # Sum of their durations
+        ("buckets", c_uint64 * MB_LATENCY_BUCKETS),   # Transactions per duration bucket
+    ]
+
+
+def latency_bucket_lower_us(bucket: int) -> int:
+    """
+    @brief Returns the lower bound of a histogram bucket in microseconds (mirrors MB_LatencyBucketLowerUs).
+    @param bucket Bucket index, from 0 to MB_LATENCY_BUCKETS.
+    """
+    if bucket < 0 or bucket > MB_LATENCY_BUCKETS:
+        return 0
+    if bucket < MB_LATENCY_LINEAR_US:
+        return bucket
+    index = bucket - MB_LATENCY_LINEAR_US
+    log2 = MB_LATENCY_SUB_BUCKET_BITS + 1 + index // MB_LATENCY_SUB_BUCKETS
+    return (MB_LATENCY_SUB_BUCKETS + index % MB_LATENCY_SUB_BUCKETS) << (log2 - MB_LATENCY_SUB_BUCKET_BITS)
+
+
+def latency_percentile_us(histogram: MBLatencyHistogram, quantile: float) -> int:
+    """
+    @brief Estimates a percentile of a histogram in microseconds (mirrors MB_LatencyPercentileUs).
+    @param histogram Histogram to read.
+    @param quantile Quantile between 0 and 1 (0.99 for the p99).
+    @return The upper bound of the bucket holding the quantile, or 0 if the histogram is empty.
+    """
+    if histogram.count == 0:
+        return 0
+    quantile = min(max(quantile, 0.0), 1.0)
+    rank = max(int(quantile * histogram.count + 0.5), 1)
+    seen = 0
+    for i in range(MB_LATENCY_BUCKETS):
+        seen += histogram.buckets[i]
+        if seen >= rank:
+            return latency_bucket_lower_us(i + 1)
+    return latency_bucket_lower_us(MB_LATENCY_BUCKETS)
+
+
+def stats_to_dict(stats, op_names) -> dict:
+    """
+    @brief Converts the counters of a handle into a dictionary.
+    @param stats RRGStats or RelayStats structure filled by the C library.
+    @param op_names Operation names in the order of the latency histograms.
+    @return {"traffic": {counter: value}, "latency": {op: {"count", "mean_us", "p50_us", "p99_us"}}}.
+    """
+    traffic = {name: getattr(stats.traffic, name) for name, _ in MBTrafficCounters._fields_}
+    latency = {}
+    for name, histogram in zip(op_names, stats.latency):
+        latency[name] = {
+            "count": histogram.count,
+            "mean_us": histogram.total_us / histogram.count if histogram.count else 0.0,
+            "p50_us": latency_percentile_us(histogram, 0.50),
+            "p99_us": latency_percentile_us(histogram, 0.99),
+        }
+    return {"traffic": traffic, "latency": latency}
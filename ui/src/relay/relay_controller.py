@@ -11,6 +11,7 @@ Each method returns an error code (with 0 indicating success) so that calling co
 error conditions appropriately.
 """
 
+from src.mb.mb_bus import MB_TRANSPORT_RTU
 from src.relay.relay_wrapper import Relay
 
 
@@ -43,29 +44,37 @@ class RelayController:
         """
         self._relay = None  # Will hold an instance of Relay after connection
 
-    def TurnOn(self, com_port: str, baudrate: int, slave_id: int, timeout: int) -> int:
+    def TurnOn(self, com_port: str, baudrate: int, slave_id: int, timeout: int,
+               adaptive_timeout: bool = False, write_cache: bool = False,
+               write_cache_refresh_ms: int = 0, fast_transport: bool = False,
+               transport: int = MB_TRANSPORT_RTU, probe_timeout: int = 0) -> int:
         """
         @brief Connects to the Relay device on the specified COM port and turns it on.
-        @param com_port Serial port name (e.g., "COM3" on Windows or "/dev/ttyUSB0" on Linux).
+        @param com_port Serial port name (e.g., "COM3" on Windows or "/dev/ttyUSB0" on Linux), or "host:port".
         @param baudrate Baud rate for communication.
         @param slave_id MODBUS slave ID for the Relay.
         @param timeout Communication timeout in milliseconds.
+        @param adaptive_timeout Whether the timeout follows the measured latency of the device.
+        @param write_cache Whether writes of the state the relay already holds are skipped.
+        @param write_cache_refresh_ms Age after which the cached state is written again anyway (0 = never).
+        @param fast_transport Whether state writes bypass libmodbus where the port allows it.
+        @param transport One of MB_TRANSPORT_*: local serial port, MODBUS TCP or RTU over TCP gateway.
+        @param probe_timeout Longest wait in milliseconds for the relay to answer a probe read (0 = no probe).
         @return RELAY_OK on success, or an error code if connection or operation fails.
         """
+        # The device is published only once turned on (see RRGController.TurnOn()).
         try:
-            self._relay = Relay(com_port, baudrate, slave_id, timeout)
-            if not self._relay.connect():
-                self._relay = None
+            relay = Relay(com_port, baudrate, slave_id, timeout, adaptive_timeout,
+                          write_cache, write_cache_refresh_ms, fast_transport, transport, probe_timeout)
+            if not relay.connect():
                 return self.ERROR_RELAY_CONNECT_FAILED
-            if self._relay.turn_on():
-                return self.RELAY_OK
-            else:
-                self._relay.close()
-                self._relay = None
+            if not relay.turn_on():
+                relay.close()
                 return self.ERROR_RELAY_TURN_ON_FAILED
         except Exception:
-            self._relay = None
             return self.ERROR_RELAY_CONNECT_FAILED
+        self._relay = relay
+        return self.RELAY_OK
 
     def TurnOff(self) -> int:
         """
@@ -92,6 +101,12 @@ class RelayController:
             return self.ERROR_RELAY_NOT_CONNECTED
         return self._relay.get_last_error()
 
+    def GetRelay(self):
+        """
+        @brief Returns the connected Relay wrapper (e.g., for RRGController.SetInterlock()), or None.
+        """
+        return self._relay
+
     def IsConnected(self):
         """
         @brief Checks if the Relay device is connected.
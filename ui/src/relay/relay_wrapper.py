@@ -6,7 +6,10 @@
 This module loads the Relay shared library and exposes a Python interface to the
 functions defined in the Relay C API. It defines:
   - RelayConfig: A ctypes Structure mapping to the C Relay_Config struct.
+  - RelayShadowRegister: A ctypes Structure mapping to the C Relay_ShadowRegister struct.
+  - RelayStats: A ctypes Structure mapping to the C Relay_Stats struct.
   - RelayHandle: A ctypes Structure mapping to the C Relay_Handle struct.
+  - RELAY_CALLBACK: The ctypes prototype of the C Relay_Callback completion callback.
   - IRelay: An abstract interface for Relay operations.
   - Relay: A concrete implementation of IRelay that wraps the C API.
 """
@@ -15,7 +18,11 @@ import os
 import sys
 import ctypes
 import logging
-from ctypes import CDLL, POINTER, c_char_p, c_int, c_void_p
+import threading
+from ctypes import CDLL, CFUNCTYPE, POINTER, c_char_p, c_int, c_int64, c_uint16, c_uint64, c_void_p
+
+from src.mb.mb_bus import MB_TRANSPORT_RTU
+from src.mb.mb_stats import MBLatencyHistogram, MBTrafficCounters, stats_to_dict
 
 
 # Configure logging.
@@ -25,7 +32,7 @@ logger = logging.getLogger(__name__)
 
 # Determine the Relay library filename based on the platform.
 if os.name == "nt":
-    lib_filename = "relay.dll"
+    lib_filename = "librelay.dll"
 else:
     lib_filename = "librelay.so"
 
@@ -55,6 +62,40 @@ class RelayConfig(ctypes.Structure):
         ("baudrate", c_int),    # Baud rate for serial communication (e.g., 9600, 19200, 38400)
         ("slave_id", c_int),    # MODBUS slave ID of the relay
         ("timeout", c_int),     # Timeout for response in milliseconds
+        ("adaptive_timeout", c_int),  # Non-zero to adapt the timeout to the measured latency
+        ("write_cache", c_int),  # Non-zero to skip writes of the state the relay already holds
+        ("write_cache_refresh_ms", c_int),  # Age after which the cached state is written again (0 = never)
+        ("fast_transport", c_int),  # Non-zero to bypass libmodbus where possible
+        ("transport", c_int),  # One of MB_TRANSPORT_* (0 = local serial port)
+        ("probe_timeout", c_int),  # Timeout of the liveness probe of RELAY_Init in milliseconds (0 = no probe)
+        ("arena", c_void_p),  # MB_Arena the bus and template come from (NULL = the heap)
+    ]
+
+
+class RelayShadowRegister(ctypes.Structure):
+    """
+    @brief Last value of a register confirmed by the relay.
+    Maps to the C structure `MB_ShadowRegister` defined in mb_device.h (Relay_ShadowRegister).
+    """
+    _fields_ = [
+        ("valid", c_int),           # Non-zero when regs holds a confirmed value
+        ("regs", c_uint16 * 2),     # Register contents; only regs[0] is used
+        ("t_ns", c_int64),          # Monotonic time the value was last written
+    ]
+
+
+# Operations with their own latency histogram, in the order of RELAY_STATS_OP_* (see relay_constants.h).
+RELAY_STATS_OPS = ("turn_on", "turn_off")
+
+
+class RelayStats(ctypes.Structure):
+    """
+    @brief Performance counters of one handle filled by `RELAY_GetStats`.
+    Maps to the C structure `Relay_Stats` defined in the header.
+    """
+    _fields_ = [
+        ("traffic", MBTrafficCounters),  # Requests, errors and bytes
+        ("latency", MBLatencyHistogram * len(RELAY_STATS_OPS)),  # Transaction durations per RELAY_STATS_OP_*
     ]
 
 
@@ -64,10 +105,25 @@ class RelayHandle(ctypes.Structure):
     Maps to the C structure `Relay_Handle` defined in the header.
     """
     _fields_ = [
-        ("modbus_ctx", c_void_p)  # Pointer to the libmodbus context.
+        ("modbus_ctx", c_void_p),  # Pointer to the libmodbus context (shared, owned by the bus).
+        ("bus", c_void_p),         # MB_Bus the handle is attached to.
+        ("rtu_frame", c_void_p),   # Request template of the fast RTU transport (NULL until enabled).
+        ("arena", c_void_p),       # Arena the template comes from (NULL = the heap).
+        ("slave_id", c_int),       # MODBUS slave ID of the relay on the bus.
+        ("last_error", c_int),     # Error code of the last operation made through the handle.
+        ("last_modbus_errno", c_int),  # libmodbus errno of the last failed request (0 if none).
+        ("write_cache", c_int),  # Non-zero when writes matching the shadow register are skipped.
+        ("fast_transport", c_int),  # Non-zero when state writes bypass libmodbus.
+        ("cache_refresh_ns", c_int64),  # Age after which the cached state is written again (0 = never).
+        ("shadow_state", RelayShadowRegister),  # On/off register 512.
+        ("stats", RelayStats),  # Performance counters (read them with RELAY_GetStats).
     ]
 
 
+# void (*Relay_Callback)(Relay_Handle *handle, uint64_t request_id, int error_code, void *user_data)
+RELAY_CALLBACK = CFUNCTYPE(None, POINTER(RelayHandle), c_uint64, c_int, c_void_p)
+
+
 class IRelay:
     """
     @brief Interface defining methods for interacting with the Relay device.
@@ -106,24 +162,47 @@ class IRelay:
         """
         raise NotImplementedError
 
+    def get_handle_error(self):
+        """
+        @brief Retrieves the last error of this device handle, independent of the calling thread.
+        @return A tuple (error_code, modbus_errno, description).
+        """
+        raise NotImplementedError
+
 
 class Relay(IRelay):
     """
     @brief Python wrapper for the Relay C API.
     Provides a high-level interface to communicate with the relay device.
     """
-    def __init__(self, port: str, baudrate: int, slave_id: int, timeout: int) -> None:
+    def __init__(self, port: str, baudrate: int, slave_id: int, timeout: int,
+                 adaptive_timeout: bool = False, write_cache: bool = False,
+                 write_cache_refresh_ms: int = 0, fast_transport: bool = False,
+                 transport: int = MB_TRANSPORT_RTU, probe_timeout: int = 0) -> None:
         """
         @brief Initializes a Relay instance with the given connection parameters.
-        @param port Serial port name (e.g., "COM3" or "/dev/ttyUSB0").
+        @param port Serial port name (e.g., "COM3" or "/dev/ttyUSB0"), or "host:port" of a gateway.
         @param baudrate Baud rate for communication.
         @param slave_id MODBUS slave ID.
         @param timeout Response timeout in milliseconds.
+        @param adaptive_timeout Whether the C library adapts the timeout to the measured latency.
+        @param write_cache Whether writes of the state the relay already holds are skipped.
+        @param write_cache_refresh_ms Age after which the cached state is written again anyway (0 = never).
+        @param fast_transport Whether state writes bypass libmodbus (falls back to it where unavailable).
+        @param transport One of MB_TRANSPORT_* (see src.mb.mb_bus): local serial port, MODBUS TCP or RTU over TCP.
+        @param probe_timeout If positive, connect() fails unless the relay answers one read within
+        this many milliseconds, so an absent device is detected without waiting for the full timeout.
         """
         logger.debug("Initializing Relay with port=%s, baudrate=%d, slave_id=%d, timeout=%d",
                      port, baudrate, slave_id, timeout)
-        self._config = RelayConfig(port.encode("utf-8"), baudrate, slave_id, timeout)
+        self._config = RelayConfig(port.encode("utf-8"), baudrate, slave_id, timeout, int(adaptive_timeout),
+                                   int(write_cache), write_cache_refresh_ms, int(fast_transport),
+                                   transport, probe_timeout)
         self._handle = RelayHandle()
+        # Completion callbacks of pending asynchronous requests, keyed by request ID.
+        self._pending = {}
+        self._pending_lock = threading.Lock()
+        self._c_callback = RELAY_CALLBACK(self._on_request_done)
         self._setup_functions()
 
     def _setup_functions(self) -> None:
@@ -140,11 +219,41 @@ class Relay(IRelay):
         relay_lib.RELAY_TurnOff.argtypes = [POINTER(RelayHandle)]
         relay_lib.RELAY_TurnOff.restype = c_int
 
+        relay_lib.RELAY_SetWriteCache.argtypes = [POINTER(RelayHandle), c_int, c_int]
+        relay_lib.RELAY_SetWriteCache.restype = c_int
+
+        relay_lib.RELAY_InvalidateWriteCache.argtypes = [POINTER(RelayHandle)]
+        relay_lib.RELAY_InvalidateWriteCache.restype = None
+
+        relay_lib.RELAY_SetFastTransport.argtypes = [POINTER(RelayHandle), c_int]
+        relay_lib.RELAY_SetFastTransport.restype = c_int
+
+        relay_lib.RELAY_TurnOnAsync.argtypes = [POINTER(RelayHandle), RELAY_CALLBACK, c_void_p, POINTER(c_uint64)]
+        relay_lib.RELAY_TurnOnAsync.restype = c_int
+
+        relay_lib.RELAY_TurnOffAsync.argtypes = [POINTER(RelayHandle), RELAY_CALLBACK, c_void_p, POINTER(c_uint64)]
+        relay_lib.RELAY_TurnOffAsync.restype = c_int
+
+        relay_lib.RELAY_Wait.argtypes = [POINTER(RelayHandle), c_uint64]
+        relay_lib.RELAY_Wait.restype = c_int
+
         relay_lib.RELAY_Close.argtypes = [POINTER(RelayHandle)]
         relay_lib.RELAY_Close.restype = None
 
+        relay_lib.RELAY_GetStats.argtypes = [POINTER(RelayHandle), POINTER(RelayStats)]
+        relay_lib.RELAY_GetStats.restype = c_int
+
+        relay_lib.RELAY_ResetStats.argtypes = [POINTER(RelayHandle)]
+        relay_lib.RELAY_ResetStats.restype = None
+
         relay_lib.RELAY_GetLastError.restype = c_char_p
 
+        relay_lib.RELAY_GetLastErrorEx.argtypes = [POINTER(RelayHandle)]
+        relay_lib.RELAY_GetLastErrorEx.restype = c_char_p
+
+        relay_lib.RELAY_GetLastErrorCodeEx.argtypes = [POINTER(RelayHandle), POINTER(c_int)]
+        relay_lib.RELAY_GetLastErrorCodeEx.restype = c_int
+
     def connect(self) -> bool:
         """
         @brief Establishes a connection with the Relay device.
@@ -186,14 +295,120 @@ class Relay(IRelay):
             logger.info("Relay turned OFF successfully.")
         return result == 0
 
+    def set_write_cache(self, enabled: bool, refresh_ms: int = 0) -> bool:
+        """
+        @brief Enables or disables skipping writes of the state the relay already holds.
+        @param enabled Whether the write cache is used (it starts empty).
+        @param refresh_ms Age after which the cached state is written again anyway (0 = never).
+        @return True on success, False otherwise.
+        """
+        result = relay_lib.RELAY_SetWriteCache(ctypes.byref(self._handle), c_int(int(enabled)), c_int(refresh_ms))
+        if result != 0:
+            logger.error("Failed to configure the write cache. Error: %s", self.get_last_error())
+        return result == 0
+
+    def invalidate_write_cache(self) -> None:
+        """
+        @brief Forgets the cached state, so the next write reaches the relay.
+        """
+        relay_lib.RELAY_InvalidateWriteCache(ctypes.byref(self._handle))
+
+    def set_fast_transport(self, enabled: bool) -> bool:
+        """
+        @brief Switches state writes to the fast RTU transport, or back to libmodbus.
+        @return True on success, False if the port cannot be driven directly (libmodbus stays in use).
+        """
+        return relay_lib.RELAY_SetFastTransport(ctypes.byref(self._handle), c_int(int(enabled))) == 0
+
+    def c_turn_off(self):
+        """
+        @brief Returns the C function turning the relay off and its argument, for callbacks run without Python.
+        @details Used as the action of RRG.set_interlock(); the relay must stay open while it is installed.
+        @return (address of RELAY_TurnOff, address of the relay handle).
+        """
+        return ctypes.cast(relay_lib.RELAY_TurnOff, c_void_p).value, ctypes.addressof(self._handle)
+
+    def _submit(self, name: str, submit, callback) -> int:
+        """
+        @brief Queues an asynchronous request and registers its Python completion callback.
+        @param name Operation name used in log messages.
+        @param submit C function queuing the request.
+        @param callback Callable (request_id, error_code) or None.
+        @return The request ID, or 0 if the request could not be queued.
+        """
+        request_id = c_uint64(0)
+        # The lock is held until the callback is registered, so a fast completion waits for it.
+        with self._pending_lock:
+            result = submit(ctypes.byref(self._handle), self._c_callback, None, ctypes.byref(request_id))
+            if result != 0:
+                logger.error("Failed to queue %s. Error: %s", name, self.get_last_error())
+                return 0
+            if callback is not None:
+                self._pending[request_id.value] = callback
+        return request_id.value
+
+    def _on_request_done(self, _handle, request_id, error_code, _user_data) -> None:
+        """
+        @brief Trampoline called by the bus I/O worker thread when a request completes.
+        """
+        with self._pending_lock:
+            callback = self._pending.pop(request_id, None)
+        if callback is None:
+            return
+        try:
+            callback(request_id, error_code)
+        except Exception:
+            logger.exception("Completion callback of request %d failed.", request_id)
+
+    def turn_on_async(self, callback=None) -> int:
+        """
+        @brief Queues a "turn on" command to the bus I/O worker and returns immediately.
+        @param callback Optional callable (request_id, error_code) run on the worker thread.
+        @return The request ID, or 0 if the request could not be queued.
+        """
+        return self._submit("relay ON", relay_lib.RELAY_TurnOnAsync, callback)
+
+    def turn_off_async(self, callback=None) -> int:
+        """
+        @brief Queues a "turn off" command to the bus I/O worker and returns immediately.
+        @param callback Optional callable (request_id, error_code) run on the worker thread.
+        @return The request ID, or 0 if the request could not be queued.
+        """
+        return self._submit("relay OFF", relay_lib.RELAY_TurnOffAsync, callback)
+
+    def wait(self, request_id: int) -> bool:
+        """
+        @brief Blocks until the request (and every request queued on the bus before it) has completed.
+        @param request_id ID returned by one of the *_async methods.
+        @return True on success, False otherwise.
+        """
+        return relay_lib.RELAY_Wait(ctypes.byref(self._handle), c_uint64(request_id)) == 0
+
+    def get_stats(self):
+        """
+        @brief Retrieves the performance counters of the handle.
+        @return A dictionary {"traffic": {...}, "latency": {op: {"count", "mean_us", "p50_us", "p99_us"}}},
+                or None on error.
+        """
+        stats = RelayStats()
+        if relay_lib.RELAY_GetStats(ctypes.byref(self._handle), ctypes.byref(stats)) != 0:
+            logger.error("Failed to read the statistics. Error: %s", self.get_last_error())
+            return None
+        return stats_to_dict(stats, RELAY_STATS_OPS)
+
+    def reset_stats(self) -> None:
+        """
+        @brief Resets the performance counters of the handle to zero.
+        """
+        relay_lib.RELAY_ResetStats(ctypes.byref(self._handle))
+
     def close(self) -> None:
         """
         @brief Closes the connection to the Relay device and frees resources.
         """
-        if self._handle and self._handle.modbus_ctx:
+        if self._handle and self._handle.bus:
             logger.info("Closing connection to Relay device.")
             relay_lib.RELAY_Close(ctypes.byref(self._handle))
-            self._handle.modbus_ctx = None
             logger.info("Connection closed successfully.")
         else:
             logger.warning("Attempted to close Relay device, but handle is invalid or already closed.")
@@ -207,3 +422,14 @@ class Relay(IRelay):
         error_str = err_ptr.decode("utf-8") if err_ptr else "Unknown error."
         logger.debug("Retrieved last error: %s", error_str)
         return error_str
+
+    def get_handle_error(self):
+        """
+        @brief Retrieves the last error recorded in the handle by the C library.
+        @return A tuple (error_code, modbus_errno, description).
+        """
+        modbus_errno = c_int(0)
+        error_code = relay_lib.RELAY_GetLastErrorCodeEx(ctypes.byref(self._handle), ctypes.byref(modbus_errno))
+        err_ptr = relay_lib.RELAY_GetLastErrorEx(ctypes.byref(self._handle))
+        error_str = err_ptr.decode("utf-8") if err_ptr else "Unknown error."
+        return error_code, modbus_errno.value, error_str
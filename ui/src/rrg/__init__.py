@@ -1,6 +1,9 @@
 # ПНППК/src/rrg/__init__.py
 
 from .rrg_controller import RRGController
-from .rrg_wrapper import RRG
+from .rrg_wrapper import (RRG, add_simulated_regulator, get_flow_many, records_to_flow, registers_to_flow,
+                          set_flow_group)
+from .flow_history import FlowHistory
 
-__all__ = ["RRGController", "RRG"]
+__all__ = ["RRGController", "RRG", "add_simulated_regulator", "get_flow_many", "records_to_flow", "registers_to_flow",
+           "set_flow_group", "FlowHistory"]
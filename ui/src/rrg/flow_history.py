@@ -0,0 +1,203 @@
+# -*- coding: utf-8 -*-
+"""
+@file flow_history.py
+@brief Fixed-capacity flow history with a min/max/mean decimation pyramid.
+@details
+Level 0 of the history is a ring buffer of the raw (time, flow) points. Every higher level
+keeps a ring of buckets, each summarizing PYRAMID_FACTOR buckets of the level below with
+the time of its first point and the minimum, maximum and mean flow. All levels span the
+same duration, so a view of any time window is served from the finest level that has no
+more buckets in the window than the caller can show (typically the width of the plot in
+pixels): its cost depends on the size of the view, not on the length of the history, and a
+24-hour trace is as cheap to draw as a one-minute one. Min/max buckets keep short spikes
+visible at any zoom level, which plain striding would skip.
+
+Appending a batch of samples is vectorized: slice assignments into the raw ring, then one
+reshape-and-reduce per level for the buckets the batch completes. This module defines:
+  - PYRAMID_FACTOR: The number of lower-level buckets summarized by one bucket.
+  - FlowHistory: The raw ring and its pyramid.
+"""
+
+import numpy as np
+
+PYRAMID_FACTOR = 4
+PYRAMID_MIN_LEVEL_CAPACITY = 64  # Levels stop once they would hold fewer buckets than this
+
+
+class _Level:
+    """
+    @brief Ring of records (t, min, max, mean) of one pyramid level, oldest first.
+    @details The raw level stores only t and values: min, max and mean alias the same array.
+    """
+
+    def __init__(self, capacity: int, raw: bool):
+        self.t = np.empty(capacity)
+        self.min = np.empty(capacity)
+        self.max = self.min if raw else np.empty(capacity)
+        self.mean = self.min if raw else np.empty(capacity)
+        self.raw = raw
+        self.head = 0   # Index the next record is written to
+        self.count = 0  # Number of valid records
+
+    def clear(self) -> None:
+        self.head = 0
+        self.count = 0
+
+    def append(self, t, mn, mx, mean) -> None:
+        capacity = len(self.t)
+        count = len(t)
+        if count > capacity:
+            t, mn, mx, mean, count = t[-capacity:], mn[-capacity:], mx[-capacity:], mean[-capacity:], capacity
+
+        # Write in at most two slices: up to the end of the storage, then from its start.
+        columns = ((self.t, t), (self.min, mn)) if self.raw else \
+            ((self.t, t), (self.min, mn), (self.max, mx), (self.mean, mean))
+        first = min(count, capacity - self.head)
+        for storage, data in columns:
+            storage[self.head:self.head + first] = data[:first]
+            storage[:count - first] = data[first:]
+        self.head = (self.head + count) % capacity
+        self.count = min(self.count + count, capacity)
+
+    def storage_index(self, offsets):
+        """
+        @brief Maps logical offsets (0 = oldest record) to storage indexes.
+        """
+        return (self.head - self.count + offsets) % len(self.t)
+
+    def search(self, t_value: float, side: str = "left") -> int:
+        """
+        @brief Returns the logical offset where t_value would be inserted (see numpy.searchsorted).
+        """
+        start = (self.head - self.count) % len(self.t)
+        if start + self.count <= len(self.t):
+            return int(np.searchsorted(self.t[start:start + self.count], t_value, side))
+        # Wrapped: the older part runs to the end of the storage, the newer one starts at 0.
+        older = len(self.t) - start
+        offset = int(np.searchsorted(self.t[start:], t_value, side))
+        if offset < older:
+            return offset
+        return older + int(np.searchsorted(self.t[:self.head], t_value, side))
+
+    def window(self, t_start: float, t_end: float):
+        """
+        @brief Returns the logical offsets [first, last) of the records in [t_start, t_end],
+        extended by one record on the left so a line enters the window from its edge.
+        """
+        first = max(self.search(t_start) - 1, 0)
+        last = self.search(t_end, "right")
+        return first, max(first, last)
+
+    def gather(self, first: int, last: int):
+        indexes = self.storage_index(np.arange(first, last))
+        return self.t[indexes], self.min[indexes], self.max[indexes], self.mean[indexes]
+
+
+class FlowHistory:
+    """
+    @brief Ring buffer of (time, flow) points with a min/max/mean pyramid for display and export.
+    """
+
+    def __init__(self, capacity: int):
+        """
+        @brief Allocates the storage of every level once.
+        @param capacity Maximum number of raw points kept; older points are overwritten.
+        """
+        self._levels = [_Level(capacity, raw=True)]
+        level_capacity = capacity // PYRAMID_FACTOR
+        while level_capacity >= PYRAMID_MIN_LEVEL_CAPACITY:
+            self._levels.append(_Level(level_capacity, raw=False))
+            level_capacity //= PYRAMID_FACTOR
+        # Records of level k-1 not yet summarized into a complete bucket of level k (index k).
+        self._pending = [None] + [tuple(np.empty(0) for _ in range(4)) for _ in self._levels[1:]]
+
+    def __len__(self) -> int:
+        return self._levels[0].count
+
+    @property
+    def levels(self) -> int:
+        """
+        @brief Number of levels, including the raw one.
+        """
+        return len(self._levels)
+
+    def clear(self) -> None:
+        """
+        @brief Forgets every point without releasing the storage.
+        """
+        for level in self._levels:
+            level.clear()
+        self._pending = [None] + [tuple(np.empty(0) for _ in range(4)) for _ in self._levels[1:]]
+
+    def append(self, times, values) -> None:
+        """
+        @brief Appends a batch of points (array-likes of equal length, times increasing), oldest first.
+        """
+        times = np.asarray(times, dtype=float)
+        values = np.asarray(values, dtype=float)
+        self._levels[0].append(times, values, values, values)
+
+        # Complete the buckets of every level with the records of the level below.
+        records = (times, values, values, values)
+        for k in range(1, len(self._levels)):
+            t, mn, mx, mean = (np.concatenate((old, new)) for old, new in zip(self._pending[k], records))
+            complete = len(t) - len(t) % PYRAMID_FACTOR
+            self._pending[k] = (t[complete:], mn[complete:], mx[complete:], mean[complete:])
+            if complete == 0:
+                break
+            records = (t[:complete:PYRAMID_FACTOR],
+                       mn[:complete].reshape(-1, PYRAMID_FACTOR).min(axis=1),
+                       mx[:complete].reshape(-1, PYRAMID_FACTOR).max(axis=1),
+                       mean[:complete].reshape(-1, PYRAMID_FACTOR).mean(axis=1))
+            self._levels[k].append(*records)
+
+    def first_time(self) -> float:
+        """
+        @brief Returns the time of the oldest point; the history must not be empty.
+        """
+        level = self._levels[0]
+        return level.t[level.storage_index(0)]
+
+    def last(self):
+        """
+        @brief Returns the newest point as a (time, flow) tuple; the history must not be empty.
+        """
+        level = self._levels[0]
+        index = (level.head - 1) % len(level.t)
+        return level.t[index], level.min[index]
+
+    def view(self, t_start: float, t_end: float, max_buckets: int):
+        """
+        @brief Returns the history in [t_start, t_end] summarized into at most about max_buckets buckets.
+        @details The finest level with at most max_buckets records in the window is used, and the
+        newest points, not yet summarized at that level, are appended from the finer levels.
+        Raw points come back as buckets with min == max == mean.
+        @return A tuple (times, mins, maxs, means) of new arrays, oldest first.
+        """
+        max_buckets = max(int(max_buckets), 1)
+        raw_first, raw_last = self._levels[0].window(t_start, t_end)
+        level_index = 0
+        count = raw_last - raw_first
+        while count > max_buckets and level_index + 1 < len(self._levels):
+            level_index += 1
+            count //= PYRAMID_FACTOR
+
+        level = self._levels[level_index]
+        first, last = level.window(t_start, t_end)
+        parts = [level.gather(first, last)]
+        if level_index > 0 and last == level.count:
+            # The window reaches the newest bucket: add the records still pending below it.
+            for k in range(level_index, 0, -1):
+                t, mn, mx, mean = self._pending[k]
+                keep = t <= t_end
+                parts.append((t[keep], mn[keep], mx[keep], mean[keep]))
+        return tuple(np.concatenate(column) for column in zip(*parts))
+
+    @staticmethod
+    def envelope(times, mins, maxs):
+        """
+        @brief Interleaves the buckets of a view into one polyline going through the minimum
+        and the maximum of every bucket, for drawing with a single Line2D.
+        @return A tuple (x, y) of arrays twice as long as the view.
+        """
+        return np.repeat(times, 2), np.column_stack((mins, maxs)).ravel()
@@ -11,6 +11,7 @@ Each method returns an error code (with 0 indicating success) so that calling co
 handle error conditions appropriately.
 """
 
+from src.mb.mb_bus import MB_TRANSPORT_RTU
 from src.rrg.rrg_wrapper import RRG
 
 
@@ -28,6 +29,8 @@ class RRGController:
     ERROR_RRG_CONNECT_FAILED = -2
     ERROR_RRG_SET_FLOW_FAILED = -3
     ERROR_RRG_GET_FLOW_FAILED = -4
+    ERROR_RRG_ACQUISITION_FAILED = -5
+    ERROR_RRG_RAMP_FAILED = -6
 
     def __init__(self):
         """
@@ -44,27 +47,39 @@ class RRGController:
         baudrate: int,
         slave_id: int,
         timeout: int,
+        adaptive_timeout: bool = False,
+        write_cache: bool = False,
+        write_cache_refresh_ms: int = 0,
+        fast_transport: bool = False,
+        transport: int = MB_TRANSPORT_RTU,
+        probe_timeout: int = 0,
     ) -> int:
         """
         @brief Connects to the RRG device on the specified COM port.
-        @param com_port Serial port name (e.g., "COM3" on Windows or "/dev/ttyUSB0" on Linux).
+        @param com_port Serial port name (e.g., "COM3" on Windows or "/dev/ttyUSB0" on Linux), or "host:port".
         @param baudrate Baud rate for communication.
         @param slave_id MODBUS slave ID.
         @param timeout Communication timeout in milliseconds.
+        @param adaptive_timeout Whether the timeout follows the measured latency of the device.
+        @param write_cache Whether writes of the setpoint or gas the device already holds are skipped.
+        @param write_cache_refresh_ms Age after which a cached value is written again anyway (0 = never).
+        @param fast_transport Whether the hot operations bypass libmodbus where the port allows it.
+        @param transport One of MB_TRANSPORT_*: local serial port, MODBUS TCP or RTU over TCP gateway.
+        @param probe_timeout Longest wait in milliseconds for the regulator to answer a probe read (0 = no probe).
         @return RRG_OK on success, or an error code if connection fails.
         """
+        # The device is published only once connected: TurnOn may run on a worker thread while the
+        # UI thread checks IsConnected(), which must never see a half-open device.
         try:
-            self._rrg = RRG(com_port, baudrate, slave_id, timeout)
-            if self._rrg.connect():
-                return self.RRG_OK
-            else:
-                # Connection failed; ensure _rrg is set to None.
-                self._rrg = None
+            rrg = RRG(com_port, baudrate, slave_id, timeout, adaptive_timeout,
+                      write_cache, write_cache_refresh_ms, fast_transport, transport, probe_timeout)
+            if not rrg.connect():
                 return self.ERROR_RRG_CONNECT_FAILED
         except Exception:
             # Log exception details if needed.
-            self._rrg = None
             return self.ERROR_RRG_CONNECT_FAILED
+        self._rrg = rrg
+        return self.RRG_OK
 
     def TurnOff(self) -> int:
         """
@@ -114,6 +129,161 @@ class RRGController:
         except Exception:
             return (self.ERROR_RRG_GET_FLOW_FAILED, -1.0)
 
+    def StartAcquisition(self, period_us: int) -> int:
+        """
+        @brief Starts sampling the flow in a C background thread every period_us microseconds.
+        @return RRG_OK on success, or an error code if the acquisition cannot be started.
+        """
+        if self._rrg is None:
+            return self.ERROR_RRG_NOT_CONNECTED
+
+        try:
+            if self._rrg.start_acquisition(period_us):
+                return self.RRG_OK
+            return self.ERROR_RRG_ACQUISITION_FAILED
+        except Exception:
+            return self.ERROR_RRG_ACQUISITION_FAILED
+
+    def SetFlowLog(self, log, channel: int = 0) -> int:
+        """
+        @brief Records the samples of the next acquisitions to a binary MBLog (None to stop recording).
+        @return RRG_OK on success, or an error code if the acquisition is running.
+        """
+        if self._rrg is None:
+            return self.ERROR_RRG_NOT_CONNECTED
+
+        if self._rrg.set_flow_log(log, channel):
+            return self.RRG_OK
+        return self.ERROR_RRG_ACQUISITION_FAILED
+
+    def SetChangeFilter(self, deadband, rate_threshold: float = 0.0, heartbeat_ms: int = 0, callback=None) -> int:
+        """
+        @brief Reports only the meaningful flow changes of the next acquisitions (deadband None: none).
+        @details See RRG.set_change_filter(); the changes are read with DrainChangeArray().
+        @return RRG_OK on success, or an error code if the acquisition is running.
+        """
+        if self._rrg is None:
+            return self.ERROR_RRG_NOT_CONNECTED
+
+        if self._rrg.set_change_filter(deadband, rate_threshold, heartbeat_ms, callback):
+            return self.RRG_OK
+        return self.ERROR_RRG_ACQUISITION_FAILED
+
+    def SetInterlock(self, fault_mask, max_failed_reads: int = 0, fault_period_us: int = 0, relay=None) -> int:
+        """
+        @brief Turns the relay off from the next acquisitions on a regulator fault (fault_mask None: never).
+        @details See RRG.set_interlock(); relay is a connected Relay (see RelayController.GetRelay()).
+        @return RRG_OK on success, or an error code if the acquisition is running.
+        """
+        if self._rrg is None:
+            return self.ERROR_RRG_NOT_CONNECTED
+
+        if self._rrg.set_interlock(fault_mask, max_failed_reads, fault_period_us, relay):
+            return self.RRG_OK
+        return self.ERROR_RRG_ACQUISITION_FAILED
+
+    def GetInterlockStatus(self):
+        """
+        @brief Returns the state and the fault-to-shutoff latencies of the interlock (see RRG.get_interlock_status()).
+        @return A dictionary, or None if no connection exists.
+        """
+        if self._rrg is None:
+            return None
+        return self._rrg.get_interlock_status()
+
+    def StopAcquisition(self) -> int:
+        """
+        @brief Stops the background flow sampling.
+        @return RRG_OK on success, or ERROR_RRG_NOT_CONNECTED if no connection exists.
+        """
+        if self._rrg is None:
+            return self.ERROR_RRG_NOT_CONNECTED
+
+        self._rrg.stop_acquisition()
+        return self.RRG_OK
+
+    def StartRamp(self, points, tick_us: int, linear: bool = True) -> int:
+        """
+        @brief Streams a setpoint profile of (t_s, setpoint) points from a C thread ticking every tick_us.
+        @return RRG_OK on success, or an error code if the ramp cannot be started.
+        """
+        if self._rrg is None:
+            return self.ERROR_RRG_NOT_CONNECTED
+
+        try:
+            if self._rrg.start_ramp(points, tick_us, linear):
+                return self.RRG_OK
+            return self.ERROR_RRG_RAMP_FAILED
+        except Exception:
+            return self.ERROR_RRG_RAMP_FAILED
+
+    def StopRamp(self) -> int:
+        """
+        @brief Stops the setpoint ramp; the regulator keeps the last setpoint written.
+        @return RRG_OK on success, or ERROR_RRG_NOT_CONNECTED if no connection exists.
+        """
+        if self._rrg is None:
+            return self.ERROR_RRG_NOT_CONNECTED
+
+        self._rrg.stop_ramp()
+        return self.RRG_OK
+
+    def DrainSamples(self):
+        """
+        @brief Retrieves the flow samples acquired since the last call without blocking.
+        @return A tuple (error_code, samples) where samples is a list of (t_ns, flow, status).
+        """
+        if self._rrg is None:
+            return (self.ERROR_RRG_NOT_CONNECTED, [])
+
+        try:
+            return (self.RRG_OK, self._rrg.drain_samples())
+        except Exception:
+            return (self.ERROR_RRG_GET_FLOW_FAILED, [])
+
+    def DrainSampleArray(self):
+        """
+        @brief Retrieves the flow samples acquired since the last call as one NumPy array.
+        @return A tuple (error_code, samples) where samples is a structured array with the fields
+        t_ns, flow and status. It is a view of a reused buffer, valid until the next call.
+        """
+        if self._rrg is None:
+            return (self.ERROR_RRG_NOT_CONNECTED, None)
+
+        try:
+            return (self.RRG_OK, self._rrg.drain_sample_array())
+        except Exception:
+            return (self.ERROR_RRG_GET_FLOW_FAILED, None)
+
+    def DrainChangeArray(self):
+        """
+        @brief Retrieves the flow changes reported since the last call as one NumPy array.
+        @return A tuple (error_code, changes) where changes is a structured array with the fields
+        t_ns, flow, status, rate and reasons. It is a view of a reused buffer, valid until the next call.
+        """
+        if self._rrg is None:
+            return (self.ERROR_RRG_NOT_CONNECTED, None)
+
+        try:
+            return (self.RRG_OK, self._rrg.drain_change_array())
+        except Exception:
+            return (self.ERROR_RRG_GET_FLOW_FAILED, None)
+
+    def AddFlowPollJob(self, poller, period_us: int):
+        """
+        @brief Registers the flow of this regulator with a shared multi-port MBPoller.
+        @details One poller serving the controllers of every adapter polls the ports in parallel,
+        so the cycle time no longer grows with the number of buses.
+        @return A tuple (error_code, job_id).
+        """
+        if self._rrg is None:
+            return (self.ERROR_RRG_NOT_CONNECTED, -1)
+
+        job_id = self._rrg.add_flow_poll_job(poller, period_us)
+        if job_id < 0:
+            return (self.ERROR_RRG_ACQUISITION_FAILED, -1)
+        return (self.RRG_OK, job_id)
+
     def GetLastError(self):
         """@brief Retrieves the last error message from the RRG device."""
         if self._rrg is None:
@@ -6,22 +6,47 @@
 This module loads the RRG shared library and exposes a Python interface to the
 functions defined in the RRG C API. It defines:
   - RRGConfig: A ctypes Structure mapping to the C RRG_Config struct.
+  - RRGShadowRegister: A ctypes Structure mapping to the C RRG_ShadowRegister struct.
+  - RRGStats: A ctypes Structure mapping to the C RRG_Stats struct.
+  - RRGFlowChange / RRGChangeFilter: ctypes Structures mapping to the C change filter of the acquisition.
+  - RRG_FLOW_CHANGE_DTYPE: The NumPy dtype with the same layout as RRG_FlowChange.
+  - RRG_CHANGE_CALLBACK: The ctypes prototype of the C RRG_ChangeCallback.
+  - RRG_INTERLOCK_ACTION / RRGInterlock / RRGInterlockStatus: The ctypes interlock of the acquisition.
+  - RRGHandle: A ctypes Structure mapping to the C RRG_Handle struct.
+  - RRGSnapshot: A ctypes Structure mapping to the C RRG_Snapshot struct.
+  - RRGSample: A ctypes Structure mapping to the C RRG_Sample struct.
+  - RRG_SAMPLE_DTYPE: The NumPy dtype with the same layout as RRG_Sample.
+  - RRGRampPoint / RRGRampProfile: ctypes Structures mapping to the C setpoint ramp profile.
+  - RRGRampTick: A ctypes Structure mapping to the C RRG_RampTick struct.
+  - RRG_RAMP_TICK_DTYPE: The NumPy dtype with the same layout as RRG_RampTick.
+  - RRGRampStatus: A ctypes Structure mapping to the C RRG_RampStatus struct.
+  - RRG_CALLBACK: The ctypes prototype of the C RRG_Callback completion callback.
   - IRRG: An abstract interface for RRG operations.
   - RRG: A concrete implementation of IRRG that wraps the C API.
+  - set_flow_group: Sets the setpoints of several regulators of one bus in one transaction.
+  - get_flow_many: Reads the flow of many regulators, on any number of buses, in one call.
+  - add_simulated_regulator: Puts a simulated regulator on an MBSim line.
 """
 
 import os
 import sys
 import ctypes
 import logging
-from ctypes import CDLL, POINTER, c_char_p, c_int, c_float, c_void_p
+import threading
+from ctypes import (CDLL, CFUNCTYPE, POINTER, c_char_p, c_double, c_int, c_int32, c_int64, c_float, c_uint16,
+                    c_uint64, c_void_p)
+
+import numpy as np
+
+from src.mb.mb_bus import MB_TRANSPORT_RTU, MBBusListener
+from src.mb.mb_stats import MBLatencyHistogram, MBTrafficCounters, latency_percentile_us, stats_to_dict
 
 logging.basicConfig(level=logging.DEBUG, format="%(asctime)s [%(levelname)s] %(name)s: %(message)s")
 logger = logging.getLogger(__name__)
 
 # Determine the library filename based on the platform.
 if os.name == "nt":
-    lib_filename = "rrg.dll"
+    lib_filename = "librrg.dll"
 else:
     lib_filename = "librrg.so"
 
@@ -41,6 +66,69 @@ except OSError as e:
     logger.error("Failed to load shared library: %s", e)
     sys.exit(f"Failed to load shared library: {e}")
 
+# RRG_ReadSnapshot() flag: also read back the setpoint registers (see rrg_constants.h).
+RRG_SNAPSHOT_WITH_SETPOINT = 0x01
+
+# RRG_SetFlowGroup() flags (see rrg_constants.h).
+RRG_GROUP_BROADCAST = 0x01
+RRG_GROUP_VERIFY = 0x02
+
+# RRG_GetFlowMany() flag: read the buses one after the other (see rrg_constants.h).
+RRG_MANY_SERIAL = 0x01
+
+# Status register of the regulator and its bits (see rrg_constants.h).
+MODBUS_REGISTER_STATUS = 2101
+RRG_STATUS_MASS_FLOW_OVERRANGE = 0x01
+RRG_STATUS_TEMPERATURE_OVERRANGE = 0x02
+RRG_STATUS_TOTALIZER_OVERRANGE = 0x04
+RRG_STATUS_VALVE_FROZEN = 0x08
+RRG_STATUS_VALVE_THERMAL_MANAGEMENT = 0x10
+
+# Measured flow registers, high word first (MODBUS_REGISTER_FLOW in rrg_constants.h).
+MODBUS_REGISTER_FLOW = 2103
+MODBUS_FLOW_REGISTERS_COUNT = 2
+
+# Samples held by the acquisition ring (RRG_DEFAULT_ACQUISITION_CAPACITY in rrg_constants.h).
+RRG_DEFAULT_ACQUISITION_CAPACITY = 8192
+
+# Change filter of the acquisition (see rrg_constants.h).
+RRG_DEFAULT_CHANGE_CAPACITY = 1024
+RRG_CHANGE_FIRST = 0x01
+RRG_CHANGE_STATUS = 0x02
+RRG_CHANGE_DEADBAND = 0x04
+RRG_CHANGE_RATE = 0x08
+RRG_CHANGE_HEARTBEAT = 0x10
+
+# Reasons of an interlock trip (see rrg_constants.h).
+RRG_INTERLOCK_STATUS = 0x01
+RRG_INTERLOCK_COMMUNICATION = 0x02
+
+# Setpoint ramps (see rrg_constants.h).
+RRG_DEFAULT_RAMP_CAPACITY = 8192
+RRG_RAMP_LINEAR = 0
+RRG_RAMP_STEP = 1
+RRG_RAMP_TICK_WRITTEN = 0x01
+RRG_RAMP_TICK_READ = 0x02
+
+
+def registers_to_flow(registers) -> float:
+    """
+    @brief Converts the flow register pair read by an MBPoller job into SCCM.
+    @param registers The two registers of MODBUS_REGISTER_FLOW, high word first (a signed 32-bit count).
+    """
+    raw = (registers[0] << 16) | registers[1]
+    return (raw - (1 << 32) if raw & 0x80000000 else raw) / 1000.0
+
+
+def records_to_flow(records: np.ndarray) -> np.ndarray:
+    """
+    @brief Converts the flow registers of binary log records (see RRG.set_flow_log()) into SCCM.
+    @param records Array of MB_LOG_RECORD_DTYPE records; failed reads come out as 0.
+    """
+    registers = records["registers"].astype(np.uint32)
+    raw = ((registers[:, 0] << 16) | registers[:, 1]).view(np.int32)
+    return np.where(records["status"] == 0, raw / 1000.0, 0.0)
+
 
 class RRGConfig(ctypes.Structure):
     """
@@ -52,6 +140,115 @@ class RRGConfig(ctypes.Structure):
         ("baudrate", c_int),   # Baud rate for serial communication (e.g., 9600, 19200)
         ("slave_id", c_int),   # MODBUS slave ID of the gas regulator
         ("timeout", c_int),    # Timeout for response in milliseconds
+        ("setpoint_write_mode", c_int),  # RRG_SETPOINT_WRITE_MODE_* (0 = auto)
+        ("adaptive_timeout", c_int),  # Non-zero to adapt the timeout to the measured latency
+        ("write_cache", c_int),  # Non-zero to skip writes of values the device already holds
+        ("write_cache_refresh_ms", c_int),  # Age after which a cached value is written again (0 = never)
+        ("fast_transport", c_int),  # Non-zero to bypass libmodbus where possible
+        ("transport", c_int),  # One of MB_TRANSPORT_* (0 = local serial port)
+        ("probe_timeout", c_int),  # Timeout of the liveness probe of RRG_Init in milliseconds (0 = no probe)
+        ("arena", c_void_p),  # MB_Arena the bus and engines come from (NULL = the heap)
+    ]
+
+
+class RRGShadowRegister(ctypes.Structure):
+    """
+    @brief Last value of a register (or register pair) confirmed by the regulator.
+    Maps to the C structure `RRG_ShadowRegister` defined in the header.
+    """
+    _fields_ = [
+        ("valid", c_int),          # Non-zero when regs holds a confirmed value
+        ("regs", c_uint16 * 2),    # Register contents (regs[0] only for single registers)
+        ("t_ns", c_int64),         # Monotonic time the value was last written or read back
+    ]
+
+
+# Operations with their own latency histogram, in the order of RRG_STATS_OP_* (see rrg_constants.h).
+RRG_STATS_OPS = ("set_flow", "get_flow", "set_gas", "read_snapshot")
+
+
+class RRGStats(ctypes.Structure):
+    """
+    @brief Performance counters of one handle filled by `RRG_GetStats`.
+    Maps to the C structure `RRG_Stats` defined in the header.
+    """
+    _fields_ = [
+        ("traffic", MBTrafficCounters),  # Requests, errors and bytes
+        ("latency", MBLatencyHistogram * len(RRG_STATS_OPS)),  # Transaction durations per RRG_STATS_OP_*
+    ]
+
+
+class RRGFlowChange(ctypes.Structure):
+    """
+    @brief Acquired sample reported by the change filter of the C acquisition thread.
+    Maps to the C structure `RRG_FlowChange` defined in the header.
+    """
+    _fields_ = [
+        ("t_ns", c_int64),     # Monotonic timestamp in nanoseconds
+        ("flow", c_float),     # Measured flow in SCCM
+        ("status", c_int32),   # RRG_OK (0) or the error code of the failed read
+        ("rate", c_float),     # Flow slope since the previous successful sample in SCCM/s
+        ("reasons", c_int32),  # RRG_CHANGE_* flags
+    ]
+
+
+# Record layout of RRGFlowChange, so drained changes can be read as a NumPy array without copying.
+RRG_FLOW_CHANGE_DTYPE = np.dtype([("t_ns", np.int64), ("flow", np.float32), ("status", np.int32),
+                                  ("rate", np.float32), ("reasons", np.int32)])
+assert RRG_FLOW_CHANGE_DTYPE.itemsize == ctypes.sizeof(RRGFlowChange)
+
+# void (*RRG_ChangeCallback)(const RRG_FlowChange *change, void *user_data)
+RRG_CHANGE_CALLBACK = CFUNCTYPE(None, POINTER(RRGFlowChange), c_void_p)
+
+
+class RRGChangeFilter(ctypes.Structure):
+    """
+    @brief Conditions under which an acquired sample is reported as a change.
+    Maps to the C structure `RRG_ChangeFilter` defined in the header.
+    """
+    _fields_ = [
+        ("deadband", c_float),               # Smallest reported flow change in SCCM
+        ("rate_threshold", c_float),         # Reported flow slope in SCCM/s (0 = off)
+        ("heartbeat_us", c_int),             # Longest time without a report (0 = off)
+        ("callback", RRG_CHANGE_CALLBACK),   # Called on the acquisition thread (NULL = drain only)
+        ("user_data", c_void_p),             # Passed to callback
+    ]
+
+
+# int (*RRG_InterlockAction)(void *target)
+RRG_INTERLOCK_ACTION = CFUNCTYPE(c_int, c_void_p)
+
+
+class RRGInterlock(ctypes.Structure):
+    """
+    @brief Faults the acquisition thread watches for, and what it does when one occurs.
+    Maps to the C structure `RRG_Interlock` defined in the header.
+    """
+    _fields_ = [
+        ("fault_mask", c_int),                # RRG_STATUS_* bits of register 2101 that trip the interlock
+        ("max_failed_reads", c_int),          # Consecutive failed reads that trip the interlock (0 = off)
+        ("fault_period_us", c_int),           # Sampling period while a fault is suspected (0 = normal period)
+        ("action", RRG_INTERLOCK_ACTION),     # Called on the acquisition thread when it trips (NULL = none)
+        ("target", c_void_p),                 # Passed to action
+    ]
+
+
+class RRGInterlockStatus(ctypes.Structure):
+    """
+    @brief State of the interlock and fault-to-shutoff latency filled by `RRG_GetInterlockStatus`.
+    Maps to the C structure `RRG_InterlockStatus` defined in the header.
+    """
+    _fields_ = [
+        ("faulted", c_int),                   # Non-zero from a trip until the interlock is re-armed
+        ("instrument_status", c_int),         # Status bits of the last successful read
+        ("failed_reads", c_int),              # Reads failed in a row so far
+        ("reasons", c_int),                   # RRG_INTERLOCK_* flags of the last trip
+        ("action_status", c_int),             # Value returned by the action of the last trip
+        ("trips", c_uint64),                  # Times the interlock tripped
+        ("last_trip_ns", c_int64),            # Start of the read that detected the last fault
+        ("last_latency_ns", c_int64),         # Latency of the last trip
+        ("max_latency_ns", c_int64),          # Worst latency of all trips
+        ("latency", MBLatencyHistogram),      # Latencies of all trips
     ]
 
 
@@ -61,10 +258,137 @@ class RRGHandle(ctypes.Structure):
     Maps to the C structure `RRG_Handle` defined in the header.
     """
     _fields_ = [
-        ("modbus_ctx", c_void_p)  # Pointer to the libmodbus context.
+        ("modbus_ctx", c_void_p),  # Pointer to the libmodbus context (shared, owned by the bus).
+        ("bus", c_void_p),         # MB_Bus the handle is attached to.
+        ("slave_id", c_int),       # MODBUS slave ID of the regulator on the bus.
+        ("setpoint_write_mode", c_int),  # Setpoint write mode currently in use.
+        ("acquisition", c_void_p),  # Background acquisition engine (NULL until started).
+        ("ramp", c_void_p),  # Setpoint ramp engine (NULL until started).
+        ("rtu_frames", c_void_p),  # Request templates of the fast RTU transport (NULL until enabled).
+        ("arena", c_void_p),  # Arena the engines and templates come from (NULL = the heap).
+        ("last_error", c_int),  # Error code of the last operation made through the handle.
+        ("last_modbus_errno", c_int),  # libmodbus errno of the last failed request (0 if none).
+        ("write_cache", c_int),  # Non-zero when writes matching the shadow registers are skipped.
+        ("fast_transport", c_int),  # Non-zero when the hot operations bypass libmodbus.
+        ("cache_refresh_ns", c_int64),  # Age after which a cached value is written again (0 = never).
+        ("telemetry_deadline_ns", c_int64),  # Time after which a queued flow read is dropped (0 = never).
+        ("flow_log", c_void_p),  # MB_Log the acquisition thread records to (NULL = none).
+        ("flow_log_channel", c_int),  # Channel of the records of the handle in flow_log.
+        ("change_filter_enabled", c_int),  # Non-zero when the acquisition thread reports changes.
+        ("change_filter", RRGChangeFilter),  # Change filter the next acquisition thread applies.
+        ("interlock_enabled", c_int),  # Non-zero when the acquisition thread watches for faults.
+        ("interlock", RRGInterlock),  # Interlock the next acquisition thread applies.
+        ("shadow_setpoint", RRGShadowRegister),  # Setpoint registers 2053-2054.
+        ("shadow_gas", RRGShadowRegister),  # Gas type register 2100.
+        ("command_setpoint", c_int64),  # Last commanded setpoint registers, (1 << 32) | regs (0 = none).
+        ("command_gas", c_int64),  # Last commanded gas register, (1 << 32) | reg (0 = none).
+        ("reconnect_listener", MBBusListener),  # Writes the commanded values back after a reconnect.
+        ("stats", RRGStats),  # Performance counters (read them with RRG_GetStats).
+    ]
+
+
+class RRGSnapshot(ctypes.Structure):
+    """
+    @brief Telemetry picture of the regulator filled by `RRG_ReadSnapshot`.
+    Maps to the C structure `RRG_Snapshot` defined in the header.
+    """
+    _fields_ = [
+        ("gas_id", c_int),       # Active gas type (register 2100)
+        ("flow", c_float),       # Measured flow in SCCM (registers 2103-2104)
+        ("setpoint", c_float),   # Setpoint in SCCM, valid only with RRG_SNAPSHOT_WITH_SETPOINT
+        ("instrument_status", c_int),  # RRG_STATUS_* bits of register 2101
+        ("flags", c_int),        # RRG_SNAPSHOT_* flags describing which optional fields were read
+    ]
+
+
+class RRGSample(ctypes.Structure):
+    """
+    @brief Timestamped flow measurement produced by the C acquisition thread.
+    Maps to the C structure `RRG_Sample` defined in the header.
+    """
+    _fields_ = [
+        ("t_ns", c_int64),     # Monotonic timestamp in nanoseconds
+        ("flow", c_float),     # Measured flow in SCCM
+        ("status", c_int32),   # RRG_OK (0) or the error code of the failed read
+    ]
+
+
+# Record layout of RRGSample, so a drained buffer can be read as a NumPy array without copying.
+RRG_SAMPLE_DTYPE = np.dtype([("t_ns", np.int64), ("flow", np.float32), ("status", np.int32)])
+assert RRG_SAMPLE_DTYPE.itemsize == ctypes.sizeof(RRGSample)
+
+
+class RRGRampPoint(ctypes.Structure):
+    """
+    @brief Point of a setpoint profile.
+    Maps to the C structure `RRG_RampPoint` defined in the header.
+    """
+    _fields_ = [
+        ("t_us", c_int64),      # Time from the start of the ramp in microseconds
+        ("setpoint", c_float),  # Setpoint in SCCM at t_us
+    ]
+
+
+class RRGRampProfile(ctypes.Structure):
+    """
+    @brief Setpoint profile streamed by `RRG_StartRamp`.
+    Maps to the C structure `RRG_RampProfile` defined in the header.
+    """
+    _fields_ = [
+        ("points", POINTER(RRGRampPoint)),  # Points with strictly increasing t_us
+        ("point_count", c_int),             # Number of points
+        ("interpolation", c_int),           # RRG_RAMP_LINEAR or RRG_RAMP_STEP
+        ("read_every", c_int),              # Ticks between two flow reads (0: never)
+    ]
+
+
+class RRGRampTick(ctypes.Structure):
+    """
+    @brief Record of one control tick of a ramp.
+    Maps to the C structure `RRG_RampTick` defined in the header.
+    """
+    _fields_ = [
+        ("t_ns", c_int64),      # Scheduled monotonic time of the tick
+        ("late_ns", c_int64),   # Wake-up lateness of the thread
+        ("setpoint", c_float),  # Setpoint of the profile at the tick
+        ("flow", c_float),      # Measured flow, valid with RRG_RAMP_TICK_READ
+        ("error", c_float),     # flow - setpoint, valid with RRG_RAMP_TICK_READ
+        ("status", c_int32),    # RRG_OK (0) or the error code of the transaction
+        ("flags", c_int32),     # RRG_RAMP_TICK_* flags
+        ("reserved", c_int32),  # Padding
+    ]
+
+
+# Record layout of RRGRampTick, so drained ticks can be read as a NumPy array without copying.
+RRG_RAMP_TICK_DTYPE = np.dtype([("t_ns", np.int64), ("late_ns", np.int64), ("setpoint", np.float32),
+                                ("flow", np.float32), ("error", np.float32), ("status", np.int32),
+                                ("flags", np.int32), ("reserved", np.int32)])
+assert RRG_RAMP_TICK_DTYPE.itemsize == ctypes.sizeof(RRGRampTick)
+
+
+class RRGRampStatus(ctypes.Structure):
+    """
+    @brief Progress and tracking statistics of a ramp filled by `RRG_GetRampStatus`.
+    Maps to the C structure `RRG_RampStatus` defined in the header.
+    """
+    _fields_ = [
+        ("running", c_int),            # Non-zero while the ramp thread streams
+        ("last_status", c_int),        # Status of the last tick
+        ("ticks", c_uint64),           # Ticks run
+        ("missed_ticks", c_uint64),    # Ticks skipped after an overrun or dropped at their deadline
+        ("writes", c_uint64),          # Setpoints written
+        ("reads", c_uint64),           # Flow reads
+        ("max_late_ns", c_int64),      # Largest wake-up lateness
+        ("mean_late_ns", c_double),    # Mean wake-up lateness
+        ("max_abs_error", c_float),    # Largest absolute tracking error in SCCM
+        ("mean_abs_error", c_float),   # Mean absolute tracking error in SCCM
     ]
 
 
+# void (*RRG_Callback)(RRG_Handle *handle, uint64_t request_id, int error_code, float value, void *user_data)
+RRG_CALLBACK = CFUNCTYPE(None, POINTER(RRGHandle), c_uint64, c_int, c_float, c_void_p)
+
+
 class IRRG:
     """
     @brief Interface defining methods for interacting with the RRG device.
@@ -91,6 +415,14 @@ class IRRG:
         """
         raise NotImplementedError
 
+    def read_snapshot(self, with_setpoint: bool = False):
+        """
+        @brief Reads gas type, flow and optionally the setpoint in one or two transactions.
+        @param with_setpoint Whether to read back the setpoint registers as well.
+        @return An RRGSnapshot on success, otherwise None.
+        """
+        raise NotImplementedError
+
     def set_gas(self, gas_id: int) -> bool:
         """
         @brief Sets the gas type in the RRG.
@@ -112,24 +444,57 @@ class IRRG:
         """
         raise NotImplementedError
 
+    def get_handle_error(self):
+        """
+        @brief Retrieves the last error of this device handle, independent of the calling thread.
+        @return A tuple (error_code, modbus_errno, description).
+        """
+        raise NotImplementedError
+
 
 class RRG(IRRG):
     """
     @brief Python wrapper for the RRG C API.
     Provides a high-level interface to communicate with the gas flow regulator.
     """
-    def __init__(self, port: str, baudrate: int, slave_id: int, timeout: int) -> None:
+    def __init__(self, port: str, baudrate: int, slave_id: int, timeout: int,
+                 adaptive_timeout: bool = False, write_cache: bool = False,
+                 write_cache_refresh_ms: int = 0, fast_transport: bool = False,
+                 transport: int = MB_TRANSPORT_RTU, probe_timeout: int = 0) -> None:
         """
         @brief Initializes an RRG instance with the given connection parameters.
-        @param port Serial port name (e.g., "COM3" or "/dev/ttyUSB0").
+        @param port Serial port name (e.g., "COM3" or "/dev/ttyUSB0"), or "host:port" of a gateway.
         @param baudrate Baud rate for communication.
         @param slave_id MODBUS slave ID.
         @param timeout Response timeout in milliseconds.
+        @param adaptive_timeout Whether the C library adapts the timeout to the measured latency.
+        @param write_cache Whether writes of the setpoint or gas the device already holds are skipped.
+        @param write_cache_refresh_ms Age after which a cached value is written again anyway (0 = never).
+        @param fast_transport Whether the hot operations bypass libmodbus (falls back to it where unavailable).
+        @param transport One of MB_TRANSPORT_* (see src.mb.mb_bus): local serial port, MODBUS TCP or RTU over TCP.
+        @param probe_timeout If positive, connect() fails unless the regulator answers one read within
+        this many milliseconds, so an absent device is detected without waiting for the full timeout.
         """
         logger.debug("Initializing RRG with port=%s, baudrate=%d, slave_id=%d, timeout=%d",
                      port, baudrate, slave_id, timeout)
-        self._config = RRGConfig(port.encode("utf-8"), baudrate, slave_id, timeout)
+        self._config = RRGConfig(port.encode("utf-8"), baudrate, slave_id, timeout, 0, int(adaptive_timeout),
+                                 int(write_cache), write_cache_refresh_ms, int(fast_transport),
+                                 transport, probe_timeout)
         self._handle = RRGHandle()
+        # Completion callbacks of pending asynchronous requests, keyed by request ID.
+        self._pending = {}
+        self._pending_lock = threading.Lock()
+        self._c_callback = RRG_CALLBACK(self._on_request_done)
+        # Drain buffer reused by every drain_sample_array() call, and its NumPy view.
+        self._sample_buffer = None
+        self._sample_array = None
+        # Python change callback and the ctypes trampoline kept alive while C may call it.
+        self._change_callback = None
+        self._c_change_callback = RRG_CHANGE_CALLBACK(self._on_change)
+        self._change_buffer = None
+        self._change_array = None
+        # Relay the interlock turns off, kept open with the handle its action receives.
+        self._interlock_relay = None
         self._setup_functions()
 
     def _setup_functions(self) -> None:
@@ -146,14 +511,95 @@ class RRG(IRRG):
         rrg_lib.RRG_GetFlow.argtypes = [POINTER(RRGHandle), POINTER(c_float)]
         rrg_lib.RRG_GetFlow.restype = c_int
 
+        rrg_lib.RRG_ReadSnapshot.argtypes = [POINTER(RRGHandle), POINTER(RRGSnapshot), c_int]
+        rrg_lib.RRG_ReadSnapshot.restype = c_int
+
         rrg_lib.RRG_SetGas.argtypes = [POINTER(RRGHandle), c_int]
         rrg_lib.RRG_SetGas.restype = c_int
 
+        rrg_lib.RRG_SetWriteCache.argtypes = [POINTER(RRGHandle), c_int, c_int]
+        rrg_lib.RRG_SetWriteCache.restype = c_int
+
+        rrg_lib.RRG_InvalidateWriteCache.argtypes = [POINTER(RRGHandle)]
+        rrg_lib.RRG_InvalidateWriteCache.restype = None
+
+        rrg_lib.RRG_SetTelemetryDeadline.argtypes = [POINTER(RRGHandle), c_int]
+        rrg_lib.RRG_SetTelemetryDeadline.restype = c_int
+
+        rrg_lib.RRG_SetFlowAsync.argtypes = [POINTER(RRGHandle), c_float, RRG_CALLBACK, c_void_p, POINTER(c_uint64)]
+        rrg_lib.RRG_SetFlowAsync.restype = c_int
+
+        rrg_lib.RRG_GetFlowAsync.argtypes = [POINTER(RRGHandle), RRG_CALLBACK, c_void_p, POINTER(c_uint64)]
+        rrg_lib.RRG_GetFlowAsync.restype = c_int
+
+        rrg_lib.RRG_SetGasAsync.argtypes = [POINTER(RRGHandle), c_int, RRG_CALLBACK, c_void_p, POINTER(c_uint64)]
+        rrg_lib.RRG_SetGasAsync.restype = c_int
+
+        rrg_lib.RRG_Wait.argtypes = [POINTER(RRGHandle), c_uint64]
+        rrg_lib.RRG_Wait.restype = c_int
+
+        rrg_lib.RRG_SetFlowLog.argtypes = [POINTER(RRGHandle), c_void_p, c_int]
+        rrg_lib.RRG_SetFlowLog.restype = c_int
+
+        rrg_lib.RRG_StartAcquisition.argtypes = [POINTER(RRGHandle), c_int]
+        rrg_lib.RRG_StartAcquisition.restype = c_int
+
+        rrg_lib.RRG_StopAcquisition.argtypes = [POINTER(RRGHandle)]
+        rrg_lib.RRG_StopAcquisition.restype = None
+
+        rrg_lib.RRG_DrainSamples.argtypes = [POINTER(RRGHandle), POINTER(RRGSample), c_int]
+        rrg_lib.RRG_DrainSamples.restype = c_int
+
+        rrg_lib.RRG_GetDroppedSamples.argtypes = [POINTER(RRGHandle)]
+        rrg_lib.RRG_GetDroppedSamples.restype = c_uint64
+
+        rrg_lib.RRG_SetChangeFilter.argtypes = [POINTER(RRGHandle), POINTER(RRGChangeFilter)]
+        rrg_lib.RRG_SetChangeFilter.restype = c_int
+
+        rrg_lib.RRG_SetInterlock.argtypes = [POINTER(RRGHandle), POINTER(RRGInterlock)]
+        rrg_lib.RRG_SetInterlock.restype = c_int
+
+        rrg_lib.RRG_GetInterlockStatus.argtypes = [POINTER(RRGHandle), POINTER(RRGInterlockStatus)]
+        rrg_lib.RRG_GetInterlockStatus.restype = c_int
+
+        rrg_lib.RRG_DrainChanges.argtypes = [POINTER(RRGHandle), POINTER(RRGFlowChange), c_int]
+        rrg_lib.RRG_DrainChanges.restype = c_int
+
+        rrg_lib.RRG_GetDroppedChanges.argtypes = [POINTER(RRGHandle)]
+        rrg_lib.RRG_GetDroppedChanges.restype = c_uint64
+
+        rrg_lib.RRG_SetFastTransport.argtypes = [POINTER(RRGHandle), c_int]
+        rrg_lib.RRG_SetFastTransport.restype = c_int
+
+        rrg_lib.RRG_StartRamp.argtypes = [POINTER(RRGHandle), POINTER(RRGRampProfile), c_int]
+        rrg_lib.RRG_StartRamp.restype = c_int
+
+        rrg_lib.RRG_StopRamp.argtypes = [POINTER(RRGHandle)]
+        rrg_lib.RRG_StopRamp.restype = None
+
+        rrg_lib.RRG_GetRampStatus.argtypes = [POINTER(RRGHandle), POINTER(RRGRampStatus)]
+        rrg_lib.RRG_GetRampStatus.restype = c_int
+
+        rrg_lib.RRG_DrainRampTicks.argtypes = [POINTER(RRGHandle), POINTER(RRGRampTick), c_int]
+        rrg_lib.RRG_DrainRampTicks.restype = c_int
+
         rrg_lib.RRG_Close.argtypes = [POINTER(RRGHandle)]
         rrg_lib.RRG_Close.restype = None
 
+        rrg_lib.RRG_GetStats.argtypes = [POINTER(RRGHandle), POINTER(RRGStats)]
+        rrg_lib.RRG_GetStats.restype = c_int
+
+        rrg_lib.RRG_ResetStats.argtypes = [POINTER(RRGHandle)]
+        rrg_lib.RRG_ResetStats.restype = None
+
         rrg_lib.RRG_GetLastError.restype = c_char_p
 
+        rrg_lib.RRG_GetLastErrorEx.argtypes = [POINTER(RRGHandle)]
+        rrg_lib.RRG_GetLastErrorEx.restype = c_char_p
+
+        rrg_lib.RRG_GetLastErrorCodeEx.argtypes = [POINTER(RRGHandle), POINTER(c_int)]
+        rrg_lib.RRG_GetLastErrorCodeEx.restype = c_int
+
     def connect(self) -> bool:
         """
         @brief Establishes a connection with the RRG device.
@@ -200,6 +646,20 @@ class RRG(IRRG):
         logger.info("Retrieved flow: %.3f SCCM.", flow.value)
         return flow.value
 
+    def read_snapshot(self, with_setpoint: bool = False):
+        """
+        @brief Reads gas type, flow and optionally the setpoint from the RRG device.
+        @param with_setpoint Whether to read back the setpoint registers as well (one extra transaction).
+        @return An RRGSnapshot on success, or None if an error occurs.
+        """
+        snapshot = RRGSnapshot()
+        flags = RRG_SNAPSHOT_WITH_SETPOINT if with_setpoint else 0
+        result = rrg_lib.RRG_ReadSnapshot(ctypes.byref(self._handle), ctypes.byref(snapshot), c_int(flags))
+        if result != 0:
+            logger.error("Failed to read snapshot (return code %d). Error: %s", result, self.get_last_error())
+            return None
+        return snapshot
+
     def set_gas(self, gas_id: int) -> bool:
         """
         @brief Sets the gas type in the RRG device.
@@ -214,14 +674,364 @@ class RRG(IRRG):
             logger.info("Gas set successfully to ID %d.", gas_id)
         return result == 0
 
+    def set_write_cache(self, enabled: bool, refresh_ms: int = 0) -> bool:
+        """
+        @brief Enables or disables skipping writes of the setpoint or gas the device already holds.
+        @param enabled Whether the write cache is used (it starts empty).
+        @param refresh_ms Age after which a cached value is written again anyway (0 = never).
+        @return True on success, False otherwise.
+        """
+        result = rrg_lib.RRG_SetWriteCache(ctypes.byref(self._handle), c_int(int(enabled)), c_int(refresh_ms))
+        if result != 0:
+            logger.error("Failed to configure the write cache. Error: %s", self.get_last_error())
+        return result == 0
+
+    def invalidate_write_cache(self) -> None:
+        """
+        @brief Forgets the cached values, so the next writes reach the device.
+        """
+        rrg_lib.RRG_InvalidateWriteCache(ctypes.byref(self._handle))
+
+    def set_fast_transport(self, enabled: bool) -> bool:
+        """
+        @brief Switches the setpoint, gas and flow requests to the fast RTU transport, or back to libmodbus.
+        @return True on success, False if the port cannot be driven directly (libmodbus stays in use).
+        """
+        return rrg_lib.RRG_SetFastTransport(ctypes.byref(self._handle), c_int(int(enabled))) == 0
+
+    def set_telemetry_deadline(self, deadline_us: int) -> bool:
+        """
+        @brief Sets how long a queued flow read may wait for the bus before it is dropped.
+        @param deadline_us Deadline relative to the submission in microseconds (0 = never drop).
+        @return True on success, False otherwise.
+        """
+        result = rrg_lib.RRG_SetTelemetryDeadline(ctypes.byref(self._handle), c_int(deadline_us))
+        if result != 0:
+            logger.error("Failed to set the telemetry deadline. Error: %s", self.get_last_error())
+        return result == 0
+
+    def _submit(self, name: str, submit, callback, *args) -> int:
+        """
+        @brief Queues an asynchronous request and registers its Python completion callback.
+        @param name Operation name used in log messages.
+        @param submit C function queuing the request.
+        @param callback Callable (request_id, error_code, value) or None.
+        @return The request ID, or 0 if the request could not be queued.
+        """
+        request_id = c_uint64(0)
+        # The lock is held until the callback is registered, so a fast completion waits for it.
+        with self._pending_lock:
+            result = submit(ctypes.byref(self._handle), *args, self._c_callback, None, ctypes.byref(request_id))
+            if result != 0:
+                logger.error("Failed to queue %s. Error: %s", name, self.get_last_error())
+                return 0
+            if callback is not None:
+                self._pending[request_id.value] = callback
+        return request_id.value
+
+    def _on_request_done(self, _handle, request_id, error_code, value, _user_data) -> None:
+        """
+        @brief Trampoline called by the bus I/O worker thread when a request completes.
+        """
+        with self._pending_lock:
+            callback = self._pending.pop(request_id, None)
+        if callback is None:
+            return
+        try:
+            callback(request_id, error_code, value)
+        except Exception:
+            logger.exception("Completion callback of request %d failed.", request_id)
+
+    def set_flow_async(self, setpoint: float, callback=None) -> int:
+        """
+        @brief Queues a setpoint write to the bus I/O worker and returns immediately.
+        @param setpoint Desired flow rate in SCCM.
+        @param callback Optional callable (request_id, error_code, value) run on the worker thread.
+        @return The request ID, or 0 if the request could not be queued.
+        """
+        return self._submit("setpoint write", rrg_lib.RRG_SetFlowAsync, callback, c_float(setpoint))
+
+    def get_flow_async(self, callback=None) -> int:
+        """
+        @brief Queues a flow read to the bus I/O worker; the flow is passed to the callback as value.
+        @param callback Optional callable (request_id, error_code, value) run on the worker thread.
+        @return The request ID, or 0 if the request could not be queued.
+        """
+        return self._submit("flow read", rrg_lib.RRG_GetFlowAsync, callback)
+
+    def set_gas_async(self, gas_id: int, callback=None) -> int:
+        """
+        @brief Queues a gas type change to the bus I/O worker and returns immediately.
+        @param gas_id Gas type identifier.
+        @param callback Optional callable (request_id, error_code, value) run on the worker thread.
+        @return The request ID, or 0 if the request could not be queued.
+        """
+        return self._submit("gas change", rrg_lib.RRG_SetGasAsync, callback, c_int(gas_id))
+
+    def wait(self, request_id: int) -> bool:
+        """
+        @brief Blocks until the request (and every request queued on the bus before it) has completed.
+        @param request_id ID returned by one of the *_async methods.
+        @return True on success, False otherwise.
+        """
+        return rrg_lib.RRG_Wait(ctypes.byref(self._handle), c_uint64(request_id)) == 0
+
+    def start_acquisition(self, period_us: int) -> bool:
+        """
+        @brief Starts the C-side background thread that samples the flow every period_us microseconds.
+        @param period_us Sampling period in microseconds.
+        @return True if the acquisition is started, False otherwise.
+        """
+        logger.info("Starting flow acquisition with period %d us.", period_us)
+        result = rrg_lib.RRG_StartAcquisition(ctypes.byref(self._handle), c_int(period_us))
+        if result != 0:
+            logger.error("Failed to start acquisition. Error: %s", self.get_last_error())
+        return result == 0
+
+    def set_flow_log(self, log, channel: int = 0) -> bool:
+        """
+        @brief Records the samples of the next acquisitions to a binary log; the acquisition must be stopped.
+        @param log An open MBLog, or None to stop recording.
+        @param channel Channel of the records of this regulator (0-255); read them back with MBLogReader.
+        @return True on success, False otherwise.
+        """
+        handle = log.handle if log is not None else None
+        result = rrg_lib.RRG_SetFlowLog(ctypes.byref(self._handle), handle, c_int(channel))
+        if result != 0:
+            logger.error("Failed to set the flow log. Error: %s", self.get_last_error())
+        return result == 0
+
+    def stop_acquisition(self) -> None:
+        """
+        @brief Stops the background acquisition thread; pending samples stay available.
+        """
+        rrg_lib.RRG_StopAcquisition(ctypes.byref(self._handle))
+
+    def drain_sample_array(self, max_samples: int = RRG_DEFAULT_ACQUISITION_CAPACITY) -> np.ndarray:
+        """
+        @brief Retrieves the samples acquired since the last call in one C call, without per-sample objects.
+        @details The C library copies the samples straight into a buffer owned by this object, and
+        the result is a NumPy view of that memory. The buffer is reused, so the view is only valid
+        until the next call: copy it (or the derived arrays) to keep the samples.
+        @param max_samples Maximum number of samples to retrieve; the default drains the whole ring.
+        @return A structured array of RRG_SAMPLE_DTYPE records (t_ns, flow, status), oldest first.
+        """
+        if self._sample_buffer is None or len(self._sample_buffer) < max_samples:
+            self._sample_buffer = (RRGSample * max_samples)()
+            self._sample_array = np.frombuffer(self._sample_buffer, dtype=RRG_SAMPLE_DTYPE)
+        count = rrg_lib.RRG_DrainSamples(ctypes.byref(self._handle), self._sample_buffer, c_int(max_samples))
+        if count < 0:
+            logger.error("Failed to drain samples. Error: %s", self.get_last_error())
+            count = 0
+        return self._sample_array[:count]
+
+    def drain_samples(self, max_samples: int = RRG_DEFAULT_ACQUISITION_CAPACITY) -> list:
+        """
+        @brief Retrieves the samples acquired since the last call without blocking.
+        @param max_samples Maximum number of samples to retrieve in one call.
+        @return A list of (t_ns, flow, status) tuples, oldest first.
+        """
+        return self.drain_sample_array(max_samples).tolist()
+
+    def get_dropped_samples(self) -> int:
+        """
+        @brief Returns how many samples were dropped because the C ring buffer was full.
+        """
+        return rrg_lib.RRG_GetDroppedSamples(ctypes.byref(self._handle))
+
+    def set_change_filter(self, deadband, rate_threshold: float = 0.0, heartbeat_ms: int = 0,
+                          callback=None) -> bool:
+        """
+        @brief Reports only the meaningful changes of the next acquisitions; the acquisition must be stopped.
+        @details The C acquisition thread compares every sample with the last one it reported and
+        reports it again past the deadband, above the rate threshold, on a change of status, or
+        after heartbeat_ms without a report. The raw samples stay available to drain_sample_array().
+        @param deadband Smallest reported flow change in SCCM, or None to report no changes.
+        @param rate_threshold Flow slope in SCCM/s above which a sample is reported (0 = off).
+        @param heartbeat_ms Longest time without a report (0 = off).
+        @param callback Optional callable (t_ns, flow, status, rate, reasons) run on the acquisition
+        thread for each change; otherwise drain them with drain_change_array().
+        @return True on success, False otherwise.
+        """
+        if deadband is None:
+            result = rrg_lib.RRG_SetChangeFilter(ctypes.byref(self._handle), None)
+        else:
+            c_callback = self._c_change_callback if callback is not None else RRG_CHANGE_CALLBACK()
+            change_filter = RRGChangeFilter(deadband, rate_threshold, int(heartbeat_ms) * 1000, c_callback, None)
+            result = rrg_lib.RRG_SetChangeFilter(ctypes.byref(self._handle), ctypes.byref(change_filter))
+        if result != 0:
+            logger.error("Failed to set the change filter. Error: %s", self.get_last_error())
+            return False
+        self._change_callback = callback
+        return True
+
+    def _on_change(self, change, _user_data) -> None:
+        """
+        @brief Trampoline called by the acquisition thread for every reported change.
+        """
+        callback = self._change_callback
+        if callback is None:
+            return
+        change = change.contents
+        try:
+            callback(change.t_ns, change.flow, change.status, change.rate, change.reasons)
+        except Exception:
+            logger.exception("Change callback failed.")
+
+    def set_interlock(self, fault_mask, max_failed_reads: int = 0, fault_period_us: int = 0, relay=None) -> bool:
+        """
+        @brief Watches the status register in the next acquisitions and shuts off on a fault.
+        @details The C acquisition thread also reads register 2101 and trips once per fault, when a
+        bit of fault_mask is set or after max_failed_reads failed reads in a row, until a clean read
+        re-arms it. The relay is turned off in C on that thread: no Python runs between the read
+        and the shutoff. The acquisition must be stopped.
+        @param fault_mask RRG_STATUS_* bits that trip the interlock, or None to remove the interlock.
+        @param max_failed_reads Consecutive failed reads that trip the interlock (0 = off).
+        @param fault_period_us Sampling period while a fault is suspected (0 = the normal period).
+        @param relay Optional open Relay turned off on a trip; keep it open while the interlock is set.
+        @return True on success, False otherwise.
+        """
+        if fault_mask is None:
+            result = rrg_lib.RRG_SetInterlock(ctypes.byref(self._handle), None)
+        else:
+            action, target = relay.c_turn_off() if relay is not None else (None, None)
+            interlock = RRGInterlock(fault_mask, max_failed_reads, fault_period_us,
+                                     ctypes.cast(action, RRG_INTERLOCK_ACTION) if action else RRG_INTERLOCK_ACTION(),
+                                     target)
+            result = rrg_lib.RRG_SetInterlock(ctypes.byref(self._handle), ctypes.byref(interlock))
+        if result != 0:
+            logger.error("Failed to set the interlock. Error: %s", self.get_last_error())
+            return False
+        self._interlock_relay = relay
+        return True
+
+    def get_interlock_status(self) -> dict:
+        """
+        @brief Returns the state of the interlock and its fault-to-shutoff latencies.
+        @return A dictionary of the RRGInterlockStatus fields; "latency" holds count, mean_us, p50_us and p99_us.
+        """
+        status = RRGInterlockStatus()
+        rrg_lib.RRG_GetInterlockStatus(ctypes.byref(self._handle), ctypes.byref(status))
+        result = {name: getattr(status, name) for name, _ in RRGInterlockStatus._fields_ if name != "latency"}
+        histogram = status.latency
+        result["latency"] = {
+            "count": histogram.count,
+            "mean_us": histogram.total_us / histogram.count if histogram.count else 0.0,
+            "p50_us": latency_percentile_us(histogram, 0.50),
+            "p99_us": latency_percentile_us(histogram, 0.99),
+        }
+        return result
+
+    def drain_change_array(self, max_changes: int = RRG_DEFAULT_CHANGE_CAPACITY) -> np.ndarray:
+        """
+        @brief Retrieves the changes reported since the last call in one C call (see set_change_filter()).
+        @details Like drain_sample_array(), the result is a view of a reused buffer, valid until the next call.
+        @param max_changes Maximum number of changes to retrieve; the default drains the whole ring.
+        @return A structured array of RRG_FLOW_CHANGE_DTYPE records (t_ns, flow, status, rate, reasons).
+        """
+        if self._change_buffer is None or len(self._change_buffer) < max_changes:
+            self._change_buffer = (RRGFlowChange * max_changes)()
+            self._change_array = np.frombuffer(self._change_buffer, dtype=RRG_FLOW_CHANGE_DTYPE)
+        count = rrg_lib.RRG_DrainChanges(ctypes.byref(self._handle), self._change_buffer, c_int(max_changes))
+        if count < 0:
+            logger.error("Failed to drain changes. Error: %s", self.get_last_error())
+            count = 0
+        return self._change_array[:count]
+
+    def get_dropped_changes(self) -> int:
+        """
+        @brief Returns how many changes were dropped because the C change ring was full.
+        """
+        return rrg_lib.RRG_GetDroppedChanges(ctypes.byref(self._handle))
+
+    def start_ramp(self, points, tick_us: int, linear: bool = True, read_every: int = 1) -> bool:
+        """
+        @brief Streams a setpoint profile from a C thread ticking every tick_us microseconds.
+        @details The thread writes the setpoint of the profile on a fixed grid of absolute
+        deadlines and reads the flow back every read_every ticks; drain the ticks with
+        drain_ramp_ticks() and follow the tracking error with get_ramp_status().
+        @param points Sequence of (t_s, setpoint) pairs with increasing times in seconds from the start.
+        @param tick_us Control tick in microseconds.
+        @param linear True to interpolate between the points, False to hold each one until the next.
+        @param read_every Ticks between two flow reads (0: never read).
+        @return True if the ramp is started, False otherwise.
+        """
+        table = (RRGRampPoint * len(points))(*[RRGRampPoint(int(round(t * 1e6)), setpoint)
+                                                for t, setpoint in points])
+        profile = RRGRampProfile(table, len(points), RRG_RAMP_LINEAR if linear else RRG_RAMP_STEP, read_every)
+        logger.info("Starting a %d-point setpoint ramp with tick %d us.", len(points), tick_us)
+        result = rrg_lib.RRG_StartRamp(ctypes.byref(self._handle), ctypes.byref(profile), c_int(tick_us))
+        if result != 0:
+            logger.error("Failed to start the ramp. Error: %s", self.get_last_error())
+        return result == 0
+
+    def stop_ramp(self) -> None:
+        """
+        @brief Stops the ramp thread; the regulator keeps the last setpoint written.
+        """
+        rrg_lib.RRG_StopRamp(ctypes.byref(self._handle))
+
+    def get_ramp_status(self) -> dict:
+        """
+        @brief Returns the progress and tracking statistics of the current (or last) ramp.
+        """
+        status = RRGRampStatus()
+        rrg_lib.RRG_GetRampStatus(ctypes.byref(self._handle), ctypes.byref(status))
+        return {name: getattr(status, name) for name, _ in RRGRampStatus._fields_}
+
+    def drain_ramp_ticks(self, max_ticks: int = RRG_DEFAULT_RAMP_CAPACITY) -> np.ndarray:
+        """
+        @brief Retrieves the ticks of the ramp run since the last call.
+        @param max_ticks Maximum number of ticks to retrieve; the default drains the whole ring.
+        @return A structured array of RRG_RAMP_TICK_DTYPE records, oldest first.
+        """
+        buffer = (RRGRampTick * max_ticks)()
+        count = rrg_lib.RRG_DrainRampTicks(ctypes.byref(self._handle), buffer, c_int(max_ticks))
+        if count < 0:
+            logger.error("Failed to drain ramp ticks. Error: %s", self.get_last_error())
+            count = 0
+        return np.frombuffer(buffer, dtype=RRG_RAMP_TICK_DTYPE)[:count].copy()
+
+    def add_flow_poll_job(self, poller, period_us: int) -> int:
+        """
+        @brief Adds a job reading the measured flow of this regulator to an MBPoller.
+        @details The poller runs one thread per serial port, so regulators on different adapters
+        are polled in parallel. Convert the registers of its samples with registers_to_flow().
+        @param poller An MBPoller (see src.mb.mb_poller).
+        @param period_us Polling period in microseconds.
+        @return The job ID reported in the samples, or -1 on failure.
+        """
+        if not self._handle.bus:
+            logger.error("Cannot poll a regulator that is not connected.")
+            return -1
+        return poller.add_job(self._handle.bus, self._handle.slave_id, MODBUS_REGISTER_FLOW,
+                              MODBUS_FLOW_REGISTERS_COUNT, period_us)
+
+    def get_stats(self):
+        """
+        @brief Retrieves the performance counters of the handle.
+        @return A dictionary {"traffic": {...}, "latency": {op: {"count", "mean_us", "p50_us", "p99_us"}}},
+                or None on error.
+        """
+        stats = RRGStats()
+        if rrg_lib.RRG_GetStats(ctypes.byref(self._handle), ctypes.byref(stats)) != 0:
+            logger.error("Failed to read the statistics. Error: %s", self.get_last_error())
+            return None
+        return stats_to_dict(stats, RRG_STATS_OPS)
+
+    def reset_stats(self) -> None:
+        """
+        @brief Resets the performance counters of the handle to zero.
+        """
+        rrg_lib.RRG_ResetStats(ctypes.byref(self._handle))
+
     def close(self) -> None:
         """
         @brief Closes the connection to the RRG device and frees resources.
         """
-        if self._handle and self._handle.modbus_ctx:
+        if self._handle and self._handle.bus:
             logger.info("Closing connection to RRG device.")
             rrg_lib.RRG_Close(ctypes.byref(self._handle))
-            self._handle.modbus_ctx = None
             logger.info("Connection closed successfully.")
         else:
             logger.warning("Attempted to close RRG device, but handle is invalid or already closed.")
@@ -235,3 +1045,82 @@ class RRG(IRRG):
         error_str = err_ptr.decode("utf-8") if err_ptr else "Unknown error."
         logger.debug("Retrieved last error: %s", error_str)
         return error_str
+
+    def get_handle_error(self):
+        """
+        @brief Retrieves the last error recorded in the handle by the C library.
+        @return A tuple (error_code, modbus_errno, description).
+        """
+        modbus_errno = c_int(0)
+        error_code = rrg_lib.RRG_GetLastErrorCodeEx(ctypes.byref(self._handle), ctypes.byref(modbus_errno))
+        err_ptr = rrg_lib.RRG_GetLastErrorEx(ctypes.byref(self._handle))
+        error_str = err_ptr.decode("utf-8") if err_ptr else "Unknown error."
+        return error_code, modbus_errno.value, error_str
+
+
+def set_flow_group(regulators, setpoints, broadcast: bool = False, verify: bool = False) -> list:
+    """
+    @brief Sets the flow setpoints of several connected regulators of one bus in one bus transaction.
+    @details The writes go out back to back while the line is held. With broadcast=True and the same
+    setpoint everywhere, a single broadcast frame (slave 0) reaches every slave of the line, so only use it
+    when all of them are regulators. verify=True reads every setpoint back and rewrites the ones that differ.
+    @param regulators The RRG instances of the group, all on the same port.
+    @param setpoints Desired flow of every regulator in SCCM.
+    @param broadcast Whether a setpoint shared by the whole group is broadcast.
+    @param verify Whether the setpoints are read back after the writes.
+    @return The outcome of every regulator (0 on success, otherwise its error code).
+    """
+    count = len(regulators)
+    if count == 0 or count != len(setpoints):
+        raise ValueError("set_flow_group() needs one setpoint per regulator")
+    rrg_lib.RRG_SetFlowGroup.argtypes = [POINTER(POINTER(RRGHandle)), POINTER(c_float), c_int, c_int,
+                                         POINTER(c_int)]
+    rrg_lib.RRG_SetFlowGroup.restype = c_int
+    handles = (POINTER(RRGHandle) * count)(*(ctypes.pointer(rrg._handle) for rrg in regulators))
+    values = (c_float * count)(*setpoints)
+    statuses = (c_int * count)()
+    flags = (RRG_GROUP_BROADCAST if broadcast else 0) | (RRG_GROUP_VERIFY if verify else 0)
+    if rrg_lib.RRG_SetFlowGroup(handles, values, count, flags, statuses) != 0:
+        logger.error("Failed to set the flow of a group of %d regulators.", count)
+    return list(statuses)
+
+
+def get_flow_many(regulators, serial: bool = False) -> tuple:
+    """
+    @brief Reads the measured flow of many connected regulators, on any number of ports, in one call.
+    @details The regulators of a port are read back to back in one bus transaction, and the ports are read
+    at the same time (one after the other with serial=True), so the call lasts about as long as the slowest
+    port.
+    @param regulators The RRG instances to read.
+    @param serial Whether the ports are read one after the other on the calling thread.
+    @return (flows, statuses): the flow of every regulator in SCCM (0.0 if it could not be read) and its
+    outcome (0 on success, otherwise its error code).
+    """
+    count = len(regulators)
+    if count == 0:
+        return [], []
+    rrg_lib.RRG_GetFlowMany.argtypes = [POINTER(POINTER(RRGHandle)), c_int, POINTER(c_float), POINTER(c_int),
+                                        c_int]
+    rrg_lib.RRG_GetFlowMany.restype = c_int
+    handles = (POINTER(RRGHandle) * count)(*(ctypes.pointer(rrg._handle) for rrg in regulators))
+    flows = (c_float * count)()
+    statuses = (c_int * count)()
+    if rrg_lib.RRG_GetFlowMany(handles, count, flows, statuses, RRG_MANY_SERIAL if serial else 0) != 0:
+        logger.error("Failed to read the flow of %d regulators.", count)
+    return list(flows), list(statuses)
+
+
+def add_simulated_regulator(sim, slave_id: int, time_constant_ms: int = 0) -> bool:
+    """
+    @brief Puts a simulated regulator on a simulated line (see src.mb.mb_sim.MBSim).
+    @details Its flow replays the recording loaded with MBSim.load_log() or MBSim.load_recording() and, once
+    a setpoint is written, approaches it as a first-order lag; an RRG connected with the "sim" transport and
+    the name of the line as its port then works as with the hardware.
+    @param sim The open MBSim line.
+    @param slave_id Address of the regulator on the line.
+    @param time_constant_ms Time constant of the flow response in simulated milliseconds.
+    @return True on success, False otherwise.
+    """
+    rrg_lib.RRG_SimAddRegulator.argtypes = [c_void_p, c_int, c_int]
+    rrg_lib.RRG_SimAddRegulator.restype = c_int
+    return rrg_lib.RRG_SimAddRegulator(sim.handle, slave_id, time_constant_ms) == 0